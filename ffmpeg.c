@@ -113,6 +113,7 @@ static const OptionDef options[];
 static const char *last_asked_format = NULL;
 static AVFormatContext *input_files[MAX_FILES];
 static int64_t input_files_ts_offset[MAX_FILES];
+static char *input_files_index_out[MAX_FILES];
 static double *input_files_ts_scale[MAX_FILES] = {NULL};
 static AVCodec **input_codecs = NULL;
 static int nb_input_files = 0;
@@ -189,6 +190,7 @@ static int64_t recording_time = INT64_MAX;
 static int64_t start_time = 0;
 static int64_t recording_timestamp = 0;
 static int64_t input_ts_offset = 0;
+static char *index_out_filename = NULL;
 static int file_overwrite = 0;
 static AVMetadata *metadata;
 static int do_benchmark = 0;
@@ -524,6 +526,7 @@ static int ffmpeg_exit(int ret)
     for(i=0;i<nb_input_files;i++) {
         av_close_input_file(input_files[i]);
         av_free(input_files_ts_scale[i]);
+        av_free(input_files_index_out[i]);
     }
 
     av_free(intra_matrix);
@@ -1433,7 +1436,7 @@ static int output_packet(AVInputStream *ist, int ist_index,
     AVFormatContext *os;
     AVOutputStream *ost;
     int ret, i;
-    int got_picture;
+    int got_picture, got_output = 0;
     AVFrame picture;
     void *buffer_to_free;
     static unsigned int samples_size= 0;
@@ -1465,7 +1468,7 @@ static int output_packet(AVInputStream *ist, int ist_index,
         pkt_pts = av_rescale_q(pkt->pts, ist->st->time_base, AV_TIME_BASE_Q);
 
     //while we have more to decode or while the decoder did output something on EOF
-    while (avpkt.size > 0 || (!pkt && ist->next_pts != ist->pts)) {
+    while (avpkt.size > 0 || (!pkt && got_output)) {
         uint8_t *data_buf, *decoded_data_buf;
         int data_size, decoded_data_size;
     handle_eof:
@@ -1501,6 +1504,7 @@ static int output_packet(AVInputStream *ist, int ist_index,
                 avpkt.data += ret;
                 avpkt.size -= ret;
                 data_size   = ret;
+                got_output  = decoded_data_size > 0;
                 /* Some bug in mpeg audio decoder gives */
                 /* decoded_data_size < 0, it seems they are overflows */
                 if (decoded_data_size <= 0) {
@@ -1523,6 +1527,7 @@ static int output_packet(AVInputStream *ist, int ist_index,
                     ist->st->quality= picture.quality;
                     if (ret < 0)
                         goto fail_decode;
+                    got_output = got_picture;
                     if (!got_picture) {
                         /* no picture yet */
                         goto discard_packet;
@@ -2609,6 +2614,13 @@ static int transcode(AVFormatContext **output_files,
         av_write_trailer(os);
     }
 
+    /* store the seek index gathered while reading the inputs */
+    for(i=0;i<nb_input_files;i++) {
+        if (input_files_index_out[i] &&
+            av_write_index_file(input_files[i], input_files_index_out[i]) < 0)
+            fprintf(stderr, "Could not write index file %s\n", input_files_index_out[i]);
+    }
+
     /* dump report by using the first video and audio streams */
     print_report(output_files, ost_table, nb_ostreams, 1);
 
@@ -3093,6 +3105,8 @@ static void opt_input_file(const char *filename)
         find_codec_or_die(subtitle_codec_name, AVMEDIA_TYPE_SUBTITLE, 0,
                           avcodec_opts[AVMEDIA_TYPE_SUBTITLE]->strict_std_compliance);
     ic->flags |= AVFMT_FLAG_NONBLOCK;
+    if (index_out_filename)
+        ic->flags |= AVFMT_FLAG_GENIDX;
 
     /* open the input file with generic libav function */
     err = av_open_input_file(&ic, filename, file_iformat, 0, ap);
@@ -3229,6 +3243,8 @@ static void opt_input_file(const char *filename)
 
     input_files[nb_input_files] = ic;
     input_files_ts_offset[nb_input_files] = input_ts_offset - (copy_ts ? 0 : timestamp);
+    input_files_index_out[nb_input_files] = index_out_filename;
+    index_out_filename = NULL;
     /* dump the file content */
     if (verbose >= 0)
         dump_format(ic, nb_input_files, filename, 0);
@@ -4080,6 +4096,7 @@ static const OptionDef options[] = {
     { "ss", OPT_FUNC2 | HAS_ARG, {(void*)opt_start_time}, "set the start time offset", "time_off" },
     { "itsoffset", OPT_FUNC2 | HAS_ARG, {(void*)opt_input_ts_offset}, "set the input ts offset", "time_off" },
     { "itsscale", HAS_ARG, {(void*)opt_input_ts_scale}, "set the input ts scale", "stream:scale" },
+    { "write_index", HAS_ARG | OPT_STRING | OPT_EXPERT, {(void*)&index_out_filename}, "write the seek index of the next input file to a file", "filename" },
     { "timestamp", OPT_FUNC2 | HAS_ARG, {(void*)opt_recording_timestamp}, "set the recording timestamp ('now' to set the current time)", "time" },
     { "metadata", OPT_FUNC2 | HAS_ARG, {(void*)opt_metadata}, "add metadata", "string=string" },
     { "dframes", OPT_INT | HAS_ARG, {(void*)&max_frames[AVMEDIA_TYPE_DATA]}, "set the number of data frames to record", "number" },
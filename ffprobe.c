@@ -34,6 +34,7 @@ const int program_birth_year = 2007;
 static int do_show_format  = 0;
 static int do_show_packets = 0;
 static int do_show_streams = 0;
+static char *index_out_filename = NULL;
 
 static int show_value_unit              = 0;
 static int use_value_prefix             = 0;
@@ -154,6 +155,20 @@ static void show_packets(AVFormatContext *fmt_ctx)
         show_packet(fmt_ctx, &pkt);
 }
 
+static void write_index(AVFormatContext *fmt_ctx)
+{
+    AVPacket pkt;
+
+    av_init_packet(&pkt);
+
+    /* the index is built while reading, so go through the whole input */
+    while (!av_read_frame(fmt_ctx, &pkt))
+        av_free_packet(&pkt);
+
+    if (av_write_index_file(fmt_ctx, index_out_filename) < 0)
+        fprintf(stderr, "Could not write index file %s\n", index_out_filename);
+}
+
 static void show_stream(AVFormatContext *fmt_ctx, int stream_idx)
 {
     AVStream *stream = fmt_ctx->streams[stream_idx];
@@ -262,11 +277,17 @@ static int open_input_file(AVFormatContext **fmt_ctx_ptr, const char *filename)
 {
     int err, i;
     AVFormatContext *fmt_ctx;
+    AVFormatParameters fmt_params;
 
     fmt_ctx = avformat_alloc_context();
     set_context_opts(fmt_ctx, avformat_opts, AV_OPT_FLAG_DECODING_PARAM, NULL);
+    if (index_out_filename)
+        fmt_ctx->flags |= AVFMT_FLAG_GENIDX;
 
-    if ((err = av_open_input_file(&fmt_ctx, filename, iformat, 0, NULL)) < 0) {
+    memset(&fmt_params, 0, sizeof(fmt_params));
+    fmt_params.prealloced_context = 1;
+
+    if ((err = av_open_input_file(&fmt_ctx, filename, iformat, 0, &fmt_params)) < 0) {
         print_error(filename, err);
         return err;
     }
@@ -315,6 +336,9 @@ static int probe_file(const char *filename)
     if (do_show_format)
         show_format(fmt_ctx);
 
+    if (index_out_filename)
+        write_index(fmt_ctx);
+
     av_close_input_file(fmt_ctx);
     return 0;
 }
@@ -379,6 +403,7 @@ static const OptionDef options[] = {
     { "show_format",  OPT_BOOL, {(void*)&do_show_format} , "show format/container info" },
     { "show_packets", OPT_BOOL, {(void*)&do_show_packets}, "show packets info" },
     { "show_streams", OPT_BOOL, {(void*)&do_show_streams}, "show streams info" },
+    { "write_index", HAS_ARG | OPT_STRING, {(void*)&index_out_filename}, "write the seek index to a file", "filename" },
     { "default", OPT_FUNC2 | HAS_ARG | OPT_AUDIO | OPT_VIDEO | OPT_EXPERT, {(void*)opt_default}, "generic catch all option", "" },
     { NULL, },
 };
@@ -34,6 +34,7 @@
 #include "libavformat/rtpdec.h"
 #include "libavformat/rtsp.h"
 #include "libavutil/avstring.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/lfg.h"
 #include "libavutil/random_seed.h"
 #include "libavcore/parseutils.h"
@@ -54,6 +55,19 @@
 #include <dlfcn.h>
 #endif
 
+/* the connections are served by several threads, each running its own
+   epoll() loop, when possible */
+#define USE_EPOLL (HAVE_SYS_EPOLL_H && HAVE_PTHREADS)
+#if USE_EPOLL
+#include <pthread.h>
+#include <sys/epoll.h>
+#define LOCK(m)   pthread_mutex_lock(&m)
+#define UNLOCK(m) pthread_mutex_unlock(&m)
+#else
+#define LOCK(m)
+#define UNLOCK(m)
+#endif
+
 #include "cmdutils.h"
 
 const char program_name[] = "FFserver";
@@ -104,6 +118,11 @@ static const char *http_state[] = {
 
 #define SYNC_TIMEOUT (10 * 1000)
 
+#define MAX_WORKERS 64
+#define EPOLL_MAX_EVENTS 256
+
+#define FANOUT_RING_SIZE 512 /* muxed packets kept for the viewers of a stream */
+
 typedef struct RTSPActionServerSetup {
     uint32_t ipaddr;
     char transport_option[512];
@@ -114,6 +133,35 @@ typedef struct {
     int64_t time1, time2;
 } DataRateData;
 
+/* link in an intrusive list of connections */
+typedef struct ConnLink {
+    struct HTTPContext *next;
+    struct HTTPContext **pprev; /* NULL if not in the list */
+} ConnLink;
+
+/* packet muxed once for all the viewers of a stream */
+typedef struct FanOutPacket {
+    int refcount;       /* ring slot and viewers sending it */
+    int key;            /* viewers may start with this packet */
+    int size;
+    uint8_t *data;
+} FanOutPacket;
+
+/* feed reader and muxer shared by the viewers of a stream */
+typedef struct FanOut {
+    int nb_viewers;
+    AVFormatContext *fmt_in;
+    AVFormatContext fmt_ctx;
+    uint8_t *header;
+    int header_size;
+    int got_key_frame;
+    int pending_key;    /* a key frame was muxed without output yet */
+    int key_stream;     /* stream whose key frames viewers start at if there is no video */
+    FanOutPacket *ring[FANOUT_RING_SIZE];
+    int64_t write_seq;  /* number of packets muxed so far */
+    int64_t key_seq;    /* last packet viewers may start with, -1 if none */
+} FanOut;
+
 /* context associated with one connection */
 typedef struct HTTPContext {
     enum HTTPState state;
@@ -177,6 +225,20 @@ typedef struct HTTPContext {
     /* RTP/TCP specific */
     struct HTTPContext *rtsp_c;
     uint8_t *packet_buffer, *packet_buffer_ptr, *packet_buffer_end;
+
+    /* epoll specific */
+    struct HTTPWorker *worker; /* thread serving the connection */
+    ConnLink worker_link;      /* in the connections of the worker */
+    ConnLink ready_link;       /* in the connections to handle */
+    ConnLink wait_link;        /* in the connections waiting for a feed */
+    int ready_events;          /* POLLIN/POLLOUT not exhausted since the last edge */
+    struct pollfd epoll_entry; /* what poll_entry points to */
+    unsigned feed_serial;      /* feed_serial when the write index was read */
+
+    /* shared muxer specific */
+    FanOut *fanout;            /* muxer shared with the other viewers, if any */
+    FanOutPacket *fanout_pkt;  /* packet being sent */
+    int64_t fanout_seq;        /* next packet to send, -1 to wait for a key frame */
 } HTTPContext;
 
 /* each generated stream is described here */
@@ -214,6 +276,8 @@ typedef struct FFStream {
     int prebuffer;      /* Number of millseconds early to start */
     int64_t max_time;      /* Number of milliseconds to run */
     int send_on_key;
+    int no_fanout;      /* give each viewer its own feed reader and muxer */
+    FanOut *fanout;     /* shared muxer new viewers join, if any */
     AVStream *streams[MAX_STREAMS];
     int feed_streams[MAX_STREAMS]; /* index of streams in the feed */
     char feed_filename[1024]; /* file name of the feed storage, or
@@ -241,11 +305,15 @@ typedef struct FFStream {
     int is_feed;         /* true if it is a feed */
     int readonly;        /* True if writing is prohibited to the file */
     int truncate;        /* True if feeder connection truncate the feed file */
+    int in_memory;       /* True if the feed data is kept in memory, not in a file */
+    uint8_t *feed_mem;   /* storage of an in-memory feed */
+    int64_t feed_mem_size;
     int conns_served;
     int64_t bytes_served;
     int64_t feed_max_size;      /* maximum storage size, zero means unlimited */
     int64_t feed_write_index;   /* current write position in feed (it wraps around) */
     int64_t feed_size;          /* current size of feed */
+    unsigned feed_serial;       /* incremented at each write or failure of the feeder */
     struct FFStream *next_feed;
 } FFStream;
 
@@ -264,6 +332,7 @@ static FFStream *first_stream; /* contains all streams, including feeds */
 
 static void new_connection(int server_fd, int is_rtsp);
 static void close_connection(HTTPContext *c);
+static void close_output_streams(AVFormatContext *ctx);
 
 /* HTTP handling */
 static int handle_connection(HTTPContext *c);
@@ -271,6 +340,10 @@ static int http_parse_request(HTTPContext *c);
 static int http_send_data(HTTPContext *c);
 static void compute_status(HTTPContext *c);
 static int open_input_stream(HTTPContext *c, const char *info);
+static void close_input_stream(AVFormatContext *s);
+static int fanout_allowed(HTTPContext *c, const char *info);
+static int fanout_join(HTTPContext *c);
+static void fanout_leave(HTTPContext *c);
 static int http_start_receive_data(HTTPContext *c);
 static int http_receive_data(HTTPContext *c);
 
@@ -313,7 +386,50 @@ static unsigned int nb_connections;
 static uint64_t max_bandwidth = 1000;
 static uint64_t current_bandwidth;
 
-static int64_t cur_time;           // Making this global saves on passing it around everywhere
+
+static unsigned int nb_connections_accepted;
+static int64_t total_bytes_served;
+static DataRateData server_datarate;
+
+static int nb_workers = 1;
+
+#if USE_EPOLL
+/* thread serving a share of the connections */
+typedef struct HTTPWorker {
+    pthread_t thread;
+    int epoll_fd;
+    int wake_fd[2];              /* pipe waking up the thread */
+    int server_fd;               /* listening sockets, first worker only */
+    int rtsp_server_fd;
+    pthread_mutex_t lock;        /* protects incoming and wake_pending */
+    HTTPContext *incoming;       /* new connections handed over by the first worker */
+    int wake_pending;
+    HTTPContext *first_ctx;      /* connections with a socket */
+    HTTPContext *first_rtp;      /* RTP connections, sent by the clock */
+    HTTPContext *ready;          /* connections with new events */
+    HTTPContext *waiting;        /* connections in HTTPSTATE_WAIT_FEED */
+    int64_t last_sweep;
+    /* statistics, written by the thread itself under stats_lock */
+    int nb_connections;
+    int64_t nb_events;
+    int64_t bytes_sent;
+} HTTPWorker;
+
+static HTTPWorker *workers;
+static int next_worker;
+
+/* server_lock protects the connection list, the streams and all the
+   request, feeder and RTSP/RTP processing. The connections streaming to
+   a TCP client run without it, and only take stats_lock to read the
+   write position of their feed, to copy the data of in-memory feeds and
+   to update the counters. fanout_lock
+   protects the rings and the feed readers of the shared muxers; it is
+   taken after server_lock and before stats_lock. */
+static pthread_mutex_t server_lock;
+static pthread_mutex_t stats_lock  = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t log_lock    = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t fanout_lock = PTHREAD_MUTEX_INITIALIZER;
+#endif
 
 static AVLFG random_state;
 
@@ -373,6 +489,7 @@ static void http_vlog(const char *fmt, va_list vargs)
 {
     static int print_prefix = 1;
     if (logfile) {
+        LOCK(log_lock);
         if (print_prefix) {
             char buf[32];
             ctime1(buf);
@@ -381,6 +498,7 @@ static void http_vlog(const char *fmt, va_list vargs)
         print_prefix = strstr(fmt, "\n") != NULL;
         vfprintf(logfile, fmt, vargs);
         fflush(logfile);
+        UNLOCK(log_lock);
     }
 }
 
@@ -414,8 +532,17 @@ static void log_connection(HTTPContext *c)
              c->protocol, (c->http_error ? c->http_error : 200), c->data_count);
 }
 
+/* wall clock in milliseconds; read where it is needed as the worker
+ * threads run their loops independently */
+static int64_t get_cur_time(void)
+{
+    return av_gettime() / 1000;
+}
+
 static void update_datarate(DataRateData *drd, int64_t count)
 {
+    int64_t cur_time = get_cur_time();
+
     if (!drd->time1 && !drd->count1) {
         drd->time1 = drd->time2 = cur_time;
         drd->count1 = drd->count2 = count;
@@ -430,6 +557,8 @@ static void update_datarate(DataRateData *drd, int64_t count)
 /* In bytes per second */
 static int compute_datarate(DataRateData *drd, int64_t count)
 {
+    int64_t cur_time = get_cur_time();
+
     if (cur_time == drd->time1)
         return 0;
 
@@ -446,7 +575,11 @@ static void start_children(FFStream *feed)
         if (feed->child_argv && !feed->pid) {
             feed->pid_start = time(0);
 
+            /* the child logs, so the lock must not be held by
+               another thread when it is forked */
+            LOCK(log_lock);
             feed->pid = fork();
+            UNLOCK(log_lock);
 
             if (feed->pid < 0) {
                 http_log("Unable to create children\n");
@@ -586,19 +719,484 @@ static void start_multicast(void)
     }
 }
 
+/* events a connection waits for on its socket in its current state */
+static int connection_events(HTTPContext *c)
+{
+    switch(c->state) {
+    case HTTPSTATE_SEND_HEADER:
+    case RTSPSTATE_SEND_REPLY:
+    case RTSPSTATE_SEND_PACKET:
+        return POLLOUT;
+    case HTTPSTATE_SEND_DATA_HEADER:
+    case HTTPSTATE_SEND_DATA:
+    case HTTPSTATE_SEND_DATA_TRAILER:
+        /* for TCP, we output as much as we can (may need to put a limit),
+           packetized output is sent by the clock */
+        return c->is_packetized ? 0 : POLLOUT;
+    case HTTPSTATE_WAIT_REQUEST:
+    case HTTPSTATE_RECEIVE_DATA:
+    case HTTPSTATE_WAIT_FEED:
+    case RTSPSTATE_WAIT_REQUEST:
+        /* need to catch errors */
+        return POLLIN;/* Maybe this will work */
+    default:
+        return 0;
+    }
+}
+
+/* send() and recv() on the socket of a connection, noting when the
+   kernel runs out of room or data for the edge-triggered epoll loop */
+static int conn_send(HTTPContext *c, const uint8_t *buf, int size)
+{
+    int len = send(c->fd, buf, size, 0);
+
+    if (len < 0 && ff_neterrno() == FF_NETERROR(EAGAIN))
+        c->ready_events &= ~POLLOUT;
+#if USE_EPOLL
+    if (len > 0 && c->worker) {
+        LOCK(stats_lock);
+        c->worker->bytes_sent += len;
+        UNLOCK(stats_lock);
+    }
+#endif
+    return len;
+}
+
+static int conn_recv(HTTPContext *c, uint8_t *buf, int size)
+{
+    int len = recv(c->fd, buf, size, 0);
+
+    if (len < 0 && ff_neterrno() == FF_NETERROR(EAGAIN))
+        c->ready_events &= ~POLLIN;
+    return len;
+}
+
+static void count_bytes_served(HTTPContext *c, int len)
+{
+    LOCK(stats_lock);
+    if (c->stream)
+        c->stream->bytes_served += len;
+    total_bytes_served += len;
+    update_datarate(&server_datarate, total_bytes_served);
+    UNLOCK(stats_lock);
+}
+
+/* the status page reads the counters of the connections of all workers */
+static void count_conn_bytes(HTTPContext *c, int len)
+{
+    LOCK(stats_lock);
+    c->data_count += len;
+    update_datarate(&c->datarate, c->data_count);
+    UNLOCK(stats_lock);
+}
+
+#if USE_EPOLL
+#define WORKER_LINK offsetof(HTTPContext, worker_link)
+#define READY_LINK  offsetof(HTTPContext, ready_link)
+#define WAIT_LINK   offsetof(HTTPContext, wait_link)
+#define CONN_LINK(c, off) ((ConnLink *)((uint8_t *)(c) + (off)))
+
+static void conn_list_add(HTTPContext **list, HTTPContext *c, size_t off)
+{
+    ConnLink *l = CONN_LINK(c, off);
+
+    l->next  = *list;
+    l->pprev = list;
+    if (*list)
+        CONN_LINK(*list, off)->pprev = &l->next;
+    *list = c;
+}
+
+static void conn_list_remove(HTTPContext *c, size_t off)
+{
+    ConnLink *l = CONN_LINK(c, off);
+
+    if (!l->pprev)
+        return;
+    *l->pprev = l->next;
+    if (l->next)
+        CONN_LINK(l->next, off)->pprev = l->pprev;
+    l->next  = NULL;
+    l->pprev = NULL;
+}
+
+static void wake_worker(HTTPWorker *w)
+{
+    int wake;
+
+    pthread_mutex_lock(&w->lock);
+    wake = !w->wake_pending;
+    w->wake_pending = 1;
+    pthread_mutex_unlock(&w->lock);
+    if (wake)
+        write(w->wake_fd[1], "", 1);
+}
+
+/* must be called by the thread of the worker */
+static void worker_attach(HTTPWorker *w, HTTPContext *c)
+{
+    struct epoll_event ev = { 0 };
+
+    c->worker = w;
+    c->poll_entry = &c->epoll_entry;
+    LOCK(stats_lock);
+    w->nb_connections++;
+    UNLOCK(stats_lock);
+    if (c->fd < 0) {
+        conn_list_add(&w->first_rtp, c, WORKER_LINK);
+        return;
+    }
+    conn_list_add(&w->first_ctx, c, WORKER_LINK);
+    ev.events   = EPOLLIN | EPOLLOUT | EPOLLET;
+    ev.data.ptr = c;
+    if (epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, c->fd, &ev) < 0)
+        http_log("epoll_ctl failed: %s\n", strerror(errno));
+}
+
+static void worker_detach(HTTPContext *c)
+{
+    /* the socket may outlive the connection in a forked feeder */
+    if (c->fd >= 0)
+        epoll_ctl(c->worker->epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+    conn_list_remove(c, WORKER_LINK);
+    conn_list_remove(c, READY_LINK);
+    conn_list_remove(c, WAIT_LINK);
+    LOCK(stats_lock);
+    c->worker->nb_connections--;
+    UNLOCK(stats_lock);
+}
+
+/* give a new connection to a worker, from the first worker */
+static void worker_add_connection(HTTPWorker *w, HTTPContext *c)
+{
+    if (w == workers) {
+        worker_attach(w, c);
+        return;
+    }
+    pthread_mutex_lock(&w->lock);
+    conn_list_add(&w->incoming, c, WORKER_LINK);
+    pthread_mutex_unlock(&w->lock);
+    wake_worker(w);
+}
+
+static void worker_queue(HTTPContext *c)
+{
+    if (!c->ready_link.pprev)
+        conn_list_add(&c->worker->ready, c, READY_LINK);
+}
+
+/* true if the events already seen let the connection make progress */
+static int conn_runnable(HTTPContext *c)
+{
+    int events = connection_events(c);
+
+    return events && (c->ready_events & (events | POLLERR | POLLHUP));
+}
+
+static void conn_set_revents(HTTPContext *c)
+{
+    int revents = c->ready_events & (connection_events(c) | POLLERR | POLLHUP);
+    uint8_t byte;
+
+    /* POLLIN may date from the request, while only a hangup or
+       unexpected data must end the wait for the feed */
+    if (revents & POLLIN && c->state == HTTPSTATE_WAIT_FEED &&
+        recv(c->fd, &byte, 1, MSG_PEEK) < 0 &&
+        ff_neterrno() == FF_NETERROR(EAGAIN)) {
+        c->ready_events &= ~POLLIN;
+        revents &= ~POLLIN;
+    }
+    c->epoll_entry.revents = revents;
+}
+
+/* wait for the feed of a connection in HTTPSTATE_WAIT_FEED, unless it
+   has been written since the connection read its write index */
+static void worker_wait_feed(HTTPContext *c)
+{
+    FFStream *feed = c->stream->feed;
+    int changed;
+
+    LOCK(stats_lock);
+    changed = c->feed_serial != feed->feed_serial;
+    UNLOCK(stats_lock);
+
+    if (!changed) {
+        if (!c->wait_link.pprev)
+            conn_list_add(&c->worker->waiting, c, WAIT_LINK);
+        return;
+    }
+    conn_list_remove(c, WAIT_LINK);
+    c->state = feed->feed_opened ? HTTPSTATE_SEND_DATA : HTTPSTATE_SEND_DATA_TRAILER;
+    if (conn_runnable(c))
+        worker_queue(c);
+}
+
+static void worker_wake_up(HTTPWorker *w)
+{
+    HTTPContext *c, *c_next, *incoming;
+    char buf[64];
+
+    while (read(w->wake_fd[0], buf, sizeof(buf)) > 0);
+
+    pthread_mutex_lock(&w->lock);
+    w->wake_pending = 0;
+    incoming = w->incoming;
+    w->incoming = NULL;
+    pthread_mutex_unlock(&w->lock);
+
+    if (incoming)
+        incoming->worker_link.pprev = &incoming;
+    while ((c = incoming)) {
+        conn_list_remove(c, WORKER_LINK);
+        worker_attach(w, c);
+    }
+
+    /* a feed may have been written */
+    for (c = w->waiting; c; c = c_next) {
+        c_next = c->wait_link.next;
+        if (c->state == HTTPSTATE_WAIT_FEED)
+            worker_wait_feed(c);
+        else
+            conn_list_remove(c, WAIT_LINK);
+    }
+}
+
+/* Streaming to a TCP client only touches the connection itself, all
+   the other states may touch other connections or the streams. */
+static int needs_server_lock(HTTPContext *c)
+{
+    if (c->is_packetized)
+        return 1;
+    switch(c->state) {
+    case HTTPSTATE_SEND_HEADER:
+    case HTTPSTATE_SEND_DATA:
+    case HTTPSTATE_SEND_DATA_TRAILER:
+    case HTTPSTATE_WAIT_FEED:
+        return 0;
+    default:
+        return 1;
+    }
+}
+
+/* handle a connection, with the events seen on its socket if events is set */
+static void worker_handle(HTTPContext *c, int events)
+{
+    int locked = needs_server_lock(c);
+
+    if (events)
+        conn_set_revents(c);
+    else
+        c->epoll_entry.revents = 0;
+
+    if (locked)
+        LOCK(server_lock);
+    if (handle_connection(c) < 0) {
+        /* close and free the connection */
+        if (!locked)
+            LOCK(server_lock);
+        log_connection(c);
+        close_connection(c);
+        UNLOCK(server_lock);
+        return;
+    }
+    if (locked)
+        UNLOCK(server_lock);
+
+    if (c->state == HTTPSTATE_WAIT_FEED)
+        worker_wait_feed(c);
+    else if (conn_runnable(c))
+        worker_queue(c);
+    /* RTP over TCP may have given some data to the RTSP connection */
+    if (c->rtsp_c && conn_runnable(c->rtsp_c))
+        worker_queue(c->rtsp_c);
+}
+
+/* main loop of a worker */
+static int worker_loop(HTTPWorker *w)
+{
+    struct epoll_event events[EPOLL_MAX_EVENTS];
+    HTTPContext *c, *c_next, *ready;
+    int64_t cur_time;
+    int i, n, delay;
+
+    for(;;) {
+        /* wait for an event on one connection. We wake up at least every
+           second to handle timeouts, and every 10 ms to send RTP */
+        delay = w->ready ? 0 : w->first_rtp ? 10 : 1000;
+        n = epoll_wait(w->epoll_fd, events, EPOLL_MAX_EVENTS, delay);
+        if (n < 0) {
+            if (ff_neterrno() != FF_NETERROR(EINTR))
+                return -1;
+            n = 0;
+        }
+
+        LOCK(stats_lock);
+        w->nb_events += n;
+        UNLOCK(stats_lock);
+
+        for (i = 0; i < n; i++) {
+            void *ptr = events[i].data.ptr;
+            int ev = events[i].events;
+
+            if (ptr == w->wake_fd) {
+                worker_wake_up(w);
+            } else if (ptr == &w->server_fd || ptr == &w->rtsp_server_fd) {
+                /* new HTTP or RTSP connection request */
+                LOCK(server_lock);
+                new_connection(*(int *)ptr, ptr == &w->rtsp_server_fd);
+                UNLOCK(server_lock);
+            } else {
+                c = ptr;
+                if (ev & EPOLLIN)
+                    c->ready_events |= POLLIN;
+                if (ev & EPOLLOUT)
+                    c->ready_events |= POLLOUT;
+                if (ev & EPOLLERR)
+                    c->ready_events |= POLLERR;
+                if (ev & EPOLLHUP)
+                    c->ready_events |= POLLHUP;
+                worker_queue(c);
+            }
+        }
+
+        if (w == workers && need_to_start_children) {
+            need_to_start_children = 0;
+            LOCK(server_lock);
+            start_children(first_feed);
+            UNLOCK(server_lock);
+        }
+
+        /* now handle the events */
+        ready = w->ready;
+        w->ready = NULL;
+        if (ready)
+            ready->ready_link.pprev = &ready;
+        while ((c = ready)) {
+            conn_list_remove(c, READY_LINK);
+            worker_handle(c, 1);
+        }
+
+        for (c = w->first_rtp; c; c = c_next) {
+            c_next = c->worker_link.next;
+            worker_handle(c, 0);
+        }
+
+        /* only the requests time out */
+        cur_time = get_cur_time();
+        if (cur_time - w->last_sweep >= 1000) {
+            w->last_sweep = cur_time;
+            for (c = w->first_ctx; c; c = c_next) {
+                c_next = c->worker_link.next;
+                if (c->state == HTTPSTATE_WAIT_REQUEST ||
+                    c->state == RTSPSTATE_WAIT_REQUEST)
+                    worker_handle(c, 0);
+            }
+        }
+    }
+}
+
+static void *worker_thread(void *arg)
+{
+    if (worker_loop(arg) < 0) {
+        http_log("epoll_wait failed: %s\n", strerror(errno));
+        exit(1);
+    }
+    return NULL;
+}
+
+static int add_server_fd(HTTPWorker *w, int *fd)
+{
+    struct epoll_event ev = { 0 };
+
+    if (!*fd)
+        return 0;
+    ev.events   = EPOLLIN;
+    ev.data.ptr = fd;
+    return epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, *fd, &ev);
+}
+
+static int init_workers(int server_fd, int rtsp_server_fd)
+{
+    struct epoll_event ev = { 0 };
+    int i;
+
+    workers = av_mallocz(nb_workers * sizeof(*workers));
+    if (!workers)
+        return -1;
+
+    for (i = 0; i < nb_workers; i++) {
+        HTTPWorker *w = &workers[i];
+
+        w->epoll_fd = epoll_create(nb_max_http_connections);
+        if (w->epoll_fd < 0) {
+            http_log("epoll_create failed: %s\n", strerror(errno));
+            goto fail;
+        }
+        if (pipe(w->wake_fd) < 0) {
+            close(w->epoll_fd);
+            goto fail;
+        }
+        fcntl(w->wake_fd[0], F_SETFL, O_NONBLOCK);
+        pthread_mutex_init(&w->lock, NULL);
+        ev.events   = EPOLLIN;
+        ev.data.ptr = w->wake_fd;
+        epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, w->wake_fd[0], &ev);
+    }
+
+    /* the first worker accepts the connections, and keeps RTSP and RTP */
+    workers->server_fd      = server_fd;
+    workers->rtsp_server_fd = rtsp_server_fd;
+    if (add_server_fd(workers, &workers->server_fd) < 0 ||
+        add_server_fd(workers, &workers->rtsp_server_fd) < 0)
+        goto fail;
+    return 0;
+
+ fail:
+    while (i--) {
+        close(workers[i].epoll_fd);
+        close(workers[i].wake_fd[0]);
+        close(workers[i].wake_fd[1]);
+        pthread_mutex_destroy(&workers[i].lock);
+    }
+    av_freep(&workers);
+    return -1;
+}
+#endif
+
+/* wake up the connections waiting for data from a feed, or for its end
+   if the feeder failed */
+static void wake_feed_connections(FFStream *feed, enum HTTPState state)
+{
+    HTTPContext *c1;
+
+    LOCK(stats_lock);
+    feed->feed_serial++;
+    UNLOCK(stats_lock);
+
+#if USE_EPOLL
+    if (workers) {
+        /* each worker moves its own connections, see worker_wait_feed() */
+        int i;
+        for (i = 0; i < nb_workers; i++)
+            wake_worker(&workers[i]);
+        return;
+    }
+#endif
+    for(c1 = first_http_ctx; c1 != NULL; c1 = c1->next) {
+        if (c1->state == HTTPSTATE_WAIT_FEED &&
+            c1->stream->feed == feed)
+            c1->state = state;
+    }
+}
+
 /* main loop of the http server */
 static int http_server(void)
 {
     int server_fd = 0, rtsp_server_fd = 0;
-    int ret, delay, delay1;
+    int ret, delay, events;
     struct pollfd *poll_table, *poll_entry;
     HTTPContext *c, *c_next;
 
-    if(!(poll_table = av_mallocz((nb_max_http_connections + 2)*sizeof(*poll_table)))) {
-        http_log("Impossible to allocate a poll table handling %d connections.\n", nb_max_http_connections);
-        return -1;
-    }
-
     if (my_http_addr.sin_port) {
         server_fd = socket_open_listen(&my_http_addr);
         if (server_fd < 0)
@@ -618,6 +1216,40 @@ static int http_server(void)
 
     http_log("FFserver started.\n");
 
+#if USE_EPOLL
+    {
+        pthread_mutexattr_t attr;
+        int i;
+
+        /* the streaming code takes it again in locked states */
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&server_lock, &attr);
+        pthread_mutexattr_destroy(&attr);
+
+        if (init_workers(server_fd, rtsp_server_fd) >= 0) {
+            start_children(first_feed);
+
+            start_multicast();
+
+            for (i = 1; i < nb_workers; i++) {
+                if (pthread_create(&workers[i].thread, NULL, worker_thread, &workers[i])) {
+                    http_log("Could only start %d workers.\n", i);
+                    nb_workers = i;
+                    break;
+                }
+            }
+            return worker_loop(workers);
+        }
+        http_log("Falling back to poll().\n");
+    }
+#endif
+
+    if(!(poll_table = av_mallocz((nb_max_http_connections + 2)*sizeof(*poll_table)))) {
+        http_log("Impossible to allocate a poll table handling %d connections.\n", nb_max_http_connections);
+        return -1;
+    }
+
     start_children(first_feed);
 
     start_multicast();
@@ -639,48 +1271,19 @@ static int http_server(void)
         c = first_http_ctx;
         delay = 1000;
         while (c != NULL) {
-            int fd;
-            fd = c->fd;
-            switch(c->state) {
-            case HTTPSTATE_SEND_HEADER:
-            case RTSPSTATE_SEND_REPLY:
-            case RTSPSTATE_SEND_PACKET:
+            events = connection_events(c);
+            if (events) {
                 c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLOUT;
+                poll_entry->fd = c->fd;
+                poll_entry->events = events;
                 poll_entry++;
-                break;
-            case HTTPSTATE_SEND_DATA_HEADER:
-            case HTTPSTATE_SEND_DATA:
-            case HTTPSTATE_SEND_DATA_TRAILER:
-                if (!c->is_packetized) {
-                    /* for TCP, we output as much as we can (may need to put a limit) */
-                    c->poll_entry = poll_entry;
-                    poll_entry->fd = fd;
-                    poll_entry->events = POLLOUT;
-                    poll_entry++;
-                } else {
-                    /* when ffserver is doing the timing, we work by
-                       looking at which packet need to be sent every
-                       10 ms */
-                    delay1 = 10; /* one tick wait XXX: 10 ms assumed */
-                    if (delay1 < delay)
-                        delay = delay1;
-                }
-                break;
-            case HTTPSTATE_WAIT_REQUEST:
-            case HTTPSTATE_RECEIVE_DATA:
-            case HTTPSTATE_WAIT_FEED:
-            case RTSPSTATE_WAIT_REQUEST:
-                /* need to catch errors */
-                c->poll_entry = poll_entry;
-                poll_entry->fd = fd;
-                poll_entry->events = POLLIN;/* Maybe this will work */
-                poll_entry++;
-                break;
-            default:
+            } else {
                 c->poll_entry = NULL;
-                break;
+                /* when ffserver is doing the timing, we work by
+                   looking at which packet need to be sent every
+                   10 ms */
+                if (c->state != HTTPSTATE_READY)
+                    delay = 10; /* one tick wait XXX: 10 ms assumed */
             }
             c = c->next;
         }
@@ -694,8 +1297,6 @@ static int http_server(void)
                 return -1;
         } while (ret < 0);
 
-        cur_time = av_gettime() / 1000;
-
         if (need_to_start_children) {
             need_to_start_children = 0;
             start_children(first_feed);
@@ -733,10 +1334,10 @@ static void start_wait_request(HTTPContext *c, int is_rtsp)
     c->buffer_end = c->buffer + c->buffer_size - 1; /* leave room for '\0' */
 
     if (is_rtsp) {
-        c->timeout = cur_time + RTSP_REQUEST_TIMEOUT;
+        c->timeout = get_cur_time() + RTSP_REQUEST_TIMEOUT;
         c->state = RTSPSTATE_WAIT_REQUEST;
     } else {
-        c->timeout = cur_time + HTTP_REQUEST_TIMEOUT;
+        c->timeout = get_cur_time() + HTTP_REQUEST_TIMEOUT;
         c->state = HTTPSTATE_WAIT_REQUEST;
     }
 }
@@ -793,9 +1394,21 @@ static void new_connection(int server_fd, int is_rtsp)
     c->next = first_http_ctx;
     first_http_ctx = c;
     nb_connections++;
+    nb_connections_accepted++;
 
     start_wait_request(c, is_rtsp);
 
+#if USE_EPOLL
+    if (workers) {
+        /* RTSP connections stay on the first worker with their RTP sessions */
+        HTTPWorker *w = workers;
+        if (!is_rtsp) {
+            w = &workers[next_worker];
+            next_worker = (next_worker + 1) % nb_workers;
+        }
+        worker_add_connection(w, c);
+    }
+#endif
     return;
 
  fail:
@@ -812,7 +1425,11 @@ static void close_connection(HTTPContext *c)
     int i, nb_streams;
     AVFormatContext *ctx;
     URLContext *h;
-    AVStream *st;
+
+#if USE_EPOLL
+    if (c->worker)
+        worker_detach(c);
+#endif
 
     /* remove connection from list */
     cp = &first_http_ctx;
@@ -833,15 +1450,10 @@ static void close_connection(HTTPContext *c)
     /* remove connection associated resources */
     if (c->fd >= 0)
         closesocket(c->fd);
-    if (c->fmt_in) {
-        /* close each frame parser */
-        for(i=0;i<c->fmt_in->nb_streams;i++) {
-            st = c->fmt_in->streams[i];
-            if (st->codec->codec)
-                avcodec_close(st->codec);
-        }
-        av_close_input_file(c->fmt_in);
-    }
+    if (c->fmt_in)
+        close_input_stream(c->fmt_in);
+    if (c->fanout)
+        fanout_leave(c);
 
     /* free RTP output streams if any */
     nb_streams = 0;
@@ -874,8 +1486,7 @@ static void close_connection(HTTPContext *c)
         }
     }
 
-    for(i=0; i<ctx->nb_streams; i++)
-        av_free(ctx->streams[i]);
+    close_output_streams(ctx);
 
     if (c->stream && !c->post && c->stream->stream_type == STREAM_TYPE_LIVE)
         current_bandwidth -= c->stream->bandwidth;
@@ -883,7 +1494,8 @@ static void close_connection(HTTPContext *c)
     /* signal that there is no feed if we are the feeder socket */
     if (c->state == HTTPSTATE_RECEIVE_DATA && c->stream) {
         c->stream->feed_opened = 0;
-        close(c->feed_fd);
+        if (c->feed_fd >= 0)
+            close(c->feed_fd);
     }
 
     av_freep(&c->pb_buffer);
@@ -901,7 +1513,7 @@ static int handle_connection(HTTPContext *c)
     case HTTPSTATE_WAIT_REQUEST:
     case RTSPSTATE_WAIT_REQUEST:
         /* timeout ? */
-        if ((c->timeout - cur_time) < 0)
+        if ((c->timeout - get_cur_time()) < 0)
             return -1;
         if (c->poll_entry->revents & (POLLERR | POLLHUP))
             return -1;
@@ -911,7 +1523,7 @@ static int handle_connection(HTTPContext *c)
             return 0;
         /* read the data */
     read_loop:
-        len = recv(c->fd, c->buffer_ptr, 1, 0);
+        len = conn_recv(c, c->buffer_ptr, 1);
         if (len < 0) {
             if (ff_neterrno() != FF_NETERROR(EAGAIN) &&
                 ff_neterrno() != FF_NETERROR(EINTR))
@@ -947,7 +1559,7 @@ static int handle_connection(HTTPContext *c)
         /* no need to write if no events */
         if (!(c->poll_entry->revents & POLLOUT))
             return 0;
-        len = send(c->fd, c->buffer_ptr, c->buffer_end - c->buffer_ptr, 0);
+        len = conn_send(c, c->buffer_ptr, c->buffer_end - c->buffer_ptr);
         if (len < 0) {
             if (ff_neterrno() != FF_NETERROR(EAGAIN) &&
                 ff_neterrno() != FF_NETERROR(EINTR)) {
@@ -957,9 +1569,8 @@ static int handle_connection(HTTPContext *c)
             }
         } else {
             c->buffer_ptr += len;
-            if (c->stream)
-                c->stream->bytes_served += len;
-            c->data_count += len;
+            count_bytes_served(c, len);
+            count_conn_bytes(c, len);
             if (c->buffer_ptr >= c->buffer_end) {
                 av_freep(&c->pb_buffer);
                 /* if error, exit */
@@ -1017,7 +1628,7 @@ static int handle_connection(HTTPContext *c)
         /* no need to write if no events */
         if (!(c->poll_entry->revents & POLLOUT))
             return 0;
-        len = send(c->fd, c->buffer_ptr, c->buffer_end - c->buffer_ptr, 0);
+        len = conn_send(c, c->buffer_ptr, c->buffer_end - c->buffer_ptr);
         if (len < 0) {
             if (ff_neterrno() != FF_NETERROR(EAGAIN) &&
                 ff_neterrno() != FF_NETERROR(EINTR)) {
@@ -1027,7 +1638,7 @@ static int handle_connection(HTTPContext *c)
             }
         } else {
             c->buffer_ptr += len;
-            c->data_count += len;
+            count_conn_bytes(c, len);
             if (c->buffer_ptr >= c->buffer_end) {
                 /* all the buffer was sent : wait for a new request */
                 av_freep(&c->pb_buffer);
@@ -1043,8 +1654,8 @@ static int handle_connection(HTTPContext *c)
         /* no need to write if no events */
         if (!(c->poll_entry->revents & POLLOUT))
             return 0;
-        len = send(c->fd, c->packet_buffer_ptr,
-                    c->packet_buffer_end - c->packet_buffer_ptr, 0);
+        len = conn_send(c, c->packet_buffer_ptr,
+                        c->packet_buffer_end - c->packet_buffer_ptr);
         if (len < 0) {
             if (ff_neterrno() != FF_NETERROR(EAGAIN) &&
                 ff_neterrno() != FF_NETERROR(EINTR)) {
@@ -1809,8 +2420,9 @@ static int http_parse_request(HTTPContext *c)
     if (c->stream->stream_type == STREAM_TYPE_STATUS)
         goto send_status;
 
-    /* open input stream */
-    if (open_input_stream(c, info) < 0) {
+    /* open input stream, or share the one of the other viewers */
+    if (fanout_allowed(c, info) ? fanout_join(c) < 0 :
+                                  open_input_stream(c, info) < 0) {
         snprintf(msg, sizeof(msg), "Input stream corresponding to '%s' not found", url);
         goto send_error;
     }
@@ -1880,7 +2492,8 @@ static void compute_status(HTTPContext *c)
     FFStream *stream;
     char *p;
     time_t ti;
-    int i, len;
+    int i, len, datarate;
+    int64_t bytes_served;
     ByteIOContext *pb;
 
     if (url_open_dyn_buf(&pb) < 0) {
@@ -2068,6 +2681,39 @@ static void compute_status(HTTPContext *c)
     url_fprintf(pb, "Bandwidth in use: %"PRIu64"k / %"PRIu64"k<br>\n",
                  current_bandwidth, max_bandwidth);
 
+    url_fprintf(pb, "Connections accepted: %u<br>\n", nb_connections_accepted);
+
+    LOCK(stats_lock);
+    bytes_served = total_bytes_served;
+    datarate = compute_datarate(&server_datarate, total_bytes_served);
+    UNLOCK(stats_lock);
+    url_fprintf(pb, "Bytes served: ");
+    fmt_bytecount(pb, bytes_served);
+    url_fprintf(pb, ", throughput: ");
+    fmt_bytecount(pb, datarate * 8LL);
+    url_fprintf(pb, "bits/sec<br>\n");
+
+#if USE_EPOLL
+    if (workers) {
+        url_fprintf(pb, "<table>\n");
+        url_fprintf(pb, "<tr><th>Worker<th>Connections<th>Events<th>Bytes sent\n");
+        for (i = 0; i < nb_workers; i++) {
+            int nb_conns;
+            int64_t nb_events;
+            LOCK(stats_lock);
+            nb_conns      = workers[i].nb_connections;
+            nb_events     = workers[i].nb_events;
+            bytes_served  = workers[i].bytes_sent;
+            UNLOCK(stats_lock);
+            url_fprintf(pb, "<tr><td><b>%d</b><td align=right>%d<td align=right>%"PRId64"<td align=right>",
+                        i, nb_conns, nb_events);
+            fmt_bytecount(pb, bytes_served);
+            url_fprintf(pb, "\n");
+        }
+        url_fprintf(pb, "</table>\n");
+    }
+#endif
+
     url_fprintf(pb, "<table>\n");
     url_fprintf(pb, "<tr><th>#<th>File<th>IP<th>Proto<th>State<th>Target bits/sec<th>Actual bits/sec<th>Bytes transferred\n");
     c1 = first_http_ctx;
@@ -2076,6 +2722,11 @@ static void compute_status(HTTPContext *c)
         int bitrate;
         int j;
 
+        LOCK(stats_lock);
+        bytes_served = c1->data_count;
+        datarate = compute_datarate(&c1->datarate, c1->data_count);
+        UNLOCK(stats_lock);
+
         bitrate = 0;
         if (c1->stream) {
             for (j = 0; j < c1->stream->nb_streams; j++) {
@@ -2097,9 +2748,9 @@ static void compute_status(HTTPContext *c)
                     http_state[c1->state]);
         fmt_bytecount(pb, bitrate);
         url_fprintf(pb, "<td align=right>");
-        fmt_bytecount(pb, compute_datarate(&c1->datarate, c1->data_count) * 8);
+        fmt_bytecount(pb, datarate * 8LL);
         url_fprintf(pb, "<td align=right>");
-        fmt_bytecount(pb, c1->data_count);
+        fmt_bytecount(pb, bytes_served);
         url_fprintf(pb, "\n");
         c1 = c1->next;
     }
@@ -2132,6 +2783,19 @@ static void open_parser(AVFormatContext *s, int i)
     }
 }
 
+static void close_input_stream(AVFormatContext *s)
+{
+    int i;
+
+    /* close each frame parser */
+    for(i=0;i<s->nb_streams;i++) {
+        AVStream *st = s->streams[i];
+        if (st->codec->codec)
+            avcodec_close(st->codec);
+    }
+    av_close_input_file(s);
+}
+
 static int open_input_stream(HTTPContext *c, const char *info)
 {
     char buf[128];
@@ -2201,7 +2865,7 @@ static int open_input_stream(HTTPContext *c, const char *info)
         av_seek_frame(c->fmt_in, -1, stream_pos, 0);
 #endif
     /* set the start time (needed for maxtime and RTP packet timing) */
-    c->start_time = cur_time;
+    c->start_time = get_cur_time();
     c->first_pts = AV_NOPTS_VALUE;
     return 0;
 }
@@ -2210,7 +2874,7 @@ static int open_input_stream(HTTPContext *c, const char *info)
 static int64_t get_server_clock(HTTPContext *c)
 {
     /* compute current pts value from system time */
-    return (cur_time - c->start_time) * 1000;
+    return (get_cur_time() - c->start_time) * 1000;
 }
 
 /* return the estimated time at which the current packet must be sent
@@ -2230,82 +2894,381 @@ static int64_t get_packet_send_clock(HTTPContext *c)
 }
 
 
-static int http_prepare_data(HTTPContext *c)
+/* free the streams set up by open_output_stream() */
+static void close_output_streams(AVFormatContext *ctx)
 {
-    int i, len, ret;
-    AVFormatContext *ctx;
+    int i;
 
-    av_freep(&c->pb_buffer);
-    switch(c->state) {
-    case HTTPSTATE_SEND_DATA_HEADER:
-        memset(&c->fmt_ctx, 0, sizeof(c->fmt_ctx));
-        av_metadata_set2(&c->fmt_ctx.metadata, "author"   , c->stream->author   , 0);
-        av_metadata_set2(&c->fmt_ctx.metadata, "comment"  , c->stream->comment  , 0);
-        av_metadata_set2(&c->fmt_ctx.metadata, "copyright", c->stream->copyright, 0);
-        av_metadata_set2(&c->fmt_ctx.metadata, "title"    , c->stream->title    , 0);
-
-        for(i=0;i<c->stream->nb_streams;i++) {
-            AVStream *st;
-            AVStream *src;
-            st = av_mallocz(sizeof(AVStream));
-            c->fmt_ctx.streams[i] = st;
-            /* if file or feed, then just take streams from FFStream struct */
-            if (!c->stream->feed ||
-                c->stream->feed == c->stream)
-                src = c->stream->streams[i];
-            else
-                src = c->stream->feed->streams[c->stream->feed_streams[i]];
-
-            *st = *src;
-            st->priv_data = 0;
-            st->codec->frame_number = 0; /* XXX: should be done in
-                                           AVStream, not in codec */
+    for(i=0;i<ctx->nb_streams;i++) {
+        AVCodecContext *codec = ctx->streams[i]->codec;
+        if (codec) {
+            av_freep(&codec->rc_eq);
+            av_freep(&codec->rc_override);
+            av_freep(&codec->intra_matrix);
+            av_freep(&codec->inter_matrix);
+            av_freep(&codec->extradata);
+            av_free(codec);
         }
-        /* set output format parameters */
-        c->fmt_ctx.oformat = c->stream->fmt;
-        c->fmt_ctx.nb_streams = c->stream->nb_streams;
+        av_free(ctx->streams[i]);
+    }
+    ctx->nb_streams = 0;
+}
 
-        c->got_key_frame = 0;
+/* set up ctx to mux stream, and return the size of its header, stored
+   in *pbuf */
+static int open_output_stream(FFStream *stream, AVFormatContext *ctx,
+                              uint8_t **pbuf)
+{
+    int i;
 
-        /* prepare header and save header data in a stream */
-        if (url_open_dyn_buf(&c->fmt_ctx.pb) < 0) {
-            /* XXX: potential leak */
+    memset(ctx, 0, sizeof(*ctx));
+    av_metadata_set2(&ctx->metadata, "author"   , stream->author   , 0);
+    av_metadata_set2(&ctx->metadata, "comment"  , stream->comment  , 0);
+    av_metadata_set2(&ctx->metadata, "copyright", stream->copyright, 0);
+    av_metadata_set2(&ctx->metadata, "title"    , stream->title    , 0);
+
+    for(i=0;i<stream->nb_streams;i++) {
+        AVStream *st;
+        AVStream *src;
+        st = av_mallocz(sizeof(AVStream));
+        if (!st)
             return -1;
-        }
-        c->fmt_ctx.pb->is_streamed = 1;
+        ctx->streams[i] = st;
+        ctx->nb_streams = i + 1;
+        /* if file or feed, then just take streams from FFStream struct */
+        if (!stream->feed ||
+            stream->feed == stream)
+            src = stream->streams[i];
+        else
+            src = stream->feed->streams[stream->feed_streams[i]];
+
+        *st = *src;
+        st->priv_data = 0;
+        /* the muxer updates the codec context, and the viewers of a
+           stream mux from several workers */
+        st->codec = avcodec_alloc_context();
+        if (!st->codec || avcodec_copy_context(st->codec, src->codec) < 0)
+            return -1;
+        st->codec->frame_number = 0; /* XXX: should be done in
+                                       AVStream, not in codec */
+    }
+    /* set output format parameters */
+    ctx->oformat = stream->fmt;
 
-        /*
-         * HACK to avoid mpeg ps muxer to spit many underflow errors
-         * Default value from FFmpeg
-         * Try to set it use configuration option
-         */
-        c->fmt_ctx.preload   = (int)(0.5*AV_TIME_BASE);
-        c->fmt_ctx.max_delay = (int)(0.7*AV_TIME_BASE);
+    /* prepare header and save header data in a stream */
+    if (url_open_dyn_buf(&ctx->pb) < 0) {
+        /* XXX: potential leak */
+        return -1;
+    }
+    ctx->pb->is_streamed = 1;
+
+    /*
+     * HACK to avoid mpeg ps muxer to spit many underflow errors
+     * Default value from FFmpeg
+     * Try to set it use configuration option
+     */
+    ctx->preload   = (int)(0.5*AV_TIME_BASE);
+    ctx->max_delay = (int)(0.7*AV_TIME_BASE);
+
+    av_set_parameters(ctx, NULL);
+    if (av_write_header(ctx) < 0) {
+        http_log("Error writing output header\n");
+        return -1;
+    }
+    av_metadata_free(&ctx->metadata);
+
+    return url_close_dyn_buf(ctx->pb, pbuf);
+}
+
+/*
+ * Shared muxers: the HTTP viewers of a stream coming from a feed share
+ * one feed reader and one muxer. The muxed packets are kept in a ring
+ * that each viewer reads at its own pace, without copying them. Viewers
+ * start, and restart when they are overtaken by the ring, with the last
+ * packet muxed from a key frame.
+ */
 
-        av_set_parameters(&c->fmt_ctx, NULL);
-        if (av_write_header(&c->fmt_ctx) < 0) {
-            http_log("Error writing output header\n");
+static int fanout_allowed(HTTPContext *c, const char *info)
+{
+    FFStream *stream = c->stream;
+    char buf[128];
+
+    /* ffm output depends on where the viewer started, and a start
+       position in the request needs a reader of its own */
+    return stream->feed && stream->feed != stream && !stream->no_fanout &&
+           stream->fmt && strcmp(stream->fmt->name, "ffm") &&
+           !find_info_tag(buf, sizeof(buf), "date", info) &&
+           !find_info_tag(buf, sizeof(buf), "buffer", info);
+}
+
+static void fanout_unref(FanOutPacket *pkt)
+{
+    if (pkt && !--pkt->refcount) {
+        av_free(pkt->data);
+        av_free(pkt);
+    }
+}
+
+static void fanout_free(FanOut *fo)
+{
+    AVFormatContext *ctx = &fo->fmt_ctx;
+    uint8_t *buf;
+    int i;
+
+    if (fo->fmt_in)
+        close_input_stream(fo->fmt_in);
+    /* the trailer frees the muxer */
+    if (fo->header && url_open_dyn_buf(&ctx->pb) >= 0) {
+        av_write_trailer(ctx);
+        url_close_dyn_buf(ctx->pb, &buf);
+        av_free(buf);
+    }
+    close_output_streams(ctx);
+    for(i=0;i<FANOUT_RING_SIZE;i++)
+        fanout_unref(fo->ring[i]);
+    av_free(fo->header);
+    av_free(fo);
+}
+
+/* share the muxer of the stream with c, creating it if needed */
+static int fanout_join(HTTPContext *c)
+{
+    FFStream *stream = c->stream;
+    FanOut *fo = stream->fanout;
+    int i, len;
+
+    if (!fo) {
+        fo = av_mallocz(sizeof(*fo));
+        if (!fo)
+            return -1;
+        if (open_input_stream(c, "") < 0) {
+            av_free(fo);
             return -1;
         }
-        av_metadata_free(&c->fmt_ctx.metadata);
+        fo->fmt_in = c->fmt_in;
+        c->fmt_in = NULL;
+        len = open_output_stream(stream, &fo->fmt_ctx, &fo->header);
+        if (len < 0) {
+            fanout_free(fo);
+            return -1;
+        }
+        fo->header_size = len;
+        fo->key_seq = -1;
+        /* without video, start at the key frames of the first audio stream */
+        for(i=0;i<stream->nb_streams;i++)
+            if (stream->streams[i]->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
+                fo->key_stream = i;
+                break;
+            }
+        for(i=0;i<stream->nb_streams;i++)
+            if (stream->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO)
+                fo->key_stream = -1;
+        stream->fanout = fo;
+    }
+    /* needed for maxtime */
+    c->start_time = get_cur_time();
+    c->fanout = fo;
+    c->fanout_seq = -1;
+    fo->nb_viewers++;
+    return 0;
+}
 
-        len = url_close_dyn_buf(c->fmt_ctx.pb, &c->pb_buffer);
-        c->buffer_ptr = c->pb_buffer;
-        c->buffer_end = c->pb_buffer + len;
+static void fanout_leave(HTTPContext *c)
+{
+    FanOut *fo = c->fanout;
+
+    LOCK(fanout_lock);
+    fanout_unref(c->fanout_pkt);
+    UNLOCK(fanout_lock);
+    c->fanout_pkt = NULL;
+    c->fanout = NULL;
+    if (--fo->nb_viewers)
+        return;
+    if (c->stream->fanout == fo)
+        c->stream->fanout = NULL;
+    fanout_free(fo);
+}
+
+/* mux the next packets of the feed until some output is added to the
+   ring, return 0 at the end of the feed data. Called with fanout_lock
+   held, which covers the muxer and the codec contexts of the FanOut:
+   open_output_stream() gave them their own copies. */
+static int fanout_mux_packet(HTTPContext *c)
+{
+    FanOut *fo = c->fanout;
+    FFStream *stream = c->stream;
+    AVFormatContext *ctx = &fo->fmt_ctx;
+    FanOutPacket *fp;
+    AVPacket pkt;
+    AVStream *ist, *ost;
+    uint8_t *buf;
+    int i, len, ret, slot;
+
+    LOCK(stats_lock);
+    ffm_set_write_index(fo->fmt_in,
+                        stream->feed->feed_write_index,
+                        stream->feed->feed_size);
+    c->feed_serial = stream->feed->feed_serial;
+    UNLOCK(stats_lock);
+
+    for(;;) {
+        if (av_read_frame(fo->fmt_in, &pkt) < 0)
+            return 0;
+        for(i=0;i<stream->nb_streams;i++)
+            if (stream->feed_streams[i] == pkt.stream_index)
+                break;
+        if (i == stream->nb_streams) {
+            av_free_packet(&pkt);
+            continue;
+        }
+        ist = fo->fmt_in->streams[pkt.stream_index];
+        ost = ctx->streams[i];
+        if (pkt.flags & AV_PKT_FLAG_KEY &&
+            (ist->codec->codec_type == AVMEDIA_TYPE_VIDEO ||
+             i == fo->key_stream)) {
+            fo->got_key_frame = 1;
+            fo->pending_key   = 1;
+        }
+        if (stream->send_on_key && !fo->got_key_frame) {
+            av_free_packet(&pkt);
+            continue;
+        }
+
+        if (url_open_dyn_buf(&ctx->pb) < 0) {
+            av_free_packet(&pkt);
+            return AVERROR(ENOMEM);
+        }
+        ctx->pb->is_streamed = 1;
+        pkt.stream_index = i;
+        if (pkt.dts != AV_NOPTS_VALUE)
+            pkt.dts = av_rescale_q(pkt.dts, ist->time_base, ost->time_base);
+        if (pkt.pts != AV_NOPTS_VALUE)
+            pkt.pts = av_rescale_q(pkt.pts, ist->time_base, ost->time_base);
+        pkt.duration = av_rescale_q(pkt.duration, ist->time_base, ost->time_base);
+        ret = av_write_frame(ctx, &pkt);
+        av_free_packet(&pkt);
+        len = url_close_dyn_buf(ctx->pb, &buf);
+        ost->codec->frame_number++;
+        if (ret < 0) {
+            http_log("Error writing frame to output\n");
+            av_free(buf);
+            return ret;
+        }
+        if (len > 0)
+            break;
+        av_free(buf);
+    }
+
+    fp = av_malloc(sizeof(*fp));
+    if (!fp) {
+        av_free(buf);
+        return AVERROR(ENOMEM);
+    }
+    fp->refcount = 1;
+    fp->key      = fo->pending_key;
+    fp->size     = len;
+    fp->data     = buf;
+    fo->pending_key = 0;
+
+    slot = fo->write_seq % FANOUT_RING_SIZE;
+    fanout_unref(fo->ring[slot]);
+    fo->ring[slot] = fp;
+    if (fp->key)
+        fo->key_seq = fo->write_seq;
+    fo->write_seq++;
+    return 1;
+}
+
+/* give the next packet of the shared muxer to c */
+static int fanout_prepare_data(HTTPContext *c)
+{
+    FanOut *fo = c->fanout;
+    FanOutPacket *fp;
+    int ret = 0;
+
+    if (c->stream->max_time &&
+        c->stream->max_time + c->start_time - get_cur_time() < 0) {
+        /* We have timed out */
+        c->state = HTTPSTATE_SEND_DATA_TRAILER;
+        return 0;
+    }
+
+    LOCK(fanout_lock);
+    fanout_unref(c->fanout_pkt);
+    c->fanout_pkt = NULL;
+    for(;;) {
+        /* start, or restart after being overtaken, at the last key frame */
+        if (c->fanout_seq < fo->write_seq - FANOUT_RING_SIZE)
+            c->fanout_seq = -1;
+        if (c->fanout_seq < 0 && fo->key_seq >= 0 &&
+            fo->key_seq >= fo->write_seq - FANOUT_RING_SIZE)
+            c->fanout_seq = fo->key_seq;
+
+        if (c->fanout_seq >= 0 && c->fanout_seq < fo->write_seq) {
+            fp = fo->ring[c->fanout_seq % FANOUT_RING_SIZE];
+            fp->refcount++;
+            c->fanout_pkt = fp;
+            c->fanout_seq++;
+            c->buffer_ptr = fp->data;
+            c->buffer_end = fp->data + fp->size;
+            break;
+        }
+        /* the viewer has caught up with the muxer */
+        if ((ret = fanout_mux_packet(c)) <= 0)
+            break;
+    }
+    UNLOCK(fanout_lock);
+
+    if (ret < 0) {
+        c->state = HTTPSTATE_SEND_DATA_TRAILER;
+    } else if (!c->fanout_pkt) {
+        /* reached the end of the feed data, must wait for more */
+        c->state = HTTPSTATE_WAIT_FEED;
+        return 1; /* state changed */
+    }
+    return 0;
+}
+
+static int http_prepare_data(HTTPContext *c)
+{
+    int i, len, ret;
+    AVFormatContext *ctx;
+
+    av_freep(&c->pb_buffer);
+    switch(c->state) {
+    case HTTPSTATE_SEND_DATA_HEADER:
+        if (c->fanout) {
+            /* the header stays valid as long as the muxer is shared */
+            c->buffer_ptr = c->fanout->header;
+            c->buffer_end = c->fanout->header + c->fanout->header_size;
+        } else {
+            len = open_output_stream(c->stream, &c->fmt_ctx, &c->pb_buffer);
+            if (len < 0)
+                return -1;
+            c->buffer_ptr = c->pb_buffer;
+            c->buffer_end = c->pb_buffer + len;
+            c->got_key_frame = 0;
+        }
 
         c->state = HTTPSTATE_SEND_DATA;
         c->last_packet_sent = 0;
         break;
     case HTTPSTATE_SEND_DATA:
+        if (c->fanout)
+            return fanout_prepare_data(c);
         /* find a new packet */
         /* read a packet from the input stream */
-        if (c->stream->feed)
+        if (c->stream->feed) {
+            LOCK(stats_lock);
             ffm_set_write_index(c->fmt_in,
                                 c->stream->feed->feed_write_index,
                                 c->stream->feed->feed_size);
+            c->feed_serial = c->stream->feed->feed_serial;
+            UNLOCK(stats_lock);
+        }
 
         if (c->stream->max_time &&
-            c->stream->max_time + c->start_time - cur_time < 0)
+            c->stream->max_time + c->start_time - get_cur_time() < 0)
             /* We have timed out */
             c->state = HTTPSTATE_SEND_DATA_TRAILER;
         else {
@@ -2323,9 +3286,12 @@ static int http_prepare_data(HTTPContext *c)
                     return 0;
                 } else {
                     if (c->stream->loop) {
+                        LOCK(server_lock);
                         av_close_input_file(c->fmt_in);
                         c->fmt_in = NULL;
-                        if (open_input_stream(c, "") < 0)
+                        ret = open_input_stream(c, "");
+                        UNLOCK(server_lock);
+                        if (ret < 0)
                             goto no_loop;
                         goto redo;
                     } else {
@@ -2339,12 +3305,13 @@ static int http_prepare_data(HTTPContext *c)
                 /* update first pts if needed */
                 if (c->first_pts == AV_NOPTS_VALUE) {
                     c->first_pts = av_rescale_q(pkt.dts, c->fmt_in->streams[pkt.stream_index]->time_base, AV_TIME_BASE_Q);
-                    c->start_time = cur_time;
+                    c->start_time = get_cur_time();
                 }
                 /* send it to the appropriate stream */
                 if (c->stream->feed) {
                     /* if coming from a feed, select the right stream */
                     if (c->switch_pending) {
+                        LOCK(server_lock);
                         c->switch_pending = 0;
                         for(i=0;i<c->stream->nb_streams;i++) {
                             if (c->switch_feed_streams[i] == pkt.stream_index)
@@ -2353,6 +3320,7 @@ static int http_prepare_data(HTTPContext *c)
                             if (c->switch_feed_streams[i] >= 0)
                                 c->switch_pending = 1;
                         }
+                        UNLOCK(server_lock);
                     }
                     for(i=0;i<c->stream->nb_streams;i++) {
                         if (c->stream->feed_streams[i] == pkt.stream_index) {
@@ -2442,6 +3410,9 @@ static int http_prepare_data(HTTPContext *c)
         /* last packet test ? */
         if (c->last_packet_sent || c->is_packetized)
             return -1;
+        /* the trailer of a shared muxer cannot be sent to one viewer */
+        if (c->fanout)
+            return -1;
         ctx = &c->fmt_ctx;
         /* prepare header */
         if (url_open_dyn_buf(&ctx->pb) < 0) {
@@ -2496,10 +3467,8 @@ static int http_send_data(HTTPContext *c)
                     return 0;
                 }
 
-                c->data_count += len;
-                update_datarate(&c->datarate, c->data_count);
-                if (c->stream)
-                    c->stream->bytes_served += len;
+                count_conn_bytes(c, len);
+                count_bytes_served(c, len);
 
                 if (c->rtp_protocol == RTSP_LOWER_TRANSPORT_TCP) {
                     /* RTP packets are sent inside the RTSP TCP connection */
@@ -2537,8 +3506,8 @@ static int http_send_data(HTTPContext *c)
                     c->buffer_ptr += len;
 
                     /* send everything we can NOW */
-                    len = send(rtsp_c->fd, rtsp_c->packet_buffer_ptr,
-                                rtsp_c->packet_buffer_end - rtsp_c->packet_buffer_ptr, 0);
+                    len = conn_send(rtsp_c, rtsp_c->packet_buffer_ptr,
+                                    rtsp_c->packet_buffer_end - rtsp_c->packet_buffer_ptr);
                     if (len > 0)
                         rtsp_c->packet_buffer_ptr += len;
                     if (rtsp_c->packet_buffer_ptr < rtsp_c->packet_buffer_end) {
@@ -2560,7 +3529,7 @@ static int http_send_data(HTTPContext *c)
                 }
             } else {
                 /* TCP data output */
-                len = send(c->fd, c->buffer_ptr, c->buffer_end - c->buffer_ptr, 0);
+                len = conn_send(c, c->buffer_ptr, c->buffer_end - c->buffer_ptr);
                 if (len < 0) {
                     if (ff_neterrno() != FF_NETERROR(EAGAIN) &&
                         ff_neterrno() != FF_NETERROR(EINTR))
@@ -2571,10 +3540,8 @@ static int http_send_data(HTTPContext *c)
                 } else
                     c->buffer_ptr += len;
 
-                c->data_count += len;
-                update_datarate(&c->datarate, c->data_count);
-                if (c->stream)
-                    c->stream->bytes_served += len;
+                count_conn_bytes(c, len);
+                count_bytes_served(c, len);
                 break;
             }
         }
@@ -2584,6 +3551,7 @@ static int http_send_data(HTTPContext *c)
 
 static int http_start_receive_data(HTTPContext *c)
 {
+    FFStream *stream;
     int fd;
 
     if (c->stream->feed_opened)
@@ -2593,47 +3561,65 @@ static int http_start_receive_data(HTTPContext *c)
     if (c->stream->readonly)
         return -1;
 
-    /* open feed */
-    fd = open(c->stream->feed_filename, O_RDWR);
-    if (fd < 0) {
-        http_log("Error opening feeder file: %s\n", strerror(errno));
-        return -1;
-    }
-    c->feed_fd = fd;
-
-    if (c->stream->truncate) {
-        /* truncate feed file */
-        ffm_write_write_index(c->feed_fd, FFM_PACKET_SIZE);
-        ftruncate(c->feed_fd, FFM_PACKET_SIZE);
-        http_log("Truncating feed file '%s'\n", c->stream->feed_filename);
+    if (c->stream->feed_mem) {
+        /* the data of an in-memory feed stays where the last feeder left it */
+        c->feed_fd = -1;
+        if (c->stream->truncate) {
+            LOCK(stats_lock);
+            c->stream->feed_write_index = FFM_PACKET_SIZE;
+            c->stream->feed_size = FFM_PACKET_SIZE;
+            AV_WB64(c->stream->feed_mem + 8, FFM_PACKET_SIZE);
+            UNLOCK(stats_lock);
+            http_log("Truncating feed '%s'\n", c->stream->filename);
+        }
     } else {
-        if ((c->stream->feed_write_index = ffm_read_write_index(fd)) < 0) {
-            http_log("Error reading write index from feed file: %s\n", strerror(errno));
+        /* open feed */
+        fd = open(c->stream->feed_filename, O_RDWR);
+        if (fd < 0) {
+            http_log("Error opening feeder file: %s\n", strerror(errno));
             return -1;
         }
-    }
+        c->feed_fd = fd;
 
-    c->stream->feed_write_index = FFMAX(ffm_read_write_index(fd), FFM_PACKET_SIZE);
-    c->stream->feed_size = lseek(fd, 0, SEEK_END);
-    lseek(fd, 0, SEEK_SET);
+        if (c->stream->truncate) {
+            /* truncate feed file */
+            ffm_write_write_index(c->feed_fd, FFM_PACKET_SIZE);
+            ftruncate(c->feed_fd, FFM_PACKET_SIZE);
+            http_log("Truncating feed file '%s'\n", c->stream->feed_filename);
+        } else {
+            if ((c->stream->feed_write_index = ffm_read_write_index(fd)) < 0) {
+                http_log("Error reading write index from feed file: %s\n", strerror(errno));
+                return -1;
+            }
+        }
+
+        LOCK(stats_lock);
+        c->stream->feed_write_index = FFMAX(ffm_read_write_index(fd), FFM_PACKET_SIZE);
+        c->stream->feed_size = lseek(fd, 0, SEEK_END);
+        UNLOCK(stats_lock);
+        lseek(fd, 0, SEEK_SET);
+    }
 
     /* init buffer input */
     c->buffer_ptr = c->buffer;
     c->buffer_end = c->buffer + FFM_PACKET_SIZE;
     c->stream->feed_opened = 1;
+    /* new viewers get a new shared muxer, reading the data of this feeder */
+    for (stream = first_stream; stream; stream = stream->next)
+        if (stream->feed == c->stream)
+            stream->fanout = NULL;
     c->chunked_encoding = !!av_stristr(c->buffer, "Transfer-Encoding: chunked");
     return 0;
 }
 
 static int http_receive_data(HTTPContext *c)
 {
-    HTTPContext *c1;
     int len, loop_run = 0;
 
     while (c->chunked_encoding && !c->chunk_size &&
            c->buffer_end > c->buffer_ptr) {
         /* read chunk header, if present */
-        len = recv(c->fd, c->buffer_ptr, 1, 0);
+        len = conn_recv(c, c->buffer_ptr, 1);
 
         if (len < 0) {
             if (ff_neterrno() != FF_NETERROR(EAGAIN) &&
@@ -2660,8 +3646,8 @@ static int http_receive_data(HTTPContext *c)
     }
 
     if (c->buffer_end > c->buffer_ptr) {
-        len = recv(c->fd, c->buffer_ptr,
-                   FFMIN(c->chunk_size, c->buffer_end - c->buffer_ptr), 0);
+        len = conn_recv(c, c->buffer_ptr,
+                        FFMIN(c->chunk_size, c->buffer_end - c->buffer_ptr));
         if (len < 0) {
             if (ff_neterrno() != FF_NETERROR(EAGAIN) &&
                 ff_neterrno() != FF_NETERROR(EINTR))
@@ -2673,8 +3659,7 @@ static int http_receive_data(HTTPContext *c)
         else {
             c->chunk_size -= len;
             c->buffer_ptr += len;
-            c->data_count += len;
-            update_datarate(&c->datarate, c->data_count);
+            count_conn_bytes(c, len);
         }
     }
 
@@ -2693,13 +3678,22 @@ static int http_receive_data(HTTPContext *c)
         if (c->data_count > FFM_PACKET_SIZE) {
 
             //            printf("writing pos=0x%"PRIx64" size=0x%"PRIx64"\n", feed->feed_write_index, feed->feed_size);
-            /* XXX: use llseek or url_seek */
-            lseek(c->feed_fd, feed->feed_write_index, SEEK_SET);
-            if (write(c->feed_fd, c->buffer, FFM_PACKET_SIZE) < 0) {
-                http_log("Error writing to feed file: %s\n", strerror(errno));
-                goto fail;
+            if (feed->feed_mem) {
+                /* the viewers copy from the buffer concurrently */
+                LOCK(stats_lock);
+                memcpy(feed->feed_mem + feed->feed_write_index, c->buffer,
+                       FFM_PACKET_SIZE);
+                UNLOCK(stats_lock);
+            } else {
+                /* XXX: use llseek or url_seek */
+                lseek(c->feed_fd, feed->feed_write_index, SEEK_SET);
+                if (write(c->feed_fd, c->buffer, FFM_PACKET_SIZE) < 0) {
+                    http_log("Error writing to feed file: %s\n", strerror(errno));
+                    goto fail;
+                }
             }
 
+            LOCK(stats_lock);
             feed->feed_write_index += FFM_PACKET_SIZE;
             /* update file size */
             if (feed->feed_write_index > c->stream->feed_size)
@@ -2710,17 +3704,17 @@ static int http_receive_data(HTTPContext *c)
                 feed->feed_write_index = FFM_PACKET_SIZE;
 
             /* write index */
-            if (ffm_write_write_index(c->feed_fd, feed->feed_write_index) < 0) {
+            if (feed->feed_mem)
+                AV_WB64(feed->feed_mem + 8, feed->feed_write_index);
+            UNLOCK(stats_lock);
+            if (!feed->feed_mem &&
+                ffm_write_write_index(c->feed_fd, feed->feed_write_index) < 0) {
                 http_log("Error writing index to feed file: %s\n", strerror(errno));
                 goto fail;
             }
 
             /* wake up any waiting connections */
-            for(c1 = first_http_ctx; c1 != NULL; c1 = c1->next) {
-                if (c1->state == HTTPSTATE_WAIT_FEED &&
-                    c1->stream->feed == c->stream->feed)
-                    c1->state = HTTPSTATE_SEND_DATA;
-            }
+            wake_feed_connections(c->stream->feed, HTTPSTATE_SEND_DATA);
         } else {
             /* We have a header in our hands that contains useful data */
             AVFormatContext *s = NULL;
@@ -2765,13 +3759,10 @@ static int http_receive_data(HTTPContext *c)
     return 0;
  fail:
     c->stream->feed_opened = 0;
-    close(c->feed_fd);
+    if (c->feed_fd >= 0)
+        close(c->feed_fd);
     /* wake up any waiting connections to stop waiting for feed */
-    for(c1 = first_http_ctx; c1 != NULL; c1 = c1->next) {
-        if (c1->state == HTTPSTATE_WAIT_FEED &&
-            c1->stream->feed == c->stream->feed)
-            c1->state = HTTPSTATE_SEND_DATA_TRAILER;
-    }
+    wake_feed_connections(c->stream->feed, HTTPSTATE_SEND_DATA_TRAILER);
     return -1;
 }
 
@@ -3365,6 +4356,10 @@ static HTTPContext *rtp_new_connection(struct sockaddr_in *from_addr,
 
     c->next = first_http_ctx;
     first_http_ctx = c;
+#if USE_EPOLL
+    if (workers)
+        worker_attach(workers, c);
+#endif
     return c;
 
  fail:
@@ -3655,6 +4650,108 @@ static void build_file_streams(void)
     }
 }
 
+/* In-memory feeds keep the layout of a feed file in a buffer of
+   FileMaxSize bytes. The ffm demuxer reads them through the
+   feed: protocol, the feeder connection writes them directly. */
+typedef struct MemoryFeedContext {
+    FFStream *feed;
+    int64_t pos;
+} MemoryFeedContext;
+
+static int memory_feed_open(URLContext *h, const char *url, int flags)
+{
+    MemoryFeedContext *m = h->priv_data;
+    FFStream *feed;
+
+    av_strstart(url, "feed:", &url);
+    for (feed = first_feed; feed; feed = feed->next_feed)
+        if (feed->feed_mem && !strcmp(feed->filename, url))
+            break;
+    if (!feed)
+        return AVERROR(ENOENT);
+    m->feed = feed;
+    return 0;
+}
+
+static int memory_feed_read(URLContext *h, unsigned char *buf, int size)
+{
+    MemoryFeedContext *m = h->priv_data;
+
+    /* the feeder writes the packets and the write index concurrently */
+    LOCK(stats_lock);
+    size = FFMIN(size, m->feed->feed_size - m->pos);
+    if (size > 0)
+        memcpy(buf, m->feed->feed_mem + m->pos, size);
+    UNLOCK(stats_lock);
+
+    if (size <= 0)
+        return 0;
+    m->pos += size;
+    return size;
+}
+
+static int memory_feed_write(URLContext *h, const unsigned char *buf, int size)
+{
+    MemoryFeedContext *m = h->priv_data;
+
+    if (size > m->feed->feed_mem_size - m->pos)
+        return AVERROR(ENOSPC);
+    LOCK(stats_lock);
+    memcpy(m->feed->feed_mem + m->pos, buf, size);
+    m->pos += size;
+    m->feed->feed_size = FFMAX(m->feed->feed_size, m->pos);
+    UNLOCK(stats_lock);
+    return size;
+}
+
+static int64_t memory_feed_seek(URLContext *h, int64_t pos, int whence)
+{
+    MemoryFeedContext *m = h->priv_data;
+    int64_t size;
+
+    LOCK(stats_lock);
+    size = m->feed->feed_size;
+    UNLOCK(stats_lock);
+
+    switch (whence) {
+    case AVSEEK_SIZE:
+        return size;
+    case SEEK_CUR:
+        pos += m->pos;
+        break;
+    case SEEK_END:
+        pos += size;
+        break;
+    }
+    if (pos < 0 || pos > m->feed->feed_mem_size)
+        return AVERROR(EINVAL);
+    return m->pos = pos;
+}
+
+static int memory_feed_close(URLContext *h)
+{
+    return 0;
+}
+
+static URLProtocol memory_feed_protocol = {
+    "feed",
+    memory_feed_open,
+    memory_feed_read,
+    memory_feed_write,
+    memory_feed_seek,
+    memory_feed_close,
+    .priv_data_size = sizeof(MemoryFeedContext),
+};
+
+static int alloc_memory_feed(FFStream *feed)
+{
+    feed->feed_mem_size = FFALIGN(feed->feed_max_size, FFM_PACKET_SIZE);
+    /* not cleared, so that the pages are only committed when the feed
+       reaches them; nothing is read past feed_size */
+    feed->feed_mem = av_malloc(feed->feed_mem_size);
+    return feed->feed_mem ? 0 : AVERROR(ENOMEM);
+}
+
 /* compute the needed AVStream for each feed */
 static void build_feed_streams(void)
 {
@@ -3688,7 +4785,13 @@ static void build_feed_streams(void)
     for(feed = first_feed; feed != NULL; feed = feed->next_feed) {
         int fd;
 
-        if (url_exist(feed->feed_filename)) {
+        if (feed->in_memory) {
+            if (alloc_memory_feed(feed) < 0) {
+                http_log("Could not allocate %"PRId64" bytes for feed '%s'\n",
+                         feed->feed_max_size, feed->filename);
+                exit(1);
+            }
+        } else if (url_exist(feed->feed_filename)) {
             /* See if it matches */
             AVFormatContext *s;
             int matches = 0;
@@ -3761,7 +4864,7 @@ static void build_feed_streams(void)
                 unlink(feed->feed_filename);
             }
         }
-        if (!url_exist(feed->feed_filename)) {
+        if (feed->in_memory || !url_exist(feed->feed_filename)) {
             AVFormatContext s1 = {0}, *s = &s1;
 
             if (feed->readonly) {
@@ -3793,6 +4896,10 @@ static void build_feed_streams(void)
             url_fclose(s->pb);
         }
         /* get feed size and write index */
+        if (feed->in_memory) {
+            feed->feed_write_index = FFMAX(AV_RB64(feed->feed_mem + 8), FFM_PACKET_SIZE);
+            continue;
+        }
         fd = open(feed->feed_filename, O_RDONLY);
         if (fd < 0) {
             http_log("Could not open output feed file '%s'\n",
@@ -4124,6 +5231,20 @@ static int parse_ffconfig(const char *filename)
             } else {
                 nb_max_connections = val;
             }
+        } else if (!strcasecmp(cmd, "Workers")) {
+            get_arg(arg, sizeof(arg), &p);
+            val = atoi(arg);
+            if (val < 1 || val > MAX_WORKERS) {
+                ERROR("Invalid Workers: %s\n", arg);
+            } else {
+#if !USE_EPOLL
+                if (val > 1)
+                    fprintf(stderr, "%s:%d: Workers needs epoll and pthreads, using one\n",
+                            filename, line_num);
+                val = 1;
+#endif
+                nb_workers = val;
+            }
         } else if (!strcasecmp(cmd, "MaxBandwidth")) {
             int64_t llval;
             get_arg(arg, sizeof(arg), &p);
@@ -4203,6 +5324,9 @@ static int parse_ffconfig(const char *filename)
                 get_arg(feed->feed_filename, sizeof(feed->feed_filename), &p);
             } else if (stream)
                 get_arg(stream->feed_filename, sizeof(stream->feed_filename), &p);
+        } else if (!strcasecmp(cmd, "InMemory")) {
+            if (feed)
+                feed->in_memory = 1;
         } else if (!strcasecmp(cmd, "Truncate")) {
             if (feed) {
                 get_arg(arg, sizeof(arg), &p);
@@ -4235,6 +5359,12 @@ static int parse_ffconfig(const char *filename)
         } else if (!strcasecmp(cmd, "</Feed>")) {
             if (!feed) {
                 ERROR("No corresponding <Feed> for </Feed>\n");
+            } else if (feed->in_memory) {
+                if (feed->readonly) {
+                    ERROR("Feed '%s' cannot be both InMemory and ReadOnlyFile\n", feed->filename);
+                }
+                snprintf(feed->feed_filename, sizeof(feed->feed_filename),
+                         "feed:%s", feed->filename);
             }
             feed = NULL;
         } else if (!strcasecmp(cmd, "<Stream")) {
@@ -4340,6 +5470,9 @@ static int parse_ffconfig(const char *filename)
         } else if (!strcasecmp(cmd, "StartSendOnKey")) {
             if (stream)
                 stream->send_on_key = 1;
+        } else if (!strcasecmp(cmd, "NoFanOut")) {
+            if (stream)
+                stream->no_fanout = 1;
         } else if (!strcasecmp(cmd, "AudioCodec")) {
             get_arg(arg, sizeof(arg), &p);
             audio_id = opt_audio_codec(arg);
@@ -4694,6 +5827,7 @@ int main(int argc, char **argv)
     struct sigaction sigact;
 
     av_register_all();
+    av_register_protocol2(&memory_feed_protocol, sizeof(memory_feed_protocol));
 
     show_banner();
 
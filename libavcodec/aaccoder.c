@@ -30,6 +30,7 @@
  * add sane pulse detection
  ***********************************/
 
+#define BITSTREAM_WRITER_64
 #include <float.h>
 #include "avcodec.h"
 #include "put_bits.h"
@@ -30,6 +30,7 @@
  * add temporal noise shaping
  ***********************************/
 
+#define BITSTREAM_WRITER_64
 #include "avcodec.h"
 #include "put_bits.h"
 #include "dsputil.h"
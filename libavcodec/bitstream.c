@@ -339,3 +339,37 @@ void free_vlc(VLC *vlc)
     av_freep(&vlc->table);
 }
 
+void ff_init_rl_vlc_multi(RL_VLC_MULTI_ELEM *table, int bits,
+                          const RL_VLC_ELEM *rl_vlc, int rl_bits)
+{
+    int i, n;
+
+    for (i = 0; i < 1 << bits; i++) {
+        RL_VLC_MULTI_ELEM *e = &table[i];
+        int left = bits, run = 0;
+
+        e->len = e->num = 0;
+        while (e->num < RL_VLC_MULTI_MAX) {
+            /* the unknown bits after the index do not change codes of at
+             * most left bits */
+            unsigned rest = i & ((1 << left) - 1);
+            unsigned idx  = left >= rl_bits ? rest >> (left - rl_bits)
+                                             : rest << (rl_bits - left);
+            const RL_VLC_ELEM *c = &rl_vlc[idx];
+
+            if (c->len <= 0 || c->len + 1 > left || !c->level ||
+                c->run < 1 || c->run > 64)
+                break;
+            left -= c->len + 1;
+            run  += c->run;
+            e->level[e->num] = (rest >> left) & 1 ? -c->level : c->level;
+            e->run[e->num]   = run;
+            e->len          += c->len + 1;
+            e->num++;
+        }
+        for (n = e->num; n && n < RL_VLC_MULTI_MAX; n++) {
+            e->level[n] = e->level[n - 1];
+            e->run[n]   = e->run[n - 1];
+        }
+    }
+}
@@ -49,8 +49,6 @@ static const uint8_t lps_range[64][4]= {
 {  6,  8,  9, 11}, {  6,  7,  9, 10}, {  6,  7,  8,  9}, {  2,  2,  2,  2},
 };
 
-uint8_t ff_h264_mlps_state[4*64];
-uint8_t ff_h264_lps_range[4*2*64];
 uint8_t ff_h264_lps_state[2*64];
 uint8_t ff_h264_mps_state[2*64];
 
@@ -87,7 +85,13 @@ const uint8_t ff_h264_norm_shift_old[128]= {
  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
 };
 #endif
-const uint8_t ff_h264_norm_shift[512]= {
+/**
+ * norm_shift, lps_range, mlps_state and the H.264 8x8 last_coeff_flag
+ * offsets in one array, so that the x86-64 asm can address all of them
+ * relative to one register. lps_range and mlps_state are set by
+ * ff_init_cabac_states().
+ */
+uint8_t ff_h264_cabac_tables[512 + 4*2*64 + 4*64 + 63]= {
  9,8,7,7,6,6,6,6,5,5,5,5,5,5,5,5,
  4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,4,
  3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,3,
@@ -108,6 +112,11 @@ const uint8_t ff_h264_norm_shift[512]= {
  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
  0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+[H264_LAST_COEFF_FLAG_OFFSET_8x8_OFFSET]=
+ 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
+ 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+ 3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4,
+ 5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7, 8, 8, 8,
 };
 
 /**
@@ -51,11 +51,28 @@ typedef struct CABACContext{
     PutBitContext pb;
 }CABACContext;
 
-extern uint8_t ff_h264_mlps_state[4*64];
-extern uint8_t ff_h264_lps_range[4*2*64];  ///< rangeTabLPS
+#define H264_NORM_SHIFT_OFFSET 0
+#define H264_LPS_RANGE_OFFSET  512
+#define H264_MLPS_STATE_OFFSET 1024
+#define H264_LAST_COEFF_FLAG_OFFSET_8x8_OFFSET 1280
+
+extern uint8_t ff_h264_cabac_tables[512 + 4*2*64 + 4*64 + 63];
+#define ff_h264_norm_shift (ff_h264_cabac_tables + H264_NORM_SHIFT_OFFSET)
+#define ff_h264_lps_range  (ff_h264_cabac_tables + H264_LPS_RANGE_OFFSET)  ///< rangeTabLPS
+#define ff_h264_mlps_state (ff_h264_cabac_tables + H264_MLPS_STATE_OFFSET)
+#define ff_h264_last_coeff_flag_offset_8x8 (ff_h264_cabac_tables + H264_LAST_COEFF_FLAG_OFFSET_8x8_OFFSET)
 extern uint8_t ff_h264_mps_state[2*64];     ///< transIdxMPS
 extern uint8_t ff_h264_lps_state[2*64];     ///< transIdxLPS
-extern const uint8_t ff_h264_norm_shift[512];
+
+/* The x86 asm needs 7 registers. On x86-64 it addresses the tables through
+ * a register and thus also works in PIC code. */
+#if ARCH_X86_64 && defined(BRANCHLESS_CABAC_DECODER)
+#   define CABAC_X86_ASM 1
+#elif ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS)
+#   define CABAC_X86_ASM 1
+#else
+#   define CABAC_X86_ASM 0
+#endif
 
 
 void ff_init_cabac_encoder(CABACContext *c, uint8_t *buf, int buf_size);
@@ -270,7 +287,7 @@ static void refill(CABACContext *c){
     c->bytestream+= CABAC_BITS/8;
 }
 
-#if ! ( ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS) )
+#if !CABAC_X86_ASM
 static void refill2(CABACContext *c){
     int i, x;
 
@@ -381,7 +398,7 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
 #define BYTE        "16"
 #define BYTEEND     "20"
 #endif
-#if ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS)
+#if CABAC_X86_ASM
     int bit;
 
 #ifndef BRANCHLESS_CABAC_DECODER
@@ -390,7 +407,7 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
         "movl "RANGE    "(%2), %%ebx            \n\t"
         "movl "RANGE    "(%2), %%edx            \n\t"
         "andl $0xC0, %%ebx                      \n\t"
-        "movzbl "MANGLE(ff_h264_lps_range)"(%0, %%ebx, 2), %%esi\n\t"
+        "movzbl "MANGLE(ff_h264_cabac_tables)"+"AV_STRINGIFY(H264_LPS_RANGE_OFFSET)"(%0, %%ebx, 2), %%esi\n\t"
         "movl "LOW      "(%2), %%ebx            \n\t"
 //eax:state ebx:low, edx:range, esi:RangeLPS
         "subl %%esi, %%edx                      \n\t"
@@ -430,7 +447,7 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
 //eax:state ebx:low, edx:range, esi:RangeLPS
         "subl %%ecx, %%ebx                      \n\t"
         "movl %%esi, %%edx                      \n\t"
-        "movzbl " MANGLE(ff_h264_norm_shift) "(%%esi), %%ecx   \n\t"
+        "movzbl " MANGLE(ff_h264_cabac_tables) "(%%esi), %%ecx   \n\t"
         "shll %%cl, %%ebx                       \n\t"
         "shll %%cl, %%edx                       \n\t"
         "movzbl "MANGLE(ff_h264_lps_state)"(%0), %%ecx   \n\t"
@@ -450,7 +467,7 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
         "leal -1(%%ebx), %%ecx                  \n\t"
         "xorl %%ebx, %%ecx                      \n\t"
         "shrl $15, %%ecx                        \n\t"
-        "movzbl " MANGLE(ff_h264_norm_shift) "(%%ecx), %%ecx   \n\t"
+        "movzbl " MANGLE(ff_h264_cabac_tables) "(%%ecx), %%ecx   \n\t"
         "neg %%ecx                              \n\t"
         "add $7, %%ecx                          \n\t"
 
@@ -467,18 +484,33 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
 #else /* BRANCHLESS_CABAC_DECODER */
 
 
+#if ARCH_X86_64
+/* Absolute addresses cannot be used in PIC code on x86-64, so the tables
+ * are addressed relative to a register holding ff_h264_cabac_tables. */
+#define TABLES_ARG , "r"(ff_h264_cabac_tables)
+#define CABAC_TABLE(tables, offset, index)\
+        AV_STRINGIFY(offset) "(" tables ", " index ")"
+#define SIGN_EXTEND(ret, retq)\
+        "movslq "ret"       , "retq"                                    \n\t"
+#else
+#define TABLES_ARG
+#define CABAC_TABLE(tables, offset, index)\
+        MANGLE(ff_h264_cabac_tables) "+" AV_STRINGIFY(offset) "(" index ")"
+#define SIGN_EXTEND(ret, retq)
+#endif
+
 #if HAVE_FAST_CMOV
-#define BRANCHLESS_GET_CABAC_UPDATE(ret, cabac, statep, low, lowword, range, tmp, tmpbyte)\
+#define BRANCHLESS_GET_CABAC_UPDATE(ret, retq, cabac, statep, low, lowword, range, tmp, tmpbyte)\
         "mov    "tmp"       , %%ecx                                     \n\t"\
         "shl    $17         , "tmp"                                     \n\t"\
         "cmp    "low"       , "tmp"                                     \n\t"\
         "cmova  %%ecx       , "range"                                   \n\t"\
-        "sbb    %%ecx       , %%ecx                                     \n\t"\
+        "sbb    %%"REG_c"   , %%"REG_c"                                 \n\t"\
         "and    %%ecx       , "tmp"                                     \n\t"\
         "sub    "tmp"       , "low"                                     \n\t"\
-        "xor    %%ecx       , "ret"                                     \n\t"
+        "xor    %%"REG_c"   , "retq"                                    \n\t"
 #else /* HAVE_FAST_CMOV */
-#define BRANCHLESS_GET_CABAC_UPDATE(ret, cabac, statep, low, lowword, range, tmp, tmpbyte)\
+#define BRANCHLESS_GET_CABAC_UPDATE(ret, retq, cabac, statep, low, lowword, range, tmp, tmpbyte)\
         "mov    "tmp"       , %%ecx                                     \n\t"\
         "shl    $17         , "tmp"                                     \n\t"\
         "sub    "low"       , "tmp"                                     \n\t"\
@@ -489,20 +521,25 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
         "shl    $17         , %%ecx                                     \n\t"\
         "and    "tmp"       , %%ecx                                     \n\t"\
         "sub    %%ecx       , "low"                                     \n\t"\
-        "xor    "tmp"       , "ret"                                     \n\t"
+        "xor    "tmp"       , "ret"                                     \n\t"\
+        SIGN_EXTEND(ret, retq)
 #endif /* HAVE_FAST_CMOV */
 
 
-#define BRANCHLESS_GET_CABAC(ret, cabac, statep, low, lowword, range, tmp, tmpbyte)\
+/* ret, range and tmp are 32-bit registers, retq and rangeq their
+ * pointer-sized names, tables the register holding ff_h264_cabac_tables
+ * on x86-64 (ignored elsewhere). */
+#define BRANCHLESS_GET_CABAC(ret, retq, cabac, statep, low, lowword, range, rangeq, tmp, tmpbyte, tables)\
         "movzbl "statep"    , "ret"                                     \n\t"\
         "mov    "range"     , "tmp"                                     \n\t"\
         "and    $0xC0       , "range"                                   \n\t"\
-        "movzbl "MANGLE(ff_h264_lps_range)"("ret", "range", 2), "range" \n\t"\
+        "lea    ("retq", "rangeq", 2), %%"REG_c"                        \n\t"\
+        "movzbl "CABAC_TABLE(tables, H264_LPS_RANGE_OFFSET, "%%"REG_c)", "range" \n\t"\
         "sub    "range"     , "tmp"                                     \n\t"\
-        BRANCHLESS_GET_CABAC_UPDATE(ret, cabac, statep, low, lowword, range, tmp, tmpbyte)\
-        "movzbl " MANGLE(ff_h264_norm_shift) "("range"), %%ecx          \n\t"\
+        BRANCHLESS_GET_CABAC_UPDATE(ret, retq, cabac, statep, low, lowword, range, tmp, tmpbyte)\
+        "movzbl "CABAC_TABLE(tables, H264_NORM_SHIFT_OFFSET, rangeq)", %%ecx \n\t"\
         "shl    %%cl        , "range"                                   \n\t"\
-        "movzbl "MANGLE(ff_h264_mlps_state)"+128("ret"), "tmp"          \n\t"\
+        "movzbl "CABAC_TABLE(tables, H264_MLPS_STATE_OFFSET+128, retq)", "tmp" \n\t"\
         "mov    "tmpbyte"   , "statep"                                  \n\t"\
         "shl    %%cl        , "low"                                     \n\t"\
         "test   "lowword"   , "lowword"                                 \n\t"\
@@ -517,7 +554,7 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
         "lea    -1("low")   , %%ecx                                     \n\t"\
         "xor    "low"       , %%ecx                                     \n\t"\
         "shr    $15         , %%ecx                                     \n\t"\
-        "movzbl " MANGLE(ff_h264_norm_shift) "(%%ecx), %%ecx            \n\t"\
+        "movzbl "CABAC_TABLE(tables, H264_NORM_SHIFT_OFFSET, "%%"REG_c)", %%ecx \n\t"\
         "neg    %%ecx                                                   \n\t"\
         "add    $7          , %%ecx                                     \n\t"\
         "shl    %%cl        , "tmp"                                     \n\t"\
@@ -527,17 +564,18 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
     __asm__ volatile(
         "movl "RANGE    "(%2), %%esi            \n\t"
         "movl "LOW      "(%2), %%ebx            \n\t"
-        BRANCHLESS_GET_CABAC("%0", "%2", "(%1)", "%%ebx", "%%bx", "%%esi", "%%edx", "%%dl")
+        BRANCHLESS_GET_CABAC("%0", "%%"REG_a, "%2", "(%1)", "%%ebx", "%%bx",
+                             "%%esi", "%%"REG_S, "%%edx", "%%dl", "%3")
         "movl %%esi, "RANGE    "(%2)            \n\t"
         "movl %%ebx, "LOW      "(%2)            \n\t"
 
         :"=&a"(bit)
-        :"r"(state), "r"(c)
+        :"r"(state), "r"(c) TABLES_ARG
         : "%"REG_c, "%ebx", "%edx", "%esi", "memory"
     );
     bit&=1;
 #endif /* BRANCHLESS_CABAC_DECODER */
-#else /* ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS) */
+#else /* CABAC_X86_ASM */
     int s = *state;
     int RangeLPS= ff_h264_lps_range[2*(c->range&0xC0) + s];
     int bit, lps_mask av_unused;
@@ -576,7 +614,7 @@ static av_always_inline int get_cabac_inline(CABACContext *c, uint8_t * const st
     if(!(c->low & CABAC_MASK))
         refill2(c);
 #endif /* BRANCHLESS_CABAC_DECODER */
-#endif /* ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS) */
+#endif /* CABAC_X86_ASM */
     return bit;
 }
 
@@ -589,7 +627,8 @@ static int av_unused get_cabac(CABACContext *c, uint8_t * const state){
 }
 
 static int av_unused get_cabac_bypass(CABACContext *c){
-#if 0 //not faster
+#if ARCH_X86_64
+    // not faster on x86-32, where ebx is often unavailable
     int bit;
     __asm__ volatile(
         "movl "RANGE    "(%1), %%ebx            \n\t"
@@ -602,14 +641,14 @@ static int av_unused get_cabac_bypass(CABACContext *c){
         "add %%ebx, %%eax                       \n\t"
         "test %%ax, %%ax                        \n\t"
         " jnz 1f                                \n\t"
-        "movl "BYTE     "(%1), %%"REG_b"        \n\t"
+        "mov  "BYTE     "(%1), %%"REG_b"        \n\t"
         "subl $0xFFFF, %%eax                    \n\t"
         "movzwl (%%"REG_b"), %%ecx              \n\t"
         "bswap %%ecx                            \n\t"
         "shrl $15, %%ecx                        \n\t"
-        "addl $2, %%"REG_b"                     \n\t"
+        "add  $2, %%"REG_b"                     \n\t"
         "addl %%ecx, %%eax                      \n\t"
-        "movl %%"REG_b", "BYTE     "(%1)        \n\t"
+        "mov  %%"REG_b", "BYTE     "(%1)        \n\t"
         "1:                                     \n\t"
         "movl %%eax, "LOW      "(%1)            \n\t"
 
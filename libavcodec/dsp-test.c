@@ -0,0 +1,2083 @@
+/*
+ * DSP function validation and benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Check the optimized functions of the DSP contexts against the C versions.
+ *
+ * For each set of CPU flags supported by the host, the contexts are
+ * initialized with av_force_cpu_flags() and every function pointer which
+ * differs from the one chosen without any flag is run on the same random
+ * inputs as the C function. With -b, the cycles taken by both are printed.
+ *
+ * The IDCTs and FDCTs are not bit-exact and are tested by dct-test.
+ * float_to_int16 is not tested since the C and SIMD versions expect
+ * differently scaled input, nor the 2-tap qpel functions, which have no C
+ * version, nor the functions which read codec state through their context
+ * argument. The DSPContext is initialized
+ * with CODEC_FLAG_BITEXACT, which leaves out the approximations.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "libavutil/cpu.h"
+#include "libavutil/lfg.h"
+#include "libavutil/timer.h"
+#include "avcodec.h"
+#include "dsputil.h"
+#include "h264dsp.h"
+#include "h264pred.h"
+#include "vp8dsp.h"
+#include "vp56dsp.h"
+#include "vp6data.h"
+#include "fft.h"
+
+#undef exit
+#undef printf
+
+#define NB_TRIALS  32
+#define BENCH_RUNS 64
+
+/* pixel buffers: 16 lines and 16 columns of margin around the blocks */
+#define STRIDE     64
+#define BUF_SIZE   (STRIDE * 48)
+#define PIX_OFF    (STRIDE * 16 + 16)
+
+#define NB_COEFS   (24 * 16)
+#define FLOAT_LEN  256
+#define FFT_BUF    (2 << 10)
+
+static const struct {
+    const char *name;
+    int flags;
+} cpu_sets[] = {
+    { "c",        0 },
+#if ARCH_X86
+    { "mmx",      AV_CPU_FLAG_MMX },
+    { "mmx2",     AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 },
+    { "3dnow",    AV_CPU_FLAG_MMX | AV_CPU_FLAG_3DNOW },
+    { "3dnowext", AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_3DNOW |
+                  AV_CPU_FLAG_3DNOWEXT },
+    { "sse",      AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE },
+    { "sse2",     AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE |
+                  AV_CPU_FLAG_SSE2 },
+    { "sse3",     AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE |
+                  AV_CPU_FLAG_SSE2 | AV_CPU_FLAG_SSE3 },
+    { "ssse3",    AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE |
+                  AV_CPU_FLAG_SSE2 | AV_CPU_FLAG_SSE3 | AV_CPU_FLAG_SSSE3 },
+    { "sse4",     AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE |
+                  AV_CPU_FLAG_SSE2 | AV_CPU_FLAG_SSE3 | AV_CPU_FLAG_SSSE3 |
+                  AV_CPU_FLAG_SSE4 },
+    { "sse42",    AV_CPU_FLAG_MMX | AV_CPU_FLAG_MMX2 | AV_CPU_FLAG_SSE |
+                  AV_CPU_FLAG_SSE2 | AV_CPU_FLAG_SSE3 | AV_CPU_FLAG_SSSE3 |
+                  AV_CPU_FLAG_SSE4 | AV_CPU_FLAG_SSE42 },
+#else
+    /* all the flags detected on the host */
+    { "native",   -1 },
+#endif
+};
+
+static const struct {
+    const char *name;
+    enum CodecID id;
+} pred_codecs[] = {
+    { "h264", CODEC_ID_H264 },
+    { "svq3", CODEC_ID_SVQ3 },
+    { "rv40", CODEC_ID_RV40 },
+    { "vp8",  CODEC_ID_VP8  },
+};
+
+static const int fft_bits[] = { 4, 7, 10 };
+
+#define NB_PRED_CODECS FF_ARRAY_ELEMS(pred_codecs)
+#define NB_FFT_SIZES   FF_ARRAY_ELEMS(fft_bits)
+
+typedef struct DSPTestContext {
+    DSPContext      dsp;
+    H264DSPContext  h264dsp;
+    H264PredContext h264pred[NB_PRED_CODECS];
+    VP8DSPContext   vp8dsp;
+    VP56DSPContext  vp56dsp[2];
+    FFTContext      fft[NB_FFT_SIZES][2];
+    FFTContext      mdct[NB_FFT_SIZES][2];
+} DSPTestContext;
+
+static DSPTestContext ref_ctx, opt_ctx;
+
+/* index 0 is used by the C function, index 1 by the optimized one */
+DECLARE_ALIGNED(16, static uint8_t, src)[2][BUF_SIZE];
+DECLARE_ALIGNED(16, static uint8_t, dst)[2][BUF_SIZE];
+DECLARE_ALIGNED(16, static DCTELEM, coef)[2][NB_COEFS];
+DECLARE_ALIGNED(16, static int32_t, isrc)[FLOAT_LEN];
+DECLARE_ALIGNED(16, static float,   fsrc)[4][FFT_BUF];
+DECLARE_ALIGNED(16, static float,   fdst)[2][FFT_BUF];
+
+static AVLFG prng;
+static const char *cpu_name;
+static int bench, verbose;
+static int nb_tested, nb_failed;
+
+static unsigned rnd(void)
+{
+    return av_lfg_get(&prng);
+}
+
+/**
+ * Fill with either noise or smooth content, the latter so that the loop
+ * filters find edges to filter.
+ */
+static void fill_pixels(uint8_t *buf, int size)
+{
+    int range = 4 << 2 * (rnd() & 3);
+    int base  = rnd() % (257 - range);
+    int i;
+
+    for (i = 0; i < size; i++)
+        buf[i] = base + rnd() % range;
+}
+
+/* Fill with values in [-range, range], half of them zero. */
+static void fill_coefs(DCTELEM *blk, int n, int range)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        blk[i] = rnd() & 1 ? rnd() % (2 * range + 1) - range : 0;
+}
+
+static void fill_floats(float *buf, int n)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        buf[i] = rnd() * (2.0 / UINT32_MAX) - 1.0;
+}
+
+static int compare_floats(const float *a, const float *b, int n, float eps)
+{
+    int i;
+
+    for (i = 0; i < n; i++)
+        if (fabsf(a[i] - b[i]) > eps * (1.0 + fabsf(a[i])))
+            return 1;
+    return 0;
+}
+
+static const char *func_name(const char *fmt, ...)
+{
+    static char name[64];
+    va_list ap;
+
+    va_start(ap, fmt);
+    vsnprintf(name, sizeof(name), fmt, ap);
+    va_end(ap);
+    return name;
+}
+
+#ifdef AV_READ_TIME
+#define BENCH(cycles, call)                                     \
+    do {                                                        \
+        uint64_t t, best = UINT64_MAX;                          \
+        int run;                                                \
+        for (run = 0; run < BENCH_RUNS; run++) {                \
+            t = AV_READ_TIME();                                 \
+            call; call; call; call;                             \
+            t = AV_READ_TIME() - t;                             \
+            best = FFMIN(best, t);                              \
+        }                                                       \
+        emms_c();                                               \
+        cycles = best / 4.0;                                    \
+    } while (0)
+#else
+#define BENCH(cycles, call) cycles = 0
+#endif
+
+/* Run call with j = 0 for the C function and j = 1 for the optimized one. */
+#define RUN_BOTH(call)                                          \
+    do {                                                        \
+        for (j = 0; j < 2; j++)                                 \
+            call;                                               \
+        emms_c();                                               \
+    } while (0)
+
+#define BENCH_BOTH(call)                                        \
+    do {                                                        \
+        for (j = 0; bench && j < 2; j++)                        \
+            BENCH(cycles[j], call);                             \
+    } while (0)
+
+/**
+ * Declare fn, the array of the C and the optimized function, and the other
+ * variables of a check, and return if there is nothing to check.
+ */
+#define CHECK_START(decl)                                       \
+    decl = { ref, opt };                                  \
+    double cycles[2] = { 0 };                                   \
+    int i, j, err = 0;                                          \
+    if (!opt || opt == ref)                                     \
+        return;
+
+static void report(const char *name, int err, const double *cycles)
+{
+    nb_tested++;
+    if (err) {
+        nb_failed++;
+        printf("%s (%s): FAILED\n", name, cpu_name);
+    } else if (verbose) {
+        printf("%s (%s): ok\n", name, cpu_name);
+    }
+    if (bench)
+        printf("%-40s %-8s %9.1f %9.1f %6.2fx\n", name, cpu_name,
+               cycles[0], cycles[1], cycles[0] / FFMAX(cycles[1], 0.1));
+}
+
+static int compare_dst(void)
+{
+    return memcmp(dst[0], dst[1], BUF_SIZE) != 0;
+}
+
+static void init_dst(void)
+{
+    fill_pixels(dst[0], BUF_SIZE);
+    memcpy(dst[1], dst[0], BUF_SIZE);
+}
+
+static void init_coefs(int range)
+{
+    fill_coefs(coef[0], NB_COEFS, range);
+    memcpy(coef[1], coef[0], sizeof(coef[0]));
+}
+
+/* motion compensation */
+
+static void check_pixels(const char *name, op_pixels_func ref,
+                         op_pixels_func opt, int h_min, int h_max)
+{
+    int off = 0, h = h_min;
+    CHECK_START(op_pixels_func fn[2])
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        off = rnd() & 15;
+        h   = h_min + rnd() % (h_max - h_min + 1);
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF + off, STRIDE, h));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF + off, STRIDE, h));
+    report(name, err, cycles);
+}
+
+static void check_pixels_l2(const char *name,
+                            void (*ref)(uint8_t *, const uint8_t *,
+                                        const uint8_t *, int, int),
+                            void (*opt)(uint8_t *, const uint8_t *,
+                                        const uint8_t *, int, int), int h)
+{
+    int off0 = 0, off1 = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, const uint8_t *, const uint8_t *, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        fill_pixels(src[1], BUF_SIZE);
+        init_dst();
+        off0 = rnd() & 15;
+        off1 = rnd() & 15;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF + off0,
+                       src[1] + PIX_OFF + off1, STRIDE, h));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF + off0,
+                     src[1] + PIX_OFF + off1, STRIDE, h));
+    report(name, err, cycles);
+}
+
+static void check_qpel(const char *name, qpel_mc_func ref, qpel_mc_func opt)
+{
+    int off = 0;
+    CHECK_START(qpel_mc_func fn[2])
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        off = rnd() & 15;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF + off, STRIDE));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF + off, STRIDE));
+    report(name, err, cycles);
+}
+
+static void check_chroma(const char *name, h264_chroma_mc_func ref,
+                         h264_chroma_mc_func opt, int h)
+{
+    int off = 0, x = 0, y = 0;
+    CHECK_START(h264_chroma_mc_func fn[2])
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        off = rnd() & 15;
+        x   = rnd() & 7;
+        y   = rnd() & 7;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF + off, STRIDE,
+                       h, x, y));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF + off, STRIDE,
+                     h, x, y));
+    report(name, err, cycles);
+}
+
+static void check_gmc(const char *name,
+                      void (*ref)(uint8_t *, uint8_t *, int, int, int, int,
+                                  int, int, int, int, int, int, int, int),
+                      void (*opt)(uint8_t *, uint8_t *, int, int, int, int,
+                                  int, int, int, int, int, int, int, int))
+{
+    int ox = 0, oy = 0, dxx = 0, dxy = 0, dyx = 0, dyy = 0, a = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, uint8_t *, int, int, int, int,
+                         int, int, int, int, int, int, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        /* sprite warping accuracy and a transform close to the identity */
+        a   = rnd() & 3;
+        ox  = rnd() % (8 << (17 + a));
+        oy  = rnd() % (8 << (17 + a));
+        dxx = (1 << (17 + a)) + (int)(rnd() % 4096) - 2048;
+        dxy =                   (int)(rnd() % 4096) - 2048;
+        dyx =                   (int)(rnd() % 4096) - 2048;
+        dyy = (1 << (17 + a)) + (int)(rnd() % 4096) - 2048;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF, STRIDE, 8,
+                       ox, oy, dxx, dxy, dyx, dyy, a + 1,
+                       (1 << (2 * a + 1)) - (i & 1), 24, 24));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF, STRIDE, 8,
+                     ox, oy, dxx, dxy, dyx, dyy, a + 1,
+                     1 << (2 * a + 1), 24, 24));
+    report(name, err, cycles);
+}
+
+static void check_vp8_mc(const char *name, vp8_mc_func ref, vp8_mc_func opt,
+                         int h, int v_idx, int h_idx)
+{
+    int off = 0, mx = 0, my = 0;
+    CHECK_START(vp8_mc_func fn[2])
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        off = rnd() & 15;
+        /* index 1 is for odd, index 2 for even nonzero positions */
+        mx  = h_idx ? h_idx == 1 ? 2 * (rnd() & 3) + 1 : 2 * (rnd() % 3) + 2 : 0;
+        my  = v_idx ? v_idx == 1 ? 2 * (rnd() & 3) + 1 : 2 * (rnd() % 3) + 2 : 0;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, src[0] + PIX_OFF + off,
+                       STRIDE, h, mx, my));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, src[0] + PIX_OFF + off,
+                     STRIDE, h, mx, my));
+    report(name, err, cycles);
+}
+
+static void check_vp6_diag4(const char *name,
+                            void (*ref)(uint8_t *, uint8_t *, int,
+                                        const int16_t *, const int16_t *),
+                            void (*opt)(uint8_t *, uint8_t *, int,
+                                        const int16_t *, const int16_t *))
+{
+    const int16_t *hw = NULL, *vw = NULL;
+    CHECK_START(void (*fn[2])(uint8_t *, uint8_t *, int,
+                         const int16_t *, const int16_t *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        hw = vp6_block_copy_filter[rnd() % 17][rnd() % 7 + 1];
+        vw = vp6_block_copy_filter[rnd() % 17][rnd() % 7 + 1];
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF, STRIDE, hw, vw));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF, STRIDE, hw, vw));
+    report(name, err, cycles);
+}
+
+static void check_h264_weight(const char *name, h264_weight_func ref,
+                              h264_weight_func opt)
+{
+    int log2_denom = 0, weight = 0, offset = 0;
+    CHECK_START(h264_weight_func fn[2])
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        log2_denom = rnd() & 7;
+        weight     = (int)(rnd() & 255) - 128;
+        offset     = (int)(rnd() & 255) - 128;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, log2_denom, weight, offset));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, log2_denom, weight, offset));
+    report(name, err, cycles);
+}
+
+static void check_h264_biweight(const char *name, h264_biweight_func ref,
+                                h264_biweight_func opt)
+{
+    int log2_denom = 0, weightd = 0, weights = 0, offset = 0;
+    CHECK_START(h264_biweight_func fn[2])
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        log2_denom = rnd() & 7;
+        weightd    = (int)(rnd() & 255) - 128;
+        weights    = (int)(rnd() & 255) - 128;
+        offset     = (int)(rnd() & 255) - 128;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF, STRIDE,
+                       log2_denom, weightd, weights, offset));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, src[0] + PIX_OFF, STRIDE,
+                     log2_denom, weightd, weights, offset));
+    report(name, err, cycles);
+}
+
+/* motion estimation */
+
+static void check_cmp(const char *name, me_cmp_func ref, me_cmp_func opt,
+                      int h)
+{
+    int off = 0, res[2];
+    CHECK_START(me_cmp_func fn[2])
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        off = rnd() & 15;
+        if (i & 1) {
+            fill_pixels(src[1], BUF_SIZE);
+        } else {
+            /* a close match, as found by the motion search */
+            for (j = 0; j < BUF_SIZE - 16; j++)
+                src[1][j + off] = av_clip_uint8(src[0][j] + (int)(rnd() % 9) - 4);
+        }
+        RUN_BOTH(res[j] = fn[j](NULL, src[0] + PIX_OFF, src[1] + PIX_OFF + off,
+                                STRIDE, h));
+        err = res[0] != res[1];
+    }
+    BENCH_BOTH(fn[j](NULL, src[0] + PIX_OFF, src[1] + PIX_OFF + off, STRIDE, h));
+    report(name, err, cycles);
+}
+
+/* blocks and coefficients */
+
+static void check_get_pixels(const char *name,
+                             void (*ref)(DCTELEM *, const uint8_t *, int),
+                             void (*opt)(DCTELEM *, const uint8_t *, int))
+{
+    CHECK_START(void (*fn[2])(DCTELEM *, const uint8_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_coefs(256);
+        RUN_BOTH(fn[j](coef[j], src[0] + PIX_OFF + 8 * (i & 1), STRIDE));
+        err = memcmp(coef[0], coef[1], sizeof(coef[0])) != 0;
+    }
+    BENCH_BOTH(fn[j](coef[j], src[0] + PIX_OFF, STRIDE));
+    report(name, err, cycles);
+}
+
+static void check_diff_pixels(const char *name,
+                              void (*ref)(DCTELEM *, const uint8_t *,
+                                          const uint8_t *, int),
+                              void (*opt)(DCTELEM *, const uint8_t *,
+                                          const uint8_t *, int))
+{
+    CHECK_START(void (*fn[2])(DCTELEM *, const uint8_t *, const uint8_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        fill_pixels(src[1], BUF_SIZE);
+        init_coefs(256);
+        RUN_BOTH(fn[j](coef[j], src[0] + PIX_OFF, src[1] + PIX_OFF + 8 * (i & 1),
+                       STRIDE));
+        err = memcmp(coef[0], coef[1], sizeof(coef[0])) != 0;
+    }
+    BENCH_BOTH(fn[j](coef[j], src[0] + PIX_OFF, src[1] + PIX_OFF, STRIDE));
+    report(name, err, cycles);
+}
+
+static void check_put_block(const char *name,
+                            void (*ref)(const DCTELEM *, uint8_t *, int),
+                            void (*opt)(const DCTELEM *, uint8_t *, int))
+{
+    CHECK_START(void (*fn[2])(const DCTELEM *, uint8_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        init_coefs(300);
+        RUN_BOTH(fn[j](coef[j], dst[j] + PIX_OFF, STRIDE));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](coef[j], dst[j] + PIX_OFF, STRIDE));
+    report(name, err, cycles);
+}
+
+/**
+ * Check a function adding a transformed block to dst.
+ * @param range     range of the coefficients
+ * @param dc_only   only fill the first coefficient of each block
+ * @param cmp_coefs also compare the coefficients, which the functions clear
+ */
+static void check_add_block(const char *name,
+                            void (*ref)(uint8_t *, DCTELEM *, int),
+                            void (*opt)(uint8_t *, DCTELEM *, int),
+                            int range, int dc_only, int cmp_coefs)
+{
+    CHECK_START(void (*fn[2])(uint8_t *, DCTELEM *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        fill_coefs(coef[0], NB_COEFS, range);
+        if (dc_only)
+            for (j = 0; j < NB_COEFS; j++)
+                if (j & 15)
+                    coef[0][j] = 0;
+        memcpy(coef[1], coef[0], sizeof(coef[0]));
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, coef[j], STRIDE));
+        err = compare_dst() ||
+              (cmp_coefs && memcmp(coef[0], coef[1], sizeof(coef[0])));
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, coef[j], STRIDE));
+    report(name, err, cycles);
+}
+
+/* the same with the arguments in the order of the VC-1 and VP3 functions */
+static void check_add_block2(const char *name,
+                             void (*ref)(uint8_t *, int, DCTELEM *),
+                             void (*opt)(uint8_t *, int, DCTELEM *),
+                             int range, int dc_only)
+{
+    CHECK_START(void (*fn[2])(uint8_t *, int, DCTELEM *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        fill_coefs(coef[0], NB_COEFS, range);
+        if (dc_only)
+            memset(coef[0] + 1, 0, sizeof(coef[0]) - sizeof(DCTELEM));
+        memcpy(coef[1], coef[0], sizeof(coef[0]));
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, coef[j]));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, coef[j]));
+    report(name, err, cycles);
+}
+
+static void check_block(const char *name, void (*ref)(DCTELEM *),
+                        void (*opt)(DCTELEM *), int range)
+{
+    CHECK_START(void (*fn[2])(DCTELEM *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_coefs(range);
+        RUN_BOTH(fn[j](coef[j]));
+        err = memcmp(coef[0], coef[1], sizeof(coef[0])) != 0;
+    }
+    BENCH_BOTH(fn[j](coef[j]));
+    report(name, err, cycles);
+}
+
+static void check_sum_abs(const char *name, int (*ref)(DCTELEM *),
+                          int (*opt)(DCTELEM *))
+{
+    int res[2];
+    CHECK_START(int (*fn[2])(DCTELEM *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_coefs(2048);
+        RUN_BOTH(res[j] = fn[j](coef[j]));
+        err = res[0] != res[1];
+    }
+    BENCH_BOTH(fn[j](coef[j]));
+    report(name, err, cycles);
+}
+
+static void check_pix_sum(const char *name, int (*ref)(uint8_t *, int),
+                          int (*opt)(uint8_t *, int))
+{
+    int res[2];
+    CHECK_START(int (*fn[2])(uint8_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        RUN_BOTH(res[j] = fn[j](src[0] + PIX_OFF, STRIDE));
+        err = res[0] != res[1];
+    }
+    BENCH_BOTH(fn[j](src[0] + PIX_OFF, STRIDE));
+    report(name, err, cycles);
+}
+
+static void check_ssd_int8_vs_int16(const char *name,
+                                    int (*ref)(const int8_t *, const int16_t *, int),
+                                    int (*opt)(const int8_t *, const int16_t *, int))
+{
+    int size = 0, res[2];
+    CHECK_START(int (*fn[2])(const int8_t *, const int16_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_coefs(255);
+        size = 8 * (rnd() % (NB_COEFS / 8) + 1);
+        RUN_BOTH(res[j] = fn[j]((int8_t *)src[0], coef[0], size));
+        err = res[0] != res[1];
+    }
+    BENCH_BOTH(fn[j]((int8_t *)src[0], coef[0], size));
+    report(name, err, cycles);
+}
+
+/* lossless prediction, the lines are multiples of 16 bytes as in the codecs */
+
+static void check_bytes(const char *name,
+                        void (*ref)(uint8_t *, uint8_t *, uint8_t *, int),
+                        void (*opt)(uint8_t *, uint8_t *, uint8_t *, int),
+                        int unaligned)
+{
+    int w = 0, off = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, uint8_t *, uint8_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        fill_pixels(src[1], BUF_SIZE);
+        init_dst();
+        w   = 16 * (rnd() % (BUF_SIZE / 32) + 1);
+        off = unaligned ? rnd() & 15 : 0;
+        RUN_BOTH(fn[j](dst[j], src[0], src[1] + off, w));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j], src[0], src[1] + off, w));
+    report(name, err, cycles);
+}
+
+static void check_add_bytes(const char *name,
+                            void (*ref)(uint8_t *, uint8_t *, int),
+                            void (*opt)(uint8_t *, uint8_t *, int))
+{
+    int w = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, uint8_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        w = 16 * (rnd() % (BUF_SIZE / 32) + 1);
+        RUN_BOTH(fn[j](dst[j], src[0], w));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j], src[0], w));
+    report(name, err, cycles);
+}
+
+static void check_median_pred(const char *name,
+                              void (*ref)(uint8_t *, const uint8_t *,
+                                          const uint8_t *, int, int *, int *),
+                              void (*opt)(uint8_t *, const uint8_t *,
+                                          const uint8_t *, int, int *, int *))
+{
+    int w = 0, left[2], left_top[2];
+    CHECK_START(void (*fn[2])(uint8_t *, const uint8_t *, const uint8_t *, int,
+                         int *, int *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        fill_pixels(src[1], BUF_SIZE);
+        init_dst();
+        w = 16 * (rnd() % (BUF_SIZE / 32) + 1);
+        left[0]     = left[1]     = rnd() & 255;
+        left_top[0] = left_top[1] = rnd() & 255;
+        RUN_BOTH(fn[j](dst[j], src[0], src[1], w, &left[j], &left_top[j]));
+        err = compare_dst() || left[0] != left[1] || left_top[0] != left_top[1];
+    }
+    BENCH_BOTH(fn[j](dst[j], src[0], src[1], w, &left[j], &left_top[j]));
+    report(name, err, cycles);
+}
+
+static void check_left_pred(const char *name,
+                            int (*ref)(uint8_t *, const uint8_t *, int, int),
+                            int (*opt)(uint8_t *, const uint8_t *, int, int))
+{
+    int w = 0, left = 0, res[2];
+    CHECK_START(int (*fn[2])(uint8_t *, const uint8_t *, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        w    = 16 * (rnd() % (BUF_SIZE / 32) + 1);
+        left = rnd() & 255;
+        RUN_BOTH(res[j] = fn[j](dst[j], src[0], w, left));
+        err = compare_dst() || res[0] != res[1];
+    }
+    BENCH_BOTH(fn[j](dst[j], src[0], w, left));
+    report(name, err, cycles);
+}
+
+static void check_paeth_pred(const char *name,
+                             void (*ref)(uint8_t *, uint8_t *, uint8_t *, int, int),
+                             void (*opt)(uint8_t *, uint8_t *, uint8_t *, int, int))
+{
+    int w = 0, bpp = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, uint8_t *, uint8_t *, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        fill_pixels(src[1], BUF_SIZE);
+        init_dst();
+        /* as called by the PNG decoder, the first pixel is not predicted */
+        bpp = 3 + (i & 1);
+        w   = bpp * (rnd() % 256 + 1);
+        RUN_BOTH(fn[j](dst[j] + bpp, src[0] + bpp, src[1] + bpp, w, bpp));
+        /* the optimized versions may write past the end */
+        err = memcmp(dst[0], dst[1], bpp + w) != 0;
+    }
+    BENCH_BOTH(fn[j](dst[j] + bpp, src[0] + bpp, src[1] + bpp, w, bpp));
+    report(name, err, cycles);
+}
+
+static void check_bswap_buf(const char *name,
+                            void (*ref)(uint32_t *, const uint32_t *, int),
+                            void (*opt)(uint32_t *, const uint32_t *, int))
+{
+    int w = 0;
+    CHECK_START(void (*fn[2])(uint32_t *, const uint32_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_pixels(src[0], BUF_SIZE);
+        init_dst();
+        w = rnd() % (BUF_SIZE / 4);
+        RUN_BOTH(fn[j]((uint32_t *)dst[j], (const uint32_t *)src[0], w));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j]((uint32_t *)dst[j], (const uint32_t *)src[0], w));
+    report(name, err, cycles);
+}
+
+static void check_draw_edges(const char *name,
+                             void (*ref)(uint8_t *, int, int, int, int),
+                             void (*opt)(uint8_t *, int, int, int, int))
+{
+    int w = 0, h = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, int, int, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        w = 8 * (rnd() % 4 + 1);
+        h = 8 * (rnd() % 2 + 1);
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, w, h, EDGE_WIDTH));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, w, h, EDGE_WIDTH));
+    report(name, err, cycles);
+}
+
+/* loop filters */
+
+static void check_loop_filter(const char *name,
+                              void (*ref)(uint8_t *, int, int),
+                              void (*opt)(uint8_t *, int, int), int max_q)
+{
+    int q = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        q = rnd() % max_q + 1;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, q));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, q));
+    report(name, err, cycles);
+}
+
+static void check_filter(const char *name, void (*ref)(uint8_t *, int),
+                         void (*opt)(uint8_t *, int))
+{
+    CHECK_START(void (*fn[2])(uint8_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE));
+    report(name, err, cycles);
+}
+
+/* as set up by the VP3 decoder */
+static void init_vp3_bounding_values(int *bounding_values, int filter_limit)
+{
+    int x, value;
+
+    memset(bounding_values - 127, 0, 256 * sizeof(int));
+    for (x = 0; x < filter_limit; x++) {
+        bounding_values[-x] = -x;
+        bounding_values[x] = x;
+    }
+    for (x = value = filter_limit; x < 128 && value; x++, value--) {
+        bounding_values[ x] =  value;
+        bounding_values[-x] = -value;
+    }
+    if (value)
+        bounding_values[128] = value;
+    bounding_values[129] = bounding_values[130] = filter_limit * 0x02020202;
+}
+
+static void check_vp3_loop_filter(const char *name,
+                                  void (*ref)(uint8_t *, int, int *),
+                                  void (*opt)(uint8_t *, int, int *))
+{
+    DECLARE_ALIGNED(8, int, bounding_values_array)[256 + 2];
+    int *bounding_values = bounding_values_array + 127;
+    CHECK_START(void (*fn[2])(uint8_t *, int, int *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        init_vp3_bounding_values(bounding_values, rnd() % 128);
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, bounding_values));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, bounding_values));
+    report(name, err, cycles);
+}
+
+static void check_h264_loop_filter(const char *name,
+                                   void (*ref)(uint8_t *, int, int, int, int8_t *),
+                                   void (*opt)(uint8_t *, int, int, int, int8_t *))
+{
+    int alpha = 0, beta = 0;
+    int8_t tc0[4];
+    CHECK_START(void (*fn[2])(uint8_t *, int, int, int, int8_t *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        alpha = rnd() & 255;
+        beta  = rnd() % 19;
+        for (j = 0; j < 4; j++)
+            tc0[j] = rnd() % 27 - 1;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, alpha, beta, tc0));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, alpha, beta, tc0));
+    report(name, err, cycles);
+}
+
+static void check_h264_loop_filter_intra(const char *name,
+                                         void (*ref)(uint8_t *, int, int, int),
+                                         void (*opt)(uint8_t *, int, int, int))
+{
+    int alpha = 0, beta = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, int, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        alpha = rnd() & 255;
+        beta  = rnd() % 19;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, alpha, beta));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, alpha, beta));
+    report(name, err, cycles);
+}
+
+static void check_vp8_loop_filter(const char *name,
+                                  void (*ref)(uint8_t *, int, int, int, int),
+                                  void (*opt)(uint8_t *, int, int, int, int))
+{
+    int flim_e = 0, flim_i = 0, hev_thresh = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, int, int, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        flim_i     = rnd() % 63 + 1;
+        flim_e     = 2 * (rnd() % 66) + flim_i;
+        hev_thresh = rnd() & 3;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, flim_e, flim_i, hev_thresh));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, flim_e, flim_i, hev_thresh));
+    report(name, err, cycles);
+}
+
+static void check_vp8_loop_filter_uv(const char *name,
+                                     void (*ref)(uint8_t *, uint8_t *, int, int, int, int),
+                                     void (*opt)(uint8_t *, uint8_t *, int, int, int, int))
+{
+    int flim_e = 0, flim_i = 0, hev_thresh = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, uint8_t *, int, int, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        flim_i     = rnd() % 63 + 1;
+        flim_e     = 2 * (rnd() % 66) + flim_i;
+        hev_thresh = rnd() & 3;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, dst[j] + PIX_OFF + 32, STRIDE,
+                       flim_e, flim_i, hev_thresh));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, dst[j] + PIX_OFF + 32, STRIDE,
+                     flim_e, flim_i, hev_thresh));
+    report(name, err, cycles);
+}
+
+/* parameter ranges as used by the RV40 decoder */
+static void check_rv40_weak_loop_filter(const char *name,
+                                        void (*ref)(uint8_t *, int, int, int, int,
+                                                    int, int, int, int),
+                                        void (*opt)(uint8_t *, int, int, int, int,
+                                                    int, int, int, int))
+{
+    int filter_p1 = 0, filter_q1 = 0, alpha = 0, beta = 0;
+    int lims = 0, lim_q1 = 0, lim_p1 = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, int, int, int, int, int, int, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        filter_p1 = rnd() & 1;
+        filter_q1 = filter_p1 ? rnd() & 1 : 1;
+        /* alpha and the limits span rv40_alpha_tab and rv40_filter_clip_tbl,
+         * alpha is 128 for all the low quantizers */
+        alpha     = rnd() & 1 ? 128 : rnd() % 127 + 1;
+        beta      = rnd() % 64;
+        lim_q1    = rnd() % 10;
+        lim_p1    = rnd() % 10;
+        lims      = filter_p1 + filter_q1 + ((lim_q1 + lim_p1) >> 1) + 1;
+        if (!filter_p1 || !filter_q1) {
+            lims   >>= 1;
+            lim_q1 >>= 1;
+            lim_p1 >>= 1;
+        }
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, filter_p1, filter_q1,
+                       alpha, beta, lims, lim_q1, lim_p1));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, filter_p1, filter_q1,
+                     alpha, beta, lims, lim_q1, lim_p1));
+    report(name, err, cycles);
+}
+
+static void check_rv40_strong_loop_filter(const char *name,
+                                          void (*ref)(uint8_t *, int, int, int,
+                                                      int, int),
+                                          void (*opt)(uint8_t *, int, int, int,
+                                                      int, int))
+{
+    int alpha = 0, lims = 0, dmode = 0, chroma = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, int, int, int, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        alpha  = rnd() & 1 ? 128 : rnd() % 127 + 1;
+        lims   = rnd() % 12 + 1;
+        dmode  = rnd() % 4 * 4;
+        chroma = rnd() & 1;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, alpha, lims, dmode, chroma));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, STRIDE, alpha, lims, dmode, chroma));
+    report(name, err, cycles);
+}
+
+/* H.264 transforms and intra prediction */
+
+/* position of the nonzero counts of the blocks, from h264.h */
+static const uint8_t scan8[16 + 2 * 4] = {
+    4 + 1 * 8, 5 + 1 * 8, 4 + 2 * 8, 5 + 2 * 8,
+    6 + 1 * 8, 7 + 1 * 8, 6 + 2 * 8, 7 + 2 * 8,
+    4 + 3 * 8, 5 + 3 * 8, 4 + 4 * 8, 5 + 4 * 8,
+    6 + 3 * 8, 7 + 3 * 8, 6 + 4 * 8, 7 + 4 * 8,
+    1 + 1 * 8, 2 + 1 * 8,
+    1 + 2 * 8, 2 + 2 * 8,
+    1 + 4 * 8, 2 + 4 * 8,
+    1 + 5 * 8, 2 + 5 * 8,
+};
+
+/**
+ * Fill the 4x4 blocks of the H.264 batch transforms consistently with the
+ * nonzero counts, which select between the full and the DC-only transform.
+ */
+static void init_h264_blocks(uint8_t *nnzc, int *block_offset, int size8)
+{
+    int step = size8 ? 4 : 1;
+    int i, k;
+
+    memset(nnzc, 0, 6 * 8);
+    fill_coefs(coef[0], NB_COEFS, 255);
+    for (i = 0; i < 24; i += step) {
+        /* empty or DC only, DC only, or any coefficients */
+        int nnz = rnd() % 3;
+        for (k = 0; k < step; k++)
+            nnzc[scan8[i + k]] = nnz;
+        if (nnz < 2)
+            memset(coef[0] + 16 * i + 1, 0, (16 * step - 1) * sizeof(DCTELEM));
+    }
+    memcpy(coef[1], coef[0], sizeof(coef[0]));
+
+    for (i = 0; i < 16; i++)
+        block_offset[i] = 4 * ((i & 1) + 2 * (i >> 2 & 1)) +
+                          4 * STRIDE * ((i >> 1 & 1) + 2 * (i >> 3));
+    for (i = 16; i < 24; i++)
+        block_offset[i] = 4 * (i & 1) + 4 * STRIDE * (i >> 1 & 1);
+}
+
+static void check_h264_idct_batch(const char *name,
+                                  void (*ref)(uint8_t *, const int *, DCTELEM *,
+                                              int, const uint8_t *),
+                                  void (*opt)(uint8_t *, const int *, DCTELEM *,
+                                              int, const uint8_t *), int size8)
+{
+    uint8_t nnzc[6 * 8];
+    int block_offset[24];
+    CHECK_START(void (*fn[2])(uint8_t *, const int *, DCTELEM *, int, const uint8_t *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        init_h264_blocks(nnzc, block_offset, size8);
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, block_offset, coef[j], STRIDE, nnzc));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, block_offset, coef[j], STRIDE, nnzc));
+    report(name, err, cycles);
+}
+
+static void check_h264_idct_add8(const char *name,
+                                 void (*ref)(uint8_t **, const int *, DCTELEM *,
+                                             int, const uint8_t *),
+                                 void (*opt)(uint8_t **, const int *, DCTELEM *,
+                                             int, const uint8_t *))
+{
+    uint8_t nnzc[6 * 8], *dest[2][2];
+    int block_offset[24];
+    CHECK_START(void (*fn[2])(uint8_t **, const int *, DCTELEM *, int, const uint8_t *))
+
+    for (j = 0; j < 2; j++) {
+        dest[j][0] = dst[j] + PIX_OFF;
+        dest[j][1] = dst[j] + PIX_OFF + 16;
+    }
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        init_h264_blocks(nnzc, block_offset, 0);
+        RUN_BOTH(fn[j](dest[j], block_offset, coef[j], STRIDE, nnzc));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dest[j], block_offset, coef[j], STRIDE, nnzc));
+    report(name, err, cycles);
+}
+
+static void check_pred4x4(const char *name,
+                          void (*ref)(uint8_t *, const uint8_t *, int),
+                          void (*opt)(uint8_t *, const uint8_t *, int))
+{
+    CHECK_START(void (*fn[2])(uint8_t *, const uint8_t *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, dst[j] + PIX_OFF - STRIDE + 4, STRIDE));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, dst[j] + PIX_OFF - STRIDE + 4, STRIDE));
+    report(name, err, cycles);
+}
+
+static void check_pred8x8l(const char *name,
+                           void (*ref)(uint8_t *, int, int, int),
+                           void (*opt)(uint8_t *, int, int, int))
+{
+    int topleft = 0, topright = 0;
+    CHECK_START(void (*fn[2])(uint8_t *, int, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        topleft  = i & 1;
+        topright = i >> 1 & 1;
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, topleft, topright, STRIDE));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, topleft, topright, STRIDE));
+    report(name, err, cycles);
+}
+
+static void check_pred_add(const char *name,
+                           void (*ref)(uint8_t *, const DCTELEM *, int),
+                           void (*opt)(uint8_t *, const DCTELEM *, int))
+{
+    CHECK_START(void (*fn[2])(uint8_t *, const DCTELEM *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        init_coefs(255);
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, coef[j], STRIDE));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, coef[j], STRIDE));
+    report(name, err, cycles);
+}
+
+static void check_pred_add_offset(const char *name,
+                                  void (*ref)(uint8_t *, const int *,
+                                              const DCTELEM *, int),
+                                  void (*opt)(uint8_t *, const int *,
+                                              const DCTELEM *, int))
+{
+    uint8_t nnzc[6 * 8];
+    int block_offset[24];
+    CHECK_START(void (*fn[2])(uint8_t *, const int *, const DCTELEM *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        init_h264_blocks(nnzc, block_offset, 0);
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, block_offset, coef[j], STRIDE));
+        err = compare_dst();
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, block_offset, coef[j], STRIDE));
+    report(name, err, cycles);
+}
+
+/* VP8 transforms */
+
+static void check_vp8_luma_dc_wht(const char *name,
+                                  void (*ref)(DCTELEM (*)[4][16], DCTELEM *),
+                                  void (*opt)(DCTELEM (*)[4][16], DCTELEM *))
+{
+    DECLARE_ALIGNED(16, DCTELEM, dc)[2][16];
+    CHECK_START(void (*fn[2])(DCTELEM (*)[4][16], DCTELEM *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_coefs(255);
+        fill_coefs(dc[0], 16, 2047);
+        memcpy(dc[1], dc[0], sizeof(dc[0]));
+        RUN_BOTH(fn[j]((DCTELEM (*)[4][16])coef[j], dc[j]));
+        err = memcmp(coef[0], coef[1], sizeof(coef[0])) ||
+              memcmp(dc[0], dc[1], sizeof(dc[0]));
+    }
+    BENCH_BOTH(fn[j]((DCTELEM (*)[4][16])coef[j], dc[j]));
+    report(name, err, cycles);
+}
+
+static void check_vp8_idct_dc_add4(const char *name,
+                                   void (*ref)(uint8_t *, DCTELEM (*)[16], int),
+                                   void (*opt)(uint8_t *, DCTELEM (*)[16], int))
+{
+    CHECK_START(void (*fn[2])(uint8_t *, DCTELEM (*)[16], int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_dst();
+        fill_coefs(coef[0], NB_COEFS, 2047);
+        for (j = 0; j < NB_COEFS; j++)
+            if (j & 15)
+                coef[0][j] = 0;
+        memcpy(coef[1], coef[0], sizeof(coef[0]));
+        RUN_BOTH(fn[j](dst[j] + PIX_OFF, (DCTELEM (*)[16])coef[j], STRIDE));
+        err = compare_dst() || memcmp(coef[0], coef[1], sizeof(coef[0]));
+    }
+    BENCH_BOTH(fn[j](dst[j] + PIX_OFF, (DCTELEM (*)[16])coef[j], STRIDE));
+    report(name, err, cycles);
+}
+
+/* audio */
+
+static void check_vector_fmul(const char *name,
+                              void (*ref)(float *, const float *, int),
+                              void (*opt)(float *, const float *, int))
+{
+    CHECK_START(void (*fn[2])(float *, const float *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fsrc[0], FLOAT_LEN);
+        fill_floats(fdst[0], FLOAT_LEN);
+        memcpy(fdst[1], fdst[0], FLOAT_LEN * sizeof(float));
+        RUN_BOTH(fn[j](fdst[j], fsrc[0], FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], fsrc[0], FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_vector_fmul2(const char *name,
+                               void (*ref)(float *, const float *,
+                                           const float *, int),
+                               void (*opt)(float *, const float *,
+                                           const float *, int))
+{
+    CHECK_START(void (*fn[2])(float *, const float *, const float *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fsrc[0], FLOAT_LEN);
+        fill_floats(fsrc[1], FLOAT_LEN);
+        RUN_BOTH(fn[j](fdst[j], fsrc[0], fsrc[1], FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], fsrc[0], fsrc[1], FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_vector_fmul_add(const char *name,
+                                  void (*ref)(float *, const float *, const float *,
+                                              const float *, int),
+                                  void (*opt)(float *, const float *, const float *,
+                                              const float *, int))
+{
+    CHECK_START(void (*fn[2])(float *, const float *, const float *, const float *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fsrc[0], FLOAT_LEN);
+        fill_floats(fsrc[1], FLOAT_LEN);
+        fill_floats(fsrc[2], FLOAT_LEN);
+        RUN_BOTH(fn[j](fdst[j], fsrc[0], fsrc[1], fsrc[2], FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], fsrc[0], fsrc[1], fsrc[2], FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_vector_fmul_window(const char *name,
+                                     void (*ref)(float *, const float *, const float *,
+                                                 const float *, float, int),
+                                     void (*opt)(float *, const float *, const float *,
+                                                 const float *, float, int))
+{
+    float bias = 0;
+    CHECK_START(void (*fn[2])(float *, const float *, const float *, const float *,
+                         float, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fsrc[0], FLOAT_LEN);
+        fill_floats(fsrc[1], FLOAT_LEN);
+        fill_floats(fsrc[2], 2 * FLOAT_LEN);
+        bias = i & 1 ? 385 : 0;
+        RUN_BOTH(fn[j](fdst[j], fsrc[0], fsrc[1], fsrc[2], bias, FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], 2 * FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], fsrc[0], fsrc[1], fsrc[2], bias, FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_vector_fmul_scalar(const char *name,
+                                     void (*ref)(float *, const float *, float, int),
+                                     void (*opt)(float *, const float *, float, int))
+{
+    float mul = 0;
+    CHECK_START(void (*fn[2])(float *, const float *, float, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fsrc[0], FLOAT_LEN);
+        mul = fsrc[0][0] * 4;
+        RUN_BOTH(fn[j](fdst[j], fsrc[0], mul, FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], fsrc[0], mul, FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_vector_fmul_sv_scalar(const char *name,
+                                        void (*ref)(float *, const float *,
+                                                    const float **, float, int),
+                                        void (*opt)(float *, const float *,
+                                                    const float **, float, int),
+                                        int sv_len)
+{
+    const float *sv[FLOAT_LEN / 2];
+    float mul = 0;
+    CHECK_START(void (*fn[2])(float *, const float *, const float **, float, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fsrc[0], FLOAT_LEN);
+        fill_floats(fsrc[1], FLOAT_LEN);
+        for (j = 0; j < FLOAT_LEN / sv_len; j++)
+            sv[j] = fsrc[1] + sv_len * (rnd() % (FLOAT_LEN / sv_len));
+        mul = fsrc[0][0] * 4;
+        RUN_BOTH(fn[j](fdst[j], fsrc[0], sv, mul, FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], fsrc[0], sv, mul, FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_sv_fmul_scalar(const char *name,
+                                 void (*ref)(float *, const float **, float, int),
+                                 void (*opt)(float *, const float **, float, int),
+                                 int sv_len)
+{
+    const float *sv[FLOAT_LEN / 2];
+    float mul = 0;
+    CHECK_START(void (*fn[2])(float *, const float **, float, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fsrc[1], FLOAT_LEN);
+        for (j = 0; j < FLOAT_LEN / sv_len; j++)
+            sv[j] = fsrc[1] + sv_len * (rnd() % (FLOAT_LEN / sv_len));
+        mul = fsrc[1][0] * 4;
+        RUN_BOTH(fn[j](fdst[j], sv, mul, FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], sv, mul, FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_int32_to_float(const char *name,
+                                 void (*ref)(float *, const int *, float, int),
+                                 void (*opt)(float *, const int *, float, int))
+{
+    float mul = 0;
+    CHECK_START(void (*fn[2])(float *, const int *, float, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        for (j = 0; j < FLOAT_LEN; j++)
+            isrc[j] = rnd();
+        mul = 1.0 / (1 << (rnd() % 31));
+        RUN_BOTH(fn[j](fdst[j], isrc, mul, FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], isrc, mul, FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_vector_clipf(const char *name,
+                               void (*ref)(float *, const float *, float, float, int),
+                               void (*opt)(float *, const float *, float, float, int))
+{
+    float min = 0, max = 0;
+    CHECK_START(void (*fn[2])(float *, const float *, float, float, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fsrc[0], FLOAT_LEN);
+        min = -fabsf(fsrc[0][0]);
+        max = i & 1 ? fabsf(fsrc[0][1]) : min / 2;
+        RUN_BOTH(fn[j](fdst[j], fsrc[0], min, max, FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], FLOAT_LEN, 0);
+    }
+    BENCH_BOTH(fn[j](fdst[j], fsrc[0], min, max, FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_scalarproduct_float(const char *name,
+                                      float (*ref)(const float *, const float *, int),
+                                      float (*opt)(const float *, const float *, int))
+{
+    float res[2];
+    CHECK_START(float (*fn[2])(const float *, const float *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fsrc[0], FLOAT_LEN);
+        fill_floats(fsrc[1], FLOAT_LEN);
+        RUN_BOTH(res[j] = fn[j](fsrc[0], fsrc[1], FLOAT_LEN));
+        /* the order of the additions differs */
+        err = compare_floats(&res[0], &res[1], 1, 1e-4);
+    }
+    BENCH_BOTH(fn[j](fsrc[0], fsrc[1], FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_butterflies_float(const char *name,
+                                    void (*ref)(float *, float *, int),
+                                    void (*opt)(float *, float *, int))
+{
+    CHECK_START(void (*fn[2])(float *, float *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fdst[0], 2 * FLOAT_LEN);
+        memcpy(fdst[1], fdst[0], 2 * FLOAT_LEN * sizeof(float));
+        RUN_BOTH(fn[j](fdst[j], fdst[j] + FLOAT_LEN, FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], 2 * FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], fdst[j] + FLOAT_LEN, FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_vorbis_coupling(const char *name,
+                                  void (*ref)(float *, float *, int),
+                                  void (*opt)(float *, float *, int))
+{
+    CHECK_START(void (*fn[2])(float *, float *, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fdst[0], 2 * FLOAT_LEN);
+        memcpy(fdst[1], fdst[0], 2 * FLOAT_LEN * sizeof(float));
+        RUN_BOTH(fn[j](fdst[j], fdst[j] + FLOAT_LEN, FLOAT_LEN));
+        err = compare_floats(fdst[0], fdst[1], 2 * FLOAT_LEN, 1e-6);
+    }
+    BENCH_BOTH(fn[j](fdst[j], fdst[j] + FLOAT_LEN, FLOAT_LEN));
+    report(name, err, cycles);
+}
+
+static void check_ac3_downmix(const char *name,
+                              void (*ref)(float (*)[256], float (*)[2], int, int, int),
+                              void (*opt)(float (*)[256], float (*)[2], int, int, int))
+{
+    DECLARE_ALIGNED(16, float, samples)[2][6][256];
+    DECLARE_ALIGNED(16, float, matrix)[6][2];
+    int out_ch = 0, in_ch = 0;
+    CHECK_START(void (*fn[2])(float (*)[256], float (*)[2], int, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(samples[0][0], 6 * 256);
+        memcpy(samples[1], samples[0], sizeof(samples[0]));
+        fill_floats(matrix[0], 6 * 2);
+        out_ch = 1 + (i & 1);
+        in_ch  = out_ch + 1 + rnd() % (6 - out_ch);
+        RUN_BOTH(fn[j](samples[j], matrix, out_ch, in_ch, 256));
+        err = compare_floats(samples[0][0], samples[1][0], 6 * 256, 1e-5);
+    }
+    BENCH_BOTH(fn[j](samples[j], matrix, out_ch, in_ch, 256));
+    report(name, err, cycles);
+}
+
+static void check_lpc_autocorr(const char *name,
+                               void (*ref)(const int32_t *, int, int, double *),
+                               void (*opt)(const int32_t *, int, int, double *))
+{
+    double autoc[2][33];
+    int len = 0, lag = 0, k;
+    CHECK_START(void (*fn[2])(const int32_t *, int, int, double *))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        for (j = 0; j < FLOAT_LEN; j++)
+            isrc[j] = (int)(rnd() & 0xFFFF) - 0x8000;
+        /* the SSE2 Welch window needs a multiple of 4, as the FLAC block sizes */
+        len = FLOAT_LEN - 4 * (rnd() % 16);
+        lag = rnd() % 32 + 1;
+        RUN_BOTH(fn[j](isrc, len, lag, autoc[j]));
+        for (k = 0; k <= lag; k++)
+            err |= fabs(autoc[0][k] - autoc[1][k]) > 1e-9 * fabs(autoc[0][0]);
+    }
+    BENCH_BOTH(fn[j](isrc, len, lag, autoc[j]));
+    report(name, err, cycles);
+}
+
+static void check_scalarproduct_int16(const char *name,
+                                      int32_t (*ref)(const int16_t *, const int16_t *,
+                                                     int, int),
+                                      int32_t (*opt)(const int16_t *, const int16_t *,
+                                                     int, int))
+{
+    int32_t res[2];
+    int len = 0;
+    CHECK_START(int32_t (*fn[2])(const int16_t *, const int16_t *, int, int))
+
+    /* only without shift, the C version shifts the products, not the sums */
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_coefs(1024);
+        len = 16 * (rnd() % (NB_COEFS / 32) + 1);
+        RUN_BOTH(res[j] = fn[j](coef[0], coef[0] + NB_COEFS / 2, len, 0));
+        err = res[0] != res[1];
+    }
+    BENCH_BOTH(fn[j](coef[0], coef[0] + NB_COEFS / 2, len, 0));
+    report(name, err, cycles);
+}
+
+static void check_scalarproduct_and_madd_int16(const char *name,
+                                               int32_t (*ref)(int16_t *, const int16_t *,
+                                                              const int16_t *, int, int),
+                                               int32_t (*opt)(int16_t *, const int16_t *,
+                                                              const int16_t *, int, int))
+{
+    int32_t res[2];
+    int len = 0, mul = 0;
+    CHECK_START(int32_t (*fn[2])(int16_t *, const int16_t *, const int16_t *, int, int))
+
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        init_coefs(1024);
+        len = 16 * (rnd() % (NB_COEFS / 48) + 1);
+        mul = (int)(rnd() % 33) - 16;
+        RUN_BOTH(res[j] = fn[j](coef[j], coef[j] + NB_COEFS / 3,
+                                coef[j] + 2 * NB_COEFS / 3, len, mul));
+        err = res[0] != res[1] || memcmp(coef[0], coef[1], sizeof(coef[0]));
+    }
+    BENCH_BOTH(fn[j](coef[j], coef[j] + NB_COEFS / 3,
+                     coef[j] + 2 * NB_COEFS / 3, len, mul));
+    report(name, err, cycles);
+}
+
+static void check_fft(const char *name, FFTContext *ref_s, FFTContext *opt_s)
+{
+    FFTContext *s[2] = { ref_s, opt_s };
+    FFTComplex *z[2] = { (FFTComplex *)fdst[0], (FFTComplex *)fdst[1] };
+    int n = 1 << ref_s->nbits;
+    void (*ref)(FFTContext *, FFTComplex *) = ref_s->fft_calc;
+    void (*opt)(FFTContext *, FFTComplex *) = opt_s->fft_calc;
+    CHECK_START(void (*fn[2])(FFTContext *, FFTComplex *))
+
+    /* the output is compared in natural order */
+    if (opt_s->permutation != FF_MDCT_PERM_NONE)
+        return;
+    for (i = 0; i < NB_TRIALS && !err; i++) {
+        fill_floats(fdst[0], 2 * n);
+        memcpy(fdst[1], fdst[0], 2 * n * sizeof(float));
+        RUN_BOTH(s[j]->fft_permute(s[j], z[j]));
+        RUN_BOTH(fn[j](s[j], z[j]));
+        err = compare_floats(fdst[0], fdst[1], 2 * n, 1e-5 * (ref_s->nbits + 1));
+    }
+    BENCH_BOTH(fn[j](s[j], z[j]));
+    report(name, err, cycles);
+}
+
+static void check_mdct(const char *name, FFTContext *ref_s, FFTContext *opt_s,
+                       int which)
+{
+    FFTContext *s[2] = { ref_s, opt_s };
+    int n = 1 << ref_s->mdct_bits;
+    void (*ref)(FFTContext *, FFTSample *, const FFTSample *);
+    void (*opt)(FFTContext *, FFTSample *, const FFTSample *);
+    ref = which == 0 ? ref_s->imdct_calc : which == 1 ? ref_s->imdct_half : ref_s->mdct_calc;
+    opt = which == 0 ? opt_s->imdct_calc : which == 1 ? opt_s->imdct_half : opt_s->mdct_calc;
+    {
+        CHECK_START(void (*fn[2])(FFTContext *, FFTSample *, const FFTSample *))
+
+        for (i = 0; i < NB_TRIALS && !err; i++) {
+            fill_floats(fsrc[0], n);
+            RUN_BOTH(fn[j](s[j], fdst[j], fsrc[0]));
+            err = compare_floats(fdst[0], fdst[1], which ? n / 2 : n,
+                                 1e-5 * (ref_s->nbits + 1));
+        }
+        BENCH_BOTH(fn[j](s[j], fdst[j], fsrc[0]));
+        report(name, err, cycles);
+    }
+}
+
+/* Check every function of the contexts initialized with the CPU flags. */
+
+static void check_dsputil(DSPContext *ref, DSPContext *opt)
+{
+    static const char *mc_names[4] = { "put", "avg", "put_no_rnd", "avg_no_rnd" };
+    op_pixels_func (*ref_pix[4])[4] = {
+        ref->put_pixels_tab,        ref->avg_pixels_tab,
+        ref->put_no_rnd_pixels_tab, ref->avg_no_rnd_pixels_tab };
+    op_pixels_func (*opt_pix[4])[4] = {
+        opt->put_pixels_tab,        opt->avg_pixels_tab,
+        opt->put_no_rnd_pixels_tab, opt->avg_no_rnd_pixels_tab };
+    qpel_mc_func (*ref_qpel[4])[16] = {
+        ref->put_qpel_pixels_tab,        ref->avg_qpel_pixels_tab,
+        ref->put_no_rnd_qpel_pixels_tab, ref->avg_no_rnd_qpel_pixels_tab };
+    qpel_mc_func (*opt_qpel[4])[16] = {
+        opt->put_qpel_pixels_tab,        opt->avg_qpel_pixels_tab,
+        opt->put_no_rnd_qpel_pixels_tab, opt->avg_no_rnd_qpel_pixels_tab };
+    int op, i, k;
+
+    for (op = 0; op < 4; op++) {
+        for (i = 0; i < 4; i++)
+            for (k = 0; k < 4; k++)
+                check_pixels(func_name("%s_pixels_tab[%d][%d]", mc_names[op], i, k),
+                             ref_pix[op][i][k], opt_pix[op][i][k],
+                             16 >> i, 16 >> i);
+        for (i = 0; i < 2; i++)
+            for (k = 0; k < 16; k++)
+                check_qpel(func_name("%s_qpel_pixels_tab[%d][%d]", mc_names[op], i, k),
+                           ref_qpel[op][i][k], opt_qpel[op][i][k]);
+    }
+    for (i = 0; i < 2; i++)
+        check_pixels_l2(func_name("put_no_rnd_pixels_l2[%d]", i),
+                        ref->put_no_rnd_pixels_l2[i], opt->put_no_rnd_pixels_l2[i],
+                        16 >> i);
+    for (i = 0; i < 8; i++)
+        check_qpel(func_name("put_mspel_pixels_tab[%d]", i),
+                   ref->put_mspel_pixels_tab[i], opt->put_mspel_pixels_tab[i]);
+    for (i = 0; i < 4; i++) {
+        for (k = 0; k < 16; k++) {
+            check_qpel(func_name("put_h264_qpel_pixels_tab[%d][%d]", i, k),
+                       ref->put_h264_qpel_pixels_tab[i][k],
+                       opt->put_h264_qpel_pixels_tab[i][k]);
+            check_qpel(func_name("avg_h264_qpel_pixels_tab[%d][%d]", i, k),
+                       ref->avg_h264_qpel_pixels_tab[i][k],
+                       opt->avg_h264_qpel_pixels_tab[i][k]);
+            check_qpel(func_name("put_rv30_tpel_pixels_tab[%d][%d]", i, k),
+                       ref->put_rv30_tpel_pixels_tab[i][k],
+                       opt->put_rv30_tpel_pixels_tab[i][k]);
+            check_qpel(func_name("avg_rv30_tpel_pixels_tab[%d][%d]", i, k),
+                       ref->avg_rv30_tpel_pixels_tab[i][k],
+                       opt->avg_rv30_tpel_pixels_tab[i][k]);
+            check_qpel(func_name("put_rv40_qpel_pixels_tab[%d][%d]", i, k),
+                       ref->put_rv40_qpel_pixels_tab[i][k],
+                       opt->put_rv40_qpel_pixels_tab[i][k]);
+            check_qpel(func_name("avg_rv40_qpel_pixels_tab[%d][%d]", i, k),
+                       ref->avg_rv40_qpel_pixels_tab[i][k],
+                       opt->avg_rv40_qpel_pixels_tab[i][k]);
+        }
+    }
+    for (i = 0; i < 3; i++) {
+        check_chroma(func_name("put_h264_chroma_pixels_tab[%d]", i),
+                     ref->put_h264_chroma_pixels_tab[i],
+                     opt->put_h264_chroma_pixels_tab[i], 8 >> i);
+        check_chroma(func_name("avg_h264_chroma_pixels_tab[%d]", i),
+                     ref->avg_h264_chroma_pixels_tab[i],
+                     opt->avg_h264_chroma_pixels_tab[i], 8 >> i);
+        check_chroma(func_name("put_no_rnd_vc1_chroma_pixels_tab[%d]", i),
+                     ref->put_no_rnd_vc1_chroma_pixels_tab[i],
+                     opt->put_no_rnd_vc1_chroma_pixels_tab[i], 8 >> i);
+        check_chroma(func_name("avg_no_rnd_vc1_chroma_pixels_tab[%d]", i),
+                     ref->avg_no_rnd_vc1_chroma_pixels_tab[i],
+                     opt->avg_no_rnd_vc1_chroma_pixels_tab[i], 8 >> i);
+        check_chroma(func_name("put_rv40_chroma_pixels_tab[%d]", i),
+                     ref->put_rv40_chroma_pixels_tab[i],
+                     opt->put_rv40_chroma_pixels_tab[i], 8 >> i);
+        check_chroma(func_name("avg_rv40_chroma_pixels_tab[%d]", i),
+                     ref->avg_rv40_chroma_pixels_tab[i],
+                     opt->avg_rv40_chroma_pixels_tab[i], 8 >> i);
+    }
+    /* the last argument is the rounding mode instead of the height */
+    for (i = 0; i < 16; i++) {
+        check_pixels(func_name("put_vc1_mspel_pixels_tab[%d]", i),
+                     ref->put_vc1_mspel_pixels_tab[i],
+                     opt->put_vc1_mspel_pixels_tab[i], 0, 1);
+        check_pixels(func_name("avg_vc1_mspel_pixels_tab[%d]", i),
+                     ref->avg_vc1_mspel_pixels_tab[i],
+                     opt->avg_vc1_mspel_pixels_tab[i], 0, 1);
+    }
+    check_gmc("gmc", ref->gmc, opt->gmc);
+
+    /* widths 16, 8 and 4 with the height equal to the width */
+    for (i = 0; i < 3; i++) {
+        check_cmp(func_name("sad[%d]", i), ref->sad[i], opt->sad[i], 16 >> i);
+        check_cmp(func_name("sse[%d]", i), ref->sse[i], opt->sse[i], 16 >> i);
+        check_cmp(func_name("hadamard8_diff[%d]", i), ref->hadamard8_diff[i],
+                  opt->hadamard8_diff[i], 16 >> i);
+        check_cmp(func_name("vsad[%d]", i), ref->vsad[i], opt->vsad[i], 16 >> i);
+        check_cmp(func_name("vsse[%d]", i), ref->vsse[i], opt->vsse[i], 16 >> i);
+        check_cmp(func_name("nsse[%d]", i), ref->nsse[i], opt->nsse[i], 16 >> i);
+        check_cmp(func_name("w53[%d]", i), ref->w53[i], opt->w53[i], 16 >> i);
+        check_cmp(func_name("w97[%d]", i), ref->w97[i], opt->w97[i], 16 >> i);
+    }
+    for (i = 0; i < 2; i++)
+        for (k = 0; k < 4; k++)
+            check_cmp(func_name("pix_abs[%d][%d]", i, k), ref->pix_abs[i][k],
+                      opt->pix_abs[i][k], 16 >> i);
+
+    check_get_pixels("get_pixels", ref->get_pixels, opt->get_pixels);
+    check_diff_pixels("diff_pixels", ref->diff_pixels, opt->diff_pixels);
+    check_put_block("put_pixels_clamped", ref->put_pixels_clamped,
+                    opt->put_pixels_clamped);
+    check_put_block("put_signed_pixels_clamped", ref->put_signed_pixels_clamped,
+                    opt->put_signed_pixels_clamped);
+    check_put_block("put_pixels_nonclamped", ref->put_pixels_nonclamped,
+                    opt->put_pixels_nonclamped);
+    check_put_block("add_pixels_clamped", ref->add_pixels_clamped,
+                    opt->add_pixels_clamped);
+    check_add_block("add_pixels8", ref->add_pixels8, opt->add_pixels8, 255, 0, 1);
+    check_add_block("add_pixels4", ref->add_pixels4, opt->add_pixels4, 255, 0, 1);
+    check_sum_abs("sum_abs_dctelem", ref->sum_abs_dctelem, opt->sum_abs_dctelem);
+    check_block("clear_block", ref->clear_block, opt->clear_block, 255);
+    check_block("clear_blocks", ref->clear_blocks, opt->clear_blocks, 255);
+    check_pix_sum("pix_sum", ref->pix_sum, opt->pix_sum);
+    check_pix_sum("pix_norm1", ref->pix_norm1, opt->pix_norm1);
+    check_ssd_int8_vs_int16("ssd_int8_vs_int16", ref->ssd_int8_vs_int16,
+                            opt->ssd_int8_vs_int16);
+
+    check_add_bytes("add_bytes", ref->add_bytes, opt->add_bytes);
+    check_bytes("add_bytes_l2", ref->add_bytes_l2, opt->add_bytes_l2, 0);
+    check_bytes("diff_bytes", ref->diff_bytes, opt->diff_bytes, 1);
+    check_median_pred("add_hfyu_median_prediction", ref->add_hfyu_median_prediction,
+                      opt->add_hfyu_median_prediction);
+    check_median_pred("sub_hfyu_median_prediction", ref->sub_hfyu_median_prediction,
+                      opt->sub_hfyu_median_prediction);
+    check_left_pred("add_hfyu_left_prediction", ref->add_hfyu_left_prediction,
+                    opt->add_hfyu_left_prediction);
+    check_paeth_pred("add_png_paeth_prediction", ref->add_png_paeth_prediction,
+                     opt->add_png_paeth_prediction);
+    check_bswap_buf("bswap_buf", ref->bswap_buf, opt->bswap_buf);
+    check_draw_edges("draw_edges", ref->draw_edges, opt->draw_edges);
+
+    check_loop_filter("h263_v_loop_filter", ref->h263_v_loop_filter,
+                      opt->h263_v_loop_filter, 31);
+    check_loop_filter("h263_h_loop_filter", ref->h263_h_loop_filter,
+                      opt->h263_h_loop_filter, 31);
+    check_filter("h261_loop_filter", ref->h261_loop_filter, opt->h261_loop_filter);
+    check_loop_filter("x8_v_loop_filter", ref->x8_v_loop_filter,
+                      opt->x8_v_loop_filter, 31);
+    check_loop_filter("x8_h_loop_filter", ref->x8_h_loop_filter,
+                      opt->x8_h_loop_filter, 31);
+    check_vp3_loop_filter("vp3_v_loop_filter", ref->vp3_v_loop_filter,
+                          opt->vp3_v_loop_filter);
+    check_vp3_loop_filter("vp3_h_loop_filter", ref->vp3_h_loop_filter,
+                          opt->vp3_h_loop_filter);
+    check_add_block2("vp3_idct_dc_add", (void (*)(uint8_t *, int, DCTELEM *))ref->vp3_idct_dc_add,
+                     (void (*)(uint8_t *, int, DCTELEM *))opt->vp3_idct_dc_add, 2047, 1);
+
+    check_block("vc1_inv_trans_8x8", ref->vc1_inv_trans_8x8,
+                opt->vc1_inv_trans_8x8, 255);
+    check_add_block2("vc1_inv_trans_8x4", ref->vc1_inv_trans_8x4,
+                     opt->vc1_inv_trans_8x4, 255, 0);
+    check_add_block2("vc1_inv_trans_4x8", ref->vc1_inv_trans_4x8,
+                     opt->vc1_inv_trans_4x8, 255, 0);
+    check_add_block2("vc1_inv_trans_4x4", ref->vc1_inv_trans_4x4,
+                     opt->vc1_inv_trans_4x4, 255, 0);
+    check_add_block2("vc1_inv_trans_8x8_dc", ref->vc1_inv_trans_8x8_dc,
+                     opt->vc1_inv_trans_8x8_dc, 255, 1);
+    check_add_block2("vc1_inv_trans_8x4_dc", ref->vc1_inv_trans_8x4_dc,
+                     opt->vc1_inv_trans_8x4_dc, 255, 1);
+    check_add_block2("vc1_inv_trans_4x8_dc", ref->vc1_inv_trans_4x8_dc,
+                     opt->vc1_inv_trans_4x8_dc, 255, 1);
+    check_add_block2("vc1_inv_trans_4x4_dc", ref->vc1_inv_trans_4x4_dc,
+                     opt->vc1_inv_trans_4x4_dc, 255, 1);
+    check_filter("vc1_v_overlap", ref->vc1_v_overlap, opt->vc1_v_overlap);
+    check_filter("vc1_h_overlap", ref->vc1_h_overlap, opt->vc1_h_overlap);
+    check_loop_filter("vc1_v_loop_filter4", ref->vc1_v_loop_filter4,
+                      opt->vc1_v_loop_filter4, 31);
+    check_loop_filter("vc1_h_loop_filter4", ref->vc1_h_loop_filter4,
+                      opt->vc1_h_loop_filter4, 31);
+    check_loop_filter("vc1_v_loop_filter8", ref->vc1_v_loop_filter8,
+                      opt->vc1_v_loop_filter8, 31);
+    check_loop_filter("vc1_h_loop_filter8", ref->vc1_h_loop_filter8,
+                      opt->vc1_h_loop_filter8, 31);
+    check_loop_filter("vc1_v_loop_filter16", ref->vc1_v_loop_filter16,
+                      opt->vc1_v_loop_filter16, 31);
+    check_loop_filter("vc1_h_loop_filter16", ref->vc1_h_loop_filter16,
+                      opt->vc1_h_loop_filter16, 31);
+    for (i = 0; i < 2; i++) {
+        check_rv40_weak_loop_filter(func_name("rv40_weak_loop_filter[%d]", i),
+                                    ref->rv40_weak_loop_filter[i],
+                                    opt->rv40_weak_loop_filter[i]);
+        check_rv40_strong_loop_filter(func_name("rv40_strong_loop_filter[%d]", i),
+                                      ref->rv40_strong_loop_filter[i],
+                                      opt->rv40_strong_loop_filter[i]);
+    }
+
+    check_vorbis_coupling("vorbis_inverse_coupling", ref->vorbis_inverse_coupling,
+                          opt->vorbis_inverse_coupling);
+    check_ac3_downmix("ac3_downmix", ref->ac3_downmix, opt->ac3_downmix);
+    check_lpc_autocorr("lpc_compute_autocorr", ref->lpc_compute_autocorr,
+                       opt->lpc_compute_autocorr);
+    check_vector_fmul("vector_fmul", ref->vector_fmul, opt->vector_fmul);
+    check_vector_fmul2("vector_fmul_reverse", ref->vector_fmul_reverse,
+                       opt->vector_fmul_reverse);
+    check_vector_fmul_add("vector_fmul_add", ref->vector_fmul_add,
+                          opt->vector_fmul_add);
+    check_vector_fmul_window("vector_fmul_window", ref->vector_fmul_window,
+                             opt->vector_fmul_window);
+    check_int32_to_float("int32_to_float_fmul_scalar", ref->int32_to_float_fmul_scalar,
+                         opt->int32_to_float_fmul_scalar);
+    check_vector_clipf("vector_clipf", ref->vector_clipf, opt->vector_clipf);
+    check_vector_fmul_scalar("vector_fmul_scalar", ref->vector_fmul_scalar,
+                             opt->vector_fmul_scalar);
+    for (i = 0; i < 2; i++) {
+        check_vector_fmul_sv_scalar(func_name("vector_fmul_sv_scalar[%d]", i),
+                                    ref->vector_fmul_sv_scalar[i],
+                                    opt->vector_fmul_sv_scalar[i], 2 << i);
+        check_sv_fmul_scalar(func_name("sv_fmul_scalar[%d]", i),
+                             ref->sv_fmul_scalar[i], opt->sv_fmul_scalar[i], 2 << i);
+    }
+    check_scalarproduct_float("scalarproduct_float", ref->scalarproduct_float,
+                              opt->scalarproduct_float);
+    check_butterflies_float("butterflies_float", ref->butterflies_float,
+                            opt->butterflies_float);
+    check_scalarproduct_int16("scalarproduct_int16", ref->scalarproduct_int16,
+                              opt->scalarproduct_int16);
+    check_scalarproduct_and_madd_int16("scalarproduct_and_madd_int16",
+                                       ref->scalarproduct_and_madd_int16,
+                                       opt->scalarproduct_and_madd_int16);
+}
+
+static void check_h264dsp(H264DSPContext *ref, H264DSPContext *opt)
+{
+    int i;
+
+    for (i = 0; i < 10; i++) {
+        check_h264_weight(func_name("weight_h264_pixels_tab[%d]", i),
+                          ref->weight_h264_pixels_tab[i],
+                          opt->weight_h264_pixels_tab[i]);
+        check_h264_biweight(func_name("biweight_h264_pixels_tab[%d]", i),
+                            ref->biweight_h264_pixels_tab[i],
+                            opt->biweight_h264_pixels_tab[i]);
+    }
+    check_h264_loop_filter("h264_v_loop_filter_luma", ref->h264_v_loop_filter_luma,
+                           opt->h264_v_loop_filter_luma);
+    check_h264_loop_filter("h264_h_loop_filter_luma", ref->h264_h_loop_filter_luma,
+                           opt->h264_h_loop_filter_luma);
+    check_h264_loop_filter_intra("h264_v_loop_filter_luma_intra",
+                                 ref->h264_v_loop_filter_luma_intra,
+                                 opt->h264_v_loop_filter_luma_intra);
+    check_h264_loop_filter_intra("h264_h_loop_filter_luma_intra",
+                                 ref->h264_h_loop_filter_luma_intra,
+                                 opt->h264_h_loop_filter_luma_intra);
+    check_h264_loop_filter("h264_v_loop_filter_chroma", ref->h264_v_loop_filter_chroma,
+                           opt->h264_v_loop_filter_chroma);
+    check_h264_loop_filter("h264_h_loop_filter_chroma", ref->h264_h_loop_filter_chroma,
+                           opt->h264_h_loop_filter_chroma);
+    check_h264_loop_filter_intra("h264_v_loop_filter_chroma_intra",
+                                 ref->h264_v_loop_filter_chroma_intra,
+                                 opt->h264_v_loop_filter_chroma_intra);
+    check_h264_loop_filter_intra("h264_h_loop_filter_chroma_intra",
+                                 ref->h264_h_loop_filter_chroma_intra,
+                                 opt->h264_h_loop_filter_chroma_intra);
+
+    /* the C transforms modify the coefficients, only the output is compared */
+    check_add_block("h264_idct_add", ref->h264_idct_add, opt->h264_idct_add,
+                    255, 0, 0);
+    check_add_block("h264_idct8_add", ref->h264_idct8_add, opt->h264_idct8_add,
+                    255, 0, 0);
+    check_add_block("h264_idct_dc_add", ref->h264_idct_dc_add,
+                    opt->h264_idct_dc_add, 2047, 1, 0);
+    check_add_block("h264_idct8_dc_add", ref->h264_idct8_dc_add,
+                    opt->h264_idct8_dc_add, 2047, 1, 0);
+    check_h264_idct_batch("h264_idct_add16", ref->h264_idct_add16,
+                          opt->h264_idct_add16, 0);
+    check_h264_idct_batch("h264_idct_add16intra", ref->h264_idct_add16intra,
+                          opt->h264_idct_add16intra, 0);
+    check_h264_idct_batch("h264_idct8_add4", ref->h264_idct8_add4,
+                          opt->h264_idct8_add4, 1);
+    check_h264_idct_add8("h264_idct_add8", ref->h264_idct_add8, opt->h264_idct_add8);
+}
+
+static void check_h264pred(H264PredContext *ref, H264PredContext *opt,
+                           const char *codec)
+{
+    int i;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(ref->pred4x4); i++)
+        check_pred4x4(func_name("%s pred4x4[%d]", codec, i),
+                      ref->pred4x4[i], opt->pred4x4[i]);
+    for (i = 0; i < FF_ARRAY_ELEMS(ref->pred8x8l); i++)
+        check_pred8x8l(func_name("%s pred8x8l[%d]", codec, i),
+                       ref->pred8x8l[i], opt->pred8x8l[i]);
+    for (i = 0; i < FF_ARRAY_ELEMS(ref->pred8x8); i++)
+        check_filter(func_name("%s pred8x8[%d]", codec, i),
+                     ref->pred8x8[i], opt->pred8x8[i]);
+    for (i = 0; i < FF_ARRAY_ELEMS(ref->pred16x16); i++)
+        check_filter(func_name("%s pred16x16[%d]", codec, i),
+                     ref->pred16x16[i], opt->pred16x16[i]);
+    for (i = 0; i < FF_ARRAY_ELEMS(ref->pred4x4_add); i++)
+        check_pred_add(func_name("%s pred4x4_add[%d]", codec, i),
+                       ref->pred4x4_add[i], opt->pred4x4_add[i]);
+    for (i = 0; i < FF_ARRAY_ELEMS(ref->pred8x8l_add); i++)
+        check_pred_add(func_name("%s pred8x8l_add[%d]", codec, i),
+                       ref->pred8x8l_add[i], opt->pred8x8l_add[i]);
+    for (i = 0; i < FF_ARRAY_ELEMS(ref->pred8x8_add); i++)
+        check_pred_add_offset(func_name("%s pred8x8_add[%d]", codec, i),
+                              ref->pred8x8_add[i], opt->pred8x8_add[i]);
+    for (i = 0; i < FF_ARRAY_ELEMS(ref->pred16x16_add); i++)
+        check_pred_add_offset(func_name("%s pred16x16_add[%d]", codec, i),
+                              ref->pred16x16_add[i], opt->pred16x16_add[i]);
+}
+
+static void check_vp8dsp(VP8DSPContext *ref, VP8DSPContext *opt)
+{
+    int i, k, l;
+
+    check_vp8_luma_dc_wht("vp8_luma_dc_wht", ref->vp8_luma_dc_wht,
+                          opt->vp8_luma_dc_wht);
+    check_vp8_luma_dc_wht("vp8_luma_dc_wht_dc", ref->vp8_luma_dc_wht_dc,
+                          opt->vp8_luma_dc_wht_dc);
+    check_add_block("vp8_idct_add", ref->vp8_idct_add, opt->vp8_idct_add,
+                    2047, 0, 1);
+    check_add_block("vp8_idct_dc_add", ref->vp8_idct_dc_add,
+                    opt->vp8_idct_dc_add, 2047, 1, 1);
+    check_vp8_idct_dc_add4("vp8_idct_dc_add4y", ref->vp8_idct_dc_add4y,
+                           opt->vp8_idct_dc_add4y);
+    check_vp8_idct_dc_add4("vp8_idct_dc_add4uv", ref->vp8_idct_dc_add4uv,
+                           opt->vp8_idct_dc_add4uv);
+
+    check_vp8_loop_filter("vp8_v_loop_filter16y", ref->vp8_v_loop_filter16y,
+                          opt->vp8_v_loop_filter16y);
+    check_vp8_loop_filter("vp8_h_loop_filter16y", ref->vp8_h_loop_filter16y,
+                          opt->vp8_h_loop_filter16y);
+    check_vp8_loop_filter_uv("vp8_v_loop_filter8uv", ref->vp8_v_loop_filter8uv,
+                             opt->vp8_v_loop_filter8uv);
+    check_vp8_loop_filter_uv("vp8_h_loop_filter8uv", ref->vp8_h_loop_filter8uv,
+                             opt->vp8_h_loop_filter8uv);
+    check_vp8_loop_filter("vp8_v_loop_filter16y_inner", ref->vp8_v_loop_filter16y_inner,
+                          opt->vp8_v_loop_filter16y_inner);
+    check_vp8_loop_filter("vp8_h_loop_filter16y_inner", ref->vp8_h_loop_filter16y_inner,
+                          opt->vp8_h_loop_filter16y_inner);
+    check_vp8_loop_filter_uv("vp8_v_loop_filter8uv_inner", ref->vp8_v_loop_filter8uv_inner,
+                             opt->vp8_v_loop_filter8uv_inner);
+    check_vp8_loop_filter_uv("vp8_h_loop_filter8uv_inner", ref->vp8_h_loop_filter8uv_inner,
+                             opt->vp8_h_loop_filter8uv_inner);
+    check_loop_filter("vp8_v_loop_filter_simple", ref->vp8_v_loop_filter_simple,
+                      opt->vp8_v_loop_filter_simple, 190);
+    check_loop_filter("vp8_h_loop_filter_simple", ref->vp8_h_loop_filter_simple,
+                      opt->vp8_h_loop_filter_simple, 190);
+
+    for (i = 0; i < 3; i++)
+        for (k = 0; k < 3; k++)
+            for (l = 0; l < 3; l++) {
+                check_vp8_mc(func_name("put_vp8_epel_pixels_tab[%d][%d][%d]", i, k, l),
+                             ref->put_vp8_epel_pixels_tab[i][k][l],
+                             opt->put_vp8_epel_pixels_tab[i][k][l], 16 >> i, k, l);
+                check_vp8_mc(func_name("put_vp8_bilinear_pixels_tab[%d][%d][%d]", i, k, l),
+                             ref->put_vp8_bilinear_pixels_tab[i][k][l],
+                             opt->put_vp8_bilinear_pixels_tab[i][k][l], 16 >> i, k, l);
+            }
+}
+
+static void check_vp56dsp(VP56DSPContext *ref, VP56DSPContext *opt,
+                          const char *codec)
+{
+    check_loop_filter(func_name("%s edge_filter_hor", codec),
+                      ref->edge_filter_hor, opt->edge_filter_hor, 64);
+    check_loop_filter(func_name("%s edge_filter_ver", codec),
+                      ref->edge_filter_ver, opt->edge_filter_ver, 64);
+    check_vp6_diag4(func_name("%s vp6_filter_diag4", codec),
+                    ref->vp6_filter_diag4, opt->vp6_filter_diag4);
+}
+
+static void init_contexts(DSPTestContext *c, AVCodecContext *avctx)
+{
+    int i;
+
+    memset(c, 0, sizeof(*c));
+    dsputil_init(&c->dsp, avctx);
+    if (CONFIG_H264DSP)
+        ff_h264dsp_init(&c->h264dsp);
+    if (CONFIG_H264PRED)
+        for (i = 0; i < NB_PRED_CODECS; i++)
+            ff_h264_pred_init(&c->h264pred[i], pred_codecs[i].id);
+    if (CONFIG_VP8_DECODER)
+        ff_vp8dsp_init(&c->vp8dsp);
+    if (CONFIG_VP5_DECODER || CONFIG_VP6_DECODER) {
+        ff_vp56dsp_init(&c->vp56dsp[0], CODEC_ID_VP5);
+        ff_vp56dsp_init(&c->vp56dsp[1], CODEC_ID_VP6);
+    }
+    for (i = 0; i < NB_FFT_SIZES; i++) {
+        if (CONFIG_FFT) {
+            ff_fft_init(&c->fft[i][0], fft_bits[i], 0);
+            ff_fft_init(&c->fft[i][1], fft_bits[i], 1);
+        }
+        if (CONFIG_MDCT) {
+            ff_mdct_init(&c->mdct[i][0], fft_bits[i], 0, 1.0);
+            ff_mdct_init(&c->mdct[i][1], fft_bits[i], 1, 1.0);
+        }
+    }
+}
+
+static void uninit_contexts(DSPTestContext *c)
+{
+    int i;
+
+    for (i = 0; i < NB_FFT_SIZES; i++) {
+        if (CONFIG_FFT) {
+            ff_fft_end(&c->fft[i][0]);
+            ff_fft_end(&c->fft[i][1]);
+        }
+        if (CONFIG_MDCT) {
+            ff_mdct_end(&c->mdct[i][0]);
+            ff_mdct_end(&c->mdct[i][1]);
+        }
+    }
+}
+
+static void check_contexts(DSPTestContext *ref, DSPTestContext *opt)
+{
+    int i;
+
+    check_dsputil(&ref->dsp, &opt->dsp);
+    if (CONFIG_H264DSP)
+        check_h264dsp(&ref->h264dsp, &opt->h264dsp);
+    if (CONFIG_H264PRED)
+        for (i = 0; i < NB_PRED_CODECS; i++)
+            check_h264pred(&ref->h264pred[i], &opt->h264pred[i],
+                           pred_codecs[i].name);
+    if (CONFIG_VP8_DECODER)
+        check_vp8dsp(&ref->vp8dsp, &opt->vp8dsp);
+    if (CONFIG_VP5_DECODER || CONFIG_VP6_DECODER) {
+        check_vp56dsp(&ref->vp56dsp[0], &opt->vp56dsp[0], "vp5");
+        check_vp56dsp(&ref->vp56dsp[1], &opt->vp56dsp[1], "vp6");
+    }
+    for (i = 0; i < NB_FFT_SIZES; i++) {
+        if (CONFIG_FFT) {
+            check_fft(func_name("fft_calc %d", 1 << fft_bits[i]),
+                      &ref->fft[i][0], &opt->fft[i][0]);
+            check_fft(func_name("ifft_calc %d", 1 << fft_bits[i]),
+                      &ref->fft[i][1], &opt->fft[i][1]);
+        }
+        if (CONFIG_MDCT) {
+            check_mdct(func_name("mdct_calc %d", 1 << fft_bits[i]),
+                       &ref->mdct[i][0], &opt->mdct[i][0], 2);
+            check_mdct(func_name("imdct_calc %d", 1 << fft_bits[i]),
+                       &ref->mdct[i][1], &opt->mdct[i][1], 0);
+            check_mdct(func_name("imdct_half %d", 1 << fft_bits[i]),
+                       &ref->mdct[i][1], &opt->mdct[i][1], 1);
+        }
+    }
+}
+
+static void help(void)
+{
+    printf("dsp-test [-b] [-v]\n"
+           "check the optimized DSP functions against the C versions\n"
+           "-b  also print the cycles taken by the C and optimized functions\n"
+           "-v  list the functions which pass\n");
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    AVCodecContext *avctx;
+    int c, i, host_flags, flags;
+
+    for (;;) {
+        c = getopt(argc, argv, "bvh");
+        if (c == -1)
+            break;
+        switch (c) {
+        case 'b':
+            bench = 1;
+            break;
+        case 'v':
+            verbose = 1;
+            break;
+        default:
+            help();
+        }
+    }
+
+    avcodec_init();
+    avctx = avcodec_alloc_context();
+    avctx->flags |= CODEC_FLAG_BITEXACT;
+    host_flags = av_get_cpu_flags();
+    av_lfg_init(&prng, 0xd5b);
+
+    av_force_cpu_flags(0);
+    init_contexts(&ref_ctx, avctx);
+    if (bench)
+        printf("%-40s %-8s %9s %9s %7s\n", "function", "cpu", "c", "opt",
+               "speedup");
+
+    for (i = 1; i < FF_ARRAY_ELEMS(cpu_sets); i++) {
+        flags = cpu_sets[i].flags == -1 ? host_flags : cpu_sets[i].flags;
+        if (flags & ~host_flags)
+            continue;
+        cpu_name = cpu_sets[i].name;
+        av_force_cpu_flags(flags);
+        init_contexts(&opt_ctx, avctx);
+        check_contexts(&ref_ctx, &opt_ctx);
+        uninit_contexts(&opt_ctx);
+    }
+    av_force_cpu_flags(-1);
+    uninit_contexts(&ref_ctx);
+    av_free(avctx);
+
+    if (nb_failed)
+        printf("dsp: %d of %d functions FAILED\n", nb_failed, nb_tested);
+    else
+        printf("dsp: ok\n");
+    return !!nb_failed;
+}
@@ -82,6 +82,10 @@ extern const uint8_t ff_zigzag248_direct[64];
 extern uint32_t ff_squareTbl[512];
 extern uint8_t ff_cropTbl[256 + 2 * MAX_NEG_CROP];
 
+/* RV40 deblocking filter dither values, left/top and right/bottom */
+extern const uint8_t ff_rv40_dither_l[16];
+extern const uint8_t ff_rv40_dither_r[16];
+
 void ff_put_pixels8x8_c(uint8_t *dst, uint8_t *src, int stride);
 void ff_avg_pixels8x8_c(uint8_t *dst, uint8_t *src, int stride);
 void ff_put_pixels16x16_c(uint8_t *dst, uint8_t *src, int stride);
@@ -548,6 +552,24 @@ typedef struct DSPContext {
     qpel_mc_func avg_rv40_qpel_pixels_tab[4][16];
     h264_chroma_mc_func put_rv40_chroma_pixels_tab[3];
     h264_chroma_mc_func avg_rv40_chroma_pixels_tab[3];
+    /**
+     * RV40 deblocking of the 4 lines of an edge, at src and 3 strides past it.
+     * Index 0 filters a horizontal edge, index 1 a vertical one.
+     */
+    void (*rv40_weak_loop_filter[2])(uint8_t *src, int stride,
+                                     int filter_p1, int filter_q1,
+                                     int alpha, int beta,
+                                     int lims, int lim_q1, int lim_p1);
+    void (*rv40_strong_loop_filter[2])(uint8_t *src, int stride,
+                                       int alpha, int lims,
+                                       int dmode, int chroma);
+    /**
+     * Decide which sides of the edge get filtered.
+     * @return nonzero if the strong filter should be used
+     */
+    int (*rv40_loop_filter_strength[2])(uint8_t *src, int stride,
+                                        int beta, int beta2, int edge,
+                                        int *p1, int *q1);
 
     /* bink functions */
     op_fill_func fill_block_tab[2];
@@ -19,6 +19,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define BITSTREAM_WRITER_64
 #include "libavutil/crc.h"
 #include "libavutil/md5.h"
 #include "avcodec.h"
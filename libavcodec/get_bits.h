@@ -35,11 +35,18 @@
 #include "libavutil/log.h"
 #include "mathops.h"
 
+/* The cached reader is selected per file and only available on 64-bit
+ * CPUs, it falls back to the default reader elsewhere. */
+#if defined(CACHED_BITSTREAM_READER) && (!HAVE_FAST_64BIT || defined(ALT_BITSTREAM_READER_LE) || \
+    defined(LIBMPEG2_BITSTREAM_READER) || defined(A32_BITSTREAM_READER) || defined(ALT_BITSTREAM_READER))
+#   undef CACHED_BITSTREAM_READER
+#endif
+
 #if defined(ALT_BITSTREAM_READER_LE) && !defined(ALT_BITSTREAM_READER)
 #   define ALT_BITSTREAM_READER
 #endif
 
-#if !defined(LIBMPEG2_BITSTREAM_READER) && !defined(A32_BITSTREAM_READER) && !defined(ALT_BITSTREAM_READER)
+#if !defined(LIBMPEG2_BITSTREAM_READER) && !defined(A32_BITSTREAM_READER) && !defined(ALT_BITSTREAM_READER) && !defined(CACHED_BITSTREAM_READER)
 #   if ARCH_ARM && !HAVE_FAST_UNALIGNED
 #       define A32_BITSTREAM_READER
 #   else
@@ -53,7 +60,7 @@
 /* buffer, buffer_end and size_in_bits must be present and used by every reader */
 typedef struct GetBitContext {
     const uint8_t *buffer, *buffer_end;
-#ifdef ALT_BITSTREAM_READER
+#if defined(ALT_BITSTREAM_READER) || defined(CACHED_BITSTREAM_READER)
     int index;
 #elif defined LIBMPEG2_BITSTREAM_READER
     uint8_t *buffer_ptr;
@@ -66,6 +73,16 @@ typedef struct GetBitContext {
     int bit_count;
 #endif
     int size_in_bits;
+#if HAVE_FAST_64BIT && (defined(ALT_BITSTREAM_READER) || defined(CACHED_BITSTREAM_READER))
+    /* State of the cached reader. It is present for the alt reader too, so
+     * that files selecting different readers agree on the layout of the
+     * structures containing a GetBitContext. The alt reader only moves
+     * index, which invalidates the cache as it no longer matches
+     * cache_index; the two readers may thus share a GetBitContext. */
+    uint64_t cache;             ///< next bits_left bits, MSB first
+    int bits_left;
+    int cache_index;            ///< index at which cache was last valid
+#endif
 } GetBitContext;
 
 #define VLC_TYPE int16_t
@@ -82,6 +99,21 @@ typedef struct RL_VLC_ELEM {
     uint8_t run;
 } RL_VLC_ELEM;
 
+#define RL_VLC_MULTI_MAX 2
+
+/**
+ * Several consecutive run-level codes, each followed by a sign bit,
+ * decoded with one table lookup. See ff_init_rl_vlc_multi().
+ * If there are less than RL_VLC_MULTI_MAX symbols, the last one is
+ * repeated, so storing all RL_VLC_MULTI_MAX coefficients is harmless.
+ */
+typedef struct RL_VLC_MULTI_ELEM {
+    int16_t level[RL_VLC_MULTI_MAX]; ///< levels with their signs applied
+    uint8_t run[RL_VLC_MULTI_MAX];   ///< sums of the runs up to each symbol
+    uint8_t len;                     ///< total length of the codes and sign bits
+    uint8_t num;                     ///< number of symbols, 0 if the first code does not fit
+} RL_VLC_MULTI_ELEM;
+
 /* Bitstream reader API docs:
 name
     arbitrary name which is used as prefix for the internal variables
@@ -189,6 +221,68 @@ static inline void skip_bits_long(GetBitContext *s, int n){
     s->index += n;
 }
 
+#elif defined CACHED_BITSTREAM_READER
+//64 bit cache, refilled from the bit position once fewer than 32 bits are left
+
+#   define MIN_CACHE_BITS 32
+
+#   define OPEN_READER(name, gb)\
+        unsigned int name##_index= (gb)->index;\
+        uint64_t name##_cache= (gb)->cache;\
+        int name##_bits_left= (gb)->cache_index == name##_index ? (gb)->bits_left : 0;\
+
+#   define CLOSE_READER(name, gb)\
+        (gb)->index= name##_index;\
+        (gb)->cache= name##_cache;\
+        (gb)->bits_left= name##_bits_left;\
+        (gb)->cache_index= name##_index;\
+
+/* near the end of the buffer only 32 bits are read, like the alt reader does */
+#   define UPDATE_CACHE(name, gb)\
+    if(name##_bits_left < MIN_CACHE_BITS){\
+        const uint8_t *name##_ptr= (gb)->buffer + (name##_index>>3);\
+        if(name##_ptr + 4 < (gb)->buffer_end){\
+            name##_cache= AV_RB64(name##_ptr) << (name##_index&7);\
+            name##_bits_left= 64 - (name##_index&7);\
+        }else{\
+            name##_cache= (uint64_t)AV_RB32(name##_ptr) << (32 + (name##_index&7));\
+            name##_bits_left= 32 - (name##_index&7);\
+        }\
+    }\
+
+#   define SKIP_CACHE(name, gb, num)\
+        name##_cache <<= (num);\
+
+#   define SKIP_COUNTER(name, gb, num)\
+        name##_index += (num);\
+        name##_bits_left -= (num);\
+
+#   define SKIP_BITS(name, gb, num)\
+        {\
+            SKIP_CACHE(name, gb, num)\
+            SKIP_COUNTER(name, gb, num)\
+        }\
+
+#   define LAST_SKIP_BITS(name, gb, num) SKIP_BITS(name, gb, num)
+#   define LAST_SKIP_CACHE(name, gb, num) SKIP_CACHE(name, gb, num)
+
+#   define SHOW_UBITS(name, gb, num)\
+        ((uint32_t)(name##_cache >> (64 - (num))))
+
+#   define SHOW_SBITS(name, gb, num)\
+        ((int32_t)((int64_t)name##_cache >> (64 - (num))))
+
+#   define GET_CACHE(name, gb)\
+        ((uint32_t)(name##_cache >> 32))
+
+static inline int get_bits_count(const GetBitContext *s){
+    return s->index;
+}
+
+static inline void skip_bits_long(GetBitContext *s, int n){
+    s->index += n;
+}
+
 #elif defined LIBMPEG2_BITSTREAM_READER
 //libmpeg2 like reader
 
@@ -482,8 +576,11 @@ static inline void init_get_bits(GetBitContext *s,
     s->buffer= buffer;
     s->size_in_bits= bit_size;
     s->buffer_end= buffer + buffer_size;
-#ifdef ALT_BITSTREAM_READER
+#if defined(ALT_BITSTREAM_READER) || defined(CACHED_BITSTREAM_READER)
     s->index=0;
+#if HAVE_FAST_64BIT
+    s->bits_left=0;
+#endif
 #elif defined LIBMPEG2_BITSTREAM_READER
     s->buffer_ptr = (uint8_t*)((intptr_t)buffer&(~1));
     s->bit_count = 16 + 8*((intptr_t)buffer&1);
@@ -519,6 +616,16 @@ int init_vlc_sparse(VLC *vlc, int nb_bits, int nb_codes,
 #define INIT_VLC_USE_NEW_STATIC 4
 void free_vlc(VLC *vlc);
 
+/**
+ * Build a table decoding up to RL_VLC_MULTI_MAX run-level codes at once
+ * from the next bits bits of a stream, out of the single-symbol table
+ * rl_vlc indexed by rl_bits bits. Only codes followed by a sign bit, with a
+ * nonzero level and a run between 1 and 64 are packed, so escapes, end of
+ * block and last coefficient codes must still be read with rl_vlc.
+ */
+void ff_init_rl_vlc_multi(RL_VLC_MULTI_ELEM *table, int bits,
+                          const RL_VLC_ELEM *rl_vlc, int rl_bits);
+
 #define INIT_VLC_STATIC(vlc, bits, a,b,c,d,e,f,g, static_size)\
 {\
     static VLC_TYPE table[static_size][2];\
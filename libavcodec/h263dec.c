@@ -25,6 +25,7 @@
  * H.263 decoder.
  */
 
+#define CACHED_BITSTREAM_READER
 #include "libavutil/cpu.h"
 #include "internal.h"
 #include "avcodec.h"
@@ -983,22 +983,17 @@ static av_always_inline int get_cabac_cbf_ctx( H264Context *h, int cat, int idx,
     return ctx + 4 * cat;
 }
 
-DECLARE_ASM_CONST(1, uint8_t, last_coeff_flag_offset_8x8)[63] = {
-    0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1,
-    2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
-    3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4,
-    5, 5, 5, 5, 6, 6, 6, 6, 7, 7, 7, 7, 8, 8, 8
-};
-
 static av_always_inline void decode_cabac_residual_internal( H264Context *h, DCTELEM *block, int cat, int n, const uint8_t *scantable, const uint32_t *qmul, int max_coeff, int is_dc ) {
     static const int significant_coeff_flag_offset[2][6] = {
       { 105+0, 105+15, 105+29, 105+44, 105+47, 402 },
       { 277+0, 277+15, 277+29, 277+44, 277+47, 436 }
     };
+#if !CABAC_X86_ASM
     static const int last_coeff_flag_offset[2][6] = {
       { 166+0, 166+15, 166+29, 166+44, 166+47, 417 },
       { 338+0, 338+15, 338+29, 338+44, 338+47, 451 }
     };
+#endif
     static const int coeff_abs_level_m1_offset[6] = {
         227+0, 227+10, 227+20, 227+30, 227+39, 426
     };
@@ -1032,7 +1027,9 @@ static av_always_inline void decode_cabac_residual_internal( H264Context *h, DCT
     int node_ctx = 0;
 
     uint8_t *significant_coeff_ctx_base;
+#if !CABAC_X86_ASM
     uint8_t *last_coeff_ctx_base;
+#endif
     uint8_t *abs_level_m1_ctx_base;
 
 #if !ARCH_X86
@@ -1074,8 +1071,10 @@ static av_always_inline void decode_cabac_residual_internal( H264Context *h, DCT
 
     significant_coeff_ctx_base = h->cabac_state
         + significant_coeff_flag_offset[MB_FIELD][cat];
+#if !CABAC_X86_ASM
     last_coeff_ctx_base = h->cabac_state
         + last_coeff_flag_offset[MB_FIELD][cat];
+#endif
     abs_level_m1_ctx_base = h->cabac_state
         + coeff_abs_level_m1_offset[cat];
 
@@ -1096,12 +1095,12 @@ static av_always_inline void decode_cabac_residual_internal( H264Context *h, DCT
             index[coeff_count++] = last;\
         }
         const uint8_t *sig_off = significant_coeff_flag_offset_8x8[MB_FIELD];
-#if ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS)
+#if CABAC_X86_ASM
         coeff_count= decode_significance_8x8_x86(CC, significant_coeff_ctx_base, index, sig_off);
     } else {
         coeff_count= decode_significance_x86(CC, max_coeff, significant_coeff_ctx_base, index);
 #else
-        DECODE_SIGNIFICANCE( 63, sig_off[last], last_coeff_flag_offset_8x8[last] );
+        DECODE_SIGNIFICANCE( 63, sig_off[last], ff_h264_last_coeff_flag_offset_8x8[last] );
     } else {
         DECODE_SIGNIFICANCE( max_coeff - 1, last, last );
 #endif
@@ -28,6 +28,7 @@
  */
 
 //#define DEBUG
+#define CACHED_BITSTREAM_READER
 #include <limits.h>
 
 #include "dsputil.h"
@@ -26,6 +26,7 @@
  */
 
 //#define DEBUG
+#define CACHED_BITSTREAM_READER
 #include "internal.h"
 #include "avcodec.h"
 #include "dsputil.h"
@@ -47,6 +48,7 @@
 #define MB_PAT_VLC_BITS 9
 #define MB_PTYPE_VLC_BITS 6
 #define MB_BTYPE_VLC_BITS 6
+#define TEX_VLC_MULTI_BITS 11
 
 static inline int mpeg1_decode_block_intra(MpegEncContext *s,
                               DCTELEM *block,
@@ -142,6 +144,8 @@ static VLC mbincr_vlc;
 static VLC mb_ptype_vlc;
 static VLC mb_btype_vlc;
 static VLC mb_pat_vlc;
+static RL_VLC_MULTI_ELEM rl_vlc_multi_mpeg1[1 << TEX_VLC_MULTI_BITS];
+static RL_VLC_MULTI_ELEM rl_vlc_multi_mpeg2[1 << TEX_VLC_MULTI_BITS];
 
 av_cold void ff_mpeg12_init_vlcs(void)
 {
@@ -177,6 +181,10 @@ av_cold void ff_mpeg12_init_vlcs(void)
 
         INIT_2D_VLC_RL(ff_rl_mpeg1, 680);
         INIT_2D_VLC_RL(ff_rl_mpeg2, 674);
+        ff_init_rl_vlc_multi(rl_vlc_multi_mpeg1, TEX_VLC_MULTI_BITS,
+                             ff_rl_mpeg1.rl_vlc[0], TEX_VLC_BITS);
+        ff_init_rl_vlc_multi(rl_vlc_multi_mpeg2, TEX_VLC_MULTI_BITS,
+                             ff_rl_mpeg2.rl_vlc[0], TEX_VLC_BITS);
     }
 }
 
@@ -613,7 +621,7 @@ static inline int mpeg1_decode_block_intra(MpegEncContext *s,
                                DCTELEM *block,
                                int n)
 {
-    int level, dc, diff, i, j, run;
+    int level, dc, diff, i, j, k, run, sign;
     int component;
     RLTable *rl = &ff_rl_mpeg1;
     uint8_t * const scantable= s->intra_scantable.permutated;
@@ -635,7 +643,27 @@ static inline int mpeg1_decode_block_intra(MpegEncContext *s,
         OPEN_READER(re, &s->gb);
         /* now quantify & encode AC coefficients */
         for(;;) {
+            const RL_VLC_MULTI_ELEM *multi;
+
             UPDATE_CACHE(re, &s->gb);
+            multi = &rl_vlc_multi_mpeg1[SHOW_UBITS(re, &s->gb, TEX_VLC_MULTI_BITS)];
+            if (multi->num) {
+                if (i + multi->run[RL_VLC_MULTI_MAX - 1] > 63) {
+                    av_log(s->avctx, AV_LOG_ERROR, "ac-tex damaged at %d %d\n", s->mb_x, s->mb_y);
+                    return -1;
+                }
+                for (k = 0; k < RL_VLC_MULTI_MAX; k++) {
+                    j = scantable[i + multi->run[k]];
+                    level = multi->level[k];
+                    sign  = level >> 31;
+                    level = (((level ^ sign) - sign)*qscale*quant_matrix[j])>>4;
+                    level = (level-1)|1;
+                    block[j] = (level ^ sign) - sign;
+                }
+                i += multi->run[RL_VLC_MULTI_MAX - 1];
+                SKIP_BITS(re, &s->gb, multi->len);
+                continue;
+            }
             GET_RL_VLC(level, run, re, &s->gb, rl->rl_vlc[0], TEX_VLC_BITS, 2, 0);
 
             if(level == 127){
@@ -1018,9 +1046,10 @@ static inline int mpeg2_decode_block_intra(MpegEncContext *s,
                                DCTELEM *block,
                                int n)
 {
-    int level, dc, diff, i, j, run;
+    int level, dc, diff, i, j, k, run, sign;
     int component;
     RLTable *rl;
+    const RL_VLC_MULTI_ELEM *multi_table;
     uint8_t * const scantable= s->intra_scantable.permutated;
     const uint16_t *quant_matrix;
     const int qscale= s->qscale;
@@ -1044,16 +1073,40 @@ static inline int mpeg2_decode_block_intra(MpegEncContext *s,
     dprintf(s->avctx, "dc=%d\n", block[0]);
     mismatch = block[0] ^ 1;
     i = 0;
-    if (s->intra_vlc_format)
+    if (s->intra_vlc_format) {
         rl = &ff_rl_mpeg2;
-    else
+        multi_table = rl_vlc_multi_mpeg2;
+    } else {
         rl = &ff_rl_mpeg1;
+        multi_table = rl_vlc_multi_mpeg1;
+    }
 
     {
         OPEN_READER(re, &s->gb);
         /* now quantify & encode AC coefficients */
         for(;;) {
+            const RL_VLC_MULTI_ELEM *multi;
+
             UPDATE_CACHE(re, &s->gb);
+            multi = &multi_table[SHOW_UBITS(re, &s->gb, TEX_VLC_MULTI_BITS)];
+            if (multi->num) {
+                if (i + multi->run[RL_VLC_MULTI_MAX - 1] > 63) {
+                    av_log(s->avctx, AV_LOG_ERROR, "ac-tex damaged at %d %d\n", s->mb_x, s->mb_y);
+                    return -1;
+                }
+                for (k = 0; k < RL_VLC_MULTI_MAX; k++) {
+                    j = scantable[i + multi->run[k]];
+                    level = multi->level[k];
+                    sign  = level >> 31;
+                    level = (((level ^ sign) - sign)*qscale*quant_matrix[j])>>4;
+                    level = (level ^ sign) - sign;
+                    mismatch^= level & -(k < multi->num);
+                    block[j] = level;
+                }
+                i += multi->run[RL_VLC_MULTI_MAX - 1];
+                SKIP_BITS(re, &s->gb, multi->len);
+                continue;
+            }
             GET_RL_VLC(level, run, re, &s->gb, rl->rl_vlc[0], TEX_VLC_BITS, 2, 0);
 
             if(level == 127){
@@ -1098,9 +1151,10 @@ static inline int mpeg2_fast_decode_block_intra(MpegEncContext *s,
                                DCTELEM *block,
                                int n)
 {
-    int level, dc, diff, j, run;
+    int level, dc, diff, j, k, run, sign;
     int component;
     RLTable *rl;
+    const RL_VLC_MULTI_ELEM *multi_table;
     uint8_t * scantable= s->intra_scantable.permutated;
     const uint16_t *quant_matrix;
     const int qscale= s->qscale;
@@ -1120,16 +1174,34 @@ static inline int mpeg2_fast_decode_block_intra(MpegEncContext *s,
     dc += diff;
     s->last_dc[component] = dc;
     block[0] = dc << (3 - s->intra_dc_precision);
-    if (s->intra_vlc_format)
+    if (s->intra_vlc_format) {
         rl = &ff_rl_mpeg2;
-    else
+        multi_table = rl_vlc_multi_mpeg2;
+    } else {
         rl = &ff_rl_mpeg1;
+        multi_table = rl_vlc_multi_mpeg1;
+    }
 
     {
         OPEN_READER(re, &s->gb);
         /* now quantify & encode AC coefficients */
         for(;;) {
+            const RL_VLC_MULTI_ELEM *multi;
+
             UPDATE_CACHE(re, &s->gb);
+            multi = &multi_table[SHOW_UBITS(re, &s->gb, TEX_VLC_MULTI_BITS)];
+            if (multi->num) {
+                for (k = 0; k < RL_VLC_MULTI_MAX; k++) {
+                    j = scantable[multi->run[k]];
+                    level = multi->level[k];
+                    sign  = level >> 31;
+                    level = (((level ^ sign) - sign)*qscale*quant_matrix[j])>>4;
+                    block[j] = (level ^ sign) - sign;
+                }
+                scantable += multi->run[RL_VLC_MULTI_MAX - 1];
+                SKIP_BITS(re, &s->gb, multi->len);
+                continue;
+            }
             GET_RL_VLC(level, run, re, &s->gb, rl->rl_vlc[0], TEX_VLC_BITS, 2, 0);
 
             if(level == 127){
@@ -20,6 +20,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#define CACHED_BITSTREAM_READER
 #include "mpegvideo.h"
 #include "mpeg4video.h"
 #include "h263.h"
@@ -31,11 +32,13 @@
 #define SPRITE_TRAJ_VLC_BITS 6
 #define DC_VLC_BITS 9
 #define MB_TYPE_B_VLC_BITS 4
+#define TEX_VLC_MULTI_BITS 11
 
 
 static VLC dc_lum, dc_chrom;
 static VLC sprite_trajectory;
 static VLC mb_type_b_vlc;
+static RL_VLC_MULTI_ELEM rl_vlc_multi_intra[1 << TEX_VLC_MULTI_BITS];
 
 static const int mb_type_b_map[4]= {
     MB_TYPE_DIRECT2 | MB_TYPE_L0L1,
@@ -837,7 +840,7 @@ int ff_mpeg4_decode_partitions(MpegEncContext *s)
 static inline int mpeg4_decode_block(MpegEncContext * s, DCTELEM * block,
                               int n, int coded, int intra, int rvlc)
 {
-    int level, i, last, run;
+    int level, i, k, last, run;
     int dc_pred_dir;
     RLTable * rl;
     RL_VLC_ELEM * rl_vlc;
@@ -918,6 +921,22 @@ static inline int mpeg4_decode_block(MpegEncContext * s, DCTELEM * block,
     OPEN_READER(re, &s->gb);
     for(;;) {
         UPDATE_CACHE(re, &s->gb);
+        if (intra && !rvlc) {
+            const RL_VLC_MULTI_ELEM *multi =
+                &rl_vlc_multi_intra[SHOW_UBITS(re, &s->gb, TEX_VLC_MULTI_BITS)];
+            if (multi->num) {
+                /* the last coefficient is never packed */
+                if (i + multi->run[RL_VLC_MULTI_MAX - 1] > 62) {
+                    av_log(s->avctx, AV_LOG_ERROR, "ac-tex damaged at %d %d\n", s->mb_x, s->mb_y);
+                    return -1;
+                }
+                for (k = 0; k < RL_VLC_MULTI_MAX; k++)
+                    block[scan_table[i + multi->run[k]]] = multi->level[k];
+                i += multi->run[RL_VLC_MULTI_MAX - 1];
+                SKIP_BITS(re, &s->gb, multi->len);
+                continue;
+            }
+        }
         GET_RL_VLC(level, run, re, &s->gb, rl_vlc, TEX_VLC_BITS, 2, 0);
         if (level==0) {
           /* escape */
@@ -2211,6 +2230,8 @@ static av_cold int decode_init(AVCodecContext *avctx)
         INIT_VLC_RL(ff_mpeg4_rl_intra, 554);
         INIT_VLC_RL(rvlc_rl_inter, 1072);
         INIT_VLC_RL(rvlc_rl_intra, 1072);
+        ff_init_rl_vlc_multi(rl_vlc_multi_intra, TEX_VLC_MULTI_BITS,
+                             ff_mpeg4_rl_intra.rl_vlc[0], TEX_VLC_BITS);
         INIT_VLC_STATIC(&dc_lum, DC_VLC_BITS, 10 /* 13 */,
                  &ff_mpeg4_DCtab_lum[0][1], 2, 1,
                  &ff_mpeg4_DCtab_lum[0][0], 2, 1, 512);
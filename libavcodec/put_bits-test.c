@@ -0,0 +1,179 @@
+/*
+ * Bitstream writer test and benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Compare the output of the 32-bit and the 64-bit bitstream writers and,
+ * with -b, measure their speed.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "config.h"
+#include "libavutil/lfg.h"
+
+#define NB_SYMBOLS 100000
+#define NB_ITS     50
+
+/* The bit counts are also checked around a byte alignment every 1024 symbols. */
+#define WRITE_SYMBOLS(name)                                               \
+static int name(PutBitContext *pb, uint8_t *buf, int buf_size,            \
+                const uint8_t *len, const uint32_t *val, int nb,          \
+                int *counts)                                              \
+{                                                                         \
+    int i;                                                                \
+                                                                          \
+    init_put_bits(pb, buf, buf_size);                                     \
+    for (i = 0; i < nb; i++) {                                            \
+        put_bits(pb, len[i], val[i]);                                     \
+        if (counts && !(i & 1023)) {                                      \
+            *counts++ = put_bits_count(pb);                               \
+            align_put_bits(pb);                                           \
+            *counts++ = put_bits_count(pb);                               \
+        }                                                                 \
+    }                                                                     \
+    put_bits32(pb, 0xDEADBEEF);                                           \
+    flush_put_bits(pb);                                                   \
+    return put_bits_count(pb);                                            \
+}
+
+#include "put_bits.h"
+
+WRITE_SYMBOLS(write_symbols32)
+
+typedef PutBitContext PutBitContext32;
+
+/* Include the writer a second time, with the 64-bit buffer and renamed. */
+#undef AVCODEC_PUT_BITS_H
+#undef PUT_BITS_BUF_SIZE
+#define BITSTREAM_WRITER_64
+#define PutBitContext            PutBitContext64
+#define init_put_bits            init_put_bits64
+#define put_bits_count           put_bits_count64
+#define flush_put_bits           flush_put_bits64
+#define put_bits                 put_bits64
+#define put_sbits                put_sbits64
+#define put_bits32               put_bits32_64
+#define put_bits_ptr             put_bits_ptr64
+#define skip_put_bytes           skip_put_bytes64
+#define skip_put_bits            skip_put_bits64
+#define set_put_bits_buffer_size set_put_bits_buffer_size64
+#include "put_bits.h"
+
+#undef exit
+#undef printf
+
+#ifdef BITSTREAM_WRITER_64
+WRITE_SYMBOLS(write_symbols64)
+#endif
+
+static int64_t gettime(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void help(void)
+{
+    printf("put_bits-test [-b]\n"
+           "test the bitstream writers, -b also measures their speed\n");
+    exit(1);
+}
+
+static uint8_t  len[NB_SYMBOLS];
+static uint32_t val[NB_SYMBOLS];
+static uint8_t  buf[2][NB_SYMBOLS * 4 + 8];
+static int      counts[2][2 * (NB_SYMBOLS / 1024 + 1)];
+
+int main(int argc, char **argv)
+{
+    AVLFG prng;
+    int i, c, bench = 0;
+
+    for (;;) {
+        c = getopt(argc, argv, "bh");
+        if (c == -1)
+            break;
+        switch (c) {
+        case 'b':
+            bench = 1;
+            break;
+        default:
+            help();
+        }
+    }
+
+    /* mostly short codes, as in the VLC tables, with some raw values */
+    av_lfg_init(&prng, 1);
+    for (i = 0; i < NB_SYMBOLS; i++) {
+        unsigned r = av_lfg_get(&prng);
+        len[i] = r & 7 ? (r & 15) + 1 : (r >> 4 & 31) % 31 + 1;
+        val[i] = av_lfg_get(&prng) & ((1U << len[i]) - 1);
+    }
+
+#ifdef BITSTREAM_WRITER_64
+    {
+        PutBitContext32 pb32;
+        PutBitContext64 pb64;
+        int bits32, bits64, err;
+
+        bits32 = write_symbols32(&pb32, buf[0], sizeof(buf[0]), len, val,
+                                 NB_SYMBOLS, counts[0]);
+        bits64 = write_symbols64(&pb64, buf[1], sizeof(buf[1]), len, val,
+                                 NB_SYMBOLS, counts[1]);
+        err = bits32 != bits64 ||
+              memcmp(buf[0],    buf[1],    bits32 >> 3) ||
+              memcmp(counts[0], counts[1], sizeof(counts[0]));
+        printf("put_bits: %s\n", err ? "FAILED" : "ok");
+        if (err)
+            return 1;
+
+        if (bench) {
+            int64_t t32 = INT64_MAX, t64 = INT64_MAX, t;
+            int it;
+
+            /* alternate the writers and keep the fastest run of each */
+            for (it = 0; it < NB_ITS; it++) {
+                t = gettime();
+                write_symbols32(&pb32, buf[0], sizeof(buf[0]), len, val,
+                                NB_SYMBOLS, NULL);
+                t32 = FFMIN(t32, gettime() - t);
+                t = gettime();
+                write_symbols64(&pb64, buf[1], sizeof(buf[1]), len, val,
+                                NB_SYMBOLS, NULL);
+                t64 = FFMIN(t64, gettime() - t);
+            }
+            printf("32-bit writer: %6.2f ns/symbol\n"
+                   "64-bit writer: %6.2f ns/symbol\n",
+                   t32 * 1000.0 / NB_SYMBOLS, t64 * 1000.0 / NB_SYMBOLS);
+        }
+    }
+#else
+    printf("put_bits: ok\n");
+    if (bench)
+        printf("the 64-bit writer is not available on this target\n");
+#endif
+    return 0;
+}
@@ -38,13 +38,36 @@
 //#define ALT_BITSTREAM_WRITER
 //#define ALIGNED_BITSTREAM_WRITER
 
+/*
+ * BITSTREAM_WRITER_64 can be defined before including this file to
+ * accumulate the bits in a 64-bit buffer, which halves the number of
+ * stores and of taken branches in put_bits(). It is only used for the
+ * big-endian writer on targets with fast 64-bit arithmetic and is ignored
+ * elsewhere. The context layout is the same for both writers, but the
+ * state is not: all the files writing to the same PutBitContext must make
+ * the same choice.
+ */
+#if !HAVE_FAST_64BIT || defined(ALT_BITSTREAM_WRITER) || defined(BITSTREAM_WRITER_LE)
+#undef BITSTREAM_WRITER_64
+#endif
+
+#ifdef BITSTREAM_WRITER_64
+#define PUT_BITS_BUF_SIZE 64
+#else
+#define PUT_BITS_BUF_SIZE 32
+#endif
+
 /* buf and buf_end must be present and used by every alternative writer. */
 typedef struct PutBitContext {
 #ifdef ALT_BITSTREAM_WRITER
     uint8_t *buf, *buf_end;
     int index;
+#else
+#if HAVE_FAST_64BIT
+    uint64_t bit_buf;
 #else
     uint32_t bit_buf;
+#endif
     int bit_left;
     uint8_t *buf, *buf_ptr, *buf_end;
 #endif
@@ -73,7 +96,7 @@ static inline void init_put_bits(PutBitContext *s, uint8_t *buffer, int buffer_s
 //    memset(buffer, 0, buffer_size);
 #else
     s->buf_ptr = s->buf;
-    s->bit_left=32;
+    s->bit_left=PUT_BITS_BUF_SIZE;
     s->bit_buf=0;
 #endif
 }
@@ -86,7 +109,7 @@ static inline int put_bits_count(PutBitContext *s)
 #ifdef ALT_BITSTREAM_WRITER
     return s->index;
 #else
-    return (s->buf_ptr - s->buf) * 8 + 32 - s->bit_left;
+    return (s->buf_ptr - s->buf) * 8 + PUT_BITS_BUF_SIZE - s->bit_left;
 #endif
 }
 
@@ -98,6 +121,16 @@ static inline void flush_put_bits(PutBitContext *s)
 #ifdef ALT_BITSTREAM_WRITER
     align_put_bits(s);
 #else
+#ifdef BITSTREAM_WRITER_64
+    if (s->bit_left < 64)
+        s->bit_buf<<= s->bit_left;
+    while (s->bit_left < 64) {
+        /* XXX: should test end of buffer */
+        *s->buf_ptr++=s->bit_buf >> 56;
+        s->bit_buf<<=8;
+        s->bit_left+=8;
+    }
+#else
 #ifndef BITSTREAM_WRITER_LE
     s->bit_buf<<= s->bit_left;
 #endif
@@ -107,12 +140,13 @@ static inline void flush_put_bits(PutBitContext *s)
         *s->buf_ptr++=s->bit_buf;
         s->bit_buf>>=8;
 #else
-        *s->buf_ptr++=s->bit_buf >> 24;
+        *s->buf_ptr++=(uint32_t)s->bit_buf >> 24;
         s->bit_buf<<=8;
 #endif
         s->bit_left+=8;
     }
-    s->bit_left=32;
+#endif
+    s->bit_left=PUT_BITS_BUF_SIZE;
     s->bit_buf=0;
 #endif
 }
@@ -121,6 +155,10 @@ static inline void flush_put_bits(PutBitContext *s)
 #define align_put_bits align_put_bits_unsupported_here
 #define ff_put_string ff_put_string_unsupported_here
 #define ff_copy_bits ff_copy_bits_unsupported_here
+#elif defined(BITSTREAM_WRITER_64)
+#define align_put_bits align_put_bits64
+#define ff_put_string ff_put_string_unsupported_here
+#define ff_copy_bits ff_copy_bits_unsupported_here
 #else
 /**
  * Pad the bitstream with zeros up to the next byte boundary.
@@ -147,7 +185,32 @@ void ff_copy_bits(PutBitContext *pb, const uint8_t *src, int length);
  * Use put_bits32 to write 32 bits.
  */
 static inline void put_bits(PutBitContext *s, int n, unsigned int value)
-#ifndef ALT_BITSTREAM_WRITER
+#ifdef BITSTREAM_WRITER_64
+{
+    uint64_t bit_buf;
+    int bit_left;
+
+    assert(n <= 31 && value < (1U << n));
+
+    bit_buf = s->bit_buf;
+    bit_left = s->bit_left;
+
+    if (n < bit_left) {
+        bit_buf = (bit_buf<<n) | value;
+        bit_left-=n;
+    } else {
+        bit_buf<<=bit_left;
+        bit_buf |= value >> (n - bit_left);
+        AV_WB64(s->buf_ptr, bit_buf);
+        s->buf_ptr+=8;
+        bit_left+=64 - n;
+        bit_buf = value;
+    }
+
+    s->bit_buf = bit_buf;
+    s->bit_left = bit_left;
+}
+#elif !defined(ALT_BITSTREAM_WRITER)
 {
     unsigned int bit_buf;
     int bit_left;
@@ -269,6 +332,16 @@ static inline void put_sbits(PutBitContext *pb, int n, int32_t value)
     put_bits(pb, n, value & ((1<<n)-1));
 }
 
+#ifdef BITSTREAM_WRITER_64
+/**
+ * Pad the bitstream with zeros up to the next byte boundary.
+ */
+static inline void align_put_bits64(PutBitContext *s)
+{
+    put_bits(s, s->bit_left & 7, 0);
+}
+#endif
+
 /**
  * Write exactly 32 bits into a bitstream.
  */
@@ -309,7 +382,7 @@ static inline void skip_put_bytes(PutBitContext *s, int n)
         FIXME may need some cleaning of the buffer
         s->index += n<<3;
 #else
-        assert(s->bit_left==32);
+        assert(s->bit_left==PUT_BITS_BUF_SIZE);
         s->buf_ptr += n;
 #endif
 }
@@ -323,11 +396,17 @@ static inline void skip_put_bits(PutBitContext *s, int n)
 {
 #ifdef ALT_BITSTREAM_WRITER
     s->index += n;
+#else
+#ifdef BITSTREAM_WRITER_64
+    s->bit_left -= n;
+    s->buf_ptr-= 8*(s->bit_left>>6);
+    s->bit_left &= 63;
 #else
     s->bit_left -= n;
     s->buf_ptr-= 4*(s->bit_left>>5);
     s->bit_left &= 31;
 #endif
+#endif
 }
 
 /**
@@ -21,22 +21,32 @@
  */
 
 #include "avcodec.h"
-#include "libavutil/bswap.h"
+#include "v210dsp.h"
+
+typedef struct R210DecContext {
+    V210DSPContext dsp;
+} R210DecContext;
 
 static av_cold int decode_init(AVCodecContext *avctx)
 {
+    R210DecContext *s = avctx->priv_data;
+
     avctx->pix_fmt             = PIX_FMT_RGB48;
     avctx->bits_per_raw_sample = 10;
 
     avctx->coded_frame         = avcodec_alloc_frame();
 
+    ff_v210dsp_init(&s->dsp);
+
     return 0;
 }
 
 static int decode_frame(AVCodecContext *avctx, void *data, int *data_size,
                         AVPacket *avpkt)
 {
-    int h, w;
+    R210DecContext *s = avctx->priv_data;
+    int h;
+    int shift = avctx->codec_id == CODEC_ID_R210 ? 0 : 2;
     AVFrame *pic = avctx->coded_frame;
     const uint32_t *src = (const uint32_t *)avpkt->data;
     int aligned_width = FFALIGN(avctx->width, 64);
@@ -59,24 +69,8 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *data_size,
     dst_line = pic->data[0];
 
     for (h = 0; h < avctx->height; h++) {
-        uint16_t *dst = (uint16_t *)dst_line;
-        for (w = 0; w < avctx->width; w++) {
-            uint32_t pixel = av_be2ne32(*src++);
-            uint16_t r, g, b;
-            if (avctx->codec_id==CODEC_ID_R210) {
-                b =  pixel <<  6;
-                g = (pixel >>  4) & 0xffc0;
-                r = (pixel >> 14) & 0xffc0;
-            } else {
-                b =  pixel <<  4;
-                g = (pixel >>  6) & 0xffc0;
-                r = (pixel >> 16) & 0xffc0;
-            }
-            *dst++ = r | (r >> 10);
-            *dst++ = g | (g >> 10);
-            *dst++ = b | (b >> 10);
-        }
-        src += aligned_width - avctx->width;
+        s->dsp.unpack_r210(src, (uint16_t *)dst_line, avctx->width, shift);
+        src += aligned_width;
         dst_line += pic->linesize[0];
     }
 
@@ -101,7 +95,7 @@ AVCodec r210_decoder = {
     "r210",
     AVMEDIA_TYPE_VIDEO,
     CODEC_ID_R210,
-    0,
+    sizeof(R210DecContext),
     decode_init,
     NULL,
     decode_close,
@@ -115,7 +109,7 @@ AVCodec r10k_decoder = {
     "r10k",
     AVMEDIA_TYPE_VIDEO,
     CODEC_ID_R10K,
-    0,
+    sizeof(R210DecContext),
     decode_init,
     NULL,
     decode_close,
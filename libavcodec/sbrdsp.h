@@ -0,0 +1,102 @@
+/*
+ * AAC Spectral Band Replication DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_SBRDSP_H
+#define AVCODEC_SBRDSP_H
+
+#include <stdint.h>
+
+/**
+ * Inner loops of the SBR QMF banks, HF generator and HF adjuster.
+ * Complex samples are stored as (real, imaginary) pairs of floats.
+ * Except for sum_square and autocorrelate, optimized versions must give
+ * the same results as the C versions bit for bit.
+ */
+typedef struct SBRDSPContext {
+    /**
+     * z[k] = z[k] + z[k + 64] + z[k + 128] + z[k + 192] + z[k + 256]
+     * for k = 0..63, z must be 16-byte aligned
+     */
+    void (*sum64x5)(float *z);
+    /**
+     * Sum of the squared magnitudes of n complex samples, x must be
+     * 16-byte aligned and n even and nonzero.
+     */
+    float (*sum_square)(float (*x)[2], int n);
+    /**
+     * Negate the odd elements of a 16-byte aligned array of 64 floats.
+     */
+    void (*neg_odd_64)(float *x);
+    /**
+     * Reorder the 64 analysis window sums in z[0..63] into the input of
+     * the analysis IMDCT in z[64..127], z must be 16-byte aligned.
+     */
+    void (*qmf_pre_shuffle)(float *z);
+    /**
+     * Build 32 complex subband samples from the analysis IMDCT output,
+     * W and z must be 16-byte aligned.
+     */
+    void (*qmf_post_shuffle)(float W[32][2], const float *z);
+    /**
+     * Build 64 synthesis samples from the downsampled synthesis IMDCT
+     * output, all arrays must be 16-byte aligned.
+     */
+    void (*qmf_deint_neg)(float *v, const float *src);
+    /**
+     * Build 128 synthesis samples from the two synthesis IMDCT outputs,
+     * all arrays must be 16-byte aligned.
+     */
+    void (*qmf_deint_bfly)(float *v, const float *src0, const float *src1);
+    /**
+     * Covariances of lags 0, 1 and 2 of 40 complex low band samples,
+     * as used by the inverse filtering (14496-3 sp04 p214).
+     */
+    void (*autocorrelate)(const float x[40][2], float phi[3][2][2]);
+    /**
+     * High frequency generation of one subband (14496-3 sp04 p215) for
+     * the time slots start to end - 1. X_high and X_low point to the same
+     * time slot of their subbands and must be 16-byte aligned there,
+     * start and end must be even.
+     */
+    void (*hf_gen)(float (*X_high)[2], const float (*X_low)[2],
+                   const float alpha0[2], const float alpha1[2],
+                   float bw, int start, int end);
+    /**
+     * Y[m] = X_high[m][ixh] * g_filt[m] for m = 0..m_max - 1
+     */
+    void (*hf_g_filt)(float (*Y)[2], const float (*X_high)[40][2],
+                      const float *g_filt, int m_max, int ixh);
+    /**
+     * Add the sinusoids or, where there are none, the noise floor to m_max
+     * subbands of one time slot (14496-3 sp04 p220). Indexed by the sine
+     * index, noise is the noise index before the first subband and kx
+     * the first subband.
+     */
+    void (*hf_apply_noise[4])(float (*Y)[2], const float *s_m,
+                              const float *q_filt, int noise,
+                              int kx, int m_max);
+} SBRDSPContext;
+
+extern const float ff_sbr_noise_table[512][2];
+
+void ff_sbrdsp_init(SBRDSPContext *s);
+void ff_sbrdsp_init_x86(SBRDSPContext *s);
+
+#endif /* AVCODEC_SBRDSP_H */
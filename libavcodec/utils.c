@@ -37,6 +37,7 @@
 #include "imgconvert.h"
 #include "audioconvert.h"
 #include "internal.h"
+#include "thread.h"
 #include <stdlib.h>
 #include <stdarg.h>
 #include <limits.h>
@@ -522,7 +523,14 @@ int attribute_align_arg avcodec_open(AVCodecContext *avctx, AVCodec *codec)
         goto free_and_end;
     }
 
-    if(avctx->codec->init){
+    if (HAVE_PTHREADS && !avctx->thread_opaque) {
+        ret = ff_thread_init(avctx);
+        if (ret < 0) {
+            goto free_and_end;
+        }
+    }
+
+    if(avctx->codec->init && !(avctx->active_thread_type&FF_THREAD_FRAME)){
         ret = avctx->codec->init(avctx);
         if (ret < 0) {
             goto free_and_end;
@@ -538,6 +546,9 @@ end:
     }
     return ret;
 free_and_end:
+    /* the threads started above; w32threads are started by the caller */
+    if (HAVE_PTHREADS && avctx->thread_opaque)
+        avcodec_thread_free(avctx);
     av_freep(&avctx->priv_data);
     avctx->codec= NULL;
     goto end;
@@ -617,9 +628,14 @@ int attribute_align_arg avcodec_decode_video2(AVCodecContext *avctx, AVFrame *pi
     *got_picture_ptr= 0;
     if((avctx->coded_width||avctx->coded_height) && av_image_check_size(avctx->coded_width, avctx->coded_height, 0, avctx))
         return -1;
-    if((avctx->codec->capabilities & CODEC_CAP_DELAY) || avpkt->size){
-        ret = avctx->codec->decode(avctx, picture, got_picture_ptr,
-                                avpkt);
+    if((avctx->codec->capabilities & CODEC_CAP_DELAY) || avpkt->size ||
+       (HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME)){
+        if (HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME)
+            ret = ff_thread_decode_frame(avctx, picture, got_picture_ptr,
+                                         avpkt);
+        else
+            ret = avctx->codec->decode(avctx, picture, got_picture_ptr,
+                                       avpkt);
 
         emms_c(); //needed to avoid an emms_c() call before every return;
 
@@ -984,7 +1000,9 @@ void avcodec_init(void)
 
 void avcodec_flush_buffers(AVCodecContext *avctx)
 {
-    if(avctx->codec->flush)
+    if(HAVE_PTHREADS && avctx->active_thread_type&FF_THREAD_FRAME)
+        ff_thread_flush(avctx);
+    else if(avctx->codec->flush)
         avctx->codec->flush(avctx);
 }
 
@@ -1078,6 +1096,34 @@ int avcodec_thread_init(AVCodecContext *s, int thread_count){
 }
 #endif
 
+#if !HAVE_PTHREADS
+
+int ff_thread_get_buffer(AVCodecContext *avctx, AVFrame *f)
+{
+    f->owner = avctx;
+    f->thread_opaque = NULL;
+    return avctx->get_buffer(avctx, f);
+}
+
+void ff_thread_release_buffer(AVCodecContext *avctx, AVFrame *f)
+{
+    avctx->release_buffer(avctx, f);
+}
+
+void ff_thread_finish_setup(AVCodecContext *avctx)
+{
+}
+
+void ff_thread_report_progress(AVFrame *f, int progress, int field)
+{
+}
+
+void ff_thread_await_progress(AVFrame *f, int progress, int field)
+{
+}
+
+#endif
+
 unsigned int av_xiphlacing(unsigned char *s, unsigned int v)
 {
     unsigned int n = 0;
@@ -22,10 +22,17 @@
  */
 
 #include "avcodec.h"
+#include "v210dsp.h"
 #include "libavutil/bswap.h"
 
+typedef struct V210DecContext {
+    V210DSPContext dsp;
+} V210DecContext;
+
 static av_cold int decode_init(AVCodecContext *avctx)
 {
+    V210DecContext *s = avctx->priv_data;
+
     if (avctx->width & 1) {
         av_log(avctx, AV_LOG_ERROR, "v210 needs even width\n");
         return -1;
@@ -35,13 +42,16 @@ static av_cold int decode_init(AVCodecContext *avctx)
 
     avctx->coded_frame         = avcodec_alloc_frame();
 
+    ff_v210dsp_init(&s->dsp);
+
     return 0;
 }
 
 static int decode_frame(AVCodecContext *avctx, void *data, int *data_size,
                         AVPacket *avpkt)
 {
-    int h, w;
+    V210DecContext *s = avctx->priv_data;
+    int h, w = avctx->width / 6 * 6;
     AVFrame *pic = avctx->coded_frame;
     const uint8_t *psrc = avpkt->data;
     uint16_t *y, *u, *v;
@@ -76,12 +86,13 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *data_size,
 
     for (h = 0; h < avctx->height; h++) {
         const uint32_t *src = (const uint32_t*)psrc;
-        uint32_t val;
-        for (w = 0; w < avctx->width - 5; w += 6) {
-            READ_PIXELS(u, y, v);
-            READ_PIXELS(y, u, y);
-            READ_PIXELS(v, y, u);
-            READ_PIXELS(y, v, y);
+        uint32_t val = 0;
+        if (w) {
+            s->dsp.unpack_v210(src, y, u, v, w);
+            src += w / 6 * 4;
+            y   += w;
+            u   += w >> 1;
+            v   += w >> 1;
         }
         if (w < avctx->width - 1) {
             READ_PIXELS(u, y, v);
@@ -124,7 +135,7 @@ AVCodec v210_decoder = {
     "v210",
     AVMEDIA_TYPE_VIDEO,
     CODEC_ID_V210,
-    0,
+    sizeof(V210DecContext),
     decode_init,
     NULL,
     decode_close,
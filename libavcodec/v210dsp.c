@@ -0,0 +1,200 @@
+/*
+ * 10-bit packed video DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/bswap.h"
+#include "libavutil/common.h"
+#include "v210dsp.h"
+
+#define READ_PIXELS(a, b, c)         \
+    do {                             \
+        val  = av_le2ne32(*src++);   \
+        *a++ =  val <<  6;           \
+        *b++ = (val >>  4) & 0xFFC0; \
+        *c++ = (val >> 14) & 0xFFC0; \
+    } while (0)
+
+static void unpack_v210_c(const uint32_t *src, uint16_t *y, uint16_t *u,
+                          uint16_t *v, int width)
+{
+    uint32_t val;
+    int w;
+
+    for (w = 0; w < width; w += 6) {
+        READ_PIXELS(u, y, v);
+        READ_PIXELS(y, u, y);
+        READ_PIXELS(v, y, u);
+        READ_PIXELS(y, v, y);
+    }
+}
+
+#define READ_PIXELS_BE(a, b, c)      \
+    do {                             \
+        val  = av_be2ne32(*src++);   \
+        *a++ = (val >> 16) & 0xFFC0; \
+        *b++ = (val >>  6) & 0xFFC0; \
+        *c++ = (val <<  4) & 0xFFC0; \
+    } while (0)
+
+static void unpack_v210x_c(const uint32_t *src, uint16_t *y, uint16_t *u,
+                           uint16_t *v, int width)
+{
+    uint32_t val;
+    int w;
+
+    for (w = 0; w < width; w += 6) {
+        READ_PIXELS_BE(u, y, v);
+        READ_PIXELS_BE(y, u, y);
+        READ_PIXELS_BE(v, y, u);
+        READ_PIXELS_BE(y, v, y);
+    }
+}
+
+#define WRITE_PIXELS(a, b, c)           \
+    do {                                \
+        val =  (*a++           >>  6) | \
+              ((*b++ & 0xFFC0) <<  4);  \
+        val|=  (*c++ & 0xFFC0) << 14;   \
+        *dst++ = av_le2ne32(val);       \
+    } while (0)
+
+static void pack_v210_c(uint32_t *dst, const uint16_t *y, const uint16_t *u,
+                        const uint16_t *v, int width)
+{
+    uint32_t val;
+    int w;
+
+    for (w = 0; w < width; w += 6) {
+        WRITE_PIXELS(u, y, v);
+        WRITE_PIXELS(y, u, y);
+        WRITE_PIXELS(v, y, u);
+        WRITE_PIXELS(y, v, y);
+    }
+}
+
+static void unpack_r210_c(const uint32_t *src, uint16_t *dst, int width,
+                          int shift)
+{
+    int w;
+
+    for (w = 0; w < width; w++) {
+        uint32_t pixel = av_be2ne32(*src++) >> shift;
+        uint16_t r = (pixel >> 14) & 0xFFC0;
+        uint16_t g = (pixel >>  4) & 0xFFC0;
+        uint16_t b =  pixel <<  6;
+        *dst++ = r | (r >> 10);
+        *dst++ = g | (g >> 10);
+        *dst++ = b | (b >> 10);
+    }
+}
+
+static av_cold void v210dsp_init_c(V210DSPContext *c)
+{
+    c->unpack_v210  = unpack_v210_c;
+    c->unpack_v210x = unpack_v210x_c;
+    c->pack_v210    = pack_v210_c;
+    c->unpack_r210  = unpack_r210_c;
+}
+
+av_cold void ff_v210dsp_init(V210DSPContext *c)
+{
+    v210dsp_init_c(c);
+    if (HAVE_MMX)
+        ff_v210dsp_init_x86(c);
+}
+
+#ifdef TEST
+#include <stdio.h>
+#include <string.h>
+#include "libavutil/lfg.h"
+
+#undef printf
+
+#define MAX_WIDTH 96
+
+static int report(const char *name, int err)
+{
+    printf("%s: %s\n", name, err ? "FAILED" : "ok");
+    return err;
+}
+
+int main(void)
+{
+    /* one spare element on each side of the lines catches overwrites */
+    uint32_t packed[MAX_WIDTH + 2];
+    uint32_t ref_p[MAX_WIDTH * 2 / 3 + 2], out_p[MAX_WIDTH * 2 / 3 + 2];
+    uint16_t ref[3][MAX_WIDTH + 2], out[3][MAX_WIDTH + 2];
+    uint16_t ref_rgb[3 * MAX_WIDTH + 2], out_rgb[3 * MAX_WIDTH + 2];
+    V210DSPContext c, dsp;
+    AVLFG lfg;
+    int i, w, shift, err, ret = 0;
+
+    av_lfg_init(&lfg, 0x210);
+    v210dsp_init_c(&c);
+    ff_v210dsp_init(&dsp);
+    for (i = 0; i < FF_ARRAY_ELEMS(packed); i++)
+        packed[i] = av_lfg_get(&lfg);
+
+    /* odd offsets into the arrays also test unaligned accesses */
+    for (err = 0, w = 6; w <= MAX_WIDTH; w += 6) {
+        memset(ref, 0, sizeof(ref));
+        memset(out, 0, sizeof(out));
+        c.unpack_v210(packed + 1, ref[0] + 1, ref[1] + 1, ref[2] + 1, w);
+        dsp.unpack_v210(packed + 1, out[0] + 1, out[1] + 1, out[2] + 1, w);
+        err |= memcmp(ref, out, sizeof(ref)) != 0;
+    }
+    ret |= report("unpack_v210", err);
+
+    for (err = 0, w = 6; w <= MAX_WIDTH; w += 6) {
+        memset(ref, 0, sizeof(ref));
+        memset(out, 0, sizeof(out));
+        c.unpack_v210x(packed + 1, ref[0] + 1, ref[1] + 1, ref[2] + 1, w);
+        dsp.unpack_v210x(packed + 1, out[0] + 1, out[1] + 1, out[2] + 1, w);
+        err |= memcmp(ref, out, sizeof(ref)) != 0;
+    }
+    ret |= report("unpack_v210x", err);
+
+    for (i = 0; i < 3; i++)
+        for (w = 0; w < MAX_WIDTH + 2; w++)
+            ref[i][w] = av_lfg_get(&lfg);
+    for (err = 0, w = 6; w <= MAX_WIDTH; w += 6) {
+        memset(ref_p, 0, sizeof(ref_p));
+        memset(out_p, 0, sizeof(out_p));
+        c.pack_v210(ref_p + 1, ref[0] + 1, ref[1] + 1, ref[2] + 1, w);
+        dsp.pack_v210(out_p + 1, ref[0] + 1, ref[1] + 1, ref[2] + 1, w);
+        err |= memcmp(ref_p, out_p, sizeof(ref_p)) != 0;
+    }
+    ret |= report("pack_v210", err);
+
+    for (err = 0, shift = 0; shift <= 2; shift += 2) {
+        for (w = 1; w <= MAX_WIDTH; w++) {
+            memset(ref_rgb, 0, sizeof(ref_rgb));
+            memset(out_rgb, 0, sizeof(out_rgb));
+            c.unpack_r210(packed + 1, ref_rgb + 1, w, shift);
+            dsp.unpack_r210(packed + 1, out_rgb + 1, w, shift);
+            err |= memcmp(ref_rgb, out_rgb, sizeof(ref_rgb)) != 0;
+        }
+    }
+    ret |= report("unpack_r210", err);
+
+    return ret;
+}
+#endif /* TEST */
@@ -0,0 +1,66 @@
+/*
+ * 10-bit packed video DSP functions
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVCODEC_V210DSP_H
+#define AVCODEC_V210DSP_H
+
+#include <stdint.h>
+
+/**
+ * Conversion of one line between the packed 10-bit formats, which store
+ * three samples per 32-bit word, and 16-bit samples with the 10 bits in
+ * the most significant bits.
+ * v210 and v210x pack 6 pixels of 4:2:2 in 4 words as (Cb Y Cr) (Y Cb Y)
+ * (Cr Y Cb) (Y Cr Y); v210 in little-endian words from the least
+ * significant bits up, v210x in big-endian words from the most
+ * significant bits down. r210 and r10k store one RGB pixel per
+ * big-endian word.
+ * None of the buffers need to be aligned.
+ */
+typedef struct V210DSPContext {
+    /**
+     * Unpack width pixels of v210, width must be a multiple of 6.
+     */
+    void (*unpack_v210)(const uint32_t *src, uint16_t *y, uint16_t *u,
+                        uint16_t *v, int width);
+    /**
+     * Unpack width pixels of v210x, width must be a multiple of 6.
+     */
+    void (*unpack_v210x)(const uint32_t *src, uint16_t *y, uint16_t *u,
+                         uint16_t *v, int width);
+    /**
+     * Pack width pixels to v210, width must be a multiple of 6.
+     * Only the 10 most significant bits of the samples are used.
+     */
+    void (*pack_v210)(uint32_t *dst, const uint16_t *y, const uint16_t *u,
+                      const uint16_t *v, int width);
+    /**
+     * Unpack width pixels of r210 (shift 0) or r10k (shift 2) to RGB48,
+     * with the low 6 bits of each sample copied from its high bits.
+     * @param shift position of the blue sample in the words
+     */
+    void (*unpack_r210)(const uint32_t *src, uint16_t *dst, int width,
+                        int shift);
+} V210DSPContext;
+
+void ff_v210dsp_init(V210DSPContext *c);
+void ff_v210dsp_init_x86(V210DSPContext *c);
+
+#endif /* AVCODEC_V210DSP_H */
@@ -22,10 +22,17 @@
  */
 
 #include "avcodec.h"
-#include "libavcodec/bytestream.h"
+#include "bytestream.h"
+#include "v210dsp.h"
+
+typedef struct V210EncContext {
+    V210DSPContext dsp;
+} V210EncContext;
 
 static av_cold int encode_init(AVCodecContext *avctx)
 {
+    V210EncContext *s = avctx->priv_data;
+
     if (avctx->width & 1) {
         av_log(avctx, AV_LOG_ERROR, "v210 needs even width\n");
         return -1;
@@ -45,16 +52,19 @@ static av_cold int encode_init(AVCodecContext *avctx)
     avctx->coded_frame->key_frame = 1;
     avctx->coded_frame->pict_type = FF_I_TYPE;
 
+    ff_v210dsp_init(&s->dsp);
+
     return 0;
 }
 
 static int encode_frame(AVCodecContext *avctx, unsigned char *buf,
                         int buf_size, void *data)
 {
+    V210EncContext *s = avctx->priv_data;
     const AVFrame *pic = data;
     int aligned_width = ((avctx->width + 47) / 48) * 48;
     int stride = aligned_width * 8 / 3;
-    int h, w;
+    int h, w = avctx->width / 6 * 6;
     const uint16_t *y = (const uint16_t*)pic->data[0];
     const uint16_t *u = (const uint16_t*)pic->data[1];
     const uint16_t *v = (const uint16_t*)pic->data[2];
@@ -75,12 +85,13 @@ static int encode_frame(AVCodecContext *avctx, unsigned char *buf,
     } while (0)
 
     for (h = 0; h < avctx->height; h++) {
-        uint32_t val;
-        for (w = 0; w < avctx->width - 5; w += 6) {
-            WRITE_PIXELS(u, y, v);
-            WRITE_PIXELS(y, u, y);
-            WRITE_PIXELS(v, y, u);
-            WRITE_PIXELS(y, v, y);
+        uint32_t val = 0;
+        if (w) {
+            s->dsp.pack_v210((uint32_t *)p, y, u, v, w);
+            p += w / 6 * 16;
+            y += w;
+            u += w >> 1;
+            v += w >> 1;
         }
         if (w < avctx->width - 1) {
             WRITE_PIXELS(u, y, v);
@@ -121,7 +132,7 @@ AVCodec v210_encoder = {
     "v210",
     AVMEDIA_TYPE_VIDEO,
     CODEC_ID_V210,
-    0,
+    sizeof(V210EncContext),
     encode_init,
     encode_frame,
     encode_close,
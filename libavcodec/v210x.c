@@ -19,10 +19,17 @@
  */
 
 #include "avcodec.h"
+#include "v210dsp.h"
 #include "libavutil/bswap.h"
 
+typedef struct V210XContext {
+    V210DSPContext dsp;
+} V210XContext;
+
 static av_cold int decode_init(AVCodecContext *avctx)
 {
+    V210XContext *s = avctx->priv_data;
+
     if(avctx->width & 1){
         av_log(avctx, AV_LOG_ERROR, "v210x needs even width\n");
         return -1;
@@ -32,11 +39,14 @@ static av_cold int decode_init(AVCodecContext *avctx)
 
     avctx->coded_frame= avcodec_alloc_frame();
 
+    ff_v210dsp_init(&s->dsp);
+
     return 0;
 }
 
 static int decode_frame(AVCodecContext *avctx, void *data, int *data_size, AVPacket *avpkt)
 {
+    V210XContext *s = avctx->priv_data;
     int y=0;
     int width= avctx->width;
     AVFrame *pic= avctx->coded_frame;
@@ -66,6 +76,16 @@ static int decode_frame(AVCodecContext *avctx, void *data, int *data_size, AVPac
     pic->pict_type= FF_I_TYPE;
     pic->key_frame= 1;
 
+    /* the groups of 6 pixels only line up with the lines for such widths */
+    if(width % 6 == 0){
+        for(y=0; y<avctx->height; y++){
+            s->dsp.unpack_v210x(src, ydst, udst, vdst, width);
+            src += width / 6 * 4;
+            ydst+= pic->linesize[0]/2;
+            udst+= pic->linesize[1]/2;
+            vdst+= pic->linesize[2]/2;
+        }
+    }else
     for(;;){
         uint32_t v= av_be2ne32(*src++);
         *udst++= (v>>16) & 0xFFC0;
@@ -136,7 +156,7 @@ AVCodec v210x_decoder = {
     "v210x",
     AVMEDIA_TYPE_VIDEO,
     CODEC_ID_V210X,
-    0,
+    sizeof(V210XContext),
     decode_init,
     NULL,
     decode_close,
@@ -315,6 +315,8 @@ typedef struct VC1Context{
     int parse_only;             ///< Context is used within parser
 
     int warn_interlaced;
+
+    struct VC1Context *slice_ctx; ///< per-thread contexts for decoding slices in parallel
 } VC1Context;
 
 /** Find VC-1 marker in buffer
@@ -38,6 +38,7 @@
 #include "simple_idct.h"
 #include "mathops.h"
 #include "vdpau_internal.h"
+#include "thread.h"
 
 #undef NDEBUG
 #include <assert.h>
@@ -176,7 +177,7 @@ static void vc1_loop_filter_iblk(MpegEncContext *s, int pq)
     }
     s->dsp.vc1_v_loop_filter16(s->dest[0] + 8*s->linesize, s->linesize, pq);
 
-    if (s->mb_y == s->mb_height-1) {
+    if (s->mb_y == s->end_mb_y-1) {
         if (s->mb_x) {
             s->dsp.vc1_h_loop_filter16(s->dest[0], s->linesize, pq);
             s->dsp.vc1_h_loop_filter8(s->dest[1], s->uvlinesize, pq);
@@ -219,6 +220,31 @@ static void vc1_put_block(VC1Context *v, DCTELEM block[6][64])
     }
 }
 
+/** Wait until a reference picture has been decoded down to a given luma line
+ * @param pic reference picture, may be NULL
+ * @param line last luma line that will be read
+ */
+static void vc1_await_ref_lines(VC1Context *v, Picture *pic, int line)
+{
+    MpegEncContext *s = &v->s;
+
+    if (pic)
+        ff_thread_await_progress((AVFrame*)pic, av_clip(line >> 4, 0, s->mb_height - 1), 0);
+}
+
+/** Report the rows of the current picture that will not change any more
+ * Filtering the current row still modifies the one above it, so progress
+ * lags one row behind. Pictures split into several slices are only reported
+ * once complete, as error concealment may touch any of their rows.
+ */
+static void vc1_report_rows(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+
+    if (!s->start_mb_y && s->end_mb_y == s->mb_height)
+        ff_thread_report_progress((AVFrame*)s->current_picture_ptr, s->mb_y - 1, 0);
+}
+
 /** Do motion compensation over 1 macroblock
  * Mostly adapted hpel_motion and qpel_motion from mpegvideo.c
  */
@@ -272,6 +298,9 @@ static void vc1_mc_1mv(VC1Context *v, int dir)
         uvsrc_y = av_clip(uvsrc_y,  -8, s->avctx->coded_height >> 1);
     }
 
+    vc1_await_ref_lines(v, dir ? s->next_picture_ptr : s->last_picture_ptr,
+                        FFMAX(src_y, 2 * uvsrc_y) + 19);
+
     srcY += src_y * s->linesize + src_x;
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
@@ -282,7 +311,10 @@ static void vc1_mc_1mv(VC1Context *v, int dir)
         srcV = s->edge_emu_buffer + 18 * s->linesize;
     }
 
+    /* the unsigned range checks below wrap for pictures smaller than the
+     * block plus the filter taps, those always need the edge emulation */
     if(v->rangeredfrm || (v->mv_mode == MV_PMODE_INTENSITY_COMP)
+       || s->h_edge_pos < 22 || s->v_edge_pos < 22
        || (unsigned)(src_x - s->mspel) > s->h_edge_pos - (mx&3) - 16 - s->mspel*3
        || (unsigned)(src_y - s->mspel) > s->v_edge_pos - (my&3) - 16 - s->mspel*3){
         uint8_t *uvbuf= s->edge_emu_buffer + 19 * s->linesize;
@@ -397,9 +429,12 @@ static void vc1_mc_4mv_luma(VC1Context *v, int n)
         src_y   = av_clip(  src_y, -18, s->avctx->coded_height + 1);
     }
 
+    vc1_await_ref_lines(v, s->last_picture_ptr, src_y + 11);
+
     srcY += src_y * s->linesize + src_x;
 
     if(v->rangeredfrm || (v->mv_mode == MV_PMODE_INTENSITY_COMP)
+       || s->h_edge_pos < 13 || s->v_edge_pos < 13
        || (unsigned)(src_x - s->mspel) > s->h_edge_pos - (mx&3) - 8 - s->mspel*2
        || (unsigned)(src_y - s->mspel) > s->v_edge_pos - (my&3) - 8 - s->mspel*2){
         srcY -= s->mspel * (1 + s->linesize);
@@ -532,9 +567,12 @@ static void vc1_mc_4mv_chroma(VC1Context *v)
         uvsrc_y = av_clip(uvsrc_y,  -8, s->avctx->coded_height >> 1);
     }
 
+    vc1_await_ref_lines(v, s->last_picture_ptr, 2 * uvsrc_y + 19);
+
     srcU = s->last_picture.data[1] + uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV = s->last_picture.data[2] + uvsrc_y * s->uvlinesize + uvsrc_x;
     if(v->rangeredfrm || (v->mv_mode == MV_PMODE_INTENSITY_COMP)
+       || s->h_edge_pos < 18 || s->v_edge_pos < 18
        || (unsigned)uvsrc_x > (s->h_edge_pos >> 1) - 9
        || (unsigned)uvsrc_y > (s->v_edge_pos >> 1) - 9){
         ff_emulated_edge_mc(s->edge_emu_buffer     , srcU, s->uvlinesize, 8+1, 8+1,
@@ -856,6 +894,8 @@ static void vc1_interp_mc(VC1Context *v)
         uvsrc_y = av_clip(uvsrc_y,  -8, s->avctx->coded_height >> 1);
     }
 
+    vc1_await_ref_lines(v, s->next_picture_ptr, FFMAX(src_y, 2 * uvsrc_y) + 19);
+
     srcY += src_y * s->linesize + src_x;
     srcU += uvsrc_y * s->uvlinesize + uvsrc_x;
     srcV += uvsrc_y * s->uvlinesize + uvsrc_x;
@@ -867,6 +907,7 @@ static void vc1_interp_mc(VC1Context *v)
     }
 
     if(v->rangeredfrm
+       || s->h_edge_pos < 22 || s->v_edge_pos < 22
        || (unsigned)(src_x - s->mspel) > s->h_edge_pos - (mx&3) - 16 - s->mspel*3
        || (unsigned)(src_y - s->mspel) > s->v_edge_pos - (my&3) - 16 - s->mspel*3){
         uint8_t *uvbuf= s->edge_emu_buffer + 19 * s->linesize;
@@ -1000,12 +1041,17 @@ static inline void vc1_pred_b_mv(VC1Context *v, int dmv_x[2], int dmv_y[2], int
     xy = s->block_index[0];
 
     if(s->mb_intra) {
+        /* a damaged interpolated MB may still be motion compensated, it must
+         * not use the vectors left over from whichever MB came before */
+        s->mv[0][0][0] = s->mv[0][0][1] = s->mv[1][0][0] = s->mv[1][0][1] = 0;
         s->current_picture.motion_val[0][xy][0] =
         s->current_picture.motion_val[0][xy][1] =
         s->current_picture.motion_val[1][xy][0] =
         s->current_picture.motion_val[1][xy][1] = 0;
         return;
     }
+    /* direct prediction reads the co-located vectors of the next anchor */
+    ff_thread_await_progress((AVFrame*)s->next_picture_ptr, s->mb_y, 0);
     s->mv[0][0][0] = scale_mv(s->next_picture.motion_val[1][xy][0], v->bfraction, 0, s->quarter_sample);
     s->mv[0][0][1] = scale_mv(s->next_picture.motion_val[1][xy][1], v->bfraction, 0, s->quarter_sample);
     s->mv[1][0][0] = scale_mv(s->next_picture.motion_val[1][xy][0], v->bfraction, 1, s->quarter_sample);
@@ -2244,7 +2290,7 @@ static int vc1_decode_p_mb(VC1Context *v)
                         if(v->a_avail)
                             s->dsp.vc1_v_overlap(s->dest[dst_idx] + off, i & 4 ? s->uvlinesize : s->linesize);
                     }
-                    if(apply_loop_filter && s->mb_x && s->mb_x != (s->mb_width - 1) && s->mb_y && s->mb_y != (s->mb_height - 1)){
+                    if(apply_loop_filter && s->mb_x && s->mb_x != (s->mb_width - 1) && !s->first_slice_line && s->mb_y != (s->mb_height - 1)){
                         int left_cbp, top_cbp;
                         if(i & 4){
                             left_cbp = v->cbp[s->mb_x - 1]            >> (i * 4);
@@ -2261,7 +2307,7 @@ static int vc1_decode_p_mb(VC1Context *v)
                     block_cbp |= 0xF << (i << 2);
                 } else if(val) {
                     int left_cbp = 0, top_cbp = 0, filter = 0;
-                    if(apply_loop_filter && s->mb_x && s->mb_x != (s->mb_width - 1) && s->mb_y && s->mb_y != (s->mb_height - 1)){
+                    if(apply_loop_filter && s->mb_x && s->mb_x != (s->mb_width - 1) && !s->first_slice_line && s->mb_y != (s->mb_height - 1)){
                         filter = 1;
                         if(i & 4){
                             left_cbp = v->cbp[s->mb_x - 1]            >> (i * 4);
@@ -2375,7 +2421,7 @@ static int vc1_decode_p_mb(VC1Context *v)
                         if(v->a_avail)
                             s->dsp.vc1_v_overlap(s->dest[dst_idx] + off, i & 4 ? s->uvlinesize : s->linesize);
                     }
-                    if(v->s.loop_filter && s->mb_x && s->mb_x != (s->mb_width - 1) && s->mb_y && s->mb_y != (s->mb_height - 1)){
+                    if(v->s.loop_filter && s->mb_x && s->mb_x != (s->mb_width - 1) && !s->first_slice_line && s->mb_y != (s->mb_height - 1)){
                         int left_cbp, top_cbp;
                         if(i & 4){
                             left_cbp = v->cbp[s->mb_x - 1]            >> (i * 4);
@@ -2392,7 +2438,7 @@ static int vc1_decode_p_mb(VC1Context *v)
                     block_cbp |= 0xF << (i << 2);
                 } else if(is_coded[i]) {
                     int left_cbp = 0, top_cbp = 0, filter = 0;
-                    if(v->s.loop_filter && s->mb_x && s->mb_x != (s->mb_width - 1) && s->mb_y && s->mb_y != (s->mb_height - 1)){
+                    if(v->s.loop_filter && s->mb_x && s->mb_x != (s->mb_width - 1) && !s->first_slice_line && s->mb_y != (s->mb_height - 1)){
                         filter = 1;
                         if(i & 4){
                             left_cbp = v->cbp[s->mb_x - 1]            >> (i * 4);
@@ -2625,7 +2671,7 @@ static void vc1_decode_i_blocks(VC1Context *v)
     s->mb_x = s->mb_y = 0;
     s->mb_intra = 1;
     s->first_slice_line = 1;
-    for(s->mb_y = 0; s->mb_y < s->mb_height; s->mb_y++) {
+    for(s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         ff_init_block_index(s);
         for(; s->mb_x < s->mb_width; s->mb_x++) {
@@ -2634,6 +2680,8 @@ static void vc1_decode_i_blocks(VC1Context *v)
             mb_pos = s->mb_x + s->mb_y * s->mb_width;
             s->current_picture.mb_type[mb_pos] = MB_TYPE_INTRA;
             s->current_picture.qscale_table[mb_pos] = v->pq;
+            s->current_picture.motion_val[0][s->block_index[0]][0] = 0;
+            s->current_picture.motion_val[0][s->block_index[0]][1] = 0;
             s->current_picture.motion_val[1][s->block_index[0]][0] = 0;
             s->current_picture.motion_val[1][s->block_index[0]][1] = 0;
 
@@ -2685,21 +2733,22 @@ static void vc1_decode_i_blocks(VC1Context *v)
             if(v->s.loop_filter) vc1_loop_filter_iblk(s, v->pq);
 
             if(get_bits_count(&s->gb) > v->bits) {
-                ff_er_add_slice(s, 0, 0, s->mb_x, s->mb_y, (AC_END|DC_END|MV_END));
+                ff_er_add_slice(s, 0, s->start_mb_y, s->mb_x, s->mb_y, (AC_END|DC_END|MV_END));
                 av_log(s->avctx, AV_LOG_ERROR, "Bits overconsumption: %i > %i\n", get_bits_count(&s->gb), v->bits);
                 return;
             }
         }
         if (!v->s.loop_filter)
             ff_draw_horiz_band(s, s->mb_y * 16, 16);
-        else if (s->mb_y)
+        else if (!s->first_slice_line)
             ff_draw_horiz_band(s, (s->mb_y-1) * 16, 16);
+        vc1_report_rows(v);
 
         s->first_slice_line = 0;
     }
     if (v->s.loop_filter)
-        ff_draw_horiz_band(s, (s->mb_height-1)*16, 16);
-    ff_er_add_slice(s, 0, 0, s->mb_width - 1, s->mb_height - 1, (AC_END|DC_END|MV_END));
+        ff_draw_horiz_band(s, (s->end_mb_y-1)*16, 16);
+    ff_er_add_slice(s, 0, s->start_mb_y, s->mb_width - 1, s->end_mb_y - 1, (AC_END|DC_END|MV_END));
 }
 
 /** Decode blocks of I-frame for advanced profile
@@ -2745,7 +2794,7 @@ static void vc1_decode_i_blocks_adv(VC1Context *v)
     s->mb_x = s->mb_y = 0;
     s->mb_intra = 1;
     s->first_slice_line = 1;
-    for(s->mb_y = 0; s->mb_y < s->mb_height; s->mb_y++) {
+    for(s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         ff_init_block_index(s);
         for(;s->mb_x < s->mb_width; s->mb_x++) {
@@ -2753,6 +2802,8 @@ static void vc1_decode_i_blocks_adv(VC1Context *v)
             s->dsp.clear_blocks(s->block[0]);
             mb_pos = s->mb_x + s->mb_y * s->mb_stride;
             s->current_picture.mb_type[mb_pos] = MB_TYPE_INTRA;
+            s->current_picture.motion_val[0][s->block_index[0]][0] = 0;
+            s->current_picture.motion_val[0][s->block_index[0]][1] = 0;
             s->current_picture.motion_val[1][s->block_index[0]][0] = 0;
             s->current_picture.motion_val[1][s->block_index[0]][1] = 0;
 
@@ -2823,20 +2874,21 @@ static void vc1_decode_i_blocks_adv(VC1Context *v)
             if(v->s.loop_filter) vc1_loop_filter_iblk(s, v->pq);
 
             if(get_bits_count(&s->gb) > v->bits) {
-                ff_er_add_slice(s, 0, 0, s->mb_x, s->mb_y, (AC_END|DC_END|MV_END));
+                ff_er_add_slice(s, 0, s->start_mb_y, s->mb_x, s->mb_y, (AC_END|DC_END|MV_END));
                 av_log(s->avctx, AV_LOG_ERROR, "Bits overconsumption: %i > %i\n", get_bits_count(&s->gb), v->bits);
                 return;
             }
         }
         if (!v->s.loop_filter)
             ff_draw_horiz_band(s, s->mb_y * 16, 16);
-        else if (s->mb_y)
+        else if (!s->first_slice_line)
             ff_draw_horiz_band(s, (s->mb_y-1) * 16, 16);
+        vc1_report_rows(v);
         s->first_slice_line = 0;
     }
     if (v->s.loop_filter)
-        ff_draw_horiz_band(s, (s->mb_height-1)*16, 16);
-    ff_er_add_slice(s, 0, 0, s->mb_width - 1, s->mb_height - 1, (AC_END|DC_END|MV_END));
+        ff_draw_horiz_band(s, (s->end_mb_y-1)*16, 16);
+    ff_er_add_slice(s, 0, s->start_mb_y, s->mb_width - 1, s->end_mb_y - 1, (AC_END|DC_END|MV_END));
 }
 
 static void vc1_decode_p_blocks(VC1Context *v)
@@ -2870,7 +2922,7 @@ static void vc1_decode_p_blocks(VC1Context *v)
 
     s->first_slice_line = 1;
     memset(v->cbp_base, 0, sizeof(v->cbp_base[0])*2*s->mb_stride);
-    for(s->mb_y = 0; s->mb_y < s->mb_height; s->mb_y++) {
+    for(s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         ff_init_block_index(s);
         for(; s->mb_x < s->mb_width; s->mb_x++) {
@@ -2878,16 +2930,17 @@ static void vc1_decode_p_blocks(VC1Context *v)
 
             vc1_decode_p_mb(v);
             if(get_bits_count(&s->gb) > v->bits || get_bits_count(&s->gb) < 0) {
-                ff_er_add_slice(s, 0, 0, s->mb_x, s->mb_y, (AC_END|DC_END|MV_END));
+                ff_er_add_slice(s, 0, s->start_mb_y, s->mb_x, s->mb_y, (AC_END|DC_END|MV_END));
                 av_log(s->avctx, AV_LOG_ERROR, "Bits overconsumption: %i > %i at %ix%i\n", get_bits_count(&s->gb), v->bits,s->mb_x,s->mb_y);
                 return;
             }
         }
         memmove(v->cbp_base, v->cbp, sizeof(v->cbp_base[0])*s->mb_stride);
         ff_draw_horiz_band(s, s->mb_y * 16, 16);
+        vc1_report_rows(v);
         s->first_slice_line = 0;
     }
-    ff_er_add_slice(s, 0, 0, s->mb_width - 1, s->mb_height - 1, (AC_END|DC_END|MV_END));
+    ff_er_add_slice(s, 0, s->start_mb_y, s->mb_width - 1, s->end_mb_y - 1, (AC_END|DC_END|MV_END));
 }
 
 static void vc1_decode_b_blocks(VC1Context *v)
@@ -2920,7 +2973,7 @@ static void vc1_decode_b_blocks(VC1Context *v)
     }
 
     s->first_slice_line = 1;
-    for(s->mb_y = 0; s->mb_y < s->mb_height; s->mb_y++) {
+    for(s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         ff_init_block_index(s);
         for(; s->mb_x < s->mb_width; s->mb_x++) {
@@ -2928,7 +2981,7 @@ static void vc1_decode_b_blocks(VC1Context *v)
 
             vc1_decode_b_mb(v);
             if(get_bits_count(&s->gb) > v->bits || get_bits_count(&s->gb) < 0) {
-                ff_er_add_slice(s, 0, 0, s->mb_x, s->mb_y, (AC_END|DC_END|MV_END));
+                ff_er_add_slice(s, 0, s->start_mb_y, s->mb_x, s->mb_y, (AC_END|DC_END|MV_END));
                 av_log(s->avctx, AV_LOG_ERROR, "Bits overconsumption: %i > %i at %ix%i\n", get_bits_count(&s->gb), v->bits,s->mb_x,s->mb_y);
                 return;
             }
@@ -2936,29 +2989,32 @@ static void vc1_decode_b_blocks(VC1Context *v)
         }
         if (!v->s.loop_filter)
             ff_draw_horiz_band(s, s->mb_y * 16, 16);
-        else if (s->mb_y)
+        else if (!s->first_slice_line)
             ff_draw_horiz_band(s, (s->mb_y-1) * 16, 16);
+        vc1_report_rows(v);
         s->first_slice_line = 0;
     }
     if (v->s.loop_filter)
-        ff_draw_horiz_band(s, (s->mb_height-1)*16, 16);
-    ff_er_add_slice(s, 0, 0, s->mb_width - 1, s->mb_height - 1, (AC_END|DC_END|MV_END));
+        ff_draw_horiz_band(s, (s->end_mb_y-1)*16, 16);
+    ff_er_add_slice(s, 0, s->start_mb_y, s->mb_width - 1, s->end_mb_y - 1, (AC_END|DC_END|MV_END));
 }
 
 static void vc1_decode_skip_blocks(VC1Context *v)
 {
     MpegEncContext *s = &v->s;
 
-    ff_er_add_slice(s, 0, 0, s->mb_width - 1, s->mb_height - 1, (AC_END|DC_END|MV_END));
+    ff_er_add_slice(s, 0, s->start_mb_y, s->mb_width - 1, s->end_mb_y - 1, (AC_END|DC_END|MV_END));
     s->first_slice_line = 1;
-    for(s->mb_y = 0; s->mb_y < s->mb_height; s->mb_y++) {
+    for(s->mb_y = s->start_mb_y; s->mb_y < s->end_mb_y; s->mb_y++) {
         s->mb_x = 0;
         ff_init_block_index(s);
         ff_update_block_index(s);
+        ff_thread_await_progress((AVFrame*)s->last_picture_ptr, s->mb_y, 0);
         memcpy(s->dest[0], s->last_picture.data[0] + s->mb_y * 16 * s->linesize, s->linesize * 16);
         memcpy(s->dest[1], s->last_picture.data[1] + s->mb_y * 8 * s->uvlinesize, s->uvlinesize * 8);
         memcpy(s->dest[2], s->last_picture.data[2] + s->mb_y * 8 * s->uvlinesize, s->uvlinesize * 8);
         ff_draw_horiz_band(s, s->mb_y * 16, 16);
+        vc1_report_rows(v);
         s->first_slice_line = 0;
     }
     s->pict_type = FF_P_TYPE;
@@ -2998,6 +3054,74 @@ static void vc1_decode_blocks(VC1Context *v)
     }
 }
 
+/** Slice of an advanced profile picture */
+typedef struct VC1SliceInfo {
+    uint8_t *buf;         ///< unescaped slice data
+    GetBitContext gb;
+    int start_mb_y;       ///< first macroblock row of the slice
+    int end_mb_y;         ///< first macroblock row after the slice
+    int pic_header;       ///< slice repeats the picture header
+    int error_count;
+} VC1SliceInfo;
+
+/** Decode one slice of a picture in a separate thread
+ * Every thread works on its own copy of the decoder state, only the
+ * picture and the per-macroblock tables are shared.
+ */
+static int vc1_decode_slice_thread(AVCodecContext *avctx, void *arg, int jobnr, int threadnr)
+{
+    VC1Context *v  = avctx->priv_data;
+    VC1Context *vt = &v->slice_ctx[threadnr];
+    VC1SliceInfo *sl = (VC1SliceInfo*)arg + jobnr;
+    uint32_t *cbp_base = vt->cbp_base;
+
+    vt->s = *v->s.thread_context[threadnr];
+    ff_update_duplicate_context(&vt->s, &v->s);
+    memcpy(&vt->bits, &v->bits, sizeof(VC1Context) - offsetof(VC1Context, bits));
+    vt->cbp_base = cbp_base;
+    vt->cbp      = cbp_base + vt->s.mb_stride;
+
+    vt->s.gb          = sl->gb;
+    vt->s.start_mb_y  = sl->start_mb_y;
+    vt->s.end_mb_y    = sl->end_mb_y;
+    vt->s.error_count = 3 * (sl->end_mb_y - sl->start_mb_y) * vt->s.mb_width;
+    if (jobnr)
+        vt->bits = sl->gb.size_in_bits;
+
+    vc1_decode_blocks(vt);
+    sl->error_count = vt->s.error_count;
+    return 0;
+}
+
+/** Allocate the per-macroblock tables of a decoder context
+ */
+static av_cold int vc1_alloc_tables(VC1Context *v)
+{
+    MpegEncContext *s = &v->s;
+
+    /* Allocate mb bitplanes */
+    v->mv_type_mb_plane = av_malloc(s->mb_stride * s->mb_height);
+    v->direct_mb_plane = av_malloc(s->mb_stride * s->mb_height);
+    v->acpred_plane = av_malloc(s->mb_stride * s->mb_height);
+    v->over_flags_plane = av_malloc(s->mb_stride * s->mb_height);
+
+    v->cbp_base = av_malloc(sizeof(v->cbp_base[0]) * 2 * s->mb_stride);
+    v->cbp = v->cbp_base + s->mb_stride;
+
+    /* allocate block type info in that way so it could be used with s->block_index[] */
+    v->mb_type_base = av_malloc(s->b8_stride * (s->mb_height * 2 + 1) + s->mb_stride * (s->mb_height + 1) * 2);
+    v->mb_type[0] = v->mb_type_base + s->b8_stride + 1;
+    v->mb_type[1] = v->mb_type_base + s->b8_stride * (s->mb_height * 2 + 1) + s->mb_stride + 1;
+    v->mb_type[2] = v->mb_type[1] + s->mb_stride * (s->mb_height + 1);
+
+    if (!v->mv_type_mb_plane || !v->direct_mb_plane || !v->acpred_plane ||
+        !v->over_flags_plane || !v->cbp_base || !v->mb_type_base)
+        return -1;
+
+    ff_intrax8_common_init(&v->x8,s);
+    return 0;
+}
+
 /** Initialize a VC1/WMV3 decoder
  * @todo TODO: Handle VC-1 IDUs (Transport level?)
  * @todo TODO: Decypher remaining bits in extra_data
@@ -3103,20 +3227,8 @@ static av_cold int vc1_decode_init(AVCodecContext *avctx)
     s->mb_width = (avctx->coded_width+15)>>4;
     s->mb_height = (avctx->coded_height+15)>>4;
 
-    /* Allocate mb bitplanes */
-    v->mv_type_mb_plane = av_malloc(s->mb_stride * s->mb_height);
-    v->direct_mb_plane = av_malloc(s->mb_stride * s->mb_height);
-    v->acpred_plane = av_malloc(s->mb_stride * s->mb_height);
-    v->over_flags_plane = av_malloc(s->mb_stride * s->mb_height);
-
-    v->cbp_base = av_malloc(sizeof(v->cbp_base[0]) * 2 * s->mb_stride);
-    v->cbp = v->cbp_base + s->mb_stride;
-
-    /* allocate block type info in that way so it could be used with s->block_index[] */
-    v->mb_type_base = av_malloc(s->b8_stride * (s->mb_height * 2 + 1) + s->mb_stride * (s->mb_height + 1) * 2);
-    v->mb_type[0] = v->mb_type_base + s->b8_stride + 1;
-    v->mb_type[1] = v->mb_type_base + s->b8_stride * (s->mb_height * 2 + 1) + s->mb_stride + 1;
-    v->mb_type[2] = v->mb_type[1] + s->mb_stride * (s->mb_height + 1);
+    if (vc1_alloc_tables(v) < 0)
+        return -1;
 
     /* Init coded blocks info */
     if (v->profile == PROFILE_ADVANCED)
@@ -3127,7 +3239,84 @@ static av_cold int vc1_decode_init(AVCodecContext *avctx)
 //            return -1;
     }
 
-    ff_intrax8_common_init(&v->x8,s);
+    if (avctx->active_thread_type & FF_THREAD_SLICE) {
+        int i;
+
+        v->slice_ctx = av_mallocz(sizeof(*v->slice_ctx) * avctx->thread_count);
+        if (!v->slice_ctx)
+            return -1;
+        for (i = 0; i < avctx->thread_count; i++) {
+            v->slice_ctx[i].cbp_base = av_malloc(sizeof(v->cbp_base[0]) * 2 * s->mb_stride);
+            if (!v->slice_ctx[i].cbp_base)
+                return -1;
+        }
+    }
+    return 0;
+}
+
+/** Initialize the decoder copy used by a frame thread
+ * The copy starts out with the pointers of the first context, so it
+ * needs tables of its own. The MpegEncContext is set up on the first
+ * vc1_update_thread_context() call.
+ */
+static av_cold int vc1_decode_init_thread_copy(AVCodecContext *avctx)
+{
+    VC1Context *v = avctx->priv_data;
+
+    v->s.avctx              = avctx;
+    v->s.context_initialized = 0;
+    v->slice_ctx            = NULL;
+
+    return vc1_alloc_tables(v);
+}
+
+/** Take over the stream state of the thread that decoded the previous frame
+ * Only the entry point fields and the state a picture header carries over
+ * to the next picture are copied; everything else is rewritten per frame
+ * and may still be in use by the source thread.
+ */
+static int vc1_update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    VC1Context *v = dst->priv_data, *v1 = src->priv_data;
+    int err;
+
+    if (dst == src)
+        return 0;
+
+    err = ff_mpeg_update_thread_context(dst, src);
+    if (err < 0)
+        return err;
+
+    v->s.loop_filter = v1->s.loop_filter;
+    v->s.h_edge_pos  = v1->s.h_edge_pos;
+    v->s.v_edge_pos  = v1->s.v_edge_pos;
+
+    /* entry point */
+    v->broken_link      = v1->broken_link;
+    v->closed_entry     = v1->closed_entry;
+    v->panscanflag      = v1->panscanflag;
+    v->refdist_flag     = v1->refdist_flag;
+    v->fastuvmc         = v1->fastuvmc;
+    v->extended_mv      = v1->extended_mv;
+    v->extended_dmv     = v1->extended_dmv;
+    v->dquant           = v1->dquant;
+    v->vstransform      = v1->vstransform;
+    v->overlap          = v1->overlap;
+    v->quantizer_mode   = v1->quantizer_mode;
+    v->range_mapy_flag  = v1->range_mapy_flag;
+    v->range_mapy       = v1->range_mapy;
+    v->range_mapuv_flag = v1->range_mapuv_flag;
+    v->range_mapuv      = v1->range_mapuv;
+
+    /* simple/main profile P frames toggle the rounding control and keep
+     * mvrange without extended_mv, B frames reuse the resolution and
+     * intensity compensation of the last reference frame */
+    v->rnd     = v1->rnd;
+    v->mvrange = v1->mvrange;
+    v->respic  = v1->respic;
+    v->use_ic  = v1->use_ic;
+    memcpy(v->luty,  v1->luty,  sizeof(v->luty));
+    memcpy(v->lutuv, v1->lutuv, sizeof(v->lutuv));
     return 0;
 }
 
@@ -3146,6 +3335,8 @@ static int vc1_decode_frame(AVCodecContext *avctx,
     AVFrame *pict = data;
     uint8_t *buf2 = NULL;
     const uint8_t *buf_start = buf;
+    VC1SliceInfo *slices = NULL, *tmp;
+    int n_slices = 0, pic_headers = 0, i;
 
     /* no supplementary picture */
     if (buf_size == 0) {
@@ -3200,10 +3391,27 @@ static int vc1_decode_frame(AVCodecContext *avctx,
                     init_get_bits(&s->gb, buf2, buf_size2*8);
                     vc1_decode_entry_point(avctx, v, &s->gb);
                     break;
-                case VC1_CODE_SLICE:
-                    av_log(avctx, AV_LOG_ERROR, "Sliced decoding is not implemented (yet)\n");
-                    av_free(buf2);
-                    return -1;
+                case VC1_CODE_SLICE: {
+                    /* index 0 is reserved for the part coded with the picture header */
+                    VC1SliceInfo *sl;
+                    int buf_size3;
+
+                    tmp = av_realloc(slices, sizeof(*slices) * (n_slices + 2));
+                    if (!tmp)
+                        goto err;
+                    slices = tmp;
+                    sl = &slices[n_slices + 1];
+                    sl->buf = av_mallocz(size + FF_INPUT_BUFFER_PADDING_SIZE);
+                    if (!sl->buf)
+                        goto err;
+                    buf_size3 = vc1_unescape_buffer(start + 4, size, sl->buf);
+                    init_get_bits(&sl->gb, sl->buf, buf_size3 * 8);
+                    sl->start_mb_y = get_bits(&sl->gb, 9);
+                    sl->pic_header = get_bits1(&sl->gb);
+                    pic_headers   |= sl->pic_header;
+                    n_slices++;
+                    break;
+                }
                 }
             }
         }else if(v->interlace && ((buf[0] & 0xC0) == 0xC0)){ /* WVC1 interlaced stores both fields divided by marker */
@@ -3212,15 +3420,14 @@ static int vc1_decode_frame(AVCodecContext *avctx,
             divider = find_next_marker(buf, buf + buf_size);
             if((divider == (buf + buf_size)) || AV_RB32(divider) != VC1_CODE_FIELD){
                 av_log(avctx, AV_LOG_ERROR, "Error in WVC1 interlaced frame\n");
-                av_free(buf2);
-                return -1;
+                goto err;
             }
 
             buf_size2 = vc1_unescape_buffer(buf, divider - buf, buf2);
             // TODO
             if(!v->warn_interlaced++)
                 av_log(v->s.avctx, AV_LOG_ERROR, "Interlaced WVC1 support is not implemented\n");
-            av_free(buf2);return -1;
+            goto err;
         }else{
             buf_size2 = vc1_unescape_buffer(buf, buf_size, buf2);
         }
@@ -3230,19 +3437,16 @@ static int vc1_decode_frame(AVCodecContext *avctx,
     // do parse frame header
     if(v->profile < PROFILE_ADVANCED) {
         if(vc1_parse_frame_header(v, &s->gb) == -1) {
-            av_free(buf2);
-            return -1;
+            goto err;
         }
     } else {
         if(vc1_parse_frame_header_adv(v, &s->gb) == -1) {
-            av_free(buf2);
-            return -1;
+            goto err;
         }
     }
 
     if(v->res_sprite && (s->pict_type!=FF_I_TYPE)){
-        av_free(buf2);
-        return -1;
+        goto err;
     }
 
     // for hurry_up==5
@@ -3251,35 +3455,36 @@ static int vc1_decode_frame(AVCodecContext *avctx,
 
     /* skip B-frames if we don't have reference frames */
     if(s->last_picture_ptr==NULL && (s->pict_type==FF_B_TYPE || s->dropable)){
-        av_free(buf2);
-        return -1;//buf_size;
+        goto err;
     }
     /* skip b frames if we are in a hurry */
-    if(avctx->hurry_up && s->pict_type==FF_B_TYPE) return -1;//buf_size;
+    if(avctx->hurry_up && s->pict_type==FF_B_TYPE) goto err;
     if(   (avctx->skip_frame >= AVDISCARD_NONREF && s->pict_type==FF_B_TYPE)
        || (avctx->skip_frame >= AVDISCARD_NONKEY && s->pict_type!=FF_I_TYPE)
        ||  avctx->skip_frame >= AVDISCARD_ALL) {
-        av_free(buf2);
-        return buf_size;
+        goto end;
     }
     /* skip everything if we are in a hurry>=5 */
     if(avctx->hurry_up>=5) {
-        av_free(buf2);
-        return -1;//buf_size;
+        goto err;
     }
 
     if(s->next_p_frame_damaged){
         if(s->pict_type==FF_B_TYPE)
-            return buf_size;
+            goto end;
         else
             s->next_p_frame_damaged=0;
     }
 
     if(MPV_frame_start(s, avctx) < 0) {
-        av_free(buf2);
-        return -1;
+        goto err;
     }
 
+    /* a repeated picture header changes the state the next frame thread
+     * copies, so such pictures let it start only once fully decoded */
+    if (!pic_headers)
+        ff_thread_finish_setup(avctx);
+
     s->me.qpel_put= s->dsp.put_qpel_pixels_tab;
     s->me.qpel_avg= s->dsp.avg_qpel_pixels_tab;
 
@@ -3288,19 +3493,72 @@ static int vc1_decode_frame(AVCodecContext *avctx,
         ff_vdpau_vc1_decode_picture(s, buf_start, (buf + buf_size) - buf_start);
     else if (avctx->hwaccel) {
         if (avctx->hwaccel->start_frame(avctx, buf, buf_size) < 0)
-            return -1;
+            goto err;
         if (avctx->hwaccel->decode_slice(avctx, buf_start, (buf + buf_size) - buf_start) < 0)
-            return -1;
+            goto err;
         if (avctx->hwaccel->end_frame(avctx) < 0)
-            return -1;
+            goto err;
     } else {
+        int j;
+
         ff_er_frame_start(s);
 
         v->bits = buf_size * 8;
-        vc1_decode_blocks(v);
+        if (n_slices) {
+            slices[0].gb         = s->gb;
+            slices[0].start_mb_y = 0;
+            slices[0].pic_header = 0;
+            /* slices have to follow each other down the picture */
+            for (i = j = 1; i <= n_slices; i++) {
+                if (slices[i].start_mb_y <= slices[j-1].start_mb_y ||
+                    slices[i].start_mb_y >= s->mb_height) {
+                    av_log(avctx, AV_LOG_ERROR, "Invalid slice address %d\n", slices[i].start_mb_y);
+                    av_free(slices[i].buf);
+                    continue;
+                }
+                slices[j++] = slices[i];
+            }
+            n_slices = j - 1;
+            for (i = 0; i < n_slices; i++)
+                slices[i].end_mb_y = slices[i+1].start_mb_y;
+            slices[n_slices].end_mb_y = s->mb_height;
+        }
+
+        if (n_slices && v->slice_ctx && !pic_headers && !v->p_frame_skipped &&
+            !avctx->draw_horiz_band) {
+            int64_t error_count = 0;
+
+            avctx->execute2(avctx, vc1_decode_slice_thread, slices, NULL, n_slices + 1);
+            /* a slice with errors sets its count to INT_MAX */
+            for (i = 0; i <= n_slices; i++)
+                error_count += slices[i].error_count;
+            s->error_count = FFMIN(error_count, INT_MAX);
+        } else {
+            s->start_mb_y = 0;
+            s->end_mb_y   = n_slices ? slices[0].end_mb_y : s->mb_height;
+            vc1_decode_blocks(v);
+            for (i = 1; i <= n_slices; i++) {
+                s->gb = slices[i].gb;
+                if (slices[i].pic_header && vc1_parse_frame_header_adv(v, &s->gb) == -1) {
+                    av_log(avctx, AV_LOG_ERROR, "Slice header damaged\n");
+                    continue;
+                }
+                s->start_mb_y = slices[i].start_mb_y;
+                s->end_mb_y   = slices[i].end_mb_y;
+                v->bits       = slices[i].gb.size_in_bits;
+                vc1_decode_blocks(v);
+            }
+        }
 //av_log(s->avctx, AV_LOG_INFO, "Consumed %i/%i bits\n", get_bits_count(&s->gb), buf_size*8);
 //  if(get_bits_count(&s->gb) > buf_size * 8)
 //      return -1;
+        if (s->error_count) {
+            /* concealment may copy from anywhere in the reference pictures */
+            if (s->last_picture_ptr)
+                ff_thread_await_progress((AVFrame*)s->last_picture_ptr, INT_MAX, 0);
+            if (s->pict_type == FF_B_TYPE && s->next_picture_ptr)
+                ff_thread_await_progress((AVFrame*)s->next_picture_ptr, INT_MAX, 0);
+        }
         ff_er_frame_end(s);
     }
 
@@ -3319,8 +3577,19 @@ assert(s->current_picture.pict_type == s->pict_type);
         ff_print_debug_info(s, pict);
     }
 
+end:
     av_free(buf2);
+    for (i = 1; i <= n_slices; i++)
+        av_free(slices[i].buf);
+    av_free(slices);
     return buf_size;
+
+err:
+    av_free(buf2);
+    for (i = 1; i <= n_slices; i++)
+        av_free(slices[i].buf);
+    av_free(slices);
+    return -1;
 }
 
 
@@ -3333,7 +3602,8 @@ static av_cold int vc1_decode_end(AVCodecContext *avctx)
 
     av_freep(&v->hrd_rate);
     av_freep(&v->hrd_buffer);
-    MPV_common_end(&v->s);
+    if (v->s.context_initialized)
+        MPV_common_end(&v->s);
     av_freep(&v->mv_type_mb_plane);
     av_freep(&v->direct_mb_plane);
     av_freep(&v->acpred_plane);
@@ -3341,6 +3611,12 @@ static av_cold int vc1_decode_end(AVCodecContext *avctx)
     av_freep(&v->mb_type_base);
     av_freep(&v->cbp_base);
     ff_intrax8_common_end(&v->x8);
+    if (v->slice_ctx) {
+        int i;
+        for (i = 0; i < avctx->thread_count; i++)
+            av_freep(&v->slice_ctx[i].cbp_base);
+        av_freep(&v->slice_ctx);
+    }
     return 0;
 }
 
@@ -3354,10 +3630,12 @@ AVCodec vc1_decoder = {
     NULL,
     vc1_decode_end,
     vc1_decode_frame,
-    CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
     NULL,
     .long_name = NULL_IF_CONFIG_SMALL("SMPTE VC-1"),
-    .pix_fmts = ff_hwaccel_pixfmt_list_420
+    .pix_fmts = ff_hwaccel_pixfmt_list_420,
+    .init_thread_copy      = vc1_decode_init_thread_copy,
+    .update_thread_context = vc1_update_thread_context,
 };
 
 #if CONFIG_WMV3_DECODER
@@ -3370,10 +3648,12 @@ AVCodec wmv3_decoder = {
     NULL,
     vc1_decode_end,
     vc1_decode_frame,
-    CODEC_CAP_DR1 | CODEC_CAP_DELAY,
+    CODEC_CAP_DR1 | CODEC_CAP_DELAY | CODEC_CAP_FRAME_THREADS,
     NULL,
     .long_name = NULL_IF_CONFIG_SMALL("Windows Media Video 9"),
-    .pix_fmts = ff_hwaccel_pixfmt_list_420
+    .pix_fmts = ff_hwaccel_pixfmt_list_420,
+    .init_thread_copy      = vc1_decode_init_thread_copy,
+    .update_thread_context = vc1_update_thread_context,
 };
 #endif
 
@@ -39,6 +39,7 @@
 #include "get_bits.h"
 
 #include "vp3data.h"
+#include "thread.h"
 #include "xiph.h"
 
 #define FRAGMENT_PIXELS 8
@@ -1312,13 +1313,17 @@ end:
 
 /**
  * called when all pixels up to row y are complete
+ * Rows are counted in decoding order, which is bottom-up in memory unless
+ * the image is flipped. Frame threads use the same rows as progress.
  */
 static void vp3_draw_horiz_band(Vp3DecodeContext *s, int y)
 {
     int h, cy;
     int offset[4];
 
-    if(s->avctx->draw_horiz_band==NULL)
+    ff_thread_report_progress(&s->current_frame, y - 1, 0);
+
+    if(s->avctx->draw_horiz_band==NULL || y <= s->last_slice_end)
         return;
 
     h= y - s->last_slice_end;
@@ -1339,6 +1344,19 @@ static void vp3_draw_horiz_band(Vp3DecodeContext *s, int y)
     s->avctx->draw_horiz_band(s->avctx, &s->current_frame, offset, y, 3, h);
 }
 
+/**
+ * Wait until a reference frame is complete down to a row of a plane.
+ */
+static void await_reference_row(Vp3DecodeContext *s, AVFrame *ref_frame, int plane, int row)
+{
+    int shift        = plane && s->chroma_y_shift;
+    int plane_height = s->height >> shift;
+
+    /* rows outside the plane are replicated from its edges */
+    row = av_clip(row, 0, plane_height - 1);
+    ff_thread_await_progress(ref_frame, ((row + 1) << shift) - 1, 0);
+}
+
 /*
  * Perform the final rendering for a particular slice of data.
  * The slice number ranges from 0..(c_superblock_height - 1).
@@ -1350,7 +1368,9 @@ static void render_slice(Vp3DecodeContext *s, int slice)
     int motion_x = 0xdeadbeef, motion_y = 0xdeadbeef;
     int motion_halfpel_index;
     uint8_t *motion_source;
+    AVFrame *ref_frame;
     int plane, first_pixel;
+    int do_await = s->avctx->active_thread_type&FF_THREAD_FRAME;
 
     if (slice >= s->c_superblock_height)
         return;
@@ -1402,10 +1422,13 @@ static void render_slice(Vp3DecodeContext *s, int slice)
                 /* transform if this block was coded */
                 if (s->all_fragments[i].coding_method != MODE_COPY) {
                     if ((s->all_fragments[i].coding_method == MODE_USING_GOLDEN) ||
-                        (s->all_fragments[i].coding_method == MODE_GOLDEN_MV))
+                        (s->all_fragments[i].coding_method == MODE_GOLDEN_MV)) {
                         motion_source= golden_plane;
-                    else
+                        ref_frame    = &s->golden_frame;
+                    } else {
                         motion_source= last_plane;
+                        ref_frame    = &s->last_frame;
+                    }
 
                     motion_source += first_pixel;
                     motion_halfpel_index = 0;
@@ -1421,6 +1444,9 @@ static void render_slice(Vp3DecodeContext *s, int slice)
                         src_x= (motion_x>>1) + 8*x;
                         src_y= (motion_y>>1) + 8*y;
 
+                        if (do_await)
+                            await_reference_row(s, ref_frame, plane, src_y + 8);
+
                         motion_halfpel_index = motion_x & 0x01;
                         motion_source += (motion_x >> 1);
 
@@ -1435,6 +1461,8 @@ static void render_slice(Vp3DecodeContext *s, int slice)
                             ff_emulated_edge_mc(temp, motion_source, stride, 9, 9, src_x, src_y, plane_width, plane_height);
                             motion_source= temp;
                         }
+                    } else if (do_await && s->all_fragments[i].coding_method != MODE_INTRA) {
+                        await_reference_row(s, ref_frame, plane, 8*y + 7);
                     }
 
 
@@ -1484,6 +1512,8 @@ static void render_slice(Vp3DecodeContext *s, int slice)
                 } else {
 
                     /* copy directly from the previous frame */
+                    if (do_await)
+                        await_reference_row(s, &s->last_frame, plane, 8*y + 7);
                     s->dsp.put_pixels_tab[1][0](
                         output_plane + first_pixel,
                         last_plane + first_pixel,
@@ -1507,7 +1537,41 @@ static void render_slice(Vp3DecodeContext *s, int slice)
       *     dispatch (slice - 1);
       */
 
-    vp3_draw_horiz_band(s, FFMIN((32 << s->chroma_y_shift) * (slice + 1) -16, s->height-16));
+    /* The next slice still filters the top edge of the last fragment row
+     * of each plane, changing the row above it. */
+    vp3_draw_horiz_band(s, (FFMIN(32 * (slice + 1), s->height >> s->chroma_y_shift) - 9) << s->chroma_y_shift);
+}
+
+/*
+ * Allocate the tables a decoding thread writes while decoding a frame.
+ */
+static av_cold int allocate_tables(AVCodecContext *avctx)
+{
+    Vp3DecodeContext *s = avctx->priv_data;
+    int y_fragment_count, c_fragment_count;
+
+    y_fragment_count = s->fragment_width[0] * s->fragment_height[0];
+    c_fragment_count = s->fragment_width[1] * s->fragment_height[1];
+
+    s->superblock_coding = av_malloc(s->superblock_count);
+    s->all_fragments = av_malloc(s->fragment_count * sizeof(Vp3Fragment));
+    s->coded_fragment_list[0] = av_malloc(s->fragment_count * sizeof(int));
+    s->dct_tokens_base = av_malloc(64*s->fragment_count * sizeof(*s->dct_tokens_base));
+    s->motion_val[0] = av_malloc(y_fragment_count * sizeof(*s->motion_val[0]));
+    s->motion_val[1] = av_malloc(c_fragment_count * sizeof(*s->motion_val[1]));
+
+    /* work out the block mapping tables */
+    s->superblock_fragments = av_malloc(s->superblock_count * 16 * sizeof(int));
+    s->macroblock_coding = av_malloc(s->macroblock_count + 1);
+
+    if (!s->superblock_coding || !s->all_fragments || !s->dct_tokens_base ||
+        !s->coded_fragment_list[0] || !s->motion_val[0] || !s->motion_val[1] ||
+        !s->superblock_fragments || !s->macroblock_coding)
+        return -1;
+
+    init_block_mapping(s);
+
+    return 0;
 }
 
 /*
@@ -1559,7 +1623,6 @@ static av_cold int vp3_decode_init(AVCodecContext *avctx)
     s->superblock_count = s->y_superblock_count + (s->c_superblock_count * 2);
     s->u_superblock_start = s->y_superblock_count;
     s->v_superblock_start = s->u_superblock_start + s->c_superblock_count;
-    s->superblock_coding = av_malloc(s->superblock_count);
 
     s->macroblock_width = (s->width + 15) / 16;
     s->macroblock_height = (s->height + 15) / 16;
@@ -1577,14 +1640,7 @@ static av_cold int vp3_decode_init(AVCodecContext *avctx)
     s->fragment_start[1] = y_fragment_count;
     s->fragment_start[2] = y_fragment_count + c_fragment_count;
 
-    s->all_fragments = av_malloc(s->fragment_count * sizeof(Vp3Fragment));
-    s->coded_fragment_list[0] = av_malloc(s->fragment_count * sizeof(int));
-    s->dct_tokens_base = av_malloc(64*s->fragment_count * sizeof(*s->dct_tokens_base));
-    s->motion_val[0] = av_malloc(y_fragment_count * sizeof(*s->motion_val[0]));
-    s->motion_val[1] = av_malloc(c_fragment_count * sizeof(*s->motion_val[1]));
-
-    if (!s->superblock_coding || !s->all_fragments || !s->dct_tokens_base ||
-        !s->coded_fragment_list[0] || !s->motion_val[0] || !s->motion_val[1]) {
+    if (allocate_tables(avctx) < 0) {
         vp3_decode_end(avctx);
         return -1;
     }
@@ -1688,15 +1744,6 @@ static av_cold int vp3_decode_init(AVCodecContext *avctx)
         &motion_vector_vlc_table[0][1], 2, 1,
         &motion_vector_vlc_table[0][0], 2, 1, 0);
 
-    /* work out the block mapping tables */
-    s->superblock_fragments = av_malloc(s->superblock_count * 16 * sizeof(int));
-    s->macroblock_coding = av_malloc(s->macroblock_count + 1);
-    if (!s->superblock_fragments || !s->macroblock_coding) {
-        vp3_decode_end(avctx);
-        return -1;
-    }
-    init_block_mapping(s);
-
     for (i = 0; i < 3; i++) {
         s->current_frame.data[i] = NULL;
         s->last_frame.data[i] = NULL;
@@ -1710,6 +1757,58 @@ vlc_fail:
     return -1;
 }
 
+/*
+ * Make the frame just decoded the reference for the next one.
+ */
+static void update_frames(AVCodecContext *avctx)
+{
+    Vp3DecodeContext *s = avctx->priv_data;
+
+    /* release the last frame, if it is allocated and if it is not the
+     * golden frame */
+    if (s->last_frame.data[0] && s->last_frame.type != FF_BUFFER_TYPE_COPY)
+        ff_thread_release_buffer(avctx, &s->last_frame);
+
+    /* shuffle frames (last = current) */
+    s->last_frame= s->current_frame;
+
+    if (s->keyframe) {
+        if (s->golden_frame.data[0])
+            ff_thread_release_buffer(avctx, &s->golden_frame);
+        s->golden_frame = s->current_frame;
+        s->last_frame.type = FF_BUFFER_TYPE_COPY;
+    }
+
+    s->current_frame.data[0]= NULL; /* ensure that we catch any access to this released frame */
+}
+
+/*
+ * Start a frame thread from the state left by the previous frame.
+ */
+static int vp3_update_thread_context(AVCodecContext *dst, const AVCodecContext *src)
+{
+    Vp3DecodeContext *s = dst->priv_data, *s1 = src->priv_data;
+
+    s->golden_frame  = s1->golden_frame;
+    s->last_frame    = s1->last_frame;
+    s->current_frame = s1->current_frame;
+    s->keyframe      = s1->keyframe;
+    s->version       = s1->version;
+
+    /* the dequantizers and loop filter are only rebuilt when qps change */
+    memcpy(s->qps, s1->qps, sizeof(s->qps));
+    s->nqps = s1->nqps;
+    memcpy(s->qmat, s1->qmat, sizeof(s->qmat));
+    memcpy(s->bounding_values_array, s1->bounding_values_array,
+           sizeof(s->bounding_values_array));
+
+    /* frames that were skipped or not decoded leave the references alone */
+    if (s->current_frame.data[0])
+        update_frames(dst);
+
+    return 0;
+}
+
 /*
  * This is the ffmpeg/libavcodec API frame decode function.
  */
@@ -1767,7 +1866,7 @@ static int vp3_decode_frame(AVCodecContext *avctx,
 
     s->current_frame.reference = 3;
     s->current_frame.pict_type = s->keyframe ? FF_I_TYPE : FF_P_TYPE;
-    if (avctx->get_buffer(avctx, &s->current_frame) < 0) {
+    if (ff_thread_get_buffer(avctx, &s->current_frame) < 0) {
         av_log(s->avctx, AV_LOG_ERROR, "get_buffer() failed\n");
         goto error;
     }
@@ -1796,15 +1895,18 @@ static int vp3_decode_frame(AVCodecContext *avctx,
 
             s->golden_frame.reference = 3;
             s->golden_frame.pict_type = FF_I_TYPE;
-            if (avctx->get_buffer(avctx, &s->golden_frame) < 0) {
+            if (ff_thread_get_buffer(avctx, &s->golden_frame) < 0) {
                 av_log(s->avctx, AV_LOG_ERROR, "get_buffer() failed\n");
                 goto error;
             }
             s->last_frame = s->golden_frame;
             s->last_frame.type = FF_BUFFER_TYPE_COPY;
+            ff_thread_report_progress(&s->last_frame, INT_MAX, 0);
         }
     }
 
+    ff_thread_finish_setup(avctx);
+
     s->current_frame.qscale_table= s->qscale_table; //FIXME allocate individual tables per AVFrame
     s->current_frame.qstride= 0;
 
@@ -1849,32 +1951,25 @@ static int vp3_decode_frame(AVCodecContext *avctx,
         apply_loop_filter(s, i, row, row+1);
     }
     vp3_draw_horiz_band(s, s->avctx->height);
+    ff_thread_report_progress(&s->current_frame, INT_MAX, 0);
 
     *data_size=sizeof(AVFrame);
     *(AVFrame*)data= s->current_frame;
 
-    /* release the last frame, if it is allocated and if it is not the
-     * golden frame */
-    if (s->last_frame.data[0] && s->last_frame.type != FF_BUFFER_TYPE_COPY)
-        avctx->release_buffer(avctx, &s->last_frame);
-
-    /* shuffle frames (last = current) */
-    s->last_frame= s->current_frame;
-
-    if (s->keyframe) {
-        if (s->golden_frame.data[0])
-            avctx->release_buffer(avctx, &s->golden_frame);
-        s->golden_frame = s->current_frame;
-        s->last_frame.type = FF_BUFFER_TYPE_COPY;
-    }
-
-    s->current_frame.data[0]= NULL; /* ensure that we catch any access to this released frame */
+    /* with frame threads, the next thread does this once it has started */
+    if (!(avctx->active_thread_type&FF_THREAD_FRAME))
+        update_frames(avctx);
 
     return buf_size;
 
 error:
-    if (s->current_frame.data[0])
-        avctx->release_buffer(avctx, &s->current_frame);
+    if (s->current_frame.data[0]) {
+        ff_thread_report_progress(&s->current_frame, INT_MAX, 0);
+
+        /* the next frame thread may already reference the frame */
+        if (!(avctx->active_thread_type&FF_THREAD_FRAME))
+            ff_thread_release_buffer(avctx, &s->current_frame);
+    }
     return -1;
 }
 
@@ -1895,6 +1990,10 @@ static av_cold int vp3_decode_end(AVCodecContext *avctx)
     av_free(s->motion_val[0]);
     av_free(s->motion_val[1]);
 
+    /* the VLCs and frames belong to the first thread */
+    if (avctx->is_copy)
+        return 0;
+
     for (i = 0; i < 16; i++) {
         free_vlc(&s->dc_vlc[i]);
         free_vlc(&s->ac_vlc_1[i]);
@@ -1908,17 +2007,41 @@ static av_cold int vp3_decode_end(AVCodecContext *avctx)
     free_vlc(&s->mode_code_vlc);
     free_vlc(&s->motion_vector_vlc);
 
+    /* a frame from the last frame thread may not have been shuffled in */
+    if (s->current_frame.data[0])
+        update_frames(avctx);
+
     /* release all frames */
     if (s->golden_frame.data[0])
-        avctx->release_buffer(avctx, &s->golden_frame);
+        ff_thread_release_buffer(avctx, &s->golden_frame);
     if (s->last_frame.data[0] && s->last_frame.type != FF_BUFFER_TYPE_COPY)
-        avctx->release_buffer(avctx, &s->last_frame);
+        ff_thread_release_buffer(avctx, &s->last_frame);
     /* no need to release the current_frame since it will always be pointing
      * to the same frame as either the golden or last frame */
 
     return 0;
 }
 
+/*
+ * Give a frame thread its own copies of the tables written while decoding.
+ */
+static av_cold int vp3_init_thread_copy(AVCodecContext *avctx)
+{
+    Vp3DecodeContext *s = avctx->priv_data;
+
+    s->avctx                  = avctx;
+    s->superblock_coding      = NULL;
+    s->all_fragments          = NULL;
+    s->coded_fragment_list[0] = NULL;
+    s->dct_tokens_base        = NULL;
+    s->superblock_fragments   = NULL;
+    s->macroblock_coding      = NULL;
+    s->motion_val[0]          = NULL;
+    s->motion_val[1]          = NULL;
+
+    return allocate_tables(avctx);
+}
+
 static int read_huffman_tree(AVCodecContext *avctx, GetBitContext *gb)
 {
     Vp3DecodeContext *s = avctx->priv_data;
@@ -2226,6 +2349,8 @@ AVCodec theora_decoder = {
     CODEC_CAP_DR1 | CODEC_CAP_DRAW_HORIZ_BAND,
     NULL,
     .long_name = NULL_IF_CONFIG_SMALL("Theora"),
+    .init_thread_copy      = vp3_init_thread_copy,
+    .update_thread_context = vp3_update_thread_context,
 };
 #endif
 
@@ -2241,4 +2366,6 @@ AVCodec vp3_decoder = {
     CODEC_CAP_DR1 | CODEC_CAP_DRAW_HORIZ_BAND,
     NULL,
     .long_name = NULL_IF_CONFIG_SMALL("On2 VP3"),
+    .init_thread_copy      = vp3_init_thread_copy,
+    .update_thread_context = vp3_update_thread_context,
 };
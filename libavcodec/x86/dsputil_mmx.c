@@ -2919,6 +2919,9 @@ void dsputil_init_mmx(DSPContext* c, AVCodecContext *avctx)
         }
         if((mm_flags & AV_CPU_FLAG_SSSE3) && !(mm_flags & (AV_CPU_FLAG_SSE42|AV_CPU_FLAG_3DNOW)) && HAVE_YASM) // cachesplit
             c->scalarproduct_and_madd_int16 = ff_scalarproduct_and_madd_int16_ssse3;
+
+        if (CONFIG_RV30_DECODER || CONFIG_RV40_DECODER)
+            ff_rv34dsp_init_mmx(c, avctx);
     }
 
     if (CONFIG_ENCODERS)
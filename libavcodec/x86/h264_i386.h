@@ -33,13 +33,13 @@
 
 //FIXME use some macros to avoid duplicating get_cabac (cannot be done yet
 //as that would make optimization work hard)
-#if ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE && !defined(BROKEN_RELOCATIONS)
+#if CABAC_X86_ASM
 static int decode_significance_x86(CABACContext *c, int max_coeff,
                                    uint8_t *significant_coeff_ctx_base,
                                    int *index){
     void *end= significant_coeff_ctx_base + max_coeff - 1;
-    int minusstart= -(int)significant_coeff_ctx_base;
-    int minusindex= 4-(int)index;
+    int minusstart= -(intptr_t)significant_coeff_ctx_base;
+    int minusindex= 4-(intptr_t)index;
     int coeff_count;
     __asm__ volatile(
         "movl "RANGE    "(%3), %%esi            \n\t"
@@ -47,14 +47,14 @@ static int decode_significance_x86(CABACContext *c, int max_coeff,
 
         "2:                                     \n\t"
 
-        BRANCHLESS_GET_CABAC("%%edx", "%3", "(%1)", "%%ebx",
-                             "%%bx", "%%esi", "%%eax", "%%al")
+        BRANCHLESS_GET_CABAC("%%edx", "%%"REG_d, "%3", "(%1)", "%%ebx",
+                             "%%bx", "%%esi", "%%"REG_S, "%%eax", "%%al", "%7")
 
         "test $1, %%edx                         \n\t"
         " jz 3f                                 \n\t"
 
-        BRANCHLESS_GET_CABAC("%%edx", "%3", "61(%1)", "%%ebx",
-                             "%%bx", "%%esi", "%%eax", "%%al")
+        BRANCHLESS_GET_CABAC("%%edx", "%%"REG_d, "%3", "61(%1)", "%%ebx",
+                             "%%bx", "%%esi", "%%"REG_S, "%%eax", "%%al", "%7")
 
         "mov  %2, %%"REG_a"                     \n\t"
         "movl %4, %%ecx                         \n\t"
@@ -82,7 +82,7 @@ static int decode_significance_x86(CABACContext *c, int max_coeff,
         "movl %%esi, "RANGE    "(%3)            \n\t"
         "movl %%ebx, "LOW      "(%3)            \n\t"
         :"=&a"(coeff_count), "+r"(significant_coeff_ctx_base), "+m"(index)
-        :"r"(c), "m"(minusstart), "m"(end), "m"(minusindex)
+        :"r"(c), "m"(minusstart), "m"(end), "m"(minusindex) TABLES_ARG
         : "%"REG_c, "%ebx", "%edx", "%esi", "memory"
     );
     return coeff_count;
@@ -91,7 +91,7 @@ static int decode_significance_x86(CABACContext *c, int max_coeff,
 static int decode_significance_8x8_x86(CABACContext *c,
                                        uint8_t *significant_coeff_ctx_base,
                                        int *index, const uint8_t *sig_off){
-    int minusindex= 4-(int)index;
+    int minusindex= 4-(intptr_t)index;
     int coeff_count;
     x86_reg last=0;
     __asm__ volatile(
@@ -105,18 +105,18 @@ static int decode_significance_8x8_x86(CABACContext *c,
         "movzbl (%%"REG_a", %%"REG_D"), %%edi   \n\t"
         "add %5, %%"REG_D"                      \n\t"
 
-        BRANCHLESS_GET_CABAC("%%edx", "%3", "(%%"REG_D")", "%%ebx",
-                             "%%bx", "%%esi", "%%eax", "%%al")
+        BRANCHLESS_GET_CABAC("%%edx", "%%"REG_d, "%3", "(%%"REG_D")", "%%ebx",
+                             "%%bx", "%%esi", "%%"REG_S, "%%eax", "%%al", "%7")
 
         "mov %1, %%edi                          \n\t"
         "test $1, %%edx                         \n\t"
         " jz 3f                                 \n\t"
 
-        "movzbl "MANGLE(last_coeff_flag_offset_8x8)"(%%edi), %%edi\n\t"
+        "movzbl "CABAC_TABLE("%7", H264_LAST_COEFF_FLAG_OFFSET_8x8_OFFSET, "%%"REG_D)", %%edi\n\t"
         "add %5, %%"REG_D"                      \n\t"
 
-        BRANCHLESS_GET_CABAC("%%edx", "%3", "15(%%"REG_D")", "%%ebx",
-                             "%%bx", "%%esi", "%%eax", "%%al")
+        BRANCHLESS_GET_CABAC("%%edx", "%%"REG_d, "%3", "15(%%"REG_D")", "%%ebx",
+                             "%%bx", "%%esi", "%%"REG_S, "%%eax", "%%al", "%7")
 
         "mov %2, %%"REG_a"                      \n\t"
         "mov %1, %%edi                          \n\t"
@@ -142,12 +142,11 @@ static int decode_significance_8x8_x86(CABACContext *c,
         "movl %%esi, "RANGE    "(%3)            \n\t"
         "movl %%ebx, "LOW      "(%3)            \n\t"
         :"=&a"(coeff_count),"+m"(last), "+m"(index)
-        :"r"(c), "m"(minusindex), "m"(significant_coeff_ctx_base), "m"(sig_off)
+        :"r"(c), "m"(minusindex), "m"(significant_coeff_ctx_base), "m"(sig_off) TABLES_ARG
         : "%"REG_c, "%ebx", "%edx", "%esi", "%"REG_D, "memory"
     );
     return coeff_count;
 }
-#endif /* ARCH_X86 && HAVE_7REGS && HAVE_EBX_AVAILABLE */
-       /* !defined(BROKEN_RELOCATIONS) */
+#endif /* CABAC_X86_ASM */
 
 #endif /* AVCODEC_X86_H264_I386_H */
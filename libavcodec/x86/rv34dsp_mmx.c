@@ -0,0 +1,682 @@
+/*
+ * RV30/40 decoder DSP functions, SSE2 and SSSE3 optimized
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/dsputil.h"
+#include "dsputil_mmx.h"
+
+/* motion compensation */
+
+#define W(x) { x, x, x, x, x, x, x, x }
+
+/* The subpel filters, as the weights of their outer and inner tap pairs and
+ * of the two center taps, followed by the rounder and the shift. Index 0 is
+ * the full pel position, which is not filtered. */
+DECLARE_ALIGNED(16, static const int16_t, rv30_filters)[3][6][8] = {
+    { { 0 } },
+    { W(0), W(-1), W(12), W( 6), W( 8), { 4 } },
+    { W(0), W(-1), W( 6), W(12), W( 8), { 4 } },
+};
+
+DECLARE_ALIGNED(16, static const int16_t, rv40_filters)[4][6][8] = {
+    { { 0 } },
+    { W(1), W(-5), W(52), W(20), W(32), { 6 } },
+    { W(1), W(-5), W(20), W(20), W(16), { 5 } },
+    { W(1), W(-5), W(20), W(52), W(32), { 6 } },
+};
+
+#define rv30_filter(pos) ((pos) ? rv30_filters[pos][0] : NULL)
+#define rv40_filter(pos) ((pos) ? rv40_filters[pos][0] : NULL)
+
+/* Filter a column of 8 pixels wide blocks. The taps are step bytes apart,
+ * 1 for the horizontal and the line size for the vertical filters. The sums
+ * fit in 16 bits, so the output is the same as with the C functions. */
+#define RV34_LOWPASS8(OPNAME, OP)                                             \
+static void OPNAME ## rv34_lowpass8_sse2(uint8_t *dst, const uint8_t *src,   \
+                                         x86_reg dstStride,                  \
+                                         x86_reg srcStride, x86_reg step,    \
+                                         int h, const int16_t *filter)       \
+{                                                                             \
+    const uint8_t *src2 = src + step;                                         \
+                                                                              \
+    src -= 2 * step;                                                          \
+    __asm__ volatile(                                                         \
+        "pxor          %%xmm7, %%xmm7   \n\t"                                 \
+        "1:                             \n\t"                                 \
+        "movq            (%1), %%xmm0   \n\t"                                 \
+        "movq       (%2,%6,2), %%xmm1   \n\t"                                 \
+        "movq         (%1,%6), %%xmm2   \n\t"                                 \
+        "movq         (%2,%6), %%xmm3   \n\t"                                 \
+        "punpcklbw     %%xmm7, %%xmm0   \n\t"                                 \
+        "punpcklbw     %%xmm7, %%xmm1   \n\t"                                 \
+        "punpcklbw     %%xmm7, %%xmm2   \n\t"                                 \
+        "punpcklbw     %%xmm7, %%xmm3   \n\t"                                 \
+        "paddw         %%xmm1, %%xmm0   \n\t"                                 \
+        "paddw         %%xmm3, %%xmm2   \n\t"                                 \
+        "pmullw      0x00(%7), %%xmm0   \n\t"                                 \
+        "pmullw      0x10(%7), %%xmm2   \n\t"                                 \
+        "movq       (%1,%6,2), %%xmm1   \n\t"                                 \
+        "movq            (%2), %%xmm3   \n\t"                                 \
+        "punpcklbw     %%xmm7, %%xmm1   \n\t"                                 \
+        "punpcklbw     %%xmm7, %%xmm3   \n\t"                                 \
+        "pmullw      0x20(%7), %%xmm1   \n\t"                                 \
+        "pmullw      0x30(%7), %%xmm3   \n\t"                                 \
+        "paddw         %%xmm2, %%xmm0   \n\t"                                 \
+        "paddw         %%xmm3, %%xmm1   \n\t"                                 \
+        "paddw       0x40(%7), %%xmm0   \n\t"                                 \
+        "paddw         %%xmm1, %%xmm0   \n\t"                                 \
+        "psraw       0x50(%7), %%xmm0   \n\t"                                 \
+        "packuswb      %%xmm0, %%xmm0   \n\t"                                 \
+        OP                                                                    \
+        "movq          %%xmm0, (%0)     \n\t"                                 \
+        "add               %4, %0       \n\t"                                 \
+        "add               %5, %1       \n\t"                                 \
+        "add               %5, %2       \n\t"                                 \
+        "decl              %3           \n\t"                                 \
+        "jnz 1b                         \n\t"                                 \
+        : "+r"(dst), "+r"(src), "+r"(src2), "+g"(h)                           \
+        : "g"(dstStride), "g"(srcStride), "r"(step), "r"(filter)              \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm7",)          \
+          "memory"                                                            \
+    );                                                                        \
+}
+
+#define OP_PUT
+#define OP_AVG                                                                \
+        "movq            (%0), %%xmm1   \n\t"                                 \
+        "pavgb         %%xmm1, %%xmm0   \n\t"
+
+RV34_LOWPASS8(put_, OP_PUT)
+RV34_LOWPASS8(avg_, OP_AVG)
+
+/* Interpolate a size x size block with the horizontal filter hf and the
+ * vertical filter vf. As in C, the 2D case filters horizontally first into
+ * an 8-bit temporary with 2 lines above and 3 below the block. */
+static av_always_inline void rv34_lowpass(uint8_t *dst, const uint8_t *src,
+                                          int dstStride, int srcStride,
+                                          int step, int w, int h,
+                                          const int16_t *filter, int avg)
+{
+    int i;
+
+    for (i = 0; i < w; i += 8) {
+        if (avg)
+            avg_rv34_lowpass8_sse2(dst + i, src + i, dstStride, srcStride,
+                                   step, h, filter);
+        else
+            put_rv34_lowpass8_sse2(dst + i, src + i, dstStride, srcStride,
+                                   step, h, filter);
+    }
+}
+
+static av_always_inline void rv34_mc(uint8_t *dst, const uint8_t *src,
+                                     int stride, int size,
+                                     const int16_t *hf, const int16_t *vf,
+                                     int avg)
+{
+    DECLARE_ALIGNED(16, uint8_t, tmp)[16 * (16 + 5)];
+
+    if (!vf) {
+        rv34_lowpass(dst, src, stride, stride, 1, size, size, hf, avg);
+    } else if (!hf) {
+        rv34_lowpass(dst, src, stride, stride, stride, size, size, vf, avg);
+    } else {
+        rv34_lowpass(tmp, src - 2 * stride, size, stride, 1,
+                     size, size + 5, hf, 0);
+        rv34_lowpass(dst, tmp + 2 * size, stride, size, size,
+                     size, size, vf, avg);
+    }
+}
+
+#define MC_FUNC(OPNAME, AVG, CODEC, TYPE, SIZE, X, Y)                         \
+static void OPNAME ## CODEC ## _ ## TYPE ## SIZE ## _mc ## X ## Y ## _sse2(   \
+    uint8_t *dst, uint8_t *src, int stride)                                   \
+{                                                                             \
+    rv34_mc(dst, src, stride, SIZE, CODEC ## _filter(X),                      \
+            CODEC ## _filter(Y), AVG);                                        \
+}
+
+#define RV30_MC_FUNCS(OPNAME, AVG, SIZE)                                      \
+    MC_FUNC(OPNAME, AVG, rv30, tpel, SIZE, 1, 0)                              \
+    MC_FUNC(OPNAME, AVG, rv30, tpel, SIZE, 2, 0)                              \
+    MC_FUNC(OPNAME, AVG, rv30, tpel, SIZE, 0, 1)                              \
+    MC_FUNC(OPNAME, AVG, rv30, tpel, SIZE, 0, 2)
+
+#define RV40_MC_FUNCS(OPNAME, AVG, SIZE)                                      \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 1, 0)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 2, 0)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 3, 0)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 0, 1)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 1, 1)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 2, 1)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 3, 1)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 0, 2)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 1, 2)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 2, 2)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 3, 2)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 0, 3)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 1, 3)                              \
+    MC_FUNC(OPNAME, AVG, rv40, qpel, SIZE, 2, 3)
+
+RV30_MC_FUNCS(put_, 0, 8)
+RV30_MC_FUNCS(put_, 0, 16)
+RV30_MC_FUNCS(avg_, 1, 8)
+RV30_MC_FUNCS(avg_, 1, 16)
+RV40_MC_FUNCS(put_, 0, 8)
+RV40_MC_FUNCS(put_, 0, 16)
+RV40_MC_FUNCS(avg_, 1, 8)
+RV40_MC_FUNCS(avg_, 1, 16)
+
+#if HAVE_SSSE3
+
+static const int rv40_bias[4][4] = {
+    {  0, 16, 32, 16 },
+    { 32, 28, 32, 28 },
+    {  0, 32, 16, 32 },
+    { 32, 28, 32, 28 }
+};
+
+/* Bilinear chroma interpolation with pmaddubsw on interleaved neighbouring
+ * pixels. For y = 0 the second line is the first one again, with weight 0,
+ * so that no line below the block is read. */
+#define RV40_CHROMA_MC(OPNAME, OP, W, MOV)                                    \
+static void OPNAME ## rv40_chroma_mc ## W ## _ssse3(uint8_t *dst,            \
+                                                   uint8_t *src,             \
+                                                   int stride, int h,        \
+                                                   int x, int y)             \
+{                                                                             \
+    int ab   = (8 - x) * (8 - y) | x * (8 - y) << 8;                          \
+    int cd   = (8 - x) * y       | x * y       << 8;                          \
+    int bias = rv40_bias[y >> 1][x >> 1];                                     \
+    x86_reg step = y ? stride : 0;                                            \
+                                                                              \
+    __asm__ volatile(                                                         \
+        "movd              %5, %%xmm5   \n\t"                                 \
+        "movd              %6, %%xmm6   \n\t"                                 \
+        "movd              %7, %%xmm7   \n\t"                                 \
+        "pshuflw   $0, %%xmm5, %%xmm5   \n\t"                                 \
+        "pshuflw   $0, %%xmm6, %%xmm6   \n\t"                                 \
+        "pshuflw   $0, %%xmm7, %%xmm7   \n\t"                                 \
+        "punpcklqdq    %%xmm5, %%xmm5   \n\t"                                 \
+        "punpcklqdq    %%xmm6, %%xmm6   \n\t"                                 \
+        "punpcklqdq    %%xmm7, %%xmm7   \n\t"                                 \
+        "1:                             \n\t"                                 \
+        MOV"             (%1), %%xmm0   \n\t"                                 \
+        MOV"            1(%1), %%xmm1   \n\t"                                 \
+        MOV"          (%1,%4), %%xmm2   \n\t"                                 \
+        MOV"         1(%1,%4), %%xmm3   \n\t"                                 \
+        "punpcklbw     %%xmm1, %%xmm0   \n\t"                                 \
+        "punpcklbw     %%xmm3, %%xmm2   \n\t"                                 \
+        "pmaddubsw     %%xmm6, %%xmm0   \n\t"                                 \
+        "pmaddubsw     %%xmm7, %%xmm2   \n\t"                                 \
+        "paddw         %%xmm5, %%xmm0   \n\t"                                 \
+        "paddw         %%xmm2, %%xmm0   \n\t"                                 \
+        "psrlw             $6, %%xmm0   \n\t"                                 \
+        "packuswb      %%xmm0, %%xmm0   \n\t"                                 \
+        OP(MOV)                                                               \
+        MOV"           %%xmm0, (%0)     \n\t"                                 \
+        "add               %3, %0       \n\t"                                 \
+        "add               %3, %1       \n\t"                                 \
+        "decl              %2           \n\t"                                 \
+        "jnz 1b                         \n\t"                                 \
+        : "+r"(dst), "+r"(src), "+g"(h)                                       \
+        : "r"((x86_reg)stride), "r"(step), "rm"(bias), "rm"(ab), "rm"(cd)     \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",                    \
+                       "%xmm5", "%xmm6", "%xmm7",)                            \
+          "memory"                                                            \
+    );                                                                        \
+}
+
+#define OP_CHROMA_PUT(MOV)
+#define OP_CHROMA_AVG(MOV)                                                    \
+        MOV"             (%0), %%xmm1   \n\t"                                 \
+        "pavgb         %%xmm1, %%xmm0   \n\t"
+
+RV40_CHROMA_MC(put_, OP_CHROMA_PUT, 8, "movq")
+RV40_CHROMA_MC(put_, OP_CHROMA_PUT, 4, "movd")
+RV40_CHROMA_MC(avg_, OP_CHROMA_AVG, 8, "movq")
+RV40_CHROMA_MC(avg_, OP_CHROMA_AVG, 4, "movd")
+
+/* loop filter */
+
+/* The 4 lines across an edge are filtered together, as 4 vectors of words
+ * [p0 q0], [p1 q1], [p2 q2] and [p3 q3], where pN and qN hold the 4 pixels
+ * N + 1 and N pixels before and after the edge. Since the filters are
+ * symmetric, the p and q sides are computed with the same instructions,
+ * the other side coming from swapping the halves. */
+
+DECLARE_ALIGNED(16, static const int16_t, pw_25)[8]  = W(25);
+DECLARE_ALIGNED(16, static const int16_t, pw_26)[8]  = W(26);
+DECLARE_ALIGNED(16, static const int16_t, pw_51)[8]  = W(51);
+DECLARE_ALIGNED(16, static const int16_t, pw_127)[8] = W(127);
+DECLARE_ALIGNED(16, static const int16_t, pw_255)[8] = W(255);
+
+/* gather [p0..p3 q0..q3] bytes of 4 lines of a vertical edge into
+ * [pN lines 0-1 | qN lines 0-1] words for N = 0..3, and back */
+DECLARE_ALIGNED(16, static const int8_t, v_gather)[16] = {
+    3, 11, 4, 12, 2, 10, 5, 13, 1, 9, 6, 14, 0, 8, 7, 15
+};
+DECLARE_ALIGNED(16, static const int8_t, v_scatter)[16] = {
+    12, 8, 4, 0, 2, 6, 10, 14, 13, 9, 5, 1, 3, 7, 11, 15
+};
+DECLARE_ALIGNED(16, static const int8_t, even_odd_words)[16] = {
+    0, 1, 4, 5, 8, 9, 12, 13, 2, 3, 6, 7, 10, 11, 14, 15
+};
+
+static av_always_inline void rv40_load_h(int16_t pix[][8], const uint8_t *src,
+                                         x86_reg stride)
+{
+    __asm__ volatile(
+        "pxor          %%xmm7, %%xmm7   \n\t"
+        "movd         (%1,%4), %%xmm0   \n\t"
+        "movd            (%2), %%xmm4   \n\t"
+        "movd       (%1,%3,2), %%xmm1   \n\t"
+        "movd         (%2,%3), %%xmm5   \n\t"
+        "movd         (%1,%3), %%xmm2   \n\t"
+        "movd       (%2,%3,2), %%xmm6   \n\t"
+        "punpckldq     %%xmm4, %%xmm0   \n\t"
+        "punpckldq     %%xmm5, %%xmm1   \n\t"
+        "punpckldq     %%xmm6, %%xmm2   \n\t"
+        "movd            (%1), %%xmm3   \n\t"
+        "movd         (%2,%4), %%xmm4   \n\t"
+        "punpckldq     %%xmm4, %%xmm3   \n\t"
+        "punpcklbw     %%xmm7, %%xmm0   \n\t"
+        "punpcklbw     %%xmm7, %%xmm1   \n\t"
+        "punpcklbw     %%xmm7, %%xmm2   \n\t"
+        "punpcklbw     %%xmm7, %%xmm3   \n\t"
+        "movdqa        %%xmm0, 0x00(%0) \n\t"
+        "movdqa        %%xmm1, 0x10(%0) \n\t"
+        "movdqa        %%xmm2, 0x20(%0) \n\t"
+        "movdqa        %%xmm3, 0x30(%0) \n\t"
+        :: "r"(pix), "r"(src - 4 * stride), "r"(src), "r"(stride),
+           "r"(3 * stride)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+
+/* p3 and q3 are never changed */
+static av_always_inline void rv40_store_h(uint8_t *src, x86_reg stride,
+                                          int16_t pix[][8])
+{
+    __asm__ volatile(
+        "movdqa      0x00(%0), %%xmm0   \n\t"
+        "movdqa      0x10(%0), %%xmm1   \n\t"
+        "movdqa      0x20(%0), %%xmm2   \n\t"
+        "packuswb      %%xmm0, %%xmm0   \n\t"
+        "packuswb      %%xmm1, %%xmm1   \n\t"
+        "packuswb      %%xmm2, %%xmm2   \n\t"
+        "movd          %%xmm0, (%1,%4)  \n\t"
+        "movd          %%xmm1, (%1,%3,2)\n\t"
+        "movd          %%xmm2, (%1,%3)  \n\t"
+        "psrlq            $32, %%xmm0   \n\t"
+        "psrlq            $32, %%xmm1   \n\t"
+        "psrlq            $32, %%xmm2   \n\t"
+        "movd          %%xmm0, (%2)     \n\t"
+        "movd          %%xmm1, (%2,%3)  \n\t"
+        "movd          %%xmm2, (%2,%3,2)\n\t"
+        :: "r"(pix), "r"(src - 4 * stride), "r"(src), "r"(stride),
+           "r"(3 * stride)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",)
+          "memory"
+    );
+}
+
+static av_always_inline void rv40_load_v(int16_t pix[][8], const uint8_t *src,
+                                         x86_reg stride)
+{
+    __asm__ volatile(
+        "movq            (%1), %%xmm0   \n\t"
+        "movhps       (%1,%2), %%xmm0   \n\t"
+        "movq       (%1,%2,2), %%xmm1   \n\t"
+        "movhps       (%1,%3), %%xmm1   \n\t"
+        "pshufb            %4, %%xmm0   \n\t"
+        "pshufb            %4, %%xmm1   \n\t"
+        "movdqa        %%xmm0, %%xmm2   \n\t"
+        "punpcklwd     %%xmm1, %%xmm0   \n\t"
+        "punpckhwd     %%xmm1, %%xmm2   \n\t"
+        "pxor          %%xmm7, %%xmm7   \n\t"
+        "movdqa        %%xmm0, %%xmm1   \n\t"
+        "movdqa        %%xmm2, %%xmm3   \n\t"
+        "punpcklbw     %%xmm7, %%xmm0   \n\t"
+        "punpckhbw     %%xmm7, %%xmm1   \n\t"
+        "punpcklbw     %%xmm7, %%xmm2   \n\t"
+        "punpckhbw     %%xmm7, %%xmm3   \n\t"
+        "movdqa        %%xmm0, 0x00(%0) \n\t"
+        "movdqa        %%xmm1, 0x10(%0) \n\t"
+        "movdqa        %%xmm2, 0x20(%0) \n\t"
+        "movdqa        %%xmm3, 0x30(%0) \n\t"
+        :: "r"(pix), "r"(src - 4), "r"(stride), "r"(3 * stride),
+           "m"(*v_gather)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm7",)
+          "memory"
+    );
+}
+
+static av_always_inline void rv40_store_v(uint8_t *src, x86_reg stride,
+                                          int16_t pix[][8])
+{
+    __asm__ volatile(
+        "movdqa      0x00(%0), %%xmm0   \n\t"
+        "movdqa      0x20(%0), %%xmm1   \n\t"
+        "packuswb    0x10(%0), %%xmm0   \n\t"
+        "packuswb    0x30(%0), %%xmm1   \n\t"
+        "pshufb            %5, %%xmm0   \n\t"
+        "pshufb            %5, %%xmm1   \n\t"
+        "movdqa        %%xmm0, %%xmm2   \n\t"
+        "punpcklqdq    %%xmm1, %%xmm0   \n\t"
+        "punpckhqdq    %%xmm1, %%xmm2   \n\t"
+        "pshufb            %4, %%xmm0   \n\t"
+        "pshufb            %4, %%xmm2   \n\t"
+        "movq          %%xmm0, (%1)     \n\t"
+        "movhps        %%xmm0, (%1,%2)  \n\t"
+        "movq          %%xmm2, (%1,%2,2)\n\t"
+        "movhps        %%xmm2, (%1,%3)  \n\t"
+        :: "r"(pix), "r"(src - 4), "r"(stride), "r"(3 * stride),
+           "m"(*v_scatter), "m"(*even_odd_words)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",)
+          "memory"
+    );
+}
+
+/* broadcast a word to all of reg, or a to its low and b to its high half */
+#define SPLATW(a, reg)                                                        \
+        "movd              "a", "reg"   \n\t"                                 \
+        "pshuflw       $0, "reg", "reg" \n\t"                                 \
+        "punpcklqdq    "reg", "reg"     \n\t"
+#define SPLATW2(a, b, reg, tmp)                                               \
+        "movd              "a", "reg"   \n\t"                                 \
+        "movd              "b", "tmp"   \n\t"                                 \
+        "pshuflw       $0, "reg", "reg" \n\t"                                 \
+        "pshuflw       $0, "tmp", "tmp" \n\t"                                 \
+        "punpcklqdq    "tmp", "reg"     \n\t"
+
+/* clip v to [-lim, lim] */
+#define CLIP_SYMM(v, lim, dst)                                                \
+        "pabsw         "v", "dst"       \n\t"                                 \
+        "pminsw      "lim", "dst"       \n\t"                                 \
+        "psignw        "v", "dst"       \n\t"
+
+static av_always_inline void rv40_weak_filter(int16_t pix[][8],
+                                              int filter_p1, int filter_q1,
+                                              int alpha, int beta, int lims,
+                                              int lim_q1, int lim_p1)
+{
+    int both = filter_p1 && filter_q1;
+    int thr  = (4 - both) << 7;
+
+    __asm__ volatile(
+        "movdqa  0x00(%[pix]), %%xmm0   \n\t" // X0
+        "movdqa  0x10(%[pix]), %%xmm1   \n\t" // X1
+        "movdqa  0x20(%[pix]), %%xmm2   \n\t" // X2
+        "pshufd $0x4e, %%xmm0, %%xmm3   \n\t"
+        "psubw         %%xmm0, %%xmm3   \n\t" // [q0-p0 p0-q0]
+        "pabsw         %%xmm3, %%xmm4   \n\t"
+        "pxor          %%xmm5, %%xmm5   \n\t"
+        "pcmpeqw       %%xmm4, %%xmm5   \n\t"
+        SPLATW("%[alpha]", "%%xmm6")
+        "pmullw        %%xmm6, %%xmm4   \n\t"
+        SPLATW("%[thr]", "%%xmm6")
+        "pcmpgtw       %%xmm4, %%xmm6   \n\t"
+        "pandn         %%xmm6, %%xmm5   \n\t" // lines to filter
+        "psllw             $2, %%xmm3   \n\t"
+        "pshufd $0x4e, %%xmm1, %%xmm4   \n\t"
+        "movdqa        %%xmm1, %%xmm6   \n\t"
+        "psubw         %%xmm4, %%xmm6   \n\t" // [p1-q1 q1-p1]
+        SPLATW("%[both]", "%%xmm4")
+        "pand          %%xmm4, %%xmm6   \n\t"
+        "paddw         %%xmm6, %%xmm3   \n\t"
+        "paddw      %[pw_4], %%xmm3     \n\t"
+        "psraw             $3, %%xmm3   \n\t"
+        SPLATW("%[lims]", "%%xmm4")
+        CLIP_SYMM("%%xmm3", "%%xmm4", "%%xmm6")
+        "pxor          %%xmm3, %%xmm3   \n\t"
+        "psubw         %%xmm6, %%xmm3   \n\t"
+        "punpcklqdq    %%xmm3, %%xmm6   \n\t" // [diff -diff]
+        "movdqa        %%xmm6, %%xmm4   \n\t"
+        "pand          %%xmm5, %%xmm4   \n\t"
+        "paddw         %%xmm0, %%xmm4   \n\t"
+        "movdqa        %%xmm4, 0x00(%[pix]) \n\t"
+        "movdqa        %%xmm1, %%xmm3   \n\t"
+        "psubw         %%xmm0, %%xmm3   \n\t"
+        "movdqa        %%xmm1, %%xmm4   \n\t"
+        "psubw         %%xmm2, %%xmm4   \n\t"
+        "paddw         %%xmm4, %%xmm3   \n\t"
+        "psubw         %%xmm6, %%xmm3   \n\t"
+        "psraw             $1, %%xmm3   \n\t"
+        "pabsw         %%xmm4, %%xmm4   \n\t"
+        SPLATW("%[beta]", "%%xmm2")
+        "pcmpgtw       %%xmm2, %%xmm4   \n\t"
+        "pandn         %%xmm5, %%xmm4   \n\t"
+        SPLATW2("%[fp1]", "%[fq1]", "%%xmm2", "%%xmm0")
+        "pand          %%xmm2, %%xmm4   \n\t" // lines to filter p1/q1 of
+        SPLATW2("%[lim_p1]", "%[lim_q1]", "%%xmm2", "%%xmm0")
+        CLIP_SYMM("%%xmm3", "%%xmm2", "%%xmm0")
+        "pand          %%xmm4, %%xmm0   \n\t"
+        "psubw         %%xmm0, %%xmm1   \n\t"
+        "movdqa        %%xmm1, 0x10(%[pix]) \n\t"
+        :: [pix]"r"(pix), [alpha]"rm"(alpha), [thr]"rm"(thr),
+           [both]"rm"(-both), [lims]"rm"(lims), [beta]"rm"(beta),
+           [fp1]"rm"(-filter_p1), [fq1]"rm"(-filter_q1),
+           [lim_p1]"rm"(lim_p1), [lim_q1]"rm"(lim_q1), [pw_4]"m"(ff_pw_4)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6",)
+          "memory"
+    );
+}
+
+/* uses pix[4] as scratch space for the dither values */
+static av_always_inline void rv40_strong_filter(int16_t pix[][8],
+                                                int alpha, int lims,
+                                                int dmode, int chroma)
+{
+    __asm__ volatile(
+        "movd    %[dither_l], %%xmm4    \n\t"
+        "movd    %[dither_r], %%xmm7    \n\t"
+        "punpckldq     %%xmm7, %%xmm4   \n\t"
+        "pxor          %%xmm7, %%xmm7   \n\t"
+        "punpcklbw     %%xmm7, %%xmm4   \n\t"
+        "movdqa        %%xmm4, 0x40(%[pix]) \n\t"
+        "movdqa  0x00(%[pix]), %%xmm0   \n\t" // X0
+        "movdqa  0x10(%[pix]), %%xmm1   \n\t" // X1
+        "movdqa  0x20(%[pix]), %%xmm2   \n\t" // X2
+        "pshufd $0x4e, %%xmm0, %%xmm3   \n\t" // [q0 p0]
+        "movdqa        %%xmm3, %%xmm4   \n\t"
+        "psubw         %%xmm0, %%xmm4   \n\t"
+        "pabsw         %%xmm4, %%xmm4   \n\t"
+        "pxor          %%xmm5, %%xmm5   \n\t"
+        "pcmpeqw       %%xmm4, %%xmm5   \n\t"
+        SPLATW("%[alpha]", "%%xmm6")
+        "pmullw        %%xmm6, %%xmm4   \n\t"
+        "movdqa        %%xmm4, %%xmm6   \n\t"
+        "pcmpgtw   %[pw_255], %%xmm6    \n\t"
+        "por           %%xmm6, %%xmm5   \n\t" // lines to skip
+        "pcmpgtw   %[pw_127], %%xmm4    \n\t" // lines to clip
+        SPLATW("%[lims]", "%%xmm6")
+        "pand          %%xmm4, %%xmm6   \n\t"
+        "pandn     %[pw_255], %%xmm4    \n\t"
+        "por           %%xmm4, %%xmm6   \n\t" // clipping limits
+        "pshufd $0x4e, %%xmm1, %%xmm4   \n\t"
+        "paddw         %%xmm2, %%xmm4   \n\t"
+        "pmullw     %[pw_25], %%xmm4    \n\t"
+        "movdqa        %%xmm0, %%xmm7   \n\t"
+        "paddw         %%xmm1, %%xmm7   \n\t"
+        "paddw         %%xmm3, %%xmm7   \n\t"
+        "pmullw     %[pw_26], %%xmm7    \n\t"
+        "paddw         %%xmm7, %%xmm4   \n\t"
+        "paddw   0x40(%[pix]), %%xmm4   \n\t"
+        "psrlw             $7, %%xmm4   \n\t"
+        "movdqa        %%xmm0, %%xmm7   \n\t"
+        "paddw         %%xmm6, %%xmm7   \n\t"
+        "pminsw        %%xmm7, %%xmm4   \n\t"
+        "movdqa        %%xmm0, %%xmm7   \n\t"
+        "psubw         %%xmm6, %%xmm7   \n\t"
+        "pmaxsw        %%xmm7, %%xmm4   \n\t" // new X0
+        "paddw   0x30(%[pix]), %%xmm3   \n\t"
+        "pmullw     %[pw_25], %%xmm3    \n\t"
+        "movdqa        %%xmm2, %%xmm7   \n\t"
+        "paddw         %%xmm1, %%xmm7   \n\t"
+        "paddw         %%xmm4, %%xmm7   \n\t"
+        "pmullw     %[pw_26], %%xmm7    \n\t"
+        "paddw         %%xmm7, %%xmm3   \n\t"
+        "paddw   0x40(%[pix]), %%xmm3   \n\t"
+        "psrlw             $7, %%xmm3   \n\t"
+        "movdqa        %%xmm1, %%xmm7   \n\t"
+        "paddw         %%xmm6, %%xmm7   \n\t"
+        "pminsw        %%xmm7, %%xmm3   \n\t"
+        "movdqa        %%xmm1, %%xmm7   \n\t"
+        "psubw         %%xmm6, %%xmm7   \n\t"
+        "pmaxsw        %%xmm7, %%xmm3   \n\t" // new X1
+        "pand          %%xmm5, %%xmm0   \n\t"
+        "movdqa        %%xmm5, %%xmm7   \n\t"
+        "pandn         %%xmm4, %%xmm7   \n\t"
+        "por           %%xmm7, %%xmm0   \n\t"
+        "movdqa        %%xmm0, 0x00(%[pix]) \n\t"
+        "pand          %%xmm5, %%xmm1   \n\t"
+        "movdqa        %%xmm5, %%xmm7   \n\t"
+        "pandn         %%xmm3, %%xmm7   \n\t"
+        "por           %%xmm7, %%xmm1   \n\t"
+        "movdqa        %%xmm1, 0x10(%[pix]) \n\t"
+        "test     %[chroma], %[chroma]  \n\t"
+        "jnz 1f                         \n\t"
+        "paddw   0x30(%[pix]), %%xmm3   \n\t"
+        "pmullw     %[pw_26], %%xmm3    \n\t"
+        "pmullw     %[pw_25], %%xmm4    \n\t"
+        "paddw         %%xmm4, %%xmm3   \n\t"
+        "movdqa        %%xmm2, %%xmm7   \n\t"
+        "pmullw     %[pw_51], %%xmm7    \n\t"
+        "paddw         %%xmm7, %%xmm3   \n\t"
+        "paddw      %[pw_64], %%xmm3    \n\t"
+        "psrlw             $7, %%xmm3   \n\t"
+        "pand          %%xmm5, %%xmm2   \n\t"
+        "pandn         %%xmm3, %%xmm5   \n\t"
+        "por           %%xmm5, %%xmm2   \n\t"
+        "movdqa        %%xmm2, 0x20(%[pix]) \n\t"
+        "1:                             \n\t"
+        :: [pix]"r"(pix), [alpha]"rm"(alpha), [lims]"rm"(lims),
+           [chroma]"r"(chroma),
+           [dither_l]"m"(*(const uint32_t *)(ff_rv40_dither_l + dmode)),
+           [dither_r]"m"(*(const uint32_t *)(ff_rv40_dither_r + dmode)),
+           [pw_25]"m"(*pw_25), [pw_26]"m"(*pw_26), [pw_51]"m"(*pw_51),
+           [pw_64]"m"(ff_pw_64), [pw_127]"m"(*pw_127), [pw_255]"m"(*pw_255)
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                       "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+          "memory"
+    );
+}
+
+#define RV40_LOOP_FILTERS(dir)                                                \
+static void rv40_ ## dir ## _weak_loop_filter_ssse3(uint8_t *src,             \
+                                                    const int stride,         \
+                                                    const int filter_p1,      \
+                                                    const int filter_q1,      \
+                                                    const int alpha,          \
+                                                    const int beta,           \
+                                                    const int lims,           \
+                                                    const int lim_q1,         \
+                                                    const int lim_p1)         \
+{                                                                             \
+    DECLARE_ALIGNED(16, int16_t, pix)[4][8];                                  \
+                                                                              \
+    rv40_load_ ## dir(pix, src, stride);                                      \
+    rv40_weak_filter(pix, filter_p1, filter_q1, alpha, beta,                  \
+                     lims, lim_q1, lim_p1);                                   \
+    rv40_store_ ## dir(src, stride, pix);                                     \
+}                                                                             \
+                                                                              \
+static void rv40_ ## dir ## _strong_loop_filter_ssse3(uint8_t *src,           \
+                                                      const int stride,       \
+                                                      const int alpha,        \
+                                                      const int lims,         \
+                                                      const int dmode,        \
+                                                      const int chroma)       \
+{                                                                             \
+    DECLARE_ALIGNED(16, int16_t, pix)[5][8];                                  \
+                                                                              \
+    rv40_load_ ## dir(pix, src, stride);                                      \
+    rv40_strong_filter(pix, alpha, lims, dmode, chroma);                      \
+    rv40_store_ ## dir(src, stride, pix);                                     \
+}
+
+RV40_LOOP_FILTERS(h)
+RV40_LOOP_FILTERS(v)
+
+#endif /* HAVE_SSSE3 */
+
+#define SET_MC(OPNAME, CODEC, TYPE, IDX, SIZE, X, Y)                          \
+    c->OPNAME ## CODEC ## _ ## TYPE ## _pixels_tab[IDX][X + 4 * Y] =          \
+        OPNAME ## CODEC ## _ ## TYPE ## SIZE ## _mc ## X ## Y ## _sse2
+
+#define SET_RV30_MC(OPNAME, IDX, SIZE)                                        \
+    SET_MC(OPNAME, rv30, tpel, IDX, SIZE, 1, 0);                              \
+    SET_MC(OPNAME, rv30, tpel, IDX, SIZE, 2, 0);                              \
+    SET_MC(OPNAME, rv30, tpel, IDX, SIZE, 0, 1);                              \
+    SET_MC(OPNAME, rv30, tpel, IDX, SIZE, 0, 2)
+
+#define SET_RV40_MC(OPNAME, IDX, SIZE)                                        \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 1, 0);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 2, 0);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 3, 0);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 0, 1);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 1, 1);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 2, 1);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 3, 1);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 0, 2);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 1, 2);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 2, 2);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 3, 2);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 0, 3);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 1, 3);                              \
+    SET_MC(OPNAME, rv40, qpel, IDX, SIZE, 2, 3)
+
+void ff_rv34dsp_init_mmx(DSPContext* c, AVCodecContext *avctx)
+{
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSE2) {
+        if (CONFIG_RV30_DECODER) {
+            SET_RV30_MC(put_, 0, 16);
+            SET_RV30_MC(put_, 1, 8);
+            SET_RV30_MC(avg_, 0, 16);
+            SET_RV30_MC(avg_, 1, 8);
+        }
+        if (CONFIG_RV40_DECODER) {
+            SET_RV40_MC(put_, 0, 16);
+            SET_RV40_MC(put_, 1, 8);
+            SET_RV40_MC(avg_, 0, 16);
+            SET_RV40_MC(avg_, 1, 8);
+        }
+    }
+#if HAVE_SSSE3
+    if (CONFIG_RV40_DECODER && mm_flags & AV_CPU_FLAG_SSSE3) {
+        c->put_rv40_chroma_pixels_tab[0] = put_rv40_chroma_mc8_ssse3;
+        c->put_rv40_chroma_pixels_tab[1] = put_rv40_chroma_mc4_ssse3;
+        c->avg_rv40_chroma_pixels_tab[0] = avg_rv40_chroma_mc8_ssse3;
+        c->avg_rv40_chroma_pixels_tab[1] = avg_rv40_chroma_mc4_ssse3;
+
+        c->rv40_weak_loop_filter[0]   = rv40_h_weak_loop_filter_ssse3;
+        c->rv40_weak_loop_filter[1]   = rv40_v_weak_loop_filter_ssse3;
+        c->rv40_strong_loop_filter[0] = rv40_h_strong_loop_filter_ssse3;
+        c->rv40_strong_loop_filter[1] = rv40_v_strong_loop_filter_ssse3;
+    }
+#endif
+}
@@ -0,0 +1,484 @@
+/*
+ * AAC Spectral Band Replication DSP functions, SSE optimized
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/dsputil.h"
+#include "libavcodec/sbrdsp.h"
+
+DECLARE_ALIGNED(16, static const uint32_t, ps_neg)[4] = {
+    0x80000000, 0x80000000, 0x80000000, 0x80000000
+};
+DECLARE_ALIGNED(16, static const uint32_t, ps_neg_odd)[4] = {
+    0, 0x80000000, 0, 0x80000000
+};
+
+static void sbr_sum64x5_sse(float *z)
+{
+    x86_reg i = -64 * 4;
+    __asm__ volatile(
+        "1:                             \n\t"
+        "movaps      (%1,%0), %%xmm0    \n\t"
+        "movaps    16(%1,%0), %%xmm1    \n\t"
+        "addps    256(%1,%0), %%xmm0    \n\t"
+        "addps    272(%1,%0), %%xmm1    \n\t"
+        "addps    512(%1,%0), %%xmm0    \n\t"
+        "addps    528(%1,%0), %%xmm1    \n\t"
+        "addps    768(%1,%0), %%xmm0    \n\t"
+        "addps    784(%1,%0), %%xmm1    \n\t"
+        "addps   1024(%1,%0), %%xmm0    \n\t"
+        "addps   1040(%1,%0), %%xmm1    \n\t"
+        "movaps       %%xmm0, (%1,%0)   \n\t"
+        "movaps       %%xmm1, 16(%1,%0) \n\t"
+        "add             $32, %0        \n\t"
+        "jl               1b            \n\t"
+        :"+r"(i)
+        :"r"(z + 64)
+        :XMM_CLOBBERS("%xmm0", "%xmm1",)
+         "memory"
+    );
+}
+
+static float sbr_sum_square_sse(float (*x)[2], int n)
+{
+    float sum;
+    x86_reg i = -n * 8;
+    __asm__ volatile(
+        "xorps        %%xmm0, %%xmm0    \n\t"
+        "1:                             \n\t"
+        "movaps      (%2,%1), %%xmm1    \n\t"
+        "mulps        %%xmm1, %%xmm1    \n\t"
+        "addps        %%xmm1, %%xmm0    \n\t"
+        "add             $16, %1        \n\t"
+        "jl               1b            \n\t"
+        "movhlps      %%xmm0, %%xmm1    \n\t"
+        "addps        %%xmm1, %%xmm0    \n\t"
+        "movaps       %%xmm0, %%xmm1    \n\t"
+        "shufps   $0x55, %%xmm1, %%xmm1 \n\t"
+        "addss        %%xmm1, %%xmm0    \n\t"
+        "movss        %%xmm0, %0        \n\t"
+        :"=m"(sum), "+r"(i)
+        :"r"(x + n)
+        :XMM_CLOBBERS("%xmm0", "%xmm1",)
+         "memory"
+    );
+    return sum;
+}
+
+static void sbr_neg_odd_64_sse(float *x)
+{
+    x86_reg i = -64 * 4;
+    __asm__ volatile(
+        "movaps          %2, %%xmm2     \n\t"
+        "1:                             \n\t"
+        "movaps    (%1,%0), %%xmm0      \n\t"
+        "movaps  16(%1,%0), %%xmm1      \n\t"
+        "xorps      %%xmm2, %%xmm0      \n\t"
+        "xorps      %%xmm2, %%xmm1      \n\t"
+        "movaps     %%xmm0,   (%1,%0)   \n\t"
+        "movaps     %%xmm1, 16(%1,%0)   \n\t"
+        "add           $32, %0          \n\t"
+        "jl             1b              \n\t"
+        :"+r"(i)
+        :"r"(x + 64), "m"(*ps_neg_odd)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",)
+         "memory"
+    );
+}
+
+static void sbr_qmf_pre_shuffle_sse(float *z)
+{
+    x86_reg i = 0;
+    const float *r = z + 61;
+
+    /* All loads are from z[1..64] and all stores to z[64..127], z[64] is
+     * loaded in the first iteration before it is overwritten. */
+    __asm__ volatile(
+        "movaps          %3, %%xmm7     \n\t"
+        "1:                             \n\t"
+        "movups        (%1), %%xmm0     \n\t"
+        "movups     4(%2,%0), %%xmm1    \n\t"
+        "shufps  $0x1b, %%xmm0, %%xmm0  \n\t"
+        "xorps      %%xmm7, %%xmm0      \n\t"
+        "movaps     %%xmm0, %%xmm2      \n\t"
+        "unpcklps   %%xmm1, %%xmm0      \n\t"
+        "unpckhps   %%xmm1, %%xmm2      \n\t"
+        "movaps     %%xmm0, 256(%2,%0,2) \n\t"
+        "movaps     %%xmm2, 272(%2,%0,2) \n\t"
+        "sub           $16, %1          \n\t"
+        "add           $16, %0          \n\t"
+        "cmp          $128, %0          \n\t"
+        "jl             1b              \n\t"
+        :"+r"(i), "+r"(r)
+        :"r"(z), "m"(*ps_neg)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm7",)
+         "memory"
+    );
+    z[64] = z[0];
+    z[65] = z[1];
+}
+
+static void sbr_qmf_post_shuffle_sse(float W[32][2], const float *z)
+{
+    x86_reg i = 0;
+    const float *r = z + 60;
+
+    __asm__ volatile(
+        "movaps          %4, %%xmm7     \n\t"
+        "1:                             \n\t"
+        "movaps        (%1), %%xmm0     \n\t"
+        "movaps    (%2,%0), %%xmm1      \n\t"
+        "shufps  $0x1b, %%xmm0, %%xmm0  \n\t"
+        "xorps      %%xmm7, %%xmm0      \n\t"
+        "movaps     %%xmm0, %%xmm2      \n\t"
+        "unpcklps   %%xmm1, %%xmm0      \n\t"
+        "unpckhps   %%xmm1, %%xmm2      \n\t"
+        "movaps     %%xmm0,   (%3,%0,2) \n\t"
+        "movaps     %%xmm2, 16(%3,%0,2) \n\t"
+        "sub           $16, %1          \n\t"
+        "add           $16, %0          \n\t"
+        "cmp          $128, %0          \n\t"
+        "jl             1b              \n\t"
+        :"+r"(i), "+r"(r)
+        :"r"(z), "r"(W), "m"(*ps_neg)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm7",)
+         "memory"
+    );
+}
+
+static void sbr_qmf_deint_neg_sse(float *v, const float *src)
+{
+    x86_reg i = 0;
+    const float *s = src + 56;
+    float *r = v + 60;
+
+    __asm__ volatile(
+        "movaps          %4, %%xmm7     \n\t"
+        "1:                             \n\t"
+        "movaps      (%1), %%xmm0       \n\t"
+        "movaps    16(%1), %%xmm1       \n\t"
+        "movaps     %%xmm1, %%xmm2      \n\t"
+        "movaps     %%xmm0, %%xmm3      \n\t"
+        "shufps  $0x77, %%xmm0, %%xmm2  \n\t"
+        "shufps  $0x88, %%xmm1, %%xmm3  \n\t"
+        "xorps      %%xmm7, %%xmm3      \n\t"
+        "movaps     %%xmm2, (%3,%0)     \n\t"
+        "movaps     %%xmm3, (%2)        \n\t"
+        "sub           $32, %1          \n\t"
+        "sub           $16, %2          \n\t"
+        "add           $16, %0          \n\t"
+        "cmp          $128, %0          \n\t"
+        "jl             1b              \n\t"
+        :"+r"(i), "+r"(s), "+r"(r)
+        :"r"(v), "m"(*ps_neg)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3", "%xmm7",)
+         "memory"
+    );
+}
+
+static void sbr_qmf_deint_bfly_sse(float *v, const float *src0, const float *src1)
+{
+    x86_reg i = 0;
+    const float *s1 = src1 + 60;
+    float *r = v + 124;
+
+    __asm__ volatile(
+        "1:                             \n\t"
+        "movaps      (%1), %%xmm1       \n\t"
+        "movaps    (%3,%0), %%xmm0      \n\t"
+        "shufps  $0x1b, %%xmm1, %%xmm1  \n\t"
+        "movaps     %%xmm0, %%xmm2      \n\t"
+        "subps      %%xmm1, %%xmm0      \n\t"
+        "addps      %%xmm1, %%xmm2      \n\t"
+        "shufps  $0x1b, %%xmm2, %%xmm2  \n\t"
+        "movaps     %%xmm0, (%4,%0)     \n\t"
+        "movaps     %%xmm2, (%2)        \n\t"
+        "sub           $16, %1          \n\t"
+        "sub           $16, %2          \n\t"
+        "add           $16, %0          \n\t"
+        "cmp          $256, %0          \n\t"
+        "jl             1b              \n\t"
+        :"+r"(i), "+r"(s1), "+r"(r)
+        :"r"(src0), "r"(v)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",)
+         "memory"
+    );
+}
+
+static void sbr_autocorrelate_sse(const float x[40][2], float phi[3][2][2])
+{
+    LOCAL_ALIGNED_16(float, acc, [5], [4]);
+    float real_sum0, real_sum1, imag_sum1, real_sum2, imag_sum2;
+    x86_reg i = -36 * 8;
+
+    /* sums over x[1..36], two complex samples per iteration; the
+     * imaginary parts of the cross terms are lane 0 - 1 + 2 - 3 */
+    __asm__ volatile(
+        "xorps      %%xmm3, %%xmm3      \n\t"
+        "xorps      %%xmm4, %%xmm4      \n\t"
+        "xorps      %%xmm5, %%xmm5      \n\t"
+        "xorps      %%xmm6, %%xmm6      \n\t"
+        "xorps      %%xmm7, %%xmm7      \n\t"
+        "1:                             \n\t"
+        "movups    (%1,%0), %%xmm0      \n\t"
+        "movaps     %%xmm0, %%xmm2      \n\t"
+        "mulps      %%xmm0, %%xmm2      \n\t"
+        "addps      %%xmm2, %%xmm3      \n\t"
+        "movups   8(%1,%0), %%xmm1      \n\t"
+        "movaps     %%xmm1, %%xmm2      \n\t"
+        "mulps      %%xmm0, %%xmm2      \n\t"
+        "addps      %%xmm2, %%xmm4      \n\t"
+        "shufps  $0xb1, %%xmm1, %%xmm1  \n\t"
+        "mulps      %%xmm0, %%xmm1      \n\t"
+        "addps      %%xmm1, %%xmm5      \n\t"
+        "movups  16(%1,%0), %%xmm1      \n\t"
+        "movaps     %%xmm1, %%xmm2      \n\t"
+        "mulps      %%xmm0, %%xmm2      \n\t"
+        "addps      %%xmm2, %%xmm6      \n\t"
+        "shufps  $0xb1, %%xmm1, %%xmm1  \n\t"
+        "mulps      %%xmm0, %%xmm1      \n\t"
+        "addps      %%xmm1, %%xmm7      \n\t"
+        "add           $16, %0          \n\t"
+        "jl             1b              \n\t"
+        "movaps     %%xmm3,   (%2)      \n\t"
+        "movaps     %%xmm4, 16(%2)      \n\t"
+        "movaps     %%xmm5, 32(%2)      \n\t"
+        "movaps     %%xmm6, 48(%2)      \n\t"
+        "movaps     %%xmm7, 64(%2)      \n\t"
+        :"+r"(i)
+        :"r"(x + 37), "r"(acc)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+
+    real_sum0 = acc[0][0] + acc[0][1] + acc[0][2] + acc[0][3] +
+                x[37][0] * x[37][0] + x[37][1] * x[37][1];
+    real_sum1 = acc[1][0] + acc[1][1] + acc[1][2] + acc[1][3] +
+                x[37][0] * x[38][0] + x[37][1] * x[38][1];
+    imag_sum1 = acc[2][0] - acc[2][1] + acc[2][2] - acc[2][3] +
+                x[37][0] * x[38][1] - x[37][1] * x[38][0];
+    real_sum2 = acc[3][0] + acc[3][1] + acc[3][2] + acc[3][3] +
+                x[37][0] * x[39][0] + x[37][1] * x[39][1];
+    imag_sum2 = acc[4][0] - acc[4][1] + acc[4][2] - acc[4][3] +
+                x[37][0] * x[39][1] - x[37][1] * x[39][0];
+
+    phi[2][1][0] = real_sum0 + x[ 0][0] * x[ 0][0] + x[ 0][1] * x[ 0][1];
+    phi[1][0][0] = real_sum0 + x[38][0] * x[38][0] + x[38][1] * x[38][1];
+    phi[1][1][0] = real_sum1 + x[ 0][0] * x[ 1][0] + x[ 0][1] * x[ 1][1];
+    phi[1][1][1] = imag_sum1 + x[ 0][0] * x[ 1][1] - x[ 0][1] * x[ 1][0];
+    phi[0][0][0] = real_sum1 + x[38][0] * x[39][0] + x[38][1] * x[39][1];
+    phi[0][0][1] = imag_sum1 + x[38][0] * x[39][1] - x[38][1] * x[39][0];
+    phi[0][1][0] = real_sum2 + x[ 0][0] * x[ 2][0] + x[ 0][1] * x[ 2][1];
+    phi[0][1][1] = imag_sum2 + x[ 0][0] * x[ 2][1] - x[ 0][1] * x[ 2][0];
+}
+
+static void sbr_hf_gen_sse(float (*X_high)[2], const float (*X_low)[2],
+                           const float alpha0[2], const float alpha1[2],
+                           float bw, int start, int end)
+{
+    LOCAL_ALIGNED_16(float, alpha, [4], [4]);
+    float a0 = alpha1[0] * bw * bw;
+    float a1 = alpha1[1] * bw * bw;
+    float a2 = alpha0[0] * bw;
+    float a3 = alpha0[1] * bw;
+    x86_reg i = (start - end) * 8;
+
+    if (start >= end)
+        return;
+
+    /* The subtracted terms of the real parts are added with a negated
+     * factor, which gives the same result as the C version. */
+    alpha[0][0] =  a0; alpha[0][1] = a0; alpha[0][2] =  a0; alpha[0][3] = a0;
+    alpha[1][0] = -a1; alpha[1][1] = a1; alpha[1][2] = -a1; alpha[1][3] = a1;
+    alpha[2][0] =  a2; alpha[2][1] = a2; alpha[2][2] =  a2; alpha[2][3] = a2;
+    alpha[3][0] = -a3; alpha[3][1] = a3; alpha[3][2] = -a3; alpha[3][3] = a3;
+
+    __asm__ volatile(
+        "movaps      (%3), %%xmm4       \n\t"
+        "movaps    16(%3), %%xmm5       \n\t"
+        "movaps    32(%3), %%xmm6       \n\t"
+        "movaps    48(%3), %%xmm7       \n\t"
+        "1:                             \n\t"
+        "movaps  -16(%2,%0), %%xmm0     \n\t"
+        "movaps     %%xmm0, %%xmm1      \n\t"
+        "shufps  $0xb1, %%xmm1, %%xmm1  \n\t"
+        "mulps      %%xmm4, %%xmm0      \n\t"
+        "mulps      %%xmm5, %%xmm1      \n\t"
+        "addps      %%xmm1, %%xmm0      \n\t"
+        "movups   -8(%2,%0), %%xmm1     \n\t"
+        "movaps     %%xmm1, %%xmm2      \n\t"
+        "shufps  $0xb1, %%xmm2, %%xmm2  \n\t"
+        "mulps      %%xmm6, %%xmm1      \n\t"
+        "mulps      %%xmm7, %%xmm2      \n\t"
+        "addps      %%xmm1, %%xmm0      \n\t"
+        "addps      %%xmm2, %%xmm0      \n\t"
+        "addps     (%2,%0), %%xmm0      \n\t"
+        "movaps     %%xmm0, (%1,%0)     \n\t"
+        "add           $16, %0          \n\t"
+        "jl             1b              \n\t"
+        :"+r"(i)
+        :"r"(X_high + end), "r"(X_low + end), "r"(alpha)
+        :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2",
+                      "%xmm4", "%xmm5", "%xmm6", "%xmm7",)
+         "memory"
+    );
+}
+
+static void sbr_hf_g_filt_sse(float (*Y)[2], const float (*X_high)[40][2],
+                              const float *g_filt, int m_max, int ixh)
+{
+    const float *x = X_high[0][ixh];
+    x86_reg i = -(m_max >> 1) * 8;
+
+    /* two subbands per iteration, their samples are one row apart */
+    if (i) {
+        __asm__ volatile(
+            "1:                             \n\t"
+            "movlps        (%1), %%xmm0     \n\t"
+            "movhps     320(%1), %%xmm0     \n\t"
+            "movlps    (%2,%0), %%xmm1      \n\t"
+            "unpcklps   %%xmm1, %%xmm1      \n\t"
+            "mulps      %%xmm1, %%xmm0      \n\t"
+            "movups     %%xmm0, (%3,%0,2)   \n\t"
+            "add          $640, %1          \n\t"
+            "add            $8, %0          \n\t"
+            "jl             1b              \n\t"
+            :"+r"(i), "+r"(x)
+            :"r"(g_filt + (m_max & ~1)), "r"(Y + (m_max & ~1))
+            :XMM_CLOBBERS("%xmm0", "%xmm1",)
+             "memory"
+        );
+    }
+    if (m_max & 1) {
+        Y[m_max - 1][0] = X_high[m_max - 1][ixh][0] * g_filt[m_max - 1];
+        Y[m_max - 1][1] = X_high[m_max - 1][ixh][1] * g_filt[m_max - 1];
+    }
+}
+
+static av_always_inline void sbr_hf_apply_noise_sse(float (*Y)[2],
+                                                    const float *s_m,
+                                                    const float *q_filt,
+                                                    int noise,
+                                                    float phi_sign0,
+                                                    float phi_sign1,
+                                                    int m_max)
+{
+    LOCAL_ALIGNED_16(float, phi, [4]);
+    int m;
+
+    phi[0] = phi_sign0;
+    phi[1] = phi_sign1;
+    phi[2] = phi_sign0;
+    phi[3] = -phi_sign1;
+
+    /* Both the sinusoid and the noise are computed and the one selected
+     * by s_m[m] != 0 is added, as in the C version. */
+    for (m = 0; m + 1 < m_max; m += 2) {
+        __asm__ volatile(
+            "movlps        (%1), %%xmm0     \n\t"
+            "unpcklps   %%xmm0, %%xmm0      \n\t"
+            "movlps        (%2), %%xmm1     \n\t"
+            "unpcklps   %%xmm1, %%xmm1      \n\t"
+            "movlps        (%3), %%xmm2     \n\t"
+            "movhps        (%4), %%xmm2     \n\t"
+            "xorps      %%xmm3, %%xmm3      \n\t"
+            "cmpneqps   %%xmm0, %%xmm3      \n\t"
+            "mulps          %5, %%xmm0      \n\t"
+            "mulps      %%xmm2, %%xmm1      \n\t"
+            "andps      %%xmm3, %%xmm0      \n\t"
+            "andnps     %%xmm1, %%xmm3      \n\t"
+            "orps       %%xmm3, %%xmm0      \n\t"
+            "movups        (%0), %%xmm1     \n\t"
+            "addps      %%xmm0, %%xmm1      \n\t"
+            "movups     %%xmm1, (%0)        \n\t"
+            ::"r"(Y + m), "r"(s_m + m), "r"(q_filt + m),
+              "r"(ff_sbr_noise_table[(noise + m + 1) & 0x1ff]),
+              "r"(ff_sbr_noise_table[(noise + m + 2) & 0x1ff]),
+              "m"(*phi)
+            :XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+             "memory"
+        );
+    }
+    if (m_max & 1) {
+        noise = (noise + m_max) & 0x1ff;
+        if (s_m[m]) {
+            Y[m][0] += s_m[m] * phi_sign0;
+            Y[m][1] += s_m[m] * phi_sign1;
+        } else {
+            Y[m][0] += q_filt[m] * ff_sbr_noise_table[noise][0];
+            Y[m][1] += q_filt[m] * ff_sbr_noise_table[noise][1];
+        }
+    }
+}
+
+static void sbr_hf_apply_noise_0_sse(float (*Y)[2], const float *s_m,
+                                     const float *q_filt, int noise,
+                                     int kx, int m_max)
+{
+    sbr_hf_apply_noise_sse(Y, s_m, q_filt, noise, 1.0f, 0.0f, m_max);
+}
+
+static void sbr_hf_apply_noise_1_sse(float (*Y)[2], const float *s_m,
+                                     const float *q_filt, int noise,
+                                     int kx, int m_max)
+{
+    float phi_sign = 1 - 2 * (kx & 1);
+    sbr_hf_apply_noise_sse(Y, s_m, q_filt, noise, 0.0f, phi_sign, m_max);
+}
+
+static void sbr_hf_apply_noise_2_sse(float (*Y)[2], const float *s_m,
+                                     const float *q_filt, int noise,
+                                     int kx, int m_max)
+{
+    sbr_hf_apply_noise_sse(Y, s_m, q_filt, noise, -1.0f, 0.0f, m_max);
+}
+
+static void sbr_hf_apply_noise_3_sse(float (*Y)[2], const float *s_m,
+                                     const float *q_filt, int noise,
+                                     int kx, int m_max)
+{
+    float phi_sign = 1 - 2 * (kx & 1);
+    sbr_hf_apply_noise_sse(Y, s_m, q_filt, noise, 0.0f, -phi_sign, m_max);
+}
+
+av_cold void ff_sbrdsp_init_x86(SBRDSPContext *s)
+{
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSE && HAVE_SSE) {
+        s->sum64x5           = sbr_sum64x5_sse;
+        s->sum_square        = sbr_sum_square_sse;
+        s->neg_odd_64        = sbr_neg_odd_64_sse;
+        s->qmf_pre_shuffle   = sbr_qmf_pre_shuffle_sse;
+        s->qmf_post_shuffle  = sbr_qmf_post_shuffle_sse;
+        s->qmf_deint_neg     = sbr_qmf_deint_neg_sse;
+        s->qmf_deint_bfly    = sbr_qmf_deint_bfly_sse;
+        s->autocorrelate     = sbr_autocorrelate_sse;
+        s->hf_gen            = sbr_hf_gen_sse;
+        s->hf_g_filt         = sbr_hf_g_filt_sse;
+        s->hf_apply_noise[0] = sbr_hf_apply_noise_0_sse;
+        s->hf_apply_noise[1] = sbr_hf_apply_noise_1_sse;
+        s->hf_apply_noise[2] = sbr_hf_apply_noise_2_sse;
+        s->hf_apply_noise[3] = sbr_hf_apply_noise_3_sse;
+    }
+}
@@ -0,0 +1,293 @@
+/*
+ * 10-bit packed video DSP functions, SSSE3 optimized
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <stdint.h>
+
+#include "libavutil/bswap.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86_cpu.h"
+#include "libavcodec/dsputil.h"
+#include "libavcodec/v210dsp.h"
+
+#if HAVE_SSSE3
+
+DECLARE_ALIGNED(16, static const uint32_t, mask_10bit)[4] = {
+    0x3FF, 0x3FF, 0x3FF, 0x3FF
+};
+DECLARE_ALIGNED(16, static const int8_t, bswap32)[16] = {
+    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+};
+
+/* A v210 group of 6 pixels is split into the low and high 10-bit fields of
+ * its words (U0 Y0) (Y1 U1) (V1 Y3) (Y4 V2), the x words, and the top fields
+ * V0 Y2 U2 Y5, the z words. These shuffles collect the luma and the chroma,
+ * Cb in the low and Cr in the high quadword, from the x and z words. */
+DECLARE_ALIGNED(16, static const int8_t, luma_x)[16] = {
+     2,  3,  4,  5, -1, -1, 10, 11, 12, 13, -1, -1, -1, -1, -1, -1
+};
+DECLARE_ALIGNED(16, static const int8_t, luma_z)[16] = {
+    -1, -1, -1, -1,  4,  5, -1, -1, -1, -1, 12, 13, -1, -1, -1, -1
+};
+DECLARE_ALIGNED(16, static const int8_t, chroma_x)[16] = {
+     0,  1,  6,  7, -1, -1, -1, -1, -1, -1,  8,  9, 14, 15, -1, -1
+};
+DECLARE_ALIGNED(16, static const int8_t, chroma_z)[16] = {
+    -1, -1, -1, -1,  8,  9, -1, -1,  0,  1, -1, -1, -1, -1, -1, -1
+};
+/* and these build the x and z words back from the luma and chroma */
+DECLARE_ALIGNED(16, static const int8_t, x_luma)[16] = {
+    -1, -1,  0,  1,  2,  3, -1, -1, -1, -1,  6,  7,  8,  9, -1, -1
+};
+DECLARE_ALIGNED(16, static const int8_t, x_chroma)[16] = {
+     0,  1, -1, -1, -1, -1,  2,  3, 10, 11, -1, -1, -1, -1, 12, 13
+};
+DECLARE_ALIGNED(16, static const int8_t, z_luma)[16] = {
+    -1, -1, -1, -1,  4,  5, -1, -1, -1, -1, -1, -1, 10, 11, -1, -1
+};
+DECLARE_ALIGNED(16, static const int8_t, z_chroma)[16] = {
+     8,  9, -1, -1, -1, -1, -1, -1,  4,  5, -1, -1, -1, -1, -1, -1
+};
+DECLARE_ALIGNED(16, static const int16_t, x_mult)[8] = {
+    1, 1 << 10, 1, 1 << 10, 1, 1 << 10, 1, 1 << 10
+};
+/* interleave 4 r210 pixels from (R0 R1 R2 R3 G0 G1 G2 G3) and (B0 B1 B2 B3) */
+DECLARE_ALIGNED(16, static const int8_t, rgb_lo_rg)[16] = {
+     0,  1,  8,  9, -1, -1,  2,  3, 10, 11, -1, -1,  4,  5, 12, 13
+};
+DECLARE_ALIGNED(16, static const int8_t, rgb_lo_b)[16] = {
+    -1, -1, -1, -1,  0,  1, -1, -1, -1, -1,  2,  3, -1, -1, -1, -1
+};
+DECLARE_ALIGNED(16, static const int8_t, rgb_hi_rg)[16] = {
+    -1, -1,  6,  7, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1
+};
+DECLARE_ALIGNED(16, static const int8_t, rgb_hi_b)[16] = {
+     4,  5, -1, -1, -1, -1,  6,  7, -1, -1, -1, -1, -1, -1, -1, -1
+};
+
+#define UNPACK_CONSTS                                          \
+    [mask]"m"(*mask_10bit), [bswap]"m"(*bswap32),              \
+    [luma_x]"m"(*luma_x), [luma_z]"m"(*luma_z),                \
+    [chroma_x]"m"(*chroma_x), [chroma_z]"m"(*chroma_z)
+
+/* Unpack the group in xmm0, which has its first, second and third sample in
+ * bits s0, s1 and s2 of the words, into the luma in xmm1 and the chroma in
+ * xmm0. */
+#define UNPACK_GROUP(s0, s1, s2)                    \
+    "movdqa          %%xmm0, %%xmm1     \n\t"       \
+    "movdqa          %%xmm0, %%xmm2     \n\t"       \
+    "psrld        $"#s0", %%xmm0        \n\t"       \
+    "psrld        $"#s1", %%xmm1        \n\t"       \
+    "psrld        $"#s2", %%xmm2        \n\t"       \
+    "pand           %[mask], %%xmm0     \n\t"       \
+    "pand           %[mask], %%xmm1     \n\t"       \
+    "pand           %[mask], %%xmm2     \n\t"       \
+    "pslld              $16, %%xmm1     \n\t"       \
+    "por             %%xmm1, %%xmm0     \n\t"       \
+    "psllw               $6, %%xmm0     \n\t"       \
+    "psllw               $6, %%xmm2     \n\t"       \
+    "movdqa          %%xmm0, %%xmm1     \n\t"       \
+    "movdqa          %%xmm2, %%xmm3     \n\t"       \
+    "pshufb       %[luma_x], %%xmm1     \n\t"       \
+    "pshufb       %[luma_z], %%xmm3     \n\t"       \
+    "pshufb     %[chroma_x], %%xmm0     \n\t"       \
+    "pshufb     %[chroma_z], %%xmm2     \n\t"       \
+    "por             %%xmm3, %%xmm1     \n\t"       \
+    "por             %%xmm2, %%xmm0     \n\t"
+
+/* All but the last group are stored with wider stores, which are
+ * overwritten by the next group, the last one exactly. */
+#define UNPACK_FUNC(name, load, s0, s1, s2)                                  \
+static void name(const uint32_t *src, uint16_t *y, uint16_t *u,             \
+                 uint16_t *v, int width)                                     \
+{                                                                            \
+    x86_reg tmp;                                                             \
+                                                                             \
+    for (; width > 6; width -= 6) {                                          \
+        __asm__ volatile(                                                    \
+            "movdqu           (%0), %%xmm0      \n\t"                        \
+            load                                                             \
+            UNPACK_GROUP(s0, s1, s2)                                         \
+            "movdqu          %%xmm1, (%1)       \n\t"                        \
+            "movq            %%xmm0, (%2)       \n\t"                        \
+            "movhps          %%xmm0, (%3)       \n\t"                        \
+            :: "r"(src), "r"(y), "r"(u), "r"(v), UNPACK_CONSTS               \
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)              \
+              "memory"                                                       \
+        );                                                                   \
+        src += 4;                                                            \
+        y   += 6;                                                            \
+        u   += 3;                                                            \
+        v   += 3;                                                            \
+    }                                                                        \
+    __asm__ volatile(                                                        \
+        "movdqu           (%1), %%xmm0      \n\t"                            \
+        load                                                                 \
+        UNPACK_GROUP(s0, s1, s2)                                             \
+        "movq            %%xmm1, (%2)       \n\t"                            \
+        "psrldq              $8, %%xmm1     \n\t"                            \
+        "movd            %%xmm1, 8(%2)      \n\t"                            \
+        "movd            %%xmm0, (%3)       \n\t"                            \
+        "pextrw          $2, %%xmm0, %k0    \n\t"                            \
+        "mov                %w0, 4(%3)      \n\t"                            \
+        "psrldq              $8, %%xmm0     \n\t"                            \
+        "movd            %%xmm0, (%4)       \n\t"                            \
+        "pextrw          $2, %%xmm0, %k0    \n\t"                            \
+        "mov                %w0, 4(%4)      \n\t"                            \
+        : "=&r"(tmp)                                                         \
+        : "r"(src), "r"(y), "r"(u), "r"(v), UNPACK_CONSTS                    \
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)                  \
+          "memory"                                                           \
+    );                                                                       \
+}
+
+UNPACK_FUNC(unpack_v210_ssse3, "", 0, 10, 20)
+UNPACK_FUNC(unpack_v210x_ssse3, "pshufb %[bswap], %%xmm0 \n\t", 22, 12, 2)
+
+#define PACK_CONSTS                                            \
+    [x_luma]"m"(*x_luma), [x_chroma]"m"(*x_chroma),            \
+    [z_luma]"m"(*z_luma), [z_chroma]"m"(*z_chroma),            \
+    [x_mult]"m"(*x_mult)
+
+/* Pack the 6 luma samples in xmm0 and the chroma in xmm1, Cb in the low and
+ * Cr in the high quadword, into a group of 4 words in xmm0. */
+#define PACK_GROUP                                  \
+    "psrlw               $6, %%xmm0     \n\t"       \
+    "psrlw               $6, %%xmm1     \n\t"       \
+    "movdqa          %%xmm0, %%xmm2     \n\t"       \
+    "movdqa          %%xmm1, %%xmm3     \n\t"       \
+    "pshufb       %[x_luma], %%xmm0     \n\t"       \
+    "pshufb     %[x_chroma], %%xmm1     \n\t"       \
+    "pshufb       %[z_luma], %%xmm2     \n\t"       \
+    "pshufb     %[z_chroma], %%xmm3     \n\t"       \
+    "por             %%xmm1, %%xmm0     \n\t"       \
+    "por             %%xmm3, %%xmm2     \n\t"       \
+    "pmaddwd      %[x_mult], %%xmm0     \n\t"       \
+    "pslld              $20, %%xmm2     \n\t"       \
+    "por             %%xmm2, %%xmm0     \n\t"
+
+/* All but the last group are loaded with wider loads. */
+static void pack_v210_ssse3(uint32_t *dst, const uint16_t *y,
+                            const uint16_t *u, const uint16_t *v, int width)
+{
+    for (; width > 6; width -= 6) {
+        __asm__ volatile(
+            "movdqu           (%1), %%xmm0      \n\t"
+            "movq             (%2), %%xmm1      \n\t"
+            "movhps           (%3), %%xmm1      \n\t"
+            PACK_GROUP
+            "movdqu          %%xmm0, (%0)       \n\t"
+            :: "r"(dst), "r"(y), "r"(u), "r"(v), PACK_CONSTS
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+              "memory"
+        );
+        dst += 4;
+        y   += 6;
+        u   += 3;
+        v   += 3;
+    }
+    __asm__ volatile(
+        "movq             (%1), %%xmm0      \n\t"
+        "movd            8(%1), %%xmm2      \n\t"
+        "punpcklqdq      %%xmm2, %%xmm0     \n\t"
+        "movd             (%2), %%xmm1      \n\t"
+        "pinsrw      $2, 4(%2), %%xmm1      \n\t"
+        "movd             (%3), %%xmm2      \n\t"
+        "pinsrw      $2, 4(%3), %%xmm2      \n\t"
+        "punpcklqdq      %%xmm2, %%xmm1     \n\t"
+        PACK_GROUP
+        "movdqu          %%xmm0, (%0)       \n\t"
+        :: "r"(dst), "r"(y), "r"(u), "r"(v), PACK_CONSTS
+        : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+          "memory"
+    );
+}
+
+static void unpack_r210_ssse3(const uint32_t *src, uint16_t *dst, int width,
+                              int shift)
+{
+    for (; width >= 4; width -= 4) {
+        __asm__ volatile(
+            "movdqu           (%0), %%xmm0      \n\t"
+            "movd               %2, %%xmm3      \n\t"
+            "pshufb        %[bswap], %%xmm0     \n\t"
+            "psrld           %%xmm3, %%xmm0     \n\t"
+            "movdqa          %%xmm0, %%xmm1     \n\t"
+            "movdqa          %%xmm0, %%xmm2     \n\t"
+            "psrld              $20, %%xmm0     \n\t"
+            "psrld              $10, %%xmm1     \n\t"
+            "pand           %[mask], %%xmm0     \n\t"
+            "pand           %[mask], %%xmm1     \n\t"
+            "pand           %[mask], %%xmm2     \n\t"
+            "packssdw        %%xmm1, %%xmm0     \n\t"
+            "packssdw        %%xmm2, %%xmm2     \n\t"
+            "movdqa          %%xmm0, %%xmm1     \n\t"
+            "movdqa          %%xmm2, %%xmm3     \n\t"
+            "psllw               $6, %%xmm0     \n\t"
+            "psllw               $6, %%xmm2     \n\t"
+            "psrlw               $4, %%xmm1     \n\t"
+            "psrlw               $4, %%xmm3     \n\t"
+            "por             %%xmm1, %%xmm0     \n\t"
+            "por             %%xmm3, %%xmm2     \n\t"
+            "movdqa          %%xmm0, %%xmm1     \n\t"
+            "movdqa          %%xmm2, %%xmm3     \n\t"
+            "pshufb    %[rgb_lo_rg], %%xmm0     \n\t"
+            "pshufb     %[rgb_lo_b], %%xmm2     \n\t"
+            "pshufb    %[rgb_hi_rg], %%xmm1     \n\t"
+            "pshufb     %[rgb_hi_b], %%xmm3     \n\t"
+            "por             %%xmm2, %%xmm0     \n\t"
+            "por             %%xmm3, %%xmm1     \n\t"
+            "movdqu          %%xmm0, (%1)       \n\t"
+            "movq            %%xmm1, 16(%1)     \n\t"
+            :: "r"(src), "r"(dst), "r"(shift),
+               [mask]"m"(*mask_10bit), [bswap]"m"(*bswap32),
+               [rgb_lo_rg]"m"(*rgb_lo_rg), [rgb_lo_b]"m"(*rgb_lo_b),
+               [rgb_hi_rg]"m"(*rgb_hi_rg), [rgb_hi_b]"m"(*rgb_hi_b)
+            : XMM_CLOBBERS("%xmm0", "%xmm1", "%xmm2", "%xmm3",)
+              "memory"
+        );
+        src += 4;
+        dst += 12;
+    }
+    for (; width > 0; width--) {
+        uint32_t pixel = av_be2ne32(*src++) >> shift;
+        uint16_t r = (pixel >> 14) & 0xFFC0;
+        uint16_t g = (pixel >>  4) & 0xFFC0;
+        uint16_t b =  pixel <<  6;
+        *dst++ = r | (r >> 10);
+        *dst++ = g | (g >> 10);
+        *dst++ = b | (b >> 10);
+    }
+}
+
+#endif /* HAVE_SSSE3 */
+
+av_cold void ff_v210dsp_init_x86(V210DSPContext *c)
+{
+#if HAVE_SSSE3
+    int mm_flags = av_get_cpu_flags();
+
+    if (mm_flags & AV_CPU_FLAG_SSSE3) {
+        c->unpack_v210  = unpack_v210_ssse3;
+        c->unpack_v210x = unpack_v210x_ssse3;
+        c->pack_v210    = pack_v210_ssse3;
+        c->unpack_r210  = unpack_r210_ssse3;
+    }
+#endif
+}
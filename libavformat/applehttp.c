@@ -26,10 +26,20 @@
  */
 
 #define _XOPEN_SOURCE 600
+#include "config.h"
 #include "libavutil/avstring.h"
 #include "avformat.h"
 #include "internal.h"
+#include "http.h"
 #include <unistd.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
+
+/* Number of segments downloaded ahead of the one being demuxed */
+#define PREFETCH_SEGMENTS 2
+#define FETCH_CHUNK_SIZE 32768
+#define SEGMENT_BUFFER_SIZE 32768
 
 /*
  * An apple http stream consists of a playlist with media segment files,
@@ -41,13 +51,43 @@
  *
  * If the main playlist doesn't point at any variants, we still create
  * one anonymous toplevel variant for this, to maintain the structure.
+ *
+ * When built with pthreads, each variant has a prefetch thread that
+ * downloads its segments into memory while it is active, up to
+ * PREFETCH_SEGMENTS ahead of the one being demuxed, and measures the
+ * throughput of these downloads. The demuxer thread is the only one
+ * modifying the variants and their segment lists, and does so with the
+ * lock held while the prefetch threads are running; the prefetch threads
+ * only read them with the lock held.
+ *
+ * With AVFMT_FLAG_ADAPTIVE, the variants with the same streams as the
+ * first one are treated as renditions of the same program: only the one
+ * fitting the measured throughput is fetched, and its packets are
+ * returned on the streams of the first variant.
  */
 
+struct AppleHTTPContext;
+
 struct segment {
     int duration;
     char url[MAX_URL_SIZE];
 };
 
+/*
+ * A segment downloaded into memory by the prefetch thread. While the
+ * download is in progress, data is appended by the prefetch thread and
+ * read from pos onwards by the demuxer of the variant.
+ */
+struct segment_data {
+    int seq_no;
+    uint8_t *data;
+    unsigned int size, allocated;
+    unsigned int pos;
+    int done;       /* download finished, with the error code in ret */
+    int ret;
+    int cancelled;  /* no longer wanted, freed by the prefetch thread */
+};
+
 /*
  * Each variant has its own demuxer. If it currently is active,
  * it has an open ByteIOContext too, and potentially an AVPacket
@@ -60,11 +100,22 @@ struct variant {
     AVFormatContext *ctx;
     AVPacket pkt;
     int stream_offset;
+    struct AppleHTTPContext *parent;
 
     int start_seq_no;
     int n_segments;
     struct segment **segments;
     int needed;
+    int active;     /* segments of this variant are being fetched */
+    int rendition;  /* same streams as the first variant, in adaptive mode */
+
+    int open_seq_no;
+    int n_fetched;
+    struct segment_data *fetched[PREFETCH_SEGMENTS + 1];
+#if HAVE_PTHREADS
+    pthread_t thread;
+    int thread_started;
+#endif
 };
 
 typedef struct AppleHTTPContext {
@@ -76,8 +127,27 @@ typedef struct AppleHTTPContext {
     int64_t last_load_time;
     int64_t last_packet_dts;
     int max_start_seq, min_end_seq;
+
+    int adaptive;
+    int cur_variant;      /* rendition fetched in adaptive mode */
+    int prefetch;         /* the prefetch threads are running */
+    int fetch_seq_no;     /* cur_seq_no, as seen by the prefetch threads */
+    int64_t throughput;   /* smoothed download rate, in bit/s */
+#if HAVE_PTHREADS
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    int abort;
+#endif
 } AppleHTTPContext;
 
+#if HAVE_PTHREADS
+#define LOCK(c)   do { if ((c)->prefetch) pthread_mutex_lock(&(c)->lock);   } while (0)
+#define UNLOCK(c) do { if ((c)->prefetch) pthread_mutex_unlock(&(c)->lock); } while (0)
+#else
+#define LOCK(c)
+#define UNLOCK(c)
+#endif
+
 static int read_chomp_line(ByteIOContext *s, char *buf, int maxlen)
 {
     int len = ff_get_line(s, buf, maxlen);
@@ -132,6 +202,292 @@ static void free_segment_list(struct variant *var)
     var->n_segments = 0;
 }
 
+#if HAVE_PTHREADS
+static struct segment_data *find_fetched(struct variant *var, int seq_no)
+{
+    int i;
+    for (i = 0; i < var->n_fetched; i++)
+        if (var->fetched[i]->seq_no == seq_no)
+            return var->fetched[i];
+    return NULL;
+}
+
+/* Remove a segment from the prefetch queue of its variant, lock held. */
+static void drop_fetched(struct variant *var, int i)
+{
+    struct segment_data *seg = var->fetched[i];
+    if (seg->done) {
+        av_free(seg->data);
+        av_free(seg);
+    } else {
+        seg->cancelled = 1;
+    }
+    var->fetched[i] = var->fetched[--var->n_fetched];
+}
+
+/*
+ * Pick the next segment of an active variant to download: the lowest
+ * sequence number within the prefetch window it hasn't got yet. Lock held.
+ */
+static struct segment_data *next_fetch(AppleHTTPContext *c,
+                                       struct variant *var, char *url)
+{
+    int seq_no;
+
+    if (!var->active)
+        return NULL;
+    for (seq_no = FFMAX(c->fetch_seq_no, var->start_seq_no);
+         seq_no <= c->fetch_seq_no + PREFETCH_SEGMENTS &&
+         seq_no - var->start_seq_no < var->n_segments &&
+         var->n_fetched < FF_ARRAY_ELEMS(var->fetched); seq_no++) {
+        struct segment_data *seg;
+        if (find_fetched(var, seq_no))
+            continue;
+        seg = av_mallocz(sizeof(struct segment_data));
+        if (!seg)
+            return NULL;
+        seg->seq_no = seq_no;
+        av_strlcpy(url, var->segments[seq_no - var->start_seq_no]->url,
+                   MAX_URL_SIZE);
+        var->fetched[var->n_fetched++] = seg;
+        return seg;
+    }
+    return NULL;
+}
+
+static void fetch_segment(AppleHTTPContext *c, struct segment_data *seg,
+                          const char *url)
+{
+    uint8_t buf[FETCH_CHUNK_SIZE];
+    ByteIOContext *in = NULL;
+    int64_t start = av_gettime(), elapsed;
+    int ret, len, stop = 0;
+
+    ret = url_fopen(&in, url, URL_RDONLY);
+    while (ret >= 0 && !stop) {
+        len = get_partial_buffer(in, buf, sizeof(buf));
+        if (len <= 0) {
+            ret = url_ferror(in);
+            if (ret == AVERROR_EOF)
+                ret = 0;
+            break;
+        }
+        pthread_mutex_lock(&c->lock);
+        stop = seg->cancelled || c->abort;
+        if (!stop) {
+            uint8_t *data = av_fast_realloc(seg->data, &seg->allocated,
+                                            seg->size + len);
+            if (data) {
+                seg->data = data;
+                memcpy(seg->data + seg->size, buf, len);
+                seg->size += len;
+                pthread_cond_broadcast(&c->cond);
+            } else {
+                ret = AVERROR(ENOMEM);
+            }
+        }
+        pthread_mutex_unlock(&c->lock);
+    }
+    if (in)
+        url_fclose(in);
+
+    pthread_mutex_lock(&c->lock);
+    elapsed = av_gettime() - start;
+    if (ret >= 0 && !stop && elapsed > 0) {
+        int64_t rate = seg->size * 8000000LL / elapsed;
+        c->throughput = c->throughput ? (3 * c->throughput + rate) / 4 : rate;
+    }
+    if (seg->cancelled) {
+        av_free(seg->data);
+        av_free(seg);
+    } else {
+        seg->ret  = ret;
+        seg->done = 1;
+    }
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+}
+
+static void *prefetch_thread(void *arg)
+{
+    struct variant *var = arg;
+    AppleHTTPContext *c = var->parent;
+    char url[MAX_URL_SIZE];
+
+    pthread_mutex_lock(&c->lock);
+    while (!c->abort) {
+        struct segment_data *seg = next_fetch(c, var, url);
+        if (!seg) {
+            pthread_cond_wait(&c->cond, &c->lock);
+            continue;
+        }
+        pthread_mutex_unlock(&c->lock);
+        fetch_segment(c, seg, url);
+        pthread_mutex_lock(&c->lock);
+    }
+    pthread_mutex_unlock(&c->lock);
+    return NULL;
+}
+
+static int read_fetched(void *opaque, uint8_t *buf, int buf_size)
+{
+    struct variant *var = opaque;
+    AppleHTTPContext *c = var->parent;
+    struct segment_data *seg;
+    int len;
+
+    pthread_mutex_lock(&c->lock);
+    while (!(seg = find_fetched(var, var->open_seq_no)) ||
+           (seg->pos == seg->size && !seg->done)) {
+        int64_t t = av_gettime() + 100000;
+        struct timespec ts = { t / 1000000, (t % 1000000) * 1000 };
+        if (url_interrupt_cb()) {
+            pthread_mutex_unlock(&c->lock);
+            return AVERROR(EINTR);
+        }
+        pthread_cond_timedwait(&c->cond, &c->lock, &ts);
+    }
+    len = FFMIN(buf_size, seg->size - seg->pos);
+    memcpy(buf, seg->data + seg->pos, len);
+    seg->pos += len;
+    if (!len && seg->ret < 0)
+        len = seg->ret;
+    pthread_mutex_unlock(&c->lock);
+    return len;
+}
+
+static void join_prefetch(AppleHTTPContext *c)
+{
+    int i;
+
+    pthread_mutex_lock(&c->lock);
+    c->abort = 1;
+    pthread_cond_broadcast(&c->cond);
+    pthread_mutex_unlock(&c->lock);
+    for (i = 0; i < c->n_variants; i++) {
+        struct variant *var = c->variants[i];
+        if (var->thread_started)
+            pthread_join(var->thread, NULL);
+        var->thread_started = 0;
+        while (var->n_fetched)
+            drop_fetched(var, 0);
+    }
+}
+
+static void start_prefetch(AppleHTTPContext *c)
+{
+    int i;
+
+    pthread_mutex_init(&c->lock, NULL);
+    pthread_cond_init(&c->cond, NULL);
+    for (i = 0; i < c->n_variants; i++) {
+        struct variant *var = c->variants[i];
+        if (!var->ctx)
+            continue;
+        if (pthread_create(&var->thread, NULL, prefetch_thread, var)) {
+            av_log(NULL, AV_LOG_WARNING,
+                   "Unable to start the prefetch threads\n");
+            join_prefetch(c);
+            pthread_mutex_destroy(&c->lock);
+            pthread_cond_destroy(&c->cond);
+            return;
+        }
+        var->thread_started = 1;
+    }
+    c->prefetch = 1;
+}
+
+static void stop_prefetch(AppleHTTPContext *c)
+{
+    if (c->prefetch)
+        join_prefetch(c);
+}
+#endif
+
+/*
+ * Update which variants the prefetch threads should fetch, and drop the
+ * downloaded segments that fell out of the prefetch window.
+ */
+static void update_prefetch(AppleHTTPContext *c)
+{
+    int i;
+
+    LOCK(c);
+    c->fetch_seq_no = c->cur_seq_no;
+    for (i = 0; i < c->n_variants; i++) {
+        struct variant *var = c->variants[i];
+        var->active = var->needed && (!var->rendition || i == c->cur_variant);
+#if HAVE_PTHREADS
+        {
+            int j = 0;
+            while (j < var->n_fetched) {
+                struct segment_data *seg = var->fetched[j];
+                if (!(var->pb && seg->seq_no == var->open_seq_no) &&
+                    (!var->active || seg->seq_no < c->fetch_seq_no ||
+                     seg->seq_no > c->fetch_seq_no + PREFETCH_SEGMENTS))
+                    drop_fetched(var, j);
+                else
+                    j++;
+            }
+        }
+#endif
+    }
+#if HAVE_PTHREADS
+    if (c->prefetch)
+        pthread_cond_broadcast(&c->cond);
+#endif
+    UNLOCK(c);
+}
+
+static int open_segment(AppleHTTPContext *c, struct variant *var, int seq_no)
+{
+#if HAVE_PTHREADS
+    if (c->prefetch) {
+        uint8_t *buf = av_malloc(SEGMENT_BUFFER_SIZE);
+        if (!buf)
+            return AVERROR(ENOMEM);
+        var->pb = av_alloc_put_byte(buf, SEGMENT_BUFFER_SIZE, 0, var,
+                                    read_fetched, NULL, NULL);
+        if (!var->pb) {
+            av_free(buf);
+            return AVERROR(ENOMEM);
+        }
+        var->pb->is_streamed = 1;
+        LOCK(c);
+        var->open_seq_no = seq_no;
+        UNLOCK(c);
+        return 0;
+    }
+#endif
+    return url_fopen(&var->pb,
+                     var->segments[seq_no - var->start_seq_no]->url,
+                     URL_RDONLY);
+}
+
+static void close_segment(AppleHTTPContext *c, struct variant *var)
+{
+    if (!var->pb)
+        return;
+#if HAVE_PTHREADS
+    if (c->prefetch) {
+        int i;
+        LOCK(c);
+        for (i = 0; i < var->n_fetched; i++) {
+            if (var->fetched[i]->seq_no == var->open_seq_no) {
+                drop_fetched(var, i);
+                break;
+            }
+        }
+        UNLOCK(c);
+        av_free(var->pb->buffer);
+        av_freep(&var->pb);
+        return;
+    }
+#endif
+    url_fclose(var->pb);
+    var->pb = NULL;
+}
+
 static void free_variant_list(AppleHTTPContext *c)
 {
     int i;
@@ -139,8 +495,7 @@ static void free_variant_list(AppleHTTPContext *c)
         struct variant *var = c->variants[i];
         free_segment_list(var);
         av_free_packet(&var->pkt);
-        if (var->pb)
-            url_fclose(var->pb);
+        close_segment(c, var);
         if (var->ctx) {
             var->ctx->pb = NULL;
             av_close_input_file(var->ctx);
@@ -168,6 +523,7 @@ static struct variant *new_variant(AppleHTTPContext *c, int bandwidth,
     if (!var)
         return NULL;
     reset_packet(&var->pkt);
+    var->parent    = c;
     var->bandwidth = bandwidth;
     make_absolute_url(var->url, sizeof(var->url), base, url);
     dynarray_add(&c->variants, &c->n_variants, var);
@@ -181,7 +537,7 @@ struct variant_info {
 static void handle_variant_args(struct variant_info *info, const char *key,
                                 int key_len, char **dest, int *dest_len)
 {
-    if (strncmp(key, "BANDWIDTH", key_len)) {
+    if (!strncmp(key, "BANDWIDTH=", key_len)) {
         *dest     =        info->bandwidth;
         *dest_len = sizeof(info->bandwidth);
     }
@@ -194,6 +550,10 @@ static int parse_playlist(AppleHTTPContext *c, const char *url,
     char line[1024];
     const char *ptr;
     int close_in = 0;
+    /* The new segment list is only swapped in once complete, since the
+     * prefetch threads may be using the current one meanwhile. */
+    struct segment **segments = NULL;
+    int n_segments = 0, start_seq_no = 0, i;
 
     if (!in) {
         close_in = 1;
@@ -207,8 +567,6 @@ static int parse_playlist(AppleHTTPContext *c, const char *url,
         goto fail;
     }
 
-    if (var)
-        free_segment_list(var);
     c->finished = 0;
     while (!url_feof(in)) {
         read_chomp_line(in, line, sizeof(line));
@@ -228,7 +586,7 @@ static int parse_playlist(AppleHTTPContext *c, const char *url,
                     goto fail;
                 }
             }
-            var->start_seq_no = atoi(ptr);
+            start_seq_no = atoi(ptr);
         } else if (av_strstart(line, "#EXT-X-ENDLIST", &ptr)) {
             c->finished = 1;
         } else if (av_strstart(line, "#EXTINF:", &ptr)) {
@@ -261,19 +619,51 @@ static int parse_playlist(AppleHTTPContext *c, const char *url,
                 }
                 seg->duration = duration;
                 make_absolute_url(seg->url, sizeof(seg->url), url, line);
-                dynarray_add(&var->segments, &var->n_segments, seg);
+                dynarray_add(&segments, &n_segments, seg);
                 is_segment = 0;
             }
         }
     }
     c->last_load_time = av_gettime();
 
+    if (var) {
+        LOCK(c);
+        free_segment_list(var);
+        var->start_seq_no = start_seq_no;
+        var->segments     = segments;
+        var->n_segments   = n_segments;
+        UNLOCK(c);
+        segments   = NULL;
+        n_segments = 0;
+    }
+
 fail:
+    for (i = 0; i < n_segments; i++)
+        av_free(segments[i]);
+    av_free(segments);
     if (close_in)
         url_fclose(in);
     return ret;
 }
 
+/*
+ * Check whether two variants contain the same streams, so that one can
+ * be fetched instead of the other.
+ */
+static int same_streams(struct variant *a, struct variant *b)
+{
+    int i;
+    if (!a->ctx || !b->ctx || a->ctx->nb_streams != b->ctx->nb_streams)
+        return 0;
+    for (i = 0; i < a->ctx->nb_streams; i++) {
+        AVCodecContext *ca = a->ctx->streams[i]->codec;
+        AVCodecContext *cb = b->ctx->streams[i]->codec;
+        if (ca->codec_type != cb->codec_type || ca->codec_id != cb->codec_id)
+            return 0;
+    }
+    return 1;
+}
+
 static int applehttp_read_header(AVFormatContext *s, AVFormatParameters *ap)
 {
     AppleHTTPContext *c = s->priv_data;
@@ -340,12 +730,31 @@ static int applehttp_read_header(AVFormatContext *s, AVFormatParameters *ap)
     }
     c->last_packet_dts = AV_NOPTS_VALUE;
 
+#if HAVE_PTHREADS
+    start_prefetch(c);
+#endif
+    if ((s->flags & AVFMT_FLAG_ADAPTIVE) && c->n_variants > 1) {
+        if (c->prefetch) {
+            c->adaptive = 1;
+            for (i = 0; i < c->n_variants; i++)
+                c->variants[i]->rendition = same_streams(c->variants[0],
+                                                         c->variants[i]);
+        } else {
+            av_log(s, AV_LOG_WARNING, "Adaptive variant selection "
+                   "needs the prefetch threads, fetching all variants\n");
+        }
+    }
+
     c->cur_seq_no = c->max_start_seq;
     /* If this is a live stream with more than 3 segments, start at the
      * third last segment. */
     if (!c->finished && c->min_end_seq - c->max_start_seq > 3)
         c->cur_seq_no = c->min_end_seq - 2;
 
+#if CONFIG_HTTP_PROTOCOL
+    /* the segments are requested one after another */
+    ff_http_connection_cache_ref();
+#endif
     return 0;
 fail:
     free_variant_list(c);
@@ -364,9 +773,7 @@ static int open_variant(AppleHTTPContext *c, struct variant *var, int skip)
     }
     if (c->cur_seq_no - var->start_seq_no >= var->n_segments)
         return c->finished ? AVERROR_EOF : 0;
-    ret = url_fopen(&var->pb,
-                    var->segments[c->cur_seq_no - var->start_seq_no]->url,
-                    URL_RDONLY);
+    ret = open_segment(c, var, c->cur_seq_no);
     if (ret < 0)
         return ret;
     var->ctx->pb = var->pb;
@@ -390,10 +797,45 @@ static int open_variant(AppleHTTPContext *c, struct variant *var, int skip)
     return 0;
 }
 
+/*
+ * Switch to the rendition with the highest bandwidth that fits within the
+ * measured throughput, with some margin, or the lowest one if none does.
+ */
+static void choose_variant(AVFormatContext *s)
+{
+    AppleHTTPContext *c = s->priv_data;
+    int64_t throughput;
+    int i, best = -1, lowest = -1;
+
+    LOCK(c);
+    throughput = c->throughput;
+    UNLOCK(c);
+    if (!throughput)
+        return;
+    for (i = 0; i < c->n_variants; i++) {
+        struct variant *var = c->variants[i];
+        if (!var->rendition)
+            continue;
+        if (lowest < 0 || var->bandwidth < c->variants[lowest]->bandwidth)
+            lowest = i;
+        if (var->bandwidth <= throughput * 4 / 5 &&
+            (best < 0 || var->bandwidth > c->variants[best]->bandwidth))
+            best = i;
+    }
+    if (best < 0)
+        best = lowest;
+    if (best != c->cur_variant) {
+        av_log(s, AV_LOG_INFO, "Switching to variant %d (%d bit/s), "
+               "measured throughput %"PRId64" bit/s\n",
+               best, c->variants[best]->bandwidth, throughput);
+        c->cur_variant = best;
+    }
+}
+
 static int applehttp_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     AppleHTTPContext *c = s->priv_data;
-    int ret, i, minvariant = -1, first = 1, needed = 0, changed = 0,
+    int ret, i, j, minvariant = -1, first = 1, needed = 0, changed = 0,
         variants = 0;
 
     /* Recheck the discard flags - which streams are desired at the moment */
@@ -412,19 +854,33 @@ static int applehttp_read_packet(AVFormatContext *s, AVPacket *pkt)
     }
     if (!needed)
         return AVERROR_EOF;
+    if (c->adaptive) {
+        /* The renditions are returned on the streams of the first variant,
+         * so they are needed whenever it is. */
+        struct variant *first_var = c->variants[0];
+        for (i = 1; i < c->n_variants; i++) {
+            struct variant *var = c->variants[i];
+            if (!var->rendition)
+                continue;
+            var->needed = first_var->needed;
+            for (j = 0; j < var->ctx->nb_streams; j++)
+                var->ctx->streams[j]->discard =
+                    s->streams[first_var->stream_offset + j]->discard;
+        }
+    }
+    update_prefetch(c);
 start:
     for (i = 0; i < c->n_variants; i++) {
         struct variant *var = c->variants[i];
         /* Close unneeded streams, open newly requested streams */
-        if (var->pb && !var->needed) {
+        if (var->pb && !var->active) {
             av_log(s, AV_LOG_DEBUG,
                    "Closing variant stream %d, no longer needed\n", i);
             av_free_packet(&var->pkt);
             reset_packet(&var->pkt);
-            url_fclose(var->pb);
-            var->pb = NULL;
+            close_segment(c, var);
             changed = 1;
-        } else if (!var->pb && var->needed) {
+        } else if (!var->pb && var->active) {
             if (first)
                 av_log(s, AV_LOG_DEBUG, "Opening variant stream %d\n", i);
             if (first && !c->finished)
@@ -459,25 +915,25 @@ start:
         av_log(s, AV_LOG_INFO, "Receiving %d variant streams\n", variants);
     /* If we got a packet, return it */
     if (minvariant >= 0) {
-        *pkt = c->variants[minvariant]->pkt;
-        pkt->stream_index += c->variants[minvariant]->stream_offset;
-        reset_packet(&c->variants[minvariant]->pkt);
+        struct variant *var = c->variants[minvariant];
+        *pkt = var->pkt;
+        pkt->stream_index += var->rendition ? c->variants[0]->stream_offset :
+                                              var->stream_offset;
+        reset_packet(&var->pkt);
         c->last_packet_dts = pkt->dts;
         return 0;
     }
     /* No more packets - eof reached in all variant streams, close the
      * current segments. */
-    for (i = 0; i < c->n_variants; i++) {
-        struct variant *var = c->variants[i];
-        if (var->pb) {
-            url_fclose(var->pb);
-            var->pb = NULL;
-        }
-    }
+    for (i = 0; i < c->n_variants; i++)
+        close_segment(c, c->variants[i]);
     /* Indicate that we're opening the next segment, not opening a new
      * variant stream in parallel, so we shouldn't try to skip ahead. */
     first = 0;
     c->cur_seq_no++;
+    /* Segment boundaries are where renditions can be switched */
+    if (c->adaptive)
+        choose_variant(s);
 reload:
     if (!c->finished) {
         /* If this is a live stream and target_duration has elapsed since
@@ -505,6 +961,7 @@ reload:
                c->max_start_seq - c->cur_seq_no);
         c->cur_seq_no = c->max_start_seq;
     }
+    update_prefetch(c);
     /* If more segments exit, open the next one */
     if (c->cur_seq_no < c->min_end_seq)
         goto start;
@@ -525,7 +982,19 @@ static int applehttp_close(AVFormatContext *s)
 {
     AppleHTTPContext *c = s->priv_data;
 
+#if HAVE_PTHREADS
+    stop_prefetch(c);
+#endif
     free_variant_list(c);
+#if HAVE_PTHREADS
+    if (c->prefetch) {
+        pthread_mutex_destroy(&c->lock);
+        pthread_cond_destroy(&c->cond);
+    }
+#endif
+#if CONFIG_HTTP_PROTOCOL
+    ff_http_connection_cache_unref();
+#endif
     return 0;
 }
 
@@ -543,10 +1012,7 @@ static int applehttp_read_seek(AVFormatContext *s, int stream_index,
     c->last_packet_dts = AV_NOPTS_VALUE;
     for (i = 0; i < c->n_variants; i++) {
         struct variant *var = c->variants[i];
-        if (var->pb) {
-            url_fclose(var->pb);
-            var->pb = NULL;
-        }
+        close_segment(c, var);
         av_free_packet(&var->pkt);
         reset_packet(&var->pkt);
     }
@@ -559,6 +1025,7 @@ static int applehttp_read_seek(AVFormatContext *s, int stream_index,
     for (i = 0; i < var->n_segments; i++) {
         if (timestamp >= pos && timestamp < pos + var->segments[i]->duration) {
             c->cur_seq_no = var->start_seq_no + i;
+            update_prefetch(c);
             return 0;
         }
         pos += var->segments[i]->duration;
@@ -0,0 +1,306 @@
+/*
+ * Apple HTTP Live Streaming segmenter
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Apple HTTP Live Streaming segmenter
+ * http://tools.ietf.org/html/draft-pantos-http-live-streaming
+ *
+ * The output is written as one MPEG-TS stream by a chained MPEG-TS muxer,
+ * which is switched to a new segment file at the first keyframe after
+ * AVFormatContext.segment_time seconds. The playlist named by the output
+ * filename is rewritten after each completed segment, listing either all
+ * the segments or the last AVFormatContext.segment_list_size ones for a
+ * live sliding window. The segments are named after the playlist, with
+ * the sequence number and a .ts extension instead of its own extension.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include "libavutil/avstring.h"
+#include "libavutil/mathematics.h"
+#include "avformat.h"
+#include "internal.h"
+#include "mpegts.h"
+
+typedef struct PlaylistEntry {
+    int seq_no;
+    int64_t duration;           ///< in AV_TIME_BASE units
+} PlaylistEntry;
+
+typedef struct AppleHTTPMuxContext {
+    AVFormatContext *ts;        ///< chained MPEG-TS muxer, kept across segments
+    char prefix[MAX_URL_SIZE];  ///< segment URLs without number and extension
+    const char *basename;       ///< prefix, relative to the playlist
+    int ref_stream;             ///< stream whose keyframes start the segments
+    int seq_no;                 ///< sequence number of the current segment
+    int64_t start_pts;          ///< start of the current segment
+    int64_t end_pts;            ///< end of the last reference stream packet
+    int target_duration;        ///< largest segment duration, in seconds
+    PlaylistEntry *entries;
+    int nb_entries;
+} AppleHTTPMuxContext;
+
+static int segment_file_no(AVFormatContext *s, int seq_no)
+{
+    return s->segment_wrap ? seq_no % s->segment_wrap : seq_no;
+}
+
+static int open_segment(AVFormatContext *s)
+{
+    AppleHTTPMuxContext *c = s->priv_data;
+    char filename[MAX_URL_SIZE];
+
+    if (snprintf(filename, sizeof(filename), "%s%d.ts", c->prefix,
+                 segment_file_no(s, c->seq_no)) >= sizeof(filename)) {
+        av_log(s, AV_LOG_ERROR, "Segment file name too long\n");
+        return AVERROR(EINVAL);
+    }
+    return url_fopen(&c->ts->pb, filename, URL_WRONLY);
+}
+
+static int write_playlist(AVFormatContext *s, int last)
+{
+    AppleHTTPMuxContext *c = s->priv_data;
+    char tmp[MAX_URL_SIZE];
+    const char *path = s->filename;
+    ByteIOContext *pb;
+    int i, ret, local;
+
+    /* Local playlists are written to a temporary file renamed over the
+     * old one, so that clients polling them never get a partial one. */
+    av_strstart(path, "file:", &path);
+    local = !strchr(path, ':');
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    if ((ret = url_fopen(&pb, local ? tmp : s->filename, URL_WRONLY)) < 0)
+        return ret;
+    url_fprintf(pb, "#EXTM3U\n");
+    url_fprintf(pb, "#EXT-X-TARGETDURATION:%d\n", c->target_duration);
+    url_fprintf(pb, "#EXT-X-MEDIA-SEQUENCE:%d\n",
+                c->nb_entries ? c->entries[0].seq_no : 0);
+    for (i = 0; i < c->nb_entries; i++) {
+        PlaylistEntry *e = &c->entries[i];
+        url_fprintf(pb, "#EXTINF:%d,\n%s%d.ts\n",
+                    (int)((e->duration + AV_TIME_BASE / 2) / AV_TIME_BASE),
+                    c->basename, segment_file_no(s, e->seq_no));
+    }
+    if (last)
+        url_fprintf(pb, "#EXT-X-ENDLIST\n");
+    put_flush_packet(pb);
+    ret = url_ferror(pb);
+    url_fclose(pb);
+    if (ret < 0)
+        return ret;
+
+    if (local && rename(tmp, path) < 0)
+        return AVERROR(errno);
+    return 0;
+}
+
+static int add_entry(AVFormatContext *s, int64_t duration)
+{
+    AppleHTTPMuxContext *c = s->priv_data;
+    PlaylistEntry *entries;
+
+    if (s->segment_list_size && c->nb_entries == s->segment_list_size) {
+        memmove(c->entries, c->entries + 1,
+                (c->nb_entries - 1) * sizeof(*c->entries));
+        c->nb_entries--;
+    } else {
+        entries = av_realloc(c->entries,
+                             (c->nb_entries + 1) * sizeof(*c->entries));
+        if (!entries)
+            return AVERROR(ENOMEM);
+        c->entries = entries;
+    }
+    c->entries[c->nb_entries].seq_no   = c->seq_no;
+    c->entries[c->nb_entries].duration = duration;
+    c->nb_entries++;
+    c->target_duration = FFMAX(c->target_duration,
+                               (duration + AV_TIME_BASE - 1) / AV_TIME_BASE);
+    return 0;
+}
+
+/**
+ * Close the current segment at end_pts, list it in the playlist and
+ * start the next one.
+ */
+static int next_segment(AVFormatContext *s, int64_t end_pts)
+{
+    AppleHTTPMuxContext *c = s->priv_data;
+    int ret;
+
+    ff_mpegts_end_segment(c->ts);
+    url_fclose(c->ts->pb);
+    c->ts->pb = NULL;
+
+    if ((ret = add_entry(s, end_pts - c->start_pts)) < 0 ||
+        (ret = write_playlist(s, 0)) < 0)
+        return ret;
+
+    c->seq_no++;
+    c->start_pts = end_pts;
+    return open_segment(s);
+}
+
+static void free_chained(AppleHTTPMuxContext *c)
+{
+    AVFormatContext *ts = c->ts;
+    int i;
+
+    if (!ts)
+        return;
+    if (ts->pb)
+        url_fclose(ts->pb);
+    for (i = 0; i < ts->nb_streams; i++) {
+        av_metadata_free(&ts->streams[i]->metadata);
+        av_free(ts->streams[i]->priv_data);
+        av_free(ts->streams[i]);
+    }
+    av_metadata_free(&ts->metadata);
+    av_free(ts->priv_data);
+    av_freep(&c->ts);
+}
+
+static int applehttp_write_header(AVFormatContext *s)
+{
+    AppleHTTPMuxContext *c = s->priv_data;
+    AVOutputFormat *ts_format = av_guess_format("mpegts", NULL, NULL);
+    AVFormatContext *ts;
+    AVMetadataTag *tag = NULL;
+    char *ext;
+    int i, ret;
+
+    if (!ts_format)
+        return AVERROR(ENOSYS);
+    if (s->segment_wrap && s->segment_wrap <= s->segment_list_size)
+        av_log(s, AV_LOG_WARNING, "segment_wrap should be larger than "
+               "segment_list_size, listed segments will be overwritten\n");
+
+    av_strlcpy(c->prefix, s->filename, sizeof(c->prefix));
+    ext = strrchr(c->prefix, '.');
+    if (ext && !strchr(ext, '/'))
+        *ext = '\0';
+    c->basename = strrchr(c->prefix, '/');
+    if (c->basename)
+        c->basename++;
+    else if (!av_strstart(c->prefix, "file:", &c->basename))
+        c->basename = c->prefix;
+
+    c->ref_stream = 0;
+    for (i = 0; i < s->nb_streams; i++) {
+        if (s->streams[i]->codec->codec_type == AVMEDIA_TYPE_VIDEO) {
+            c->ref_stream = i;
+            break;
+        }
+    }
+    c->start_pts       = AV_NOPTS_VALUE;
+    c->end_pts         = AV_NOPTS_VALUE;
+    c->target_duration = s->segment_time;
+
+    ts = c->ts = avformat_alloc_context();
+    if (!ts)
+        return AVERROR(ENOMEM);
+    ts->oformat   = ts_format;
+    ts->max_delay = s->max_delay;
+    ts->mux_rate  = s->mux_rate;
+    while ((tag = av_metadata_get(s->metadata, "", tag,
+                                  AV_METADATA_IGNORE_SUFFIX)))
+        av_metadata_set2(&ts->metadata, tag->key, tag->value, 0);
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = av_new_stream(ts, 0);
+        if (!st) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        /* Share the codec contexts, the MPEG-TS muxer only reads them. */
+        av_free(st->codec);
+        st->codec               = s->streams[i]->codec;
+        st->sample_aspect_ratio = s->streams[i]->sample_aspect_ratio;
+    }
+
+    if ((ret = open_segment(s)) < 0 ||
+        (ret = av_write_header(ts)) < 0)
+        goto fail;
+
+    for (i = 0; i < s->nb_streams; i++)
+        s->streams[i]->time_base = ts->streams[i]->time_base;
+    return 0;
+fail:
+    free_chained(c);
+    return ret;
+}
+
+static int applehttp_write_packet(AVFormatContext *s, AVPacket *pkt)
+{
+    AppleHTTPMuxContext *c = s->priv_data;
+    AVStream *st = s->streams[pkt->stream_index];
+    int ret;
+
+    if (pkt->stream_index == c->ref_stream && pkt->pts != AV_NOPTS_VALUE) {
+        int64_t pts = av_rescale_q(pkt->pts, st->time_base, AV_TIME_BASE_Q);
+        int random_access = (pkt->flags & AV_PKT_FLAG_KEY) ||
+                            st->codec->codec_type != AVMEDIA_TYPE_VIDEO;
+
+        if (c->start_pts == AV_NOPTS_VALUE) {
+            c->start_pts = pts;
+        } else if (random_access &&
+                   pts - c->start_pts >= s->segment_time * (int64_t)AV_TIME_BASE) {
+            if ((ret = next_segment(s, pts)) < 0)
+                return ret;
+        }
+        pts += av_rescale_q(pkt->duration, st->time_base, AV_TIME_BASE_Q);
+        if (c->end_pts == AV_NOPTS_VALUE || pts > c->end_pts)
+            c->end_pts = pts;
+    }
+    return ff_write_chained(c->ts, pkt->stream_index, pkt, s);
+}
+
+static int applehttp_write_trailer(AVFormatContext *s)
+{
+    AppleHTTPMuxContext *c = s->priv_data;
+    int ret = AVERROR(EIO);
+
+    /* the chained muxer has no output left if opening a segment failed */
+    if (c->ts->pb && (ret = av_write_trailer(c->ts)) >= 0)
+        ret = url_ferror(c->ts->pb);
+    if (ret >= 0 && c->start_pts != AV_NOPTS_VALUE) {
+        if ((ret = add_entry(s, c->end_pts - c->start_pts)) >= 0)
+            ret = write_playlist(s, 1);
+    }
+    free_chained(c);
+    av_freep(&c->entries);
+    return ret;
+}
+
+AVOutputFormat applehttp_muxer = {
+    "applehttp",
+    NULL_IF_CONFIG_SMALL("Apple HTTP Live Streaming format"),
+    "application/vnd.apple.mpegurl",
+    "m3u8",
+    sizeof(AppleHTTPMuxContext),
+    CODEC_ID_MP2,
+    CODEC_ID_MPEG2VIDEO,
+    applehttp_write_header,
+    applehttp_write_packet,
+    applehttp_write_trailer,
+    .flags = AVFMT_NOFILE,
+};
@@ -22,7 +22,7 @@
 #define AVFORMAT_AVFORMAT_H
 
 #define LIBAVFORMAT_VERSION_MAJOR 52
-#define LIBAVFORMAT_VERSION_MINOR 84
+#define LIBAVFORMAT_VERSION_MINOR 90
 #define LIBAVFORMAT_VERSION_MICRO  0
 
 #define LIBAVFORMAT_VERSION_INT AV_VERSION_INT(LIBAVFORMAT_VERSION_MAJOR, \
@@ -803,6 +803,9 @@ typedef struct AVFormatContext {
 #define AVFMT_FLAG_NOFILLIN     0x0010 ///< Do not infer any values from other values, just return what is stored in the container
 #define AVFMT_FLAG_NOPARSE      0x0020 ///< Do not use AVParsers, you also must set AVFMT_FLAG_NOFILLIN as the fillin code works on frames and no parsing -> no frames. Also seeking to frames can not work if parsing to find frame boundaries has been disabled
 #define AVFMT_FLAG_RTP_HINT     0x0040 ///< Add RTP hinting to the output file
+#define AVFMT_FLAG_GENIDX       0x0080 ///< Build the generic keyframe index while reading, even if the demuxer does not use it
+#define AVFMT_FLAG_PACED        0x0100 ///< Send the output at the pace given by its timestamps instead of as fast as possible
+#define AVFMT_FLAG_ADAPTIVE     0x0200 ///< Fetch only the variant of a multi-bitrate stream that fits the measured throughput
 
     int loop_input;
 
@@ -896,6 +899,45 @@ typedef struct AVFormatContext {
      * - decoding: Unused.
      */
     int64_t start_time_realtime;
+
+    /**
+     * Seek index file to preload when the input is opened, see
+     * av_read_index_file().
+     * - encoding: unused
+     * - decoding: Set by user.
+     */
+    char *index_filename;
+
+    /**
+     * Index loaded from a seek index file, kept until all its streams
+     * have been created by the demuxer.
+     * NOT PART OF PUBLIC API
+     */
+    struct AVIndexFile *index_file;
+
+    /**
+     * Target duration of the segments written by segmenting muxers, in
+     * seconds. Segments are cut at the first keyframe after it.
+     * - encoding: Set by user.
+     * - decoding: unused
+     */
+    int segment_time;
+
+    /**
+     * Maximum number of segments listed in the playlist of segmenting
+     * muxers, for a live sliding window. 0 lists all of them.
+     * - encoding: Set by user.
+     * - decoding: unused
+     */
+    int segment_list_size;
+
+    /**
+     * Number of segment files after which segmenting muxers wrap around
+     * and overwrite the oldest ones. 0 never wraps.
+     * - encoding: Set by user.
+     * - decoding: unused
+     */
+    int segment_wrap;
 } AVFormatContext;
 
 typedef struct AVPacketList {
@@ -1305,6 +1347,31 @@ void ff_reduce_index(AVFormatContext *s, int stream_index);
 int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                        int size, int distance, int flags);
 
+/**
+ * Store the index entries, start time and duration of all streams of s
+ * in a seek index file.
+ *
+ * The file can be given back to av_read_index_file() (or through the
+ * AVFormatContext.index_filename option) when opening the same input
+ * again, which avoids rebuilding the index by bisecting the input.
+ *
+ * @param filename URL of the index file to write
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_write_index_file(AVFormatContext *s, const char *filename);
+
+/**
+ * Preload a seek index file written by av_write_index_file().
+ *
+ * Entries for streams which the demuxer has not created yet are added
+ * as soon as the stream shows up. The file is ignored if it was written
+ * for an input of a different size.
+ *
+ * @param filename URL of the index file to read
+ * @return 0 on success, a negative AVERROR code on failure
+ */
+int av_read_index_file(AVFormatContext *s, const char *filename);
+
 /**
  * Perform a binary search using av_index_search_timestamp() and
  * AVInputFormat.read_timestamp().
@@ -255,6 +255,44 @@ int url_write(URLContext *h, const unsigned char *buf, int size)
     return retry_transfer_wrapper(h, buf, size, h->prot->url_write);
 }
 
+int url_write_packets(URLContext *h, const URLPacket *pkts, int nb_packets)
+{
+    uint8_t *buf = NULL;
+    unsigned int buf_size = 0;
+    int i, size, ret = 0;
+
+    if (!(h->flags & (URL_WRONLY | URL_RDWR)))
+        return AVERROR(EIO);
+    for (i = 0; i < nb_packets; i++)
+        if (h->max_packet_size &&
+            pkts[i].header_size + pkts[i].size > h->max_packet_size)
+            return AVERROR(EIO);
+
+    if (h->prot->url_write_packets)
+        return h->prot->url_write_packets(h, pkts, nb_packets);
+
+    for (i = 0; i < nb_packets && ret >= 0; i++) {
+        const URLPacket *pkt = &pkts[i];
+
+        size = pkt->header_size + pkt->size;
+        if (!pkt->size) {
+            ret = url_write(h, pkt->header, size);
+        } else if (!pkt->header_size) {
+            ret = url_write(h, pkt->data, size);
+        } else {
+            /* each packet must be a single url_write() call */
+            av_fast_malloc(&buf, &buf_size, size);
+            if (!buf)
+                return AVERROR(ENOMEM);
+            memcpy(buf, pkt->header, pkt->header_size);
+            memcpy(buf + pkt->header_size, pkt->data, pkt->size);
+            ret = url_write(h, buf, size);
+        }
+    }
+    av_free(buf);
+    return ret < 0 ? ret : 0;
+}
+
 int64_t url_seek(URLContext *h, int64_t pos, int whence)
 {
     int64_t ret;
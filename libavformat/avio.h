@@ -141,6 +141,28 @@ int url_read_complete(URLContext *h, unsigned char *buf, int size);
  */
 int url_write(URLContext *h, const unsigned char *buf, int size);
 
+/**
+ * A packet written by url_write_packets(), made of a header and a
+ * payload sent back to back without being copied together.
+ * Either part may be empty. The buffers are not modified.
+ */
+typedef struct URLPacket {
+    unsigned char *header;
+    int header_size;
+    unsigned char *data;
+    int size;
+} URLPacket;
+
+/**
+ * Write nb_packets packets to the resource accessed by h, each one as if
+ * written by its own url_write() call. Protocols supporting it send them
+ * with a single system call, the others are written one after another.
+ *
+ * @return 0 if all packets were written, or a negative value
+ * corresponding to an AVERROR code in case of failure
+ */
+int url_write_packets(URLContext *h, const URLPacket *pkts, int nb_packets);
+
 /**
  * Passing this as the "whence" parameter to a seek function causes it to
  * return the filesize without seeking anywhere. Supporting this is optional.
@@ -271,6 +293,7 @@ typedef struct URLProtocol {
     int (*url_get_file_handle)(URLContext *h);
     int priv_data_size;
     const AVClass *priv_data_class;
+    int (*url_write_packets)(URLContext *h, const URLPacket *pkts, int nb_packets);
 } URLProtocol;
 
 #if FF_API_REGISTER_PROTOCOL
@@ -435,6 +458,17 @@ int get_buffer(ByteIOContext *s, unsigned char *buf, int size);
  */
 int get_partial_buffer(ByteIOContext *s, unsigned char *buf, int size);
 
+/**
+ * Read size bytes from ByteIOContext without copying them if possible.
+ * If the bytes are already buffered, *data points into the internal
+ * buffer and stays valid until the next read from s, otherwise they are
+ * read into buf and *data is set to buf.
+ * @note This function is NOT part of the public API
+ * @return number of bytes read or AVERROR
+ */
+int ff_get_buffer_indirect(ByteIOContext *s, unsigned char *buf, int size,
+                           const unsigned char **data);
+
 /** @note return 0 if EOF, so you cannot use it if EOF handling is
     necessary */
 int get_byte(ByteIOContext *s);
@@ -453,6 +453,18 @@ int get_buffer(ByteIOContext *s, unsigned char *buf, int size)
     return size1 - size;
 }
 
+int ff_get_buffer_indirect(ByteIOContext *s, unsigned char *buf, int size,
+                           const unsigned char **data)
+{
+    if (s->buf_end - s->buf_ptr >= size && !s->write_flag) {
+        *data = s->buf_ptr;
+        s->buf_ptr += size;
+        return size;
+    }
+    *data = buf;
+    return get_buffer(s, buf, size);
+}
+
 int get_partial_buffer(ByteIOContext *s, unsigned char *buf, int size)
 {
     int len;
@@ -724,6 +736,14 @@ URLContext *url_fileno(ByteIOContext *s)
     return s->opaque;
 }
 
+URLContext *ff_url_context(ByteIOContext *s)
+{
+    if (s->write_packet != (int (*)(void *, uint8_t *, int))url_write &&
+        s->read_packet  != (int (*)(void *, uint8_t *, int))url_read)
+        return NULL;
+    return s->opaque;
+}
+
 #if CONFIG_MUXERS
 int url_fprintf(ByteIOContext *s, const char *fmt, ...)
 {
@@ -29,6 +29,13 @@
 #include "os_support.h"
 #include "httpauth.h"
 #include "libavutil/opt.h"
+#if HAVE_SYS_SELECT_H
+#include <sys/select.h>
+#endif
+#include <sys/time.h>
+#if HAVE_PTHREADS
+#include <pthread.h>
+#endif
 
 /* XXX: POST protocol is not completely implemented because ffmpeg uses
    only a subset of it. */
@@ -37,6 +44,14 @@
 #define BUFFER_SIZE 1024
 #define MAX_REDIRECTS 8
 
+/* forward seeks and response remainders up to this size are read through
+ * instead of issuing a new request */
+#define MAX_DRAIN_SIZE (64 * 1024)
+
+/* idle persistent connections kept for later requests to the same host */
+#define MAX_CACHED_CONNECTIONS 8
+#define CONNECTION_IDLE_TIMEOUT (10 * 1000000)
+
 typedef struct {
     const AVClass *class;
     URLContext *hd;
@@ -49,8 +64,143 @@ typedef struct {
     HTTPAuthState auth_state;
     unsigned char headers[BUFFER_SIZE];
     int willclose;          /**< Set if the server correctly handles Connection: close and will close the connection after feeding us the content. */
+    int keepalive;          /**< Set if the server keeps the connection open after the response. */
+    int end_chunked;        /**< Set once the last chunk of a chunked response has been read. */
+    char hd_key[1024];      /**< tcp URL of hd, identifying it in the connection cache */
 } HTTPContext;
 
+typedef struct {
+    char key[1024];
+    URLContext *hd;
+    int64_t idle_since;
+} HTTPCachedConnection;
+
+static HTTPCachedConnection connection_cache[MAX_CACHED_CONNECTIONS];
+static int connection_cache_users;
+#if HAVE_PTHREADS
+static pthread_mutex_t connection_cache_lock = PTHREAD_MUTEX_INITIALIZER;
+#define connection_cache_lock()   pthread_mutex_lock  (&connection_cache_lock)
+#define connection_cache_unlock() pthread_mutex_unlock(&connection_cache_lock)
+#else
+#define connection_cache_lock()
+#define connection_cache_unlock()
+#endif
+
+/**
+ * Check that an idle connection has not been closed by the server,
+ * in which case it would be readable.
+ */
+static int connection_is_alive(URLContext *hd)
+{
+    int fd = url_get_file_handle(hd);
+    fd_set rfds;
+    struct timeval tv = { 0 };
+
+    if (fd < 0)
+        return 0;
+    FD_ZERO(&rfds);
+    FD_SET(fd, &rfds);
+    return select(fd + 1, &rfds, NULL, NULL, &tv) == 0;
+}
+
+/**
+ * Take an idle connection to the given tcp URL out of the cache.
+ * @return the connection or NULL if there is none
+ */
+static URLContext *connection_cache_get(const char *key)
+{
+    int64_t now = av_gettime();
+    URLContext *hd = NULL, *expired[MAX_CACHED_CONNECTIONS];
+    int i, nb_expired = 0;
+
+    connection_cache_lock();
+    for (i = 0; i < MAX_CACHED_CONNECTIONS; i++) {
+        HTTPCachedConnection *c = &connection_cache[i];
+        if (!c->hd)
+            continue;
+        if (now - c->idle_since > CONNECTION_IDLE_TIMEOUT) {
+            expired[nb_expired++] = c->hd;
+            c->hd = NULL;
+        } else if (!hd && !strcmp(c->key, key)) {
+            hd = c->hd;
+            c->hd = NULL;
+        }
+    }
+    connection_cache_unlock();
+
+    for (i = 0; i < nb_expired; i++)
+        url_close(expired[i]);
+    if (hd && !connection_is_alive(hd)) {
+        url_close(hd);
+        hd = NULL;
+    }
+    return hd;
+}
+
+/**
+ * Keep an idle connection for later requests, evicting the connection
+ * idle for the longest time if the cache is full. Expired connections
+ * are closed as well.
+ */
+static void connection_cache_put(const char *key, URLContext *hd)
+{
+    int64_t now = av_gettime();
+    URLContext *evicted[MAX_CACHED_CONNECTIONS];
+    int i, slot = 0, nb_evicted = 0;
+
+    connection_cache_lock();
+    for (i = 0; i < MAX_CACHED_CONNECTIONS; i++) {
+        HTTPCachedConnection *c = &connection_cache[i];
+        if (c->hd && now - c->idle_since > CONNECTION_IDLE_TIMEOUT) {
+            evicted[nb_evicted++] = c->hd;
+            c->hd = NULL;
+        }
+    }
+    for (i = 0; i < MAX_CACHED_CONNECTIONS; i++) {
+        if (!connection_cache[i].hd) {
+            slot = i;
+            break;
+        }
+        if (connection_cache[i].idle_since < connection_cache[slot].idle_since)
+            slot = i;
+    }
+    if (connection_cache[slot].hd)
+        evicted[nb_evicted++] = connection_cache[slot].hd;
+    av_strlcpy(connection_cache[slot].key, key, sizeof(connection_cache[slot].key));
+    connection_cache[slot].hd         = hd;
+    connection_cache[slot].idle_since = now;
+    connection_cache_unlock();
+
+    for (i = 0; i < nb_evicted; i++)
+        url_close(evicted[i]);
+}
+
+void ff_http_connection_cache_ref(void)
+{
+    connection_cache_lock();
+    connection_cache_users++;
+    connection_cache_unlock();
+}
+
+void ff_http_connection_cache_unref(void)
+{
+    URLContext *idle[MAX_CACHED_CONNECTIONS];
+    int i, nb_idle = 0;
+
+    connection_cache_lock();
+    if (!--connection_cache_users) {
+        for (i = 0; i < MAX_CACHED_CONNECTIONS; i++) {
+            if (connection_cache[i].hd)
+                idle[nb_idle++] = connection_cache[i].hd;
+            connection_cache[i].hd = NULL;
+        }
+    }
+    connection_cache_unlock();
+
+    for (i = 0; i < nb_idle; i++)
+        url_close(idle[i]);
+}
+
 #define OFFSET(x) offsetof(HTTPContext, x)
 static const AVOption options[] = {
 {"chunksize", "use chunked transfer-encoding for posts, -1 disables it, 0 enables it", OFFSET(chunksize), FF_OPT_TYPE_INT64, 0, -1, 0 }, /* Default to 0, for chunked POSTs */
@@ -93,7 +243,7 @@ static int http_open_cnx(URLContext *h)
     char auth[1024];
     char path1[1024];
     char buf[1024];
-    int port, use_proxy, err, location_changed = 0, redirects = 0;
+    int port, use_proxy, err, location_changed = 0, redirects = 0, reused;
     HTTPAuthType cur_auth_type;
     HTTPContext *s = h->priv_data;
     URLContext *hd = NULL;
@@ -123,14 +273,27 @@ static int http_open_cnx(URLContext *h)
         port = 80;
 
     ff_url_join(buf, sizeof(buf), "tcp", NULL, hostname, port, NULL);
-    err = url_open(&hd, buf, URL_RDWR);
-    if (err < 0)
-        goto fail;
+    hd = h->flags & URL_WRONLY ? NULL : connection_cache_get(buf);
+    reused = !!hd;
+    if (!hd) {
+        err = url_open(&hd, buf, URL_RDWR);
+        if (err < 0)
+            goto fail;
+    }
 
     s->hd = hd;
+    av_strlcpy(s->hd_key, buf, sizeof(s->hd_key));
     cur_auth_type = s->auth_state.auth_type;
-    if (http_connect(h, path, hoststr, auth, &location_changed) < 0)
+    s->line_count = 0;
+    if (http_connect(h, path, hoststr, auth, &location_changed) < 0) {
+        if (reused && !s->line_count) {
+            /* the server dropped the idle connection, use a new one */
+            url_close(hd);
+            hd = NULL;
+            goto redo;
+        }
         goto fail;
+    }
     if (s->http_code == 401) {
         if (cur_auth_type == HTTP_AUTH_NONE && s->auth_state.auth_type != HTTP_AUTH_NONE) {
             url_close(hd);
@@ -158,13 +321,18 @@ static int http_open_cnx(URLContext *h)
 static int http_open(URLContext *h, const char *uri, int flags)
 {
     HTTPContext *s = h->priv_data;
+    int ret;
 
     h->is_streamed = 1;
 
     s->filesize = -1;
     av_strlcpy(s->location, uri, sizeof(s->location));
 
-    return http_open_cnx(h);
+    ff_http_connection_cache_ref();
+    ret = http_open_cnx(h);
+    if (ret < 0)
+        ff_http_connection_cache_unref();
+    return ret;
 }
 static int http_getc(HTTPContext *s)
 {
@@ -224,6 +392,7 @@ static int process_line(URLContext *h, char *line, int line_count,
         while (isspace(*p))
             p++;
         s->http_code = strtol(p, &end, 10);
+        s->keepalive = av_strstart(line, "HTTP/1.1", NULL);
 
         dprintf(NULL, "http_code=%d\n", s->http_code);
 
@@ -271,6 +440,8 @@ static int process_line(URLContext *h, char *line, int line_count,
         } else if (!strcmp (tag, "Connection")) {
             if (!strcmp(p, "close"))
                 s->willclose = 1;
+            else if (!strcasecmp(p, "keep-alive"))
+                s->keepalive = 1;
         }
     }
     return 1;
@@ -310,7 +481,8 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
         len += av_strlcatf(headers + len, sizeof(headers) - len,
                            "Range: bytes=%"PRId64"-\r\n", s->off);
     if (!has_header(s->headers, "\r\nConnection: "))
-        len += av_strlcpy(headers + len, "Connection: close\r\n",
+        len += av_strlcpy(headers + len, post ? "Connection: close\r\n" :
+                                                "Connection: keep-alive\r\n",
                           sizeof(headers)-len);
     if (!has_header(s->headers, "\r\nHost: "))
         len += av_strlcatf(headers + len, sizeof(headers) - len,
@@ -342,6 +514,8 @@ static int http_connect(URLContext *h, const char *path, const char *hoststr,
     s->off = 0;
     s->filesize = -1;
     s->willclose = 0;
+    s->keepalive = 0;
+    s->end_chunked = 0;
     if (post) {
         /* Pretend that it did work. We didn't read any header yet, since
          * we've still to send the POST data, but the code calling this
@@ -376,6 +550,8 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
     int len;
 
     if (s->chunksize >= 0) {
+        if (s->end_chunked)
+            return 0;
         if (!s->chunksize) {
             char line[32];
 
@@ -389,8 +565,16 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
 
                 dprintf(NULL, "Chunked encoding data size: %"PRId64"'\n", s->chunksize);
 
-                if (!s->chunksize)
+                if (!s->chunksize) {
+                    /* skip the trailer, leaving the connection ready for
+                     * the next request */
+                    do {
+                        if (http_get_line(s, line, sizeof(line)) < 0)
+                            return AVERROR(EIO);
+                    } while (*line);
+                    s->end_chunked = 1;
                     return 0;
+                }
                 break;
             }
         }
@@ -406,6 +590,8 @@ static int http_read(URLContext *h, uint8_t *buf, int size)
     } else {
         if (!s->willclose && s->filesize >= 0 && s->off >= s->filesize)
             return AVERROR_EOF;
+        if (!s->hd)
+            return AVERROR(EIO);
         len = url_read(s->hd, buf, size);
     }
     if (len > 0) {
@@ -443,6 +629,75 @@ static int http_write(URLContext *h, const uint8_t *buf, int size)
     return size;
 }
 
+/**
+ * Read the rest of the current response if it is short enough, so that
+ * its connection can serve another request.
+ * @return non zero if the connection can be reused; if it cannot, it is
+ *         left untouched or, when draining it failed, closed
+ */
+static int http_finish_response(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+    uint8_t buf[BUFFER_SIZE];
+    int64_t drained = 0;
+    int len;
+
+    if (!s->hd || !s->keepalive || s->willclose || (h->flags & URL_WRONLY))
+        return 0;
+    if (s->chunksize < 0) {
+        if (s->filesize < 0 || s->filesize - s->off > MAX_DRAIN_SIZE)
+            return 0;
+        while (s->off < s->filesize)
+            if (http_read(h, buf, FFMIN(sizeof(buf), s->filesize - s->off)) <= 0)
+                goto fail;
+    } else {
+        while (!s->end_chunked) {
+            len = http_read(h, buf, sizeof(buf));
+            if (len < 0 || (!len && !s->end_chunked) ||
+                (drained += len) > MAX_DRAIN_SIZE)
+                goto fail;
+        }
+    }
+    if (s->buf_ptr == s->buf_end)
+        return 1;
+fail:
+    url_close(s->hd);
+    s->hd = NULL;
+    return 0;
+}
+
+/**
+ * @return non zero if the current response has been read completely, so
+ *         that its connection can serve another request without draining
+ */
+static int http_response_complete(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+
+    if (!s->hd || !s->keepalive || s->willclose || (h->flags & URL_WRONLY) ||
+        s->buf_ptr != s->buf_end)
+        return 0;
+    if (s->chunksize < 0)
+        return s->filesize >= 0 && s->off >= s->filesize;
+    return s->end_chunked;
+}
+
+/**
+ * Close the connection of the current response, or keep it for reuse.
+ */
+static void http_release_connection(URLContext *h)
+{
+    HTTPContext *s = h->priv_data;
+
+    if (!s->hd)
+        return;
+    if (http_finish_response(h))
+        connection_cache_put(s->hd_key, s->hd);
+    else if (s->hd)
+        url_close(s->hd);
+    s->hd = NULL;
+}
+
 static int http_close(URLContext *h)
 {
     int ret = 0;
@@ -455,16 +710,17 @@ static int http_close(URLContext *h)
         ret = ret > 0 ? 0 : ret;
     }
 
-    if (s->hd)
-        url_close(s->hd);
+    http_release_connection(h);
+    ff_http_connection_cache_unref();
     return ret;
 }
 
 static int64_t http_seek(URLContext *h, int64_t off, int whence)
 {
     HTTPContext *s = h->priv_data;
-    URLContext *old_hd = s->hd;
-    int64_t old_off = s->off;
+    URLContext *old_hd;
+    int64_t old_off = s->off, old_filesize, old_chunksize;
+    int old_willclose, old_keepalive, old_end_chunked;
     uint8_t old_buf[BUFFER_SIZE];
     int old_buf_size;
 
@@ -473,26 +729,59 @@ static int64_t http_seek(URLContext *h, int64_t off, int whence)
     else if ((s->filesize == -1 && whence == SEEK_END) || h->is_streamed)
         return -1;
 
-    /* we save the old context in case the seek fails */
-    old_buf_size = s->buf_end - s->buf_ptr;
-    memcpy(old_buf, s->buf_ptr, old_buf_size);
-    s->hd = NULL;
     if (whence == SEEK_CUR)
         off += s->off;
     else if (whence == SEEK_END)
         off += s->filesize;
+
+    /* short forward seeks are cheaper to read through */
+    if (off >= s->off && off - s->off <= MAX_DRAIN_SIZE &&
+        s->chunksize < 0 && (s->filesize < 0 || off <= s->filesize)) {
+        uint8_t buf[BUFFER_SIZE];
+        while (s->off < off)
+            if (http_read(h, buf, FFMIN(sizeof(buf), off - s->off)) <= 0)
+                break;
+        if (s->off == off)
+            return off;
+        old_off = s->off;
+    }
+
+    /* we save the old context in case the seek fails */
+    old_hd          = s->hd;
+    old_buf_size    = s->buf_end - s->buf_ptr;
+    memcpy(old_buf, s->buf_ptr, old_buf_size);
+    old_filesize    = s->filesize;
+    old_chunksize   = s->chunksize;
+    old_willclose   = s->willclose;
+    old_keepalive   = s->keepalive;
+    old_end_chunked = s->end_chunked;
+
+    /* A response which has been read completely leaves its connection to
+     * the new request: at the old position there is nothing left to read,
+     * which the restored response state reports without a connection. */
+    if (http_response_complete(h)) {
+        connection_cache_put(s->hd_key, s->hd);
+        old_hd = NULL;
+    }
+    s->hd = NULL;
     s->off = off;
 
     /* if it fails, continue on old connection */
     if (http_open_cnx(h) < 0) {
         memcpy(s->buffer, old_buf, old_buf_size);
-        s->buf_ptr = s->buffer;
-        s->buf_end = s->buffer + old_buf_size;
-        s->hd = old_hd;
-        s->off = old_off;
+        s->buf_ptr     = s->buffer;
+        s->buf_end     = s->buffer + old_buf_size;
+        s->hd          = old_hd;
+        s->off         = old_off;
+        s->filesize    = old_filesize;
+        s->chunksize   = old_chunksize;
+        s->willclose   = old_willclose;
+        s->keepalive   = old_keepalive;
+        s->end_chunked = old_end_chunked;
         return -1;
     }
-    url_close(old_hd);
+    if (old_hd)
+        url_close(old_hd);
     return off;
 }
 
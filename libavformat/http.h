@@ -61,4 +61,17 @@ void ff_http_set_chunked_transfer_encoding(URLContext *h, int is_chunked);
  */
 void ff_http_init_auth_state(URLContext *dest, const URLContext *src);
 
+/**
+ * Keep the idle connections of finished HTTP requests for reuse.
+ * Each open HTTP URLContext holds a reference; other users can hold one
+ * to keep connections alive between requests that do not overlap. The
+ * idle connections are closed when the last reference is released.
+ */
+void ff_http_connection_cache_ref(void);
+
+/**
+ * Release a reference taken by ff_http_connection_cache_ref().
+ */
+void ff_http_connection_cache_unref(void);
+
 #endif /* AVFORMAT_HTTP_H */
@@ -0,0 +1,245 @@
+/*
+ * seek index files
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Storing and preloading of the demuxer seek index.
+ *
+ * File layout, all values big-endian:
+ *   "FFIX", version, file size of the indexed input, start_time, duration,
+ *   number of streams, then for each stream:
+ *     index, id, time_base, start_time, duration, number of entries,
+ *     then for each entry: pos, timestamp, flags and size, min_distance
+ */
+
+#include "libavutil/mathematics.h"
+#include "avformat.h"
+#include "internal.h"
+
+#define INDEX_FILE_VERSION 1
+
+typedef struct IndexFileStream {
+    int index;
+    int id;
+    AVRational time_base;
+    int64_t start_time;
+    int64_t duration;
+    int nb_entries;
+    AVIndexEntry *entries;
+    int applied;
+} IndexFileStream;
+
+typedef struct AVIndexFile {
+    int64_t start_time;
+    int64_t duration;
+    int nb_streams;
+    IndexFileStream *streams;
+    int has_timings;        ///< at least one stream has a stored duration
+} AVIndexFile;
+
+int av_write_index_file(AVFormatContext *s, const char *filename)
+{
+    ByteIOContext *pb;
+    int i, j, ret;
+
+    if ((ret = url_fopen(&pb, filename, URL_WRONLY)) < 0)
+        return ret;
+
+    put_tag(pb, "FFIX");
+    put_be32(pb, INDEX_FILE_VERSION);
+    put_be64(pb, s->file_size);
+    put_be64(pb, s->start_time);
+    put_be64(pb, s->duration);
+    put_be32(pb, s->nb_streams);
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+
+        put_be32(pb, st->index);
+        put_be32(pb, st->id);
+        put_be32(pb, st->time_base.num);
+        put_be32(pb, st->time_base.den);
+        put_be64(pb, st->start_time);
+        put_be64(pb, st->duration);
+        put_be32(pb, st->nb_index_entries);
+        for (j = 0; j < st->nb_index_entries; j++) {
+            AVIndexEntry *e = &st->index_entries[j];
+            put_be64(pb, e->pos);
+            put_be64(pb, e->timestamp);
+            put_be32(pb, (unsigned)(e->flags & 3) << 30 | (e->size & 0x3FFFFFFF));
+            put_be32(pb, e->min_distance);
+        }
+    }
+    put_flush_packet(pb);
+    ret = url_ferror(pb);
+    url_fclose(pb);
+    return ret;
+}
+
+void ff_index_file_free(AVFormatContext *s)
+{
+    AVIndexFile *idx = s->index_file;
+    int i;
+
+    if (!idx)
+        return;
+    for (i = 0; i < idx->nb_streams; i++)
+        av_free(idx->streams[i].entries);
+    av_free(idx->streams);
+    av_freep(&s->index_file);
+}
+
+int av_read_index_file(AVFormatContext *s, const char *filename)
+{
+    ByteIOContext *pb;
+    AVIndexFile *idx;
+    int64_t file_size;
+    int i, j, ret;
+
+    if ((ret = url_fopen(&pb, filename, URL_RDONLY)) < 0)
+        return ret;
+
+    ret = AVERROR_INVALIDDATA;
+    if (get_le32(pb) != MKTAG('F','F','I','X') ||
+        get_be32(pb) != INDEX_FILE_VERSION)
+        goto fail_close;
+
+    file_size = get_be64(pb);
+    if (s->pb && !url_is_streamed(s->pb) && url_fsize(s->pb) != file_size) {
+        av_log(s, AV_LOG_WARNING,
+               "Index file %s does not match the input size, ignoring it\n",
+               filename);
+        goto fail_close;
+    }
+
+    ff_index_file_free(s);
+    idx = s->index_file = av_mallocz(sizeof(*idx));
+    if (!idx) {
+        ret = AVERROR(ENOMEM);
+        goto fail_close;
+    }
+    idx->start_time = get_be64(pb);
+    idx->duration   = get_be64(pb);
+    idx->nb_streams = get_be32(pb);
+    if ((unsigned)idx->nb_streams >= INT_MAX / sizeof(*idx->streams))
+        goto fail;
+    idx->streams = av_mallocz(idx->nb_streams * sizeof(*idx->streams));
+    if (!idx->streams) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    for (i = 0; i < idx->nb_streams; i++) {
+        IndexFileStream *ist = &idx->streams[i];
+
+        ist->index          = get_be32(pb);
+        ist->id             = get_be32(pb);
+        ist->time_base.num  = get_be32(pb);
+        ist->time_base.den  = get_be32(pb);
+        ist->start_time     = get_be64(pb);
+        ist->duration       = get_be64(pb);
+        ist->nb_entries     = get_be32(pb);
+        if (url_feof(pb) || ist->time_base.num <= 0 || ist->time_base.den <= 0 ||
+            (unsigned)ist->nb_entries >= UINT_MAX / sizeof(AVIndexEntry))
+            goto fail;
+        ist->entries = av_malloc(ist->nb_entries * sizeof(*ist->entries));
+        if (ist->nb_entries && !ist->entries) {
+            ret = AVERROR(ENOMEM);
+            goto fail;
+        }
+        for (j = 0; j < ist->nb_entries; j++) {
+            AVIndexEntry *e = &ist->entries[j];
+            unsigned flags_size;
+
+            e->pos          = get_be64(pb);
+            e->timestamp    = get_be64(pb);
+            flags_size      = get_be32(pb);
+            e->flags        = flags_size >> 30;
+            e->size         = flags_size & 0x3FFFFFFF;
+            e->min_distance = get_be32(pb);
+        }
+        if (url_feof(pb))
+            goto fail;
+        if (ist->duration != AV_NOPTS_VALUE)
+            idx->has_timings = 1;
+    }
+    url_fclose(pb);
+
+    ff_index_file_apply(s);
+    return 0;
+fail:
+    ff_index_file_free(s);
+fail_close:
+    url_fclose(pb);
+    return ret;
+}
+
+void ff_index_file_apply(AVFormatContext *s)
+{
+    AVIndexFile *idx = s->index_file;
+    int i, j;
+
+    if (!idx)
+        return;
+
+    for (i = 0; i < idx->nb_streams; i++) {
+        IndexFileStream *ist = &idx->streams[i];
+        AVStream *st;
+
+        if (ist->applied || ist->index >= s->nb_streams)
+            continue;
+        st = s->streams[ist->index];
+        if (st->id != ist->id)
+            continue;
+
+        for (j = 0; j < ist->nb_entries; j++) {
+            AVIndexEntry *e = &ist->entries[j];
+            av_add_index_entry(st, e->pos,
+                               av_rescale_q(e->timestamp, ist->time_base, st->time_base),
+                               e->size, e->min_distance, e->flags);
+        }
+        if (st->start_time == AV_NOPTS_VALUE && ist->start_time != AV_NOPTS_VALUE)
+            st->start_time = av_rescale_q(ist->start_time, ist->time_base, st->time_base);
+        if (st->duration == AV_NOPTS_VALUE && ist->duration != AV_NOPTS_VALUE)
+            st->duration = av_rescale_q(ist->duration, ist->time_base, st->time_base);
+        ist->applied = 1;
+    }
+    if (s->start_time == AV_NOPTS_VALUE)
+        s->start_time = idx->start_time;
+    if (s->duration == AV_NOPTS_VALUE)
+        s->duration = idx->duration;
+}
+
+int ff_index_file_has_timings(AVFormatContext *s)
+{
+    return s->index_file && s->index_file->has_timings;
+}
+
+int ff_index_file_stream_loaded(AVFormatContext *s, int stream_index)
+{
+    AVIndexFile *idx = s->index_file;
+    int i;
+
+    if (!idx)
+        return 0;
+    for (i = 0; i < idx->nb_streams; i++)
+        if (idx->streams[i].index == stream_index)
+            return idx->streams[i].applied && idx->streams[i].nb_entries > 0;
+    return 0;
+}
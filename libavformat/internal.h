@@ -194,6 +194,13 @@ void ff_put_v(ByteIOContext *bc, uint64_t val);
  */
 int ff_get_line(ByteIOContext *s, char *buf, int maxlen);
 
+/**
+ * Return the URLContext accessed by a ByteIOContext opened with
+ * url_fopen() or url_fdopen(), or NULL for any other kind of
+ * ByteIOContext, such as dynamic buffers.
+ */
+URLContext *ff_url_context(ByteIOContext *s);
+
 #define SPACE_CHARS " \t\r\n"
 
 /**
@@ -220,4 +227,26 @@ typedef void (*ff_parse_key_val_cb)(void *context, const char *key,
 void ff_parse_key_value(const char *str, ff_parse_key_val_cb callback_get_buf,
                         void *context);
 
+/**
+ * Add the entries of the preloaded seek index file to all streams of s
+ * which have been created since the last call.
+ */
+void ff_index_file_apply(AVFormatContext *s);
+
+/**
+ * Free the preloaded seek index file, if any.
+ */
+void ff_index_file_free(AVFormatContext *s);
+
+/**
+ * @return nonzero if the preloaded seek index file provides stream durations
+ */
+int ff_index_file_has_timings(AVFormatContext *s);
+
+/**
+ * @return nonzero if the index of the given stream was filled from a
+ *         preloaded seek index file
+ */
+int ff_index_file_stream_loaded(AVFormatContext *s, int stream_index);
+
 #endif /* AVFORMAT_INTERNAL_H */
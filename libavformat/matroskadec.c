@@ -58,6 +58,7 @@ typedef enum {
     EBML_NEST,
     EBML_PASS,
     EBML_STOP,
+    EBML_BLOCK,
 } EbmlType;
 
 typedef const struct EbmlSyntax {
@@ -82,6 +83,7 @@ typedef struct {
     int      size;
     uint8_t *data;
     int64_t  pos;
+    unsigned int allocated;
 } EbmlBin;
 
 typedef struct {
@@ -208,6 +210,13 @@ typedef struct {
     uint64_t length;
 } MatroskaLevel;
 
+typedef struct {
+    uint64_t duration;
+    int64_t  reference;
+    uint64_t non_simple;
+    EbmlBin  bin;
+} MatroskaBlock;
+
 typedef struct {
     AVFormatContext *ctx;
 
@@ -230,6 +239,20 @@ typedef struct {
     /* byte position of the segment inside the stream */
     int64_t segment_start;
 
+    /* byte position of the Cues, until they are loaded on the first seek */
+    int64_t cues_pos;
+    int has_cues;
+
+    /* the cluster being parsed */
+    uint64_t cluster_timecode;
+    int64_t  cluster_pos;
+
+    /* BlockGroup being parsed, its data buffer is reused */
+    MatroskaBlock block;
+    /* scratch buffer for laces which cannot be read into their packet */
+    uint8_t *lace_buf;
+    unsigned int lace_buf_size;
+
     /* the packet queue */
     AVPacket **packets;
     int num_packets;
@@ -242,17 +265,6 @@ typedef struct {
     uint64_t skip_to_timecode;
 } MatroskaDemuxContext;
 
-typedef struct {
-    uint64_t duration;
-    int64_t  reference;
-    uint64_t non_simple;
-    EbmlBin  bin;
-} MatroskaBlock;
-
-typedef struct {
-    uint64_t timecode;
-    EbmlList blocks;
-} MatroskaCluster;
 
 static EbmlSyntax ebml_header[] = {
     { EBML_ID_EBMLREADVERSION,        EBML_UINT, 0, offsetof(Ebml,version), {.u=EBML_VERSION} },
@@ -490,9 +502,9 @@ static EbmlSyntax matroska_blockgroup[] = {
 };
 
 static EbmlSyntax matroska_cluster[] = {
-    { MATROSKA_ID_CLUSTERTIMECODE,EBML_UINT,0, offsetof(MatroskaCluster,timecode) },
-    { MATROSKA_ID_BLOCKGROUP,     EBML_NEST, sizeof(MatroskaBlock), offsetof(MatroskaCluster,blocks), {.n=matroska_blockgroup} },
-    { MATROSKA_ID_SIMPLEBLOCK,    EBML_PASS, sizeof(MatroskaBlock), offsetof(MatroskaCluster,blocks), {.n=matroska_blockgroup} },
+    { MATROSKA_ID_CLUSTERTIMECODE,EBML_UINT,0, offsetof(MatroskaDemuxContext,cluster_timecode) },
+    { MATROSKA_ID_BLOCKGROUP,     EBML_BLOCK },
+    { MATROSKA_ID_SIMPLEBLOCK,    EBML_BLOCK },
     { MATROSKA_ID_CLUSTERPOSITION,EBML_NONE },
     { MATROSKA_ID_CLUSTERPREVSIZE,EBML_NONE },
     { 0 }
@@ -509,6 +521,9 @@ static EbmlSyntax matroska_clusters[] = {
 
 static const char *matroska_doctypes[] = { "matroska", "webm" };
 
+/* below this distance, clusters are read linearly instead of bisected */
+#define CLUSTER_BISECT_MIN_SIZE (256*1024)
+
 /*
  * Return: Whether we reached the end of a level in the hierarchy or not.
  */
@@ -652,14 +667,15 @@ static int ebml_read_ascii(ByteIOContext *pb, int size, char **str)
  */
 static int ebml_read_binary(ByteIOContext *pb, int length, EbmlBin *bin)
 {
-    av_free(bin->data);
-    if (!(bin->data = av_malloc(length)))
+    av_fast_malloc(&bin->data, &bin->allocated, length);
+    if (!bin->data)
         return AVERROR(ENOMEM);
 
     bin->size = length;
     bin->pos  = url_ftell(pb);
     if (get_buffer(pb, bin->data, length) != length) {
         av_freep(&bin->data);
+        bin->allocated = 0;
         return AVERROR(EIO);
     }
 
@@ -690,28 +706,17 @@ static int ebml_read_master(MatroskaDemuxContext *matroska, uint64_t length)
 }
 
 /*
- * Read signed/unsigned "EBML" numbers.
+ * Read a signed "EBML" number.
  * Return: number of bytes processed, < 0 on error
  */
-static int matroska_ebmlnum_uint(MatroskaDemuxContext *matroska,
-                                 uint8_t *data, uint32_t size, uint64_t *num)
-{
-    ByteIOContext pb;
-    init_put_byte(&pb, data, size, 0, NULL, NULL, NULL, NULL);
-    return ebml_read_num(matroska, &pb, FFMIN(size, 8), num);
-}
-
-/*
- * Same as above, but signed.
- */
 static int matroska_ebmlnum_sint(MatroskaDemuxContext *matroska,
-                                 uint8_t *data, uint32_t size, int64_t *num)
+                                 ByteIOContext *pb, int max_size, int64_t *num)
 {
     uint64_t unum;
     int res;
 
     /* read as unsigned number first */
-    if ((res = matroska_ebmlnum_uint(matroska, data, size, &unum)) < 0)
+    if ((res = ebml_read_num(matroska, pb, max_size, &unum)) < 0)
         return res;
 
     /* make signed (weird way) */
@@ -722,6 +727,8 @@ static int matroska_ebmlnum_sint(MatroskaDemuxContext *matroska,
 
 static int ebml_parse_elem(MatroskaDemuxContext *matroska,
                            EbmlSyntax *syntax, void *data);
+static int matroska_read_block(MatroskaDemuxContext *matroska, uint32_t id,
+                               uint64_t length);
 
 static int ebml_parse_id(MatroskaDemuxContext *matroska, EbmlSyntax *syntax,
                          uint32_t id, void *data)
@@ -813,6 +820,7 @@ static int ebml_parse_elem(MatroskaDemuxContext *matroska,
                      return ebml_parse_nest(matroska, syntax->def.n, data);
     case EBML_PASS:  return ebml_parse_id(matroska, syntax->def.n, id, data);
     case EBML_STOP:  return 1;
+    case EBML_BLOCK: return matroska_read_block(matroska, id, length);
     default:         return url_fseek(pb,length,SEEK_CUR)<0 ? AVERROR(EIO) : 0;
     }
     if (res == AVERROR_INVALIDDATA)
@@ -1088,6 +1096,45 @@ static void matroska_convert_tags(AVFormatContext *s)
     }
 }
 
+/*
+ * Parse the level 1 element found at the given position of the stream.
+ * The caller is responsible for restoring the previous position.
+ */
+static int matroska_parse_seekhead_entry(MatroskaDemuxContext *matroska,
+                                         int64_t offset)
+{
+    MatroskaLevel level;
+
+    /* seek */
+    if (url_fseek(matroska->ctx->pb, offset, SEEK_SET) != offset)
+        return 0;
+
+    /* We don't want to lose our seekhead level, so we add
+     * a dummy. This is a crude hack. */
+    if (matroska->num_levels == EBML_MAX_DEPTH) {
+        av_log(matroska->ctx, AV_LOG_INFO,
+               "Max EBML element depth (%d) reached, "
+               "cannot parse further.\n", EBML_MAX_DEPTH);
+        return AVERROR_INVALIDDATA;
+    }
+
+    level.start = 0;
+    level.length = (uint64_t)-1;
+    matroska->levels[matroska->num_levels] = level;
+    matroska->num_levels++;
+    matroska->current_id = 0;
+
+    ebml_parse(matroska, matroska_segment, matroska);
+
+    /* remove dummy level */
+    while (matroska->num_levels) {
+        uint64_t length = matroska->levels[--matroska->num_levels].length;
+        if (length == (uint64_t)-1)
+            break;
+    }
+    return 0;
+}
+
 static void matroska_execute_seekhead(MatroskaDemuxContext *matroska)
 {
     EbmlList *seekhead_list = &matroska->seekhead;
@@ -1095,7 +1142,6 @@ static void matroska_execute_seekhead(MatroskaDemuxContext *matroska)
     uint32_t level_up = matroska->level_up;
     int64_t before_pos = url_ftell(matroska->ctx->pb);
     uint32_t saved_id = matroska->current_id;
-    MatroskaLevel level;
     int i;
 
     // we should not do any seeking in the streaming case
@@ -1111,36 +1157,67 @@ static void matroska_execute_seekhead(MatroskaDemuxContext *matroska)
             || seekhead[i].id == MATROSKA_ID_CLUSTER)
             continue;
 
-        /* seek */
-        if (url_fseek(matroska->ctx->pb, offset, SEEK_SET) != offset)
+        /* the Cues are usually at the end of the file and only
+         * needed for seeking, so they are loaded on the first seek */
+        if (seekhead[i].id == MATROSKA_ID_CUES) {
+            matroska->cues_pos = offset;
             continue;
+        }
 
-        /* We don't want to lose our seekhead level, so we add
-         * a dummy. This is a crude hack. */
-        if (matroska->num_levels == EBML_MAX_DEPTH) {
-            av_log(matroska->ctx, AV_LOG_INFO,
-                   "Max EBML element depth (%d) reached, "
-                   "cannot parse further.\n", EBML_MAX_DEPTH);
+        if (matroska_parse_seekhead_entry(matroska, offset) < 0)
             break;
-        }
+    }
 
-        level.start = 0;
-        level.length = (uint64_t)-1;
-        matroska->levels[matroska->num_levels] = level;
-        matroska->num_levels++;
-        matroska->current_id = 0;
+    /* seek back */
+    url_fseek(matroska->ctx->pb, before_pos, SEEK_SET);
+    matroska->level_up = level_up;
+    matroska->current_id = saved_id;
+}
 
-        ebml_parse(matroska, matroska_segment, matroska);
+static void matroska_add_index_entries(MatroskaDemuxContext *matroska)
+{
+    EbmlList *index_list = &matroska->index;
+    MatroskaIndex *index = index_list->elem;
+    int index_scale = 1;
+    int i, j;
 
-        /* remove dummy level */
-        while (matroska->num_levels) {
-            uint64_t length = matroska->levels[--matroska->num_levels].length;
-            if (length == (uint64_t)-1)
-                break;
+    if (index_list->nb_elem
+        && index[0].time > 100000000000000/matroska->time_scale) {
+        av_log(matroska->ctx, AV_LOG_WARNING, "Working around broken index.\n");
+        index_scale = matroska->time_scale;
+    }
+    if (index_list->nb_elem)
+        matroska->has_cues = 1;
+    for (i=0; i<index_list->nb_elem; i++) {
+        EbmlList *pos_list = &index[i].pos;
+        MatroskaIndexPos *pos = pos_list->elem;
+        for (j=0; j<pos_list->nb_elem; j++) {
+            MatroskaTrack *track = matroska_find_track_by_num(matroska,
+                                                              pos[j].track);
+            if (track && track->stream)
+                av_add_index_entry(track->stream,
+                                   pos[j].pos + matroska->segment_start,
+                                   index[i].time/index_scale, 0, 0,
+                                   AVINDEX_KEYFRAME);
         }
     }
 
-    /* seek back */
+    /* the entries now live in the generic index */
+    ebml_free(matroska_index, matroska);
+    memset(index_list, 0, sizeof(*index_list));
+}
+
+static void matroska_load_cues(MatroskaDemuxContext *matroska)
+{
+    uint32_t level_up = matroska->level_up;
+    int64_t before_pos = url_ftell(matroska->ctx->pb);
+    uint32_t saved_id = matroska->current_id;
+    int64_t cues_pos = matroska->cues_pos;
+
+    matroska->cues_pos = 0;
+    if (matroska_parse_seekhead_entry(matroska, cues_pos) >= 0)
+        matroska_add_index_entries(matroska);
+
     url_fseek(matroska->ctx->pb, before_pos, SEEK_SET);
     matroska->level_up = level_up;
     matroska->current_id = saved_id;
@@ -1175,9 +1252,6 @@ static int matroska_read_header(AVFormatContext *s, AVFormatParameters *ap)
     EbmlList *chapters_list = &matroska->chapters;
     MatroskaChapter *chapters;
     MatroskaTrack *tracks;
-    EbmlList *index_list;
-    MatroskaIndex *index;
-    int index_scale = 1;
     uint64_t max_start = 0;
     Ebml ebml = { 0 };
     AVStream *st;
@@ -1504,26 +1578,8 @@ static int matroska_read_header(AVFormatContext *s, AVFormatParameters *ap)
             max_start = chapters[i].start;
         }
 
-    index_list = &matroska->index;
-    index = index_list->elem;
-    if (index_list->nb_elem
-        && index[0].time > 100000000000000/matroska->time_scale) {
-        av_log(matroska->ctx, AV_LOG_WARNING, "Working around broken index.\n");
-        index_scale = matroska->time_scale;
-    }
-    for (i=0; i<index_list->nb_elem; i++) {
-        EbmlList *pos_list = &index[i].pos;
-        MatroskaIndexPos *pos = pos_list->elem;
-        for (j=0; j<pos_list->nb_elem; j++) {
-            MatroskaTrack *track = matroska_find_track_by_num(matroska,
-                                                              pos[j].track);
-            if (track && track->stream)
-                av_add_index_entry(track->stream,
-                                   pos[j].pos + matroska->segment_start,
-                                   index[i].time/index_scale, 0, 0,
-                                   AVINDEX_KEYFRAME);
-        }
-    }
+    /* Cues stored before the first cluster have already been read */
+    matroska_add_index_entries(matroska);
 
     matroska_convert_tags(s);
 
@@ -1572,10 +1628,10 @@ static void matroska_clear_queue(MatroskaDemuxContext *matroska)
     }
 }
 
-static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
-                                int size, int64_t pos, uint64_t cluster_time,
-                                uint64_t duration, int is_keyframe,
-                                int64_t cluster_pos)
+static int matroska_parse_block(MatroskaDemuxContext *matroska,
+                                ByteIOContext *pb, int size, int64_t pos,
+                                uint64_t cluster_time, uint64_t duration,
+                                int is_keyframe, int64_t cluster_pos)
 {
     uint64_t timecode = AV_NOPTS_VALUE;
     MatroskaTrack *track;
@@ -1583,15 +1639,14 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
     AVStream *st;
     AVPacket *pkt;
     int16_t block_time;
-    uint32_t *lace_size = NULL;
+    uint32_t lace_size[256];
     int n, flags, laces = 0;
     uint64_t num;
 
-    if ((n = matroska_ebmlnum_uint(matroska, data, size, &num)) < 0) {
+    if ((n = ebml_read_num(matroska, pb, FFMIN(size, 8), &num)) < 0) {
         av_log(matroska->ctx, AV_LOG_ERROR, "EBML block data error\n");
         return res;
     }
-    data += n;
     size -= n;
 
     track = matroska_find_track_by_num(matroska, num);
@@ -1606,9 +1661,8 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
     if (duration == AV_NOPTS_VALUE)
         duration = track->default_duration / matroska->time_scale;
 
-    block_time = AV_RB16(data);
-    data += 2;
-    flags = *data++;
+    block_time = get_be16(pb);
+    flags = get_byte(pb);
     size -= 3;
     if (is_keyframe == -1)
         is_keyframe = flags & 0x80 ? AV_PKT_FLAG_KEY : 0;
@@ -1630,10 +1684,11 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
         matroska->skip_to_keyframe = 0;
     }
 
+    /* the lace sizes are read in place, the data of each lace is then
+     * read straight into its packet */
     switch ((flags & 0x06) >> 1) {
         case 0x0: /* no lacing */
             laces = 1;
-            lace_size = av_mallocz(sizeof(int));
             lace_size[0] = size;
             break;
 
@@ -1641,10 +1696,9 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
         case 0x2: /* fixed-size lacing */
         case 0x3: /* EBML lacing */
             assert(size>0); // size <=3 is checked before size-=3 above
-            laces = (*data) + 1;
-            data += 1;
+            laces = get_byte(pb) + 1;
             size -= 1;
-            lace_size = av_mallocz(laces * sizeof(int));
+            memset(lace_size, 0, laces * sizeof(*lace_size));
 
             switch ((flags & 0x06) >> 1) {
                 case 0x1: /* Xiph lacing */ {
@@ -1653,12 +1707,11 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
                     for (n = 0; res == 0 && n < laces - 1; n++) {
                         while (1) {
                             if (size == 0) {
-                                res = -1;
+                                res = AVERROR_INVALIDDATA;
                                 break;
                             }
-                            temp = *data;
+                            temp = get_byte(pb);
                             lace_size[n] += temp;
-                            data += 1;
                             size -= 1;
                             if (temp != 0xff)
                                 break;
@@ -1676,25 +1729,23 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
 
                 case 0x3: /* EBML lacing */ {
                     uint32_t total;
-                    n = matroska_ebmlnum_uint(matroska, data, size, &num);
+                    n = ebml_read_num(matroska, pb, FFMIN(size, 8), &num);
                     if (n < 0) {
                         av_log(matroska->ctx, AV_LOG_INFO,
                                "EBML block data error\n");
                         break;
                     }
-                    data += n;
                     size -= n;
                     total = lace_size[0] = num;
                     for (n = 1; res == 0 && n < laces - 1; n++) {
                         int64_t snum;
                         int r;
-                        r = matroska_ebmlnum_sint(matroska, data, size, &snum);
+                        r = matroska_ebmlnum_sint(matroska, pb, FFMIN(size, 8), &snum);
                         if (r < 0) {
                             av_log(matroska->ctx, AV_LOG_INFO,
                                    "EBML block data error\n");
                             break;
                         }
-                        data += r;
                         size -= r;
                         lace_size[n] = lace_size[n - 1] + snum;
                         total += lace_size[n];
@@ -1708,6 +1759,11 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
 
     if (res == 0) {
         for (n = 0; n < laces; n++) {
+            if (lace_size[n] > size) {
+                av_log(matroska->ctx, AV_LOG_ERROR, "Invalid packet size\n");
+                break;
+            }
+
             if ((st->codec->codec_id == CODEC_ID_RA_288 ||
                  st->codec->codec_id == CODEC_ID_COOK ||
                  st->codec->codec_id == CODEC_ID_SIPR ||
@@ -1720,8 +1776,19 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
                 int y = track->audio.sub_packet_cnt;
                 int w = track->audio.frame_size;
                 int x;
+                uint8_t *data;
 
                 if (!track->audio.pkt_cnt) {
+                    av_fast_malloc(&matroska->lace_buf,
+                                   &matroska->lace_buf_size, lace_size[n]);
+                    if (!(data = matroska->lace_buf)) {
+                        res = AVERROR(ENOMEM);
+                        break;
+                    }
+                    if (get_buffer(pb, data, lace_size[n]) != lace_size[n]) {
+                        res = AVERROR(EIO);
+                        break;
+                    }
                     if (st->codec->codec_id == CODEC_ID_RA_288)
                         for (x=0; x<h/2; x++)
                             memcpy(track->audio.buf+x*2*w+y*cfs,
@@ -1738,7 +1805,8 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
                         track->audio.sub_packet_cnt = 0;
                         track->audio.pkt_cnt = h*w / a;
                     }
-                }
+                } else
+                    url_fskip(pb, lace_size[n]);
                 while (track->audio.pkt_cnt) {
                     pkt = av_mallocz(sizeof(AVPacket));
                     av_new_packet(pkt, a);
@@ -1751,32 +1819,48 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
             } else {
                 MatroskaTrackEncoding *encodings = track->encodings.elem;
                 int offset = 0, pkt_size = lace_size[n];
-                uint8_t *pkt_data = data;
-
-                if (pkt_size > size) {
-                    av_log(matroska->ctx, AV_LOG_ERROR, "Invalid packet size\n");
-                    break;
-                }
-
-                if (encodings && encodings->scope & 1) {
-                    offset = matroska_decode_buffer(&pkt_data,&pkt_size, track);
-                    if (offset < 0)
-                        continue;
+                uint8_t *pkt_data = NULL;
+
+                if (encodings && encodings->scope & 1 &&
+                    encodings->compression.algo != MATROSKA_TRACK_ENCODING_COMP_HEADERSTRIP) {
+                    /* compressed lace, decode it from the scratch buffer */
+                    av_fast_malloc(&matroska->lace_buf,
+                                   &matroska->lace_buf_size, pkt_size);
+                    if (!(pkt_data = matroska->lace_buf)) {
+                        res = AVERROR(ENOMEM);
+                        break;
+                    }
+                    if (get_buffer(pb, pkt_data, pkt_size) != pkt_size) {
+                        res = AVERROR(EIO);
+                        break;
+                    }
+                    if (matroska_decode_buffer(&pkt_data, &pkt_size, track) < 0) {
+                        size -= lace_size[n];
+                        goto next_lace;
+                    }
+                } else if (encodings && encodings->scope & 1) {
+                    offset = encodings->compression.settings.size;
                 }
 
                 pkt = av_mallocz(sizeof(AVPacket));
-                /* XXX: prevent data copy... */
-                if (av_new_packet(pkt, pkt_size+offset) < 0) {
+                if (!pkt || av_new_packet(pkt, pkt_size+offset) < 0) {
                     av_free(pkt);
+                    if (pkt_data != matroska->lace_buf)
+                        av_free(pkt_data);
                     res = AVERROR(ENOMEM);
                     break;
                 }
                 if (offset)
                     memcpy (pkt->data, encodings->compression.settings.data, offset);
-                memcpy (pkt->data+offset, pkt_data, pkt_size);
-
-                if (pkt_data != data)
+                if (pkt_data) {
+                    memcpy (pkt->data+offset, pkt_data, pkt_size);
                     av_free(pkt_data);
+                } else if (get_buffer(pb, pkt->data+offset, pkt_size) != pkt_size) {
+                    av_free_packet(pkt);
+                    av_free(pkt);
+                    res = AVERROR(EIO);
+                    break;
+                }
 
                 if (n == 0)
                     pkt->flags = is_keyframe;
@@ -1807,40 +1891,72 @@ static int matroska_parse_block(MatroskaDemuxContext *matroska, uint8_t *data,
                 }
             }
 
+            size -= lace_size[n];
+        next_lace:
             if (timecode != AV_NOPTS_VALUE)
                 timecode = duration ? timecode + duration : AV_NOPTS_VALUE;
-            data += lace_size[n];
-            size -= lace_size[n];
         }
     }
 
-    av_free(lace_size);
     return res;
 }
 
+/*
+ * Parse a SimpleBlock straight from the input. A BlockGroup is read into
+ * the reused block buffer first, its duration and references may follow
+ * the block data.
+ */
+static int matroska_read_block(MatroskaDemuxContext *matroska, uint32_t id,
+                               uint64_t length)
+{
+    ByteIOContext *pb = matroska->ctx->pb;
+    int64_t pos = url_ftell(pb);
+    int res;
+
+    if (length > INT_MAX)
+        return AVERROR_INVALIDDATA;
+
+    if (id == MATROSKA_ID_SIMPLEBLOCK) {
+        res = matroska_parse_block(matroska, pb, length, pos,
+                                   matroska->cluster_timecode, 0, -1,
+                                   matroska->cluster_pos);
+    } else {
+        MatroskaBlock *block = &matroska->block;
+        ByteIOContext b;
+
+        block->bin.size = 0;
+        if ((res = ebml_read_master(matroska, length)) < 0 ||
+            (res = ebml_parse_nest(matroska, matroska_blockgroup, block)) < 0)
+            return res;
+        if (block->bin.size <= 0 || !block->bin.data)
+            return 0;
+        init_put_byte(&b, block->bin.data, block->bin.size, 0,
+                      NULL, NULL, NULL, NULL);
+        res = matroska_parse_block(matroska, &b, block->bin.size,
+                                   block->bin.pos, matroska->cluster_timecode,
+                                   block->duration,
+                                   block->non_simple ? !block->reference : -1,
+                                   matroska->cluster_pos);
+    }
+    if (res == AVERROR(EIO) || res == AVERROR(ENOMEM))
+        return res;
+
+    /* skip what was not read, e.g. blocks of discarded streams */
+    if (url_ftell(pb) != pos + length &&
+        url_fseek(pb, pos + length, SEEK_SET) < 0)
+        return AVERROR(EIO);
+    return 0;
+}
+
 static int matroska_parse_cluster(MatroskaDemuxContext *matroska)
 {
-    MatroskaCluster cluster = { 0 };
-    EbmlList *blocks_list;
-    MatroskaBlock *blocks;
-    int i, res;
+    int res;
     int64_t pos = url_ftell(matroska->ctx->pb);
     matroska->prev_pkt = NULL;
     if (matroska->current_id)
         pos -= 4;  /* sizeof the ID which was already read */
-    res = ebml_parse(matroska, matroska_clusters, &cluster);
-    blocks_list = &cluster.blocks;
-    blocks = blocks_list->elem;
-    for (i=0; i<blocks_list->nb_elem; i++)
-        if (blocks[i].bin.size > 0 && blocks[i].bin.data) {
-            int is_keyframe = blocks[i].non_simple ? !blocks[i].reference : -1;
-            res=matroska_parse_block(matroska,
-                                     blocks[i].bin.data, blocks[i].bin.size,
-                                     blocks[i].bin.pos,  cluster.timecode,
-                                     blocks[i].duration, is_keyframe,
-                                     pos);
-        }
-    ebml_free(matroska_cluster, &cluster);
+    matroska->cluster_pos = pos;
+    res = ebml_parse(matroska, matroska_clusters, matroska);
     if (res < 0)  matroska->done = 1;
     return res;
 }
@@ -1858,6 +1974,94 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+/*
+ * Read an EBML number from a buffer, without complaining about invalid
+ * data, as used when looking for clusters at arbitrary positions.
+ * Return: number of bytes read, < 0 on error
+ */
+static int ebml_peek_num(const uint8_t *p, const uint8_t *end, uint64_t *num)
+{
+    int n, len;
+
+    if (p >= end || !*p)
+        return -1;
+    len = 8 - ff_log2_tab[*p];
+    if (end - p < len)
+        return -1;
+    *num = *p ^ (1 << ff_log2_tab[*p]);
+    for (n = 1; n < len; n++)
+        *num = (*num << 8) | p[n];
+    return len;
+}
+
+/*
+ * Find the first cluster starting between pos and end and read its
+ * timecode.
+ * Return: the position of the cluster, < 0 if none was found
+ */
+static int64_t matroska_find_cluster(MatroskaDemuxContext *matroska,
+                                     int64_t pos, int64_t end,
+                                     uint64_t *timecode)
+{
+    ByteIOContext *pb = matroska->ctx->pb;
+    uint8_t buf[32];
+    uint32_t state = 0;
+
+    if (url_fseek(pb, pos, SEEK_SET) < 0)
+        return -1;
+    while (pos < end && !url_feof(pb)) {
+        const uint8_t *p = buf, *buf_end;
+        uint64_t length;
+        int n;
+
+        state = (state << 8) | get_byte(pb);
+        pos++;
+        if (state != MATROSKA_ID_CLUSTER)
+            continue;
+
+        buf_end = buf + get_buffer(pb, buf, sizeof(buf));
+        url_fseek(pb, pos, SEEK_SET);
+        /* cluster size, optional CRC-32, then the timecode */
+        if ((n = ebml_peek_num(p, buf_end, &length)) < 0)
+            continue;
+        p += n;
+        if (p + 6 <= buf_end && p[0] == EBML_ID_CRC32 && p[1] == 0x84)
+            p += 6;
+        if (p >= buf_end || *p++ != MATROSKA_ID_CLUSTERTIMECODE ||
+            (n = ebml_peek_num(p, buf_end, &length)) < 0 || length > 8 ||
+            buf_end - p - n < length)
+            continue;
+        p += n;
+        for (*timecode = 0; length--; )
+            *timecode = (*timecode << 8) | *p++;
+        return pos - 4;
+    }
+    return -1;
+}
+
+/*
+ * Bisect the clusters between start and end to find the last one starting
+ * before timestamp, so that files without Cues need not be read linearly
+ * up to it.
+ */
+static int64_t matroska_bisect_clusters(MatroskaDemuxContext *matroska,
+                                        int64_t start, int64_t end,
+                                        int64_t timestamp)
+{
+    int64_t lo = start, hi = end, pos, mid;
+    uint64_t timecode;
+
+    while (hi - lo > CLUSTER_BISECT_MIN_SIZE) {
+        mid = lo + (hi - lo) / 2;
+        pos = matroska_find_cluster(matroska, mid, hi, &timecode);
+        if (pos < 0 || (int64_t)timecode > timestamp)
+            hi = mid;
+        else
+            lo = pos;
+    }
+    return lo;
+}
+
 static int matroska_read_seek(AVFormatContext *s, int stream_index,
                               int64_t timestamp, int flags)
 {
@@ -1866,18 +2070,35 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     AVStream *st = s->streams[stream_index];
     int i, index, index_sub, index_min;
 
+    if (matroska->cues_pos)
+        matroska_load_cues(matroska);
+
     if (!st->nb_index_entries)
         return 0;
     timestamp = FFMAX(timestamp, st->index_entries[0].timestamp);
 
-    if ((index = av_index_search_timestamp(st, timestamp, flags)) < 0) {
-        url_fseek(s->pb, st->index_entries[st->nb_index_entries-1].pos, SEEK_SET);
-        while ((index = av_index_search_timestamp(st, timestamp, flags)) < 0) {
+    /* Read the clusters around timestamp if it is beyond the index, or if
+     * the index only has the keyframes seen so far and a large hole there. */
+    index = av_index_search_timestamp(st, timestamp, AVSEEK_FLAG_BACKWARD);
+    if (index == st->nb_index_entries-1 ||
+        (!matroska->has_cues && st->index_entries[index+1].pos -
+         st->index_entries[index].pos > CLUSTER_BISECT_MIN_SIZE)) {
+        int64_t pos = st->index_entries[index].pos;
+        int64_t end = index == st->nb_index_entries-1 ? url_fsize(s->pb) :
+                      st->index_entries[index+1].pos;
+        /* end is negative if the file size is unknown */
+        if (!url_is_streamed(s->pb) && end > pos)
+            pos = matroska_bisect_clusters(matroska, pos, end, timestamp);
+        url_fseek(s->pb, pos, SEEK_SET);
+        matroska->current_id = 0;
+        do {
             matroska_clear_queue(matroska);
             if (matroska_parse_cluster(matroska) < 0)
                 break;
-        }
+        } while (matroska->cluster_timecode <= timestamp ||
+                 av_index_search_timestamp(st, timestamp, 0) < 0);
     }
+    index = av_index_search_timestamp(st, timestamp, flags);
 
     matroska_clear_queue(matroska);
     if (index < 0)
@@ -1897,6 +2118,7 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     }
 
     url_fseek(s->pb, st->index_entries[index_min].pos, SEEK_SET);
+    matroska->current_id = 0;
     matroska->skip_to_keyframe = !(flags & AVSEEK_FLAG_ANY);
     matroska->skip_to_timecode = st->index_entries[index].timestamp;
     matroska->done = 0;
@@ -1916,6 +2138,8 @@ static int matroska_read_close(AVFormatContext *s)
         if (tracks[n].type == MATROSKA_TRACK_TYPE_AUDIO)
             av_free(tracks[n].audio.buf);
     ebml_free(matroska_segment, matroska);
+    av_free(matroska->block.bin.data);
+    av_free(matroska->lace_buf);
 
     return 0;
 }
@@ -118,6 +118,14 @@ struct MpegTSContext {
     struct Program *prg;
 
 
+    /** bitmap of the pids only carried by discarded programs */
+    uint8_t discard_pids[NB_PID_MAX / 8];
+    /** set when the Program->pids mapping changed since the bitmap was built */
+    int discard_pids_stale;
+    /** AVProgram.discard values the bitmap was built for */
+    enum AVDiscard *prg_discard;
+    unsigned int nb_prg_discard;
+
     /** filters for various streams specified by PMT + for the PAT and PMT */
     MpegTSFilter *pids[NB_PID_MAX];
 };
@@ -166,12 +174,14 @@ static void clear_program(MpegTSContext *ts, unsigned int programid)
     for(i=0; i<ts->nb_prg; i++)
         if(ts->prg[i].id == programid)
             ts->prg[i].nb_pids = 0;
+    ts->discard_pids_stale = 1;
 }
 
 static void clear_programs(MpegTSContext *ts)
 {
     av_freep(&ts->prg);
     ts->nb_prg=0;
+    ts->discard_pids_stale = 1;
 }
 
 static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
@@ -185,6 +195,7 @@ static void add_pat_entry(MpegTSContext *ts, unsigned int programid)
     p->id = programid;
     p->nb_pids = 0;
     ts->nb_prg++;
+    ts->discard_pids_stale = 1;
 }
 
 static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned int pid)
@@ -203,39 +214,58 @@ static void add_pid_to_pmt(MpegTSContext *ts, unsigned int programid, unsigned i
     if(p->nb_pids >= MAX_PIDS_PER_PROGRAM)
         return;
     p->pids[p->nb_pids++] = pid;
+    ts->discard_pids_stale = 1;
 }
 
 /**
- * \brief discard_pid() decides if the pid is to be discarded according
- *                      to caller's programs selection
- * \param ts    : - TS context
- * \param pid   : - pid
- * \return 1 if the pid is only comprised in programs that have .discard=AVDISCARD_ALL
- *         0 otherwise
+ * Rebuild the discard_pids bitmap if the programs or the caller's
+ * program selection changed. A pid is discarded if it is only
+ * comprised in programs that have .discard=AVDISCARD_ALL.
+ * Called on entry with the caller's selection, and again after every
+ * packet whose PAT or PMT changed the programs.
  */
-static int discard_pid(MpegTSContext *ts, unsigned int pid)
+static void update_discard_pids(MpegTSContext *ts)
 {
+    AVFormatContext *s = ts->stream;
+    uint8_t used[NB_PID_MAX / 8];
+    uint8_t *map;
     int i, j, k;
-    int used = 0, discarded = 0;
-    struct Program *p;
+
+    if (!ts->discard_pids_stale && ts->nb_prg_discard == s->nb_programs) {
+        for(k=0; k<s->nb_programs; k++)
+            if(s->programs[k]->discard != ts->prg_discard[k])
+                break;
+        if(k == s->nb_programs)
+            return;
+    }
+
+    if (ts->nb_prg_discard != s->nb_programs) {
+        void *tmp = av_realloc(ts->prg_discard, s->nb_programs * sizeof(*ts->prg_discard));
+        if (!tmp && s->nb_programs)
+            return;
+        ts->prg_discard = tmp;
+        ts->nb_prg_discard = s->nb_programs;
+    }
+    for(k=0; k<s->nb_programs; k++)
+        ts->prg_discard[k] = s->programs[k]->discard;
+
+    memset(ts->discard_pids, 0, sizeof(ts->discard_pids));
+    memset(used, 0, sizeof(used));
     for(i=0; i<ts->nb_prg; i++) {
-        p = &ts->prg[i];
-        for(j=0; j<p->nb_pids; j++) {
-            if(p->pids[j] != pid)
+        struct Program *p = &ts->prg[i];
+        for(k=0; k<s->nb_programs; k++) {
+            if(s->programs[k]->id != p->id)
                 continue;
-            //is program with id p->id set to be discarded?
-            for(k=0; k<ts->stream->nb_programs; k++) {
-                if(ts->stream->programs[k]->id == p->id) {
-                    if(ts->stream->programs[k]->discard == AVDISCARD_ALL)
-                        discarded++;
-                    else
-                        used++;
-                }
-            }
+            map = s->programs[k]->discard == AVDISCARD_ALL ? ts->discard_pids : used;
+            for(j=0; j<p->nb_pids; j++)
+                map[p->pids[j] >> 3] |= 1 << (p->pids[j] & 7);
         }
     }
-
-    return !used && discarded;
+    for(i=0; i<NB_PID_MAX / 8; i++)
+        ts->discard_pids[i] &= ~used[i];
+    /* the PAT is always needed */
+    ts->discard_pids[0] &= ~1;
+    ts->discard_pids_stale = 0;
 }
 
 /**
@@ -1153,7 +1183,7 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     int64_t pos;
 
     pid = AV_RB16(packet + 1) & 0x1fff;
-    if(pid && discard_pid(ts, pid))
+    if(ts->discard_pids[pid >> 3] & (1 << (pid & 7)))
         return 0;
     is_start = packet[1] & 0x40;
     tss = ts->pids[pid];
@@ -1224,14 +1254,32 @@ static int handle_packet(MpegTSContext *ts, const uint8_t *packet)
     return 0;
 }
 
-/* XXX: try to find a better synchro over several packets (use
-   get_packet_size() ?) */
-static int mpegts_resync(AVFormatContext *s)
+static int mpegts_resync(AVFormatContext *s, int raw_packet_size)
 {
     ByteIOContext *pb = s->pb;
-    int c, i;
+    const uint8_t *p;
+    int c, i, len;
 
     for(i = 0;i < MAX_RESYNC_SIZE; i++) {
+        /* scan what is already buffered in one go, memchr() is much
+           faster than fetching the input byte by byte */
+        len = FFMIN(pb->buf_end - pb->buf_ptr, MAX_RESYNC_SIZE - i);
+        if (len > 0) {
+            p = memchr(pb->buf_ptr, 0x47, len);
+            if (!p) {
+                pb->buf_ptr += len;
+                i += len - 1;
+                continue;
+            }
+            i += p - pb->buf_ptr;
+            pb->buf_ptr += p - pb->buf_ptr;
+            /* a sync byte must also start the next packet, if we have it */
+            if (pb->buf_end - p > raw_packet_size && p[raw_packet_size] != 0x47) {
+                pb->buf_ptr++;
+                continue;
+            }
+            return 0;
+        }
         c = url_fgetc(pb);
         if (c < 0)
             return -1;
@@ -1245,28 +1293,31 @@ static int mpegts_resync(AVFormatContext *s)
     return -1;
 }
 
-/* return -1 if error or EOF. Return 0 if OK. */
-static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size)
+/**
+ * Read one packet including its FEC bytes. The packet is returned in
+ * *data, which points into the ByteIOContext buffer whenever the packet
+ * is already buffered, and into buf (TS_MAX_PACKET_SIZE bytes) otherwise.
+ * @return -1 if error or EOF, 0 if OK
+ */
+static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size,
+                       const uint8_t **data)
 {
     ByteIOContext *pb = s->pb;
-    int skip, len;
+    int len;
 
     for(;;) {
-        len = get_buffer(pb, buf, TS_PACKET_SIZE);
-        if (len != TS_PACKET_SIZE)
+        len = ff_get_buffer_indirect(pb, buf, raw_packet_size, data);
+        if (len < TS_PACKET_SIZE)
             return AVERROR(EIO);
         /* check paquet sync byte */
-        if (buf[0] != 0x47) {
+        if ((*data)[0] != 0x47) {
             /* find a new packet start */
-            url_fseek(pb, -TS_PACKET_SIZE, SEEK_CUR);
-            if (mpegts_resync(s) < 0)
+            url_fseek(pb, -len, SEEK_CUR);
+            if (mpegts_resync(s, raw_packet_size) < 0)
                 return AVERROR(EAGAIN);
             else
                 continue;
         } else {
-            skip = raw_packet_size - TS_PACKET_SIZE;
-            if (skip > 0)
-                url_fskip(pb, skip);
             break;
         }
     }
@@ -1276,9 +1327,12 @@ static int read_packet(AVFormatContext *s, uint8_t *buf, int raw_packet_size)
 static int handle_packets(MpegTSContext *ts, int nb_packets)
 {
     AVFormatContext *s = ts->stream;
-    uint8_t packet[TS_PACKET_SIZE];
+    uint8_t packet[TS_MAX_PACKET_SIZE];
+    const uint8_t *data;
     int packet_num, ret;
 
+    update_discard_pids(ts);
+
     ts->stop_parse = 0;
     packet_num = 0;
     for(;;) {
@@ -1287,10 +1341,12 @@ static int handle_packets(MpegTSContext *ts, int nb_packets)
         packet_num++;
         if (nb_packets != 0 && packet_num >= nb_packets)
             break;
-        ret = read_packet(s, packet, ts->raw_packet_size);
+        ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             return ret;
-        ret = handle_packet(ts, packet);
+        ret = handle_packet(ts, data);
+        if (ts->discard_pids_stale)
+            update_discard_pids(ts);
         if (ret != 0)
             return ret;
     }
@@ -1408,7 +1464,8 @@ static int mpegts_read_header(AVFormatContext *s,
         int pcr_pid, pid, nb_packets, nb_pcrs, ret, pcr_l;
         int64_t pcrs[2], pcr_h;
         int packet_count[2];
-        uint8_t packet[TS_PACKET_SIZE];
+        uint8_t packet[TS_MAX_PACKET_SIZE];
+        const uint8_t *data;
 
         /* only read packets */
 
@@ -1424,12 +1481,12 @@ static int mpegts_read_header(AVFormatContext *s,
         nb_pcrs = 0;
         nb_packets = 0;
         for(;;) {
-            ret = read_packet(s, packet, ts->raw_packet_size);
+            ret = read_packet(s, packet, ts->raw_packet_size, &data);
             if (ret < 0)
                 return -1;
-            pid = AV_RB16(packet + 1) & 0x1fff;
+            pid = AV_RB16(data + 1) & 0x1fff;
             if ((pcr_pid == -1 || pcr_pid == pid) &&
-                parse_pcr(&pcr_h, &pcr_l, packet) == 0) {
+                parse_pcr(&pcr_h, &pcr_l, data) == 0) {
                 pcr_pid = pid;
                 packet_count[nb_pcrs] = nb_packets;
                 pcrs[nb_pcrs] = pcr_h * 300 + pcr_l;
@@ -1469,15 +1526,18 @@ static int mpegts_raw_read_packet(AVFormatContext *s,
     int64_t pcr_h, next_pcr_h, pos;
     int pcr_l, next_pcr_l;
     uint8_t pcr_buf[12];
+    uint8_t packet[TS_MAX_PACKET_SIZE];
+    const uint8_t *data;
 
     if (av_new_packet(pkt, TS_PACKET_SIZE) < 0)
         return AVERROR(ENOMEM);
     pkt->pos= url_ftell(s->pb);
-    ret = read_packet(s, pkt->data, ts->raw_packet_size);
+    ret = read_packet(s, packet, ts->raw_packet_size, &data);
     if (ret < 0) {
         av_free_packet(pkt);
         return ret;
     }
+    memcpy(pkt->data, data, TS_PACKET_SIZE);
     if (ts->mpeg2ts_compute_pcr) {
         /* compute exact PCR for each packet */
         if (parse_pcr(&pcr_h, &pcr_l, pkt->data) == 0) {
@@ -1551,6 +1611,7 @@ static int mpegts_read_close(AVFormatContext *s)
     int i;
 
     clear_programs(ts);
+    av_freep(&ts->prg_discard);
 
     for(i=0;i<NB_PID_MAX;i++)
         if (ts->pids[i]) mpegts_close_filter(ts, ts->pids[i]);
@@ -1735,6 +1796,7 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
     len1 = len;
     ts->pkt = pkt;
     ts->stop_parse = 0;
+    update_discard_pids(ts);
     for(;;) {
         if (ts->stop_parse>0)
             break;
@@ -1745,6 +1807,8 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
             len--;
         } else {
             handle_packet(ts, buf);
+            if (ts->discard_pids_stale)
+                update_discard_pids(ts);
             buf += TS_PACKET_SIZE;
             len -= TS_PACKET_SIZE;
         }
@@ -1758,6 +1822,7 @@ void ff_mpegts_parse_close(MpegTSContext *ts)
 
     for(i=0;i<NB_PID_MAX;i++)
         av_free(ts->pids[i]);
+    av_free(ts->prg_discard);
     av_free(ts);
 }
 
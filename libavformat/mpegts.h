@@ -63,4 +63,11 @@ int ff_mpegts_parse_packet(MpegTSContext *ts, AVPacket *pkt,
                            const uint8_t *buf, int len);
 void ff_mpegts_parse_close(MpegTSContext *ts);
 
+/**
+ * Write out the data buffered by the MPEG-TS muxer s, and have the
+ * PAT and PMT repeated first thing afterwards. Used by muxers cutting
+ * the transport stream into segments written to different files.
+ */
+void ff_mpegts_end_segment(AVFormatContext *s);
+
 #endif /* AVFORMAT_MPEGTS_H */
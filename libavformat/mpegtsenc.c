@@ -19,6 +19,7 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "config.h"
 #include "libavutil/bswap.h"
 #include "libavutil/crc.h"
 #include "libavcodec/mpegvideo.h"
@@ -27,6 +28,13 @@
 #include "mpegts.h"
 #include "adts.h"
 
+#define TS_PACING (HAVE_PTHREADS && HAVE_CLOCK_GETTIME)
+
+#if TS_PACING
+#include <pthread.h>
+#include <time.h>
+#endif
+
 /* write DVB SI sections */
 
 /*********************************************/
@@ -62,8 +70,235 @@ typedef struct MpegTSWrite {
     int tsid;
     uint64_t cur_pcr;
     int mux_rate; ///< set to 1 when VBR
+    struct MpegTSPacer *pacer; ///< non-NULL when output is paced to the PCR
 } MpegTSWrite;
 
+#if TS_PACING
+/*********************************************/
+/* PCR paced output */
+
+/* TS packets per datagram, 1316 bytes fit the usual UDP payload */
+#define PACED_DGRAM_PACKETS 7
+/* queued datagrams, a bit more than one second at 10 Mbit/s */
+#define PACED_QUEUE_SIZE    1024
+/* lateness in microseconds after which the schedule is restarted */
+#define PACED_MAX_LATENESS  200000
+
+typedef struct PacedDatagram {
+    uint64_t pcr;   ///< scheduled departure of the first packet, 90 kHz
+    int nb_packets;
+    uint8_t data[PACED_DGRAM_PACKETS * TS_PACKET_SIZE];
+} PacedDatagram;
+
+/**
+ * The muxer fills the datagrams of a fixed ring, a sender thread writes
+ * each of them to the output when the monotonic clock reaches the time
+ * of its first packet.
+ * The sender thread writes through the output callback of the
+ * ByteIOContext but never touches its buffer or position, which the
+ * muxer thread advances when it queues the packets, so that url_ftell()
+ * and url_fsize() can still be called from the muxing thread.
+ */
+typedef struct MpegTSPacer {
+    AVFormatContext *s;
+    int (*write_packet)(void *opaque, uint8_t *buf, int buf_size);
+    void *opaque;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    PacedDatagram queue[PACED_QUEUE_SIZE];
+    unsigned int rd;        ///< next datagram to send
+    unsigned int wr;        ///< datagram being filled by the muxer
+    int eof;
+    int error;              ///< write error that stopped the sender thread
+
+    int64_t base_time;      ///< monotonic time base_pcr is sent at, in us
+    uint64_t base_pcr;
+
+    /* statistics, times in microseconds */
+    int64_t nb_sent;
+    int64_t late_sum;
+    int64_t late_max;
+    int underruns;
+} MpegTSPacer;
+
+static int64_t pacer_clock(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static void *pacer_thread(void *arg)
+{
+    MpegTSPacer *p = arg;
+    PacedDatagram *d;
+    int64_t now, target, late;
+    int ret;
+
+    for (;;) {
+        pthread_mutex_lock(&p->mutex);
+        while (p->rd == p->wr && !p->eof)
+            pthread_cond_wait(&p->cond, &p->mutex);
+        if (p->rd == p->wr) {
+            pthread_mutex_unlock(&p->mutex);
+            break;
+        }
+        d = &p->queue[p->rd % PACED_QUEUE_SIZE];
+        pthread_mutex_unlock(&p->mutex);
+
+        now = pacer_clock();
+        if (!p->nb_sent) {
+            p->base_time = now;
+            p->base_pcr  = d->pcr;
+        }
+        target = p->base_time + av_rescale(d->pcr - p->base_pcr, 1000000, 90000);
+        if (now - target > PACED_MAX_LATENESS) {
+            /* the muxer could not keep up, bursting would not help */
+            p->underruns++;
+            p->base_time = target = now;
+            p->base_pcr  = d->pcr;
+        } else if (target > now) {
+            struct timespec ts;
+            ts.tv_sec  =  (target - now) / 1000000;
+            ts.tv_nsec = ((target - now) % 1000000) * 1000;
+            while (nanosleep(&ts, &ts) < 0 && errno == EINTR);
+        }
+
+        ret = p->write_packet(p->opaque, d->data, d->nb_packets * TS_PACKET_SIZE);
+        if (ret < 0) {
+            /* the output is gone, the muxer picks the error up */
+            pthread_mutex_lock(&p->mutex);
+            p->error = ret;
+            pthread_cond_signal(&p->cond);
+            pthread_mutex_unlock(&p->mutex);
+            break;
+        }
+
+        late = FFMAX(pacer_clock() - target, 0);
+        p->late_sum += late;
+        p->late_max  = FFMAX(p->late_max, late);
+        p->nb_sent++;
+
+        pthread_mutex_lock(&p->mutex);
+        p->rd++;
+        pthread_cond_signal(&p->cond);
+        pthread_mutex_unlock(&p->mutex);
+    }
+    return NULL;
+}
+
+static int pacer_init(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    MpegTSPacer *p;
+
+    p = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    p->s            = s;
+    p->write_packet = s->pb->write_packet;
+    p->opaque       = s->pb->opaque;
+    pthread_mutex_init(&p->mutex, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    if (pthread_create(&p->thread, NULL, pacer_thread, p)) {
+        pthread_cond_destroy(&p->cond);
+        pthread_mutex_destroy(&p->mutex);
+        av_free(p);
+        return AVERROR(ENOMEM);
+    }
+    ts->pacer = p;
+    return 0;
+}
+
+/**
+ * @return the write error that stopped the sender thread, 0 if none
+ */
+static int pacer_error(MpegTSPacer *p)
+{
+    int ret;
+
+    pthread_mutex_lock(&p->mutex);
+    ret = p->error;
+    pthread_mutex_unlock(&p->mutex);
+    return ret;
+}
+
+static void pacer_write_packet(MpegTSPacer *p, const uint8_t *packet, uint64_t pcr)
+{
+    PacedDatagram *d = &p->queue[p->wr % PACED_QUEUE_SIZE];
+
+    if (!d->nb_packets) {
+        int error;
+        pthread_mutex_lock(&p->mutex);
+        while (p->wr - p->rd >= PACED_QUEUE_SIZE - 1 && !p->error)
+            pthread_cond_wait(&p->cond, &p->mutex);
+        error = p->error;
+        pthread_mutex_unlock(&p->mutex);
+        /* nobody is sending anymore, drop the packet */
+        if (error)
+            return;
+        d->pcr = pcr;
+    }
+    memcpy(d->data + d->nb_packets * TS_PACKET_SIZE, packet, TS_PACKET_SIZE);
+    p->s->pb->pos += TS_PACKET_SIZE;
+    if (++d->nb_packets == PACED_DGRAM_PACKETS) {
+        pthread_mutex_lock(&p->mutex);
+        p->wr++;
+        p->queue[p->wr % PACED_QUEUE_SIZE].nb_packets = 0;
+        pthread_cond_signal(&p->cond);
+        pthread_mutex_unlock(&p->mutex);
+    }
+}
+
+static int pacer_close(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    MpegTSPacer *p = ts->pacer;
+    int ret;
+
+    pthread_mutex_lock(&p->mutex);
+    if (p->queue[p->wr % PACED_QUEUE_SIZE].nb_packets)
+        p->wr++;
+    p->eof = 1;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->mutex);
+    pthread_join(p->thread, NULL);
+
+    av_log(s, AV_LOG_INFO, "paced %"PRId64" datagrams, lateness avg %"PRId64" us "
+           "max %"PRId64" us, %d underruns\n", p->nb_sent,
+           p->nb_sent ? p->late_sum / p->nb_sent : 0, p->late_max, p->underruns);
+
+    ret = p->error;
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->mutex);
+    av_freep(&ts->pacer);
+    return ret;
+}
+#endif
+
+static void mpegts_write_ts_packet(AVFormatContext *s, const uint8_t *packet)
+{
+#if TS_PACING
+    MpegTSWrite *ts = s->priv_data;
+
+    if (ts->pacer) {
+        pacer_write_packet(ts->pacer, packet, ts->cur_pcr);
+        return;
+    }
+#endif
+    put_buffer(s->pb, packet, TS_PACKET_SIZE);
+}
+
+static void mpegts_flush(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+
+    /* the sender thread flushes each datagram on its own */
+    if (!ts->pacer)
+        put_flush_packet(s->pb);
+}
+
 /* NOTE: 4 bytes must be left at the end for the crc32 */
 static void mpegts_write_section(MpegTSSection *s, uint8_t *buf, int len)
 {
@@ -382,7 +617,7 @@ static MpegTSService *mpegts_add_service(MpegTSWrite *ts,
 static void section_write_packet(MpegTSSection *s, const uint8_t *packet)
 {
     AVFormatContext *ctx = s->opaque;
-    put_buffer(ctx->pb, packet, TS_PACKET_SIZE);
+    mpegts_write_ts_packet(ctx, packet);
 }
 
 static int mpegts_write_header(AVFormatContext *s)
@@ -526,6 +761,17 @@ static int mpegts_write_header(AVFormatContext *s)
 
     put_flush_packet(s->pb);
 
+    if (s->flags & AVFMT_FLAG_PACED) {
+#if TS_PACING
+        if (ts->mux_rate == 1)
+            av_log(s, AV_LOG_WARNING, "paced output needs a constant muxrate, ignored\n");
+        else if (pacer_init(s) < 0)
+            return -1;
+#else
+        av_log(s, AV_LOG_WARNING, "paced output is not supported by this build\n");
+#endif
+    }
+
     return 0;
 
  fail:
@@ -569,7 +815,7 @@ static void mpegts_insert_null_packet(AVFormatContext *s)
     *q++ = 0xff;
     *q++ = 0x10;
     memset(q, 0x0FF, TS_PACKET_SIZE - (q - buf));
-    put_buffer(s->pb, buf, TS_PACKET_SIZE);
+    mpegts_write_ts_packet(s, buf);
     ts->cur_pcr += TS_PACKET_SIZE*8*90000LL/ts->mux_rate;
 }
 
@@ -601,7 +847,7 @@ static void mpegts_insert_pcr_only(AVFormatContext *s, AVStream *st)
 
     /* stuffing bytes */
     memset(q, 0xFF, TS_PACKET_SIZE - (q - buf));
-    put_buffer(s->pb, buf, TS_PACKET_SIZE);
+    mpegts_write_ts_packet(s, buf);
     ts->cur_pcr += TS_PACKET_SIZE*8*90000LL/ts->mux_rate;
 }
 
@@ -801,10 +1047,10 @@ static void mpegts_write_pes(AVFormatContext *s, AVStream *st,
         memcpy(buf + TS_PACKET_SIZE - len, payload, len);
         payload += len;
         payload_size -= len;
-        put_buffer(s->pb, buf, TS_PACKET_SIZE);
+        mpegts_write_ts_packet(s, buf);
         ts->cur_pcr += TS_PACKET_SIZE*8*90000LL/ts->mux_rate;
     }
-    put_flush_packet(s->pb);
+    mpegts_flush(s);
 }
 
 static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
@@ -817,6 +1063,15 @@ static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
     const uint64_t delay = av_rescale(s->max_delay, 90000, AV_TIME_BASE)*2;
     int64_t dts = AV_NOPTS_VALUE, pts = AV_NOPTS_VALUE;
 
+#if TS_PACING
+    {
+        MpegTSWrite *ts = s->priv_data;
+        int ret;
+        if (ts->pacer && (ret = pacer_error(ts->pacer)) < 0)
+            return ret;
+    }
+#endif
+
     if (pkt->pts != AV_NOPTS_VALUE)
         pts = pkt->pts + delay;
     if (pkt->dts != AV_NOPTS_VALUE)
@@ -909,13 +1164,35 @@ static int mpegts_write_packet(AVFormatContext *s, AVPacket *pkt)
     return 0;
 }
 
+void ff_mpegts_end_segment(AVFormatContext *s)
+{
+    MpegTSWrite *ts = s->priv_data;
+    int i;
+
+    for (i = 0; i < s->nb_streams; i++) {
+        AVStream *st = s->streams[i];
+        MpegTSWriteStream *ts_st = st->priv_data;
+        if (ts_st->payload_index > 0) {
+            mpegts_write_pes(s, st, ts_st->payload, ts_st->payload_index,
+                             ts_st->payload_pts, ts_st->payload_dts);
+            ts_st->payload_index = 0;
+        }
+    }
+    mpegts_flush(s);
+
+    /* start the next segment with the tables, so that it can be
+     * decoded on its own */
+    ts->sdt_packet_count = ts->sdt_packet_period - 1;
+    ts->pat_packet_count = ts->pat_packet_period - 1;
+}
+
 static int mpegts_write_end(AVFormatContext *s)
 {
     MpegTSWrite *ts = s->priv_data;
     MpegTSWriteStream *ts_st;
     MpegTSService *service;
     AVStream *st;
-    int i;
+    int i, ret = 0;
 
     /* flush current packets */
     for(i = 0; i < s->nb_streams; i++) {
@@ -927,6 +1204,10 @@ static int mpegts_write_end(AVFormatContext *s)
         }
         av_freep(&ts_st->adts);
     }
+#if TS_PACING
+    if (ts->pacer)
+        ret = pacer_close(s);
+#endif
     put_flush_packet(s->pb);
 
     for(i = 0; i < ts->nb_services; i++) {
@@ -937,7 +1218,7 @@ static int mpegts_write_end(AVFormatContext *s)
     }
     av_free(ts->services);
 
-    return 0;
+    return ret;
 }
 
 AVOutputFormat mpegts_muxer = {
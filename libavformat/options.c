@@ -50,6 +50,9 @@ static const AVOption options[]={
 {"noparse", "disable AVParsers, this needs nofillin too", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_NOPARSE, INT_MIN, INT_MAX, D, "fflags"},
 {"igndts", "ignore dts", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_IGNDTS, INT_MIN, INT_MAX, D, "fflags"},
 {"rtphint", "add rtp hinting", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_RTP_HINT, INT_MIN, INT_MAX, E, "fflags"},
+{"genidx", "generate keyframe index while reading", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_GENIDX, INT_MIN, INT_MAX, D, "fflags"},
+{"paced", "send the output at the pace of its timestamps", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_PACED, INT_MIN, INT_MAX, E, "fflags"},
+{"adaptive", "fetch only the variant fitting the measured throughput", 0, FF_OPT_TYPE_CONST, AVFMT_FLAG_ADAPTIVE, INT_MIN, INT_MAX, D, "fflags"},
 #if FF_API_OLD_METADATA
 {"track", " set the track number", OFFSET(track), FF_OPT_TYPE_INT, DEFAULT, 0, INT_MAX, E},
 {"year", "set the year", OFFSET(year), FF_OPT_TYPE_INT, DEFAULT, INT_MIN, INT_MAX, E},
@@ -61,6 +64,10 @@ static const AVOption options[]={
 {"fdebug", "print specific debug info", OFFSET(debug), FF_OPT_TYPE_FLAGS, DEFAULT, 0, INT_MAX, E|D, "fdebug"},
 {"ts", NULL, 0, FF_OPT_TYPE_CONST, FF_FDEBUG_TS, INT_MIN, INT_MAX, E|D, "fdebug"},
 {"max_delay", "maximum muxing or demuxing delay in microseconds", OFFSET(max_delay), FF_OPT_TYPE_INT, DEFAULT, 0, INT_MAX, E|D},
+{"indexfile", "preload the seek index from the given file", OFFSET(index_filename), FF_OPT_TYPE_STRING, DEFAULT, CHAR_MIN, CHAR_MAX, D},
+{"segment_time", "target segment duration in seconds", OFFSET(segment_time), FF_OPT_TYPE_INT, 10, 1, INT_MAX, E},
+{"segment_list_size", "maximum number of playlist entries, 0 for all", OFFSET(segment_list_size), FF_OPT_TYPE_INT, DEFAULT, 0, INT_MAX, E},
+{"segment_wrap", "number of segment files after which they are reused, 0 for never", OFFSET(segment_wrap), FF_OPT_TYPE_INT, DEFAULT, 0, INT_MAX, E},
 {NULL},
 };
 
@@ -28,6 +28,9 @@
 
 #define RTMP_HANDSHAKE_PACKET_SIZE 1536
 
+#define RTMP_DEFAULT_CHUNK_SIZE 128  ///< chunk size used until changed by a Set Chunk Size message
+#define RTMP_OUT_CHUNK_SIZE    4096  ///< chunk size requested for the messages sent when publishing
+
 /**
  * emulated Flash client version - 9.0.124.2 on Linux
  * @{
@@ -156,13 +156,26 @@ int ff_rtmp_packet_read(URLContext *h, RTMPPacket *p,
     return size;
 }
 
+static void rtmp_put_basic_header(uint8_t **p, int mode, int channel_id)
+{
+    if (channel_id < 64) {
+        bytestream_put_byte(p, channel_id | (mode << 6));
+    } else if (channel_id < 64 + 256) {
+        bytestream_put_byte(p, 0          | (mode << 6));
+        bytestream_put_byte(p, channel_id - 64);
+    } else {
+        bytestream_put_byte(p, 1          | (mode << 6));
+        bytestream_put_le16(p, channel_id - 64);
+    }
+}
+
 int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
                          int chunk_size, RTMPPacket *prev_pkt)
 {
-    uint8_t pkt_hdr[16], *p = pkt_hdr;
+    uint8_t pkt_hdr[16], *p = pkt_hdr, *buf, *q;
     int mode = RTMP_PS_TWELVEBYTES;
     int off = 0;
-    int size = 0;
+    int marker_size, nb_markers, size, ret;
 
     pkt->ts_delta = pkt->timestamp - prev_pkt[pkt->channel_id].timestamp;
 
@@ -179,15 +192,7 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
         }
     }
 
-    if (pkt->channel_id < 64) {
-        bytestream_put_byte(&p, pkt->channel_id | (mode << 6));
-    } else if (pkt->channel_id < 64 + 256) {
-        bytestream_put_byte(&p, 0               | (mode << 6));
-        bytestream_put_byte(&p, pkt->channel_id - 64);
-    } else {
-        bytestream_put_byte(&p, 1               | (mode << 6));
-        bytestream_put_le16(&p, pkt->channel_id - 64);
-    }
+    rtmp_put_basic_header(&p, mode, pkt->channel_id);
     if (mode != RTMP_PS_ONEBYTE) {
         uint32_t timestamp = pkt->timestamp;
         if (mode != RTMP_PS_TWELVEBYTES)
@@ -214,19 +219,46 @@ int ff_rtmp_packet_write(URLContext *h, RTMPPacket *pkt,
     }
     prev_pkt[pkt->channel_id].extra      = pkt->extra;
 
-    url_write(h, pkt_hdr, p-pkt_hdr);
-    size = p - pkt_hdr + pkt->data_size;
+    /* send the header and all the chunks in one write */
+    marker_size = pkt->channel_id < 64 ? 1 : pkt->channel_id < 64 + 256 ? 2 : 3;
+    nb_markers  = pkt->data_size > 0 ? (pkt->data_size - 1) / chunk_size : 0;
+    size = p - pkt_hdr + pkt->data_size + nb_markers * marker_size;
+    buf  = q = av_malloc(size);
+    if (!buf)
+        return AVERROR(ENOMEM);
+    bytestream_put_buffer(&q, pkt_hdr, p - pkt_hdr);
     while (off < pkt->data_size) {
         int towrite = FFMIN(chunk_size, pkt->data_size - off);
-        url_write(h, pkt->data + off, towrite);
+        bytestream_put_buffer(&q, pkt->data + off, towrite);
         off += towrite;
-        if (off < pkt->data_size) {
-            uint8_t marker = 0xC0 | pkt->channel_id;
-            url_write(h, &marker, 1);
-            size++;
-        }
+        if (off < pkt->data_size)
+            rtmp_put_basic_header(&q, RTMP_PS_ONEBYTE, pkt->channel_id);
     }
-    return size;
+    ret = url_write(h, buf, size);
+    av_free(buf);
+    return ret < 0 ? ret : size;
+}
+
+int ff_rtmp_aggregate_fix_timestamps(RTMPPacket *p)
+{
+    uint8_t *next = p->data, *end = p->data + p->data_size;
+    uint32_t first_ts = 0, ts;
+    int size;
+
+    /* each tag is followed by the size of the previous tag */
+    while (end - next >= 11) {
+        size = AV_RB24(next + 1);
+        if (size > end - next - 11)
+            return AVERROR_INVALIDDATA;
+        ts = AV_RB24(next + 4) | next[7] << 24;
+        if (next == p->data)
+            first_ts = ts;
+        ts = p->timestamp + ts - first_ts;
+        AV_WB24(next + 4, ts);
+        next[7] = ts >> 24;
+        next += 11 + size + 4;
+    }
+    return 0;
 }
 
 int ff_rtmp_packet_create(RTMPPacket *pkt, int channel_id, RTMPPacketType type,
@@ -352,7 +384,7 @@ static const char* rtmp_packet_type(int type)
     case RTMP_PT_NOTIFY:         return "notification";
     case RTMP_PT_SHARED_OBJ:     return "shared object";
     case RTMP_PT_INVOKE:         return "invoke";
-    case RTMP_PT_METADATA:       return "metadata";
+    case RTMP_PT_AGGREGATE:      return "aggregate";
     default:                     return "unknown";
     }
 }
@@ -437,7 +469,7 @@ void ff_rtmp_packet_dump(void *ctx, RTMPPacket *p)
         av_log(ctx, AV_LOG_DEBUG, "Server BW = %d\n", AV_RB32(p->data));
     } else if (p->type == RTMP_PT_CLIENT_BW){
         av_log(ctx, AV_LOG_DEBUG, "Client BW = %d\n", AV_RB32(p->data));
-    } else if (p->type != RTMP_PT_AUDIO && p->type != RTMP_PT_VIDEO && p->type != RTMP_PT_METADATA) {
+    } else if (p->type != RTMP_PT_AUDIO && p->type != RTMP_PT_VIDEO && p->type != RTMP_PT_AGGREGATE) {
         int i;
         for (i = 0; i < p->data_size; i++)
             av_log(ctx, AV_LOG_DEBUG, " %02X", p->data[i]);
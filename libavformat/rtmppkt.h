@@ -56,7 +56,7 @@ typedef enum RTMPPacketType {
     RTMP_PT_NOTIFY,             ///< some notification
     RTMP_PT_SHARED_OBJ,         ///< shared object
     RTMP_PT_INVOKE,             ///< invoke some stream action
-    RTMP_PT_METADATA     = 22,  ///< FLV metadata
+    RTMP_PT_AGGREGATE    = 22,  ///< aggregate message, a sequence of FLV tags
 } RTMPPacketType;
 
 /**
@@ -128,6 +128,16 @@ int ff_rtmp_packet_read(URLContext *h, RTMPPacket *p,
 int ff_rtmp_packet_write(URLContext *h, RTMPPacket *p,
                          int chunk_size, RTMPPacket *prev_pkt);
 
+/**
+ * Make the FLV tags of an aggregate message usable as they are: their
+ * timestamps, relative to the first tag, are rebased on the message
+ * timestamp.
+ *
+ * @param p aggregate message
+ * @return 0 on success, negative value if a tag overruns the message
+ */
+int ff_rtmp_aggregate_fix_timestamps(RTMPPacket *p);
+
 /**
  * Print information and contents of RTMP packet.
  *
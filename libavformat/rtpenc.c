@@ -22,6 +22,7 @@
 #include "avformat.h"
 #include "mpegts.h"
 #include "internal.h"
+#include "libavutil/intreadwrite.h"
 #include "libavutil/random_seed.h"
 
 #include "rtpenc.h"
@@ -102,6 +103,16 @@ static int rtp_write_header(AVFormatContext *s1)
     }
     s->max_payload_size = max_packet_size - 12;
 
+    s->batch_hd = ff_url_context(s1->pb);
+    if (s->batch_hd && s->batch_hd->prot->url_write_packets) {
+        s->queue = av_malloc(RTP_MAX_QUEUE * max_packet_size);
+        if (!s->queue) {
+            av_freep(&s->buf);
+            return AVERROR(ENOMEM);
+        }
+        s->queue_slot_size = max_packet_size;
+    }
+
     s->max_frames_per_packet = 0;
     if (s1->max_delay) {
         if (st->codec->codec_type == AVMEDIA_TYPE_AUDIO) {
@@ -185,12 +196,29 @@ defaultcase:
     return 0;
 }
 
+/* send the queued rtp packets */
+static void rtp_flush_queue(AVFormatContext *s1)
+{
+    RTPMuxContext *s = s1->priv_data;
+    int ret;
+
+    if (!s->nb_queued)
+        return;
+    if (!s1->pb->error) {
+        ret = url_write_packets(s->batch_hd, s->queue_pkts, s->nb_queued);
+        if (ret < 0)
+            s1->pb->error = ret;
+    }
+    s->nb_queued = 0;
+}
+
 /* send an rtcp sender report packet */
 static void rtcp_send_sr(AVFormatContext *s1, int64_t ntp_time)
 {
     RTPMuxContext *s = s1->priv_data;
     uint32_t rtp_ts;
 
+    rtp_flush_queue(s1);
     dprintf(s1, "RTCP: %02x %"PRIx64" %x\n", s->payload_type, ntp_time, s->timestamp);
 
     s->last_rtcp_ntp_time = ntp_time;
@@ -210,27 +238,60 @@ static void rtcp_send_sr(AVFormatContext *s1, int64_t ntp_time)
 
 /* send an rtp packet. sequence number is incremented, but the caller
    must update the timestamp itself */
-void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
+void ff_rtp_send_data_ref(AVFormatContext *s1, const uint8_t *hdr, int hdr_len,
+                          const uint8_t *buf1, int len, int m)
 {
     RTPMuxContext *s = s1->priv_data;
 
-    dprintf(s1, "rtp_send_data size=%d\n", len);
-
-    /* build the RTP header */
-    put_byte(s1->pb, (RTP_VERSION << 6));
-    put_byte(s1->pb, (s->payload_type & 0x7f) | ((m & 0x01) << 7));
-    put_be16(s1->pb, s->seq);
-    put_be32(s1->pb, s->timestamp);
-    put_be32(s1->pb, s->ssrc);
-
-    put_buffer(s1->pb, buf1, len);
-    put_flush_packet(s1->pb);
+    dprintf(s1, "rtp_send_data size=%d\n", hdr_len + len);
+
+    if (s->queue && 12 + hdr_len + len <= s->queue_slot_size &&
+        (!len || (buf1 >= s->pkt_data &&
+                  buf1 + len <= s->pkt_data + s->pkt_size))) {
+        uint8_t *p = s->queue + s->nb_queued * s->queue_slot_size;
+        URLPacket *pkt = &s->queue_pkts[s->nb_queued];
+
+        /* build the RTP header */
+        p[0] = RTP_VERSION << 6;
+        p[1] = (s->payload_type & 0x7f) | ((m & 0x01) << 7);
+        AV_WB16(p + 2, s->seq);
+        AV_WB32(p + 4, s->timestamp);
+        AV_WB32(p + 8, s->ssrc);
+
+        if (hdr_len)
+            memcpy(p + 12, hdr, hdr_len);
+        pkt->header      = p;
+        pkt->header_size = 12 + hdr_len;
+        pkt->data        = len ? s->pkt_data + (buf1 - s->pkt_data) : NULL;
+        pkt->size        = len;
+        if (++s->nb_queued == RTP_MAX_QUEUE)
+            rtp_flush_queue(s1);
+    } else {
+        rtp_flush_queue(s1);
+
+        /* build the RTP header */
+        put_byte(s1->pb, (RTP_VERSION << 6));
+        put_byte(s1->pb, (s->payload_type & 0x7f) | ((m & 0x01) << 7));
+        put_be16(s1->pb, s->seq);
+        put_be32(s1->pb, s->timestamp);
+        put_be32(s1->pb, s->ssrc);
+
+        put_buffer(s1->pb, hdr, hdr_len);
+        put_buffer(s1->pb, buf1, len);
+        put_flush_packet(s1->pb);
+    }
 
     s->seq++;
-    s->octet_count += len;
+    s->octet_count += hdr_len + len;
     s->packet_count++;
 }
 
+/* send an rtp packet whose payload is copied, so that buf1 can be reused */
+void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m)
+{
+    ff_rtp_send_data_ref(s1, buf1, len, NULL, 0, m);
+}
+
 /* send an integer number of samples and compute time stamp and fill
    the rtp send buffer before sending. */
 static void rtp_send_samples(AVFormatContext *s1,
@@ -325,7 +386,7 @@ static void rtp_send_raw(AVFormatContext *s1,
             len = size;
 
         s->timestamp = s->cur_timestamp;
-        ff_rtp_send_data(s1, buf1, len, (len == size));
+        ff_rtp_send_data_ref(s1, NULL, 0, buf1, len, (len == size));
 
         buf1 += len;
         size -= len;
@@ -374,6 +435,8 @@ static int rtp_write_packet(AVFormatContext *s1, AVPacket *pkt)
         s->first_packet = 0;
     }
     s->cur_timestamp = s->base_timestamp + pkt->pts;
+    s->pkt_data = pkt->data;
+    s->pkt_size = size;
 
     switch(st->codec->codec_id) {
     case CODEC_ID_PCM_MULAW:
@@ -431,6 +494,9 @@ static int rtp_write_packet(AVFormatContext *s1, AVPacket *pkt)
         rtp_send_raw(s1, pkt->data, size);
         break;
     }
+    rtp_flush_queue(s1);
+    s->pkt_data = NULL;
+    s->pkt_size = 0;
     return 0;
 }
 
@@ -438,7 +504,9 @@ static int rtp_write_trailer(AVFormatContext *s1)
 {
     RTPMuxContext *s = s1->priv_data;
 
+    rtp_flush_queue(s1);
     av_freep(&s->buf);
+    av_freep(&s->queue);
 
     return 0;
 }
@@ -24,6 +24,9 @@
 #include "avformat.h"
 #include "rtp.h"
 
+/** maximum number of RTP packets sent together */
+#define RTP_MAX_QUEUE 32
+
 struct RTPMuxContext {
     AVFormatContext *ic;
     AVStream *st;
@@ -56,12 +59,34 @@ struct RTPMuxContext {
      * (1, 2 or 4)
      */
     int nal_length_size;
+
+    /**
+     * Packets built by ff_rtp_send_data() and ff_rtp_send_data_ref(),
+     * sent with a single url_write_packets() call at the end of each
+     * AVPacket. Only used if the output protocol supports batched writes.
+     */
+    URLContext *batch_hd;
+    uint8_t *queue;             ///< RTP_MAX_QUEUE slots of queue_slot_size bytes
+    int queue_slot_size;        ///< maximum packet size of the output
+    URLPacket queue_pkts[RTP_MAX_QUEUE];
+    int nb_queued;
+    uint8_t *pkt_data;          ///< data of the AVPacket being sent, the only payload that is queued
+    int pkt_size;
 };
 
 typedef struct RTPMuxContext RTPMuxContext;
 
 void ff_rtp_send_data(AVFormatContext *s1, const uint8_t *buf1, int len, int m);
 
+/**
+ * Send an RTP packet made of a payload header and of payload data taken
+ * from the AVPacket being written. Unlike the header, the data is not
+ * copied when the packet is queued, it must stay valid until the end of
+ * the current write_packet call.
+ */
+void ff_rtp_send_data_ref(AVFormatContext *s1, const uint8_t *hdr, int hdr_len,
+                          const uint8_t *buf1, int len, int m);
+
 void ff_rtp_send_h264(AVFormatContext *s1, const uint8_t *buf1, int size);
 void ff_rtp_send_h263(AVFormatContext *s1, const uint8_t *buf1, int size);
 void ff_rtp_send_aac(AVFormatContext *s1, const uint8_t *buff, int size);
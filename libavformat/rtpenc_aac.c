@@ -67,17 +67,16 @@ void ff_rtp_send_aac(AVFormatContext *s1, const uint8_t *buff, int size)
         s->buf_ptr += size;
     } else {
         int au_size = size;
+        uint8_t hdr[4];
 
         max_packet_size = s->max_payload_size - 4;
-        p = s->buf;
-        p[0] = 0;
-        p[1] = 16;
+        hdr[0] = 0;
+        hdr[1] = 16;
+        hdr[2] = au_size >> 5;
+        hdr[3] = (au_size & 0x1F) << 3;
         while (size > 0) {
             len = FFMIN(size, max_packet_size);
-            p[2] = au_size >> 5;
-            p[3] = (au_size & 0x1F) << 3;
-            memcpy(p + 4, buff, len);
-            ff_rtp_send_data(s1, p, len + 4, len == size);
+            ff_rtp_send_data_ref(s1, hdr, 4, buff, len, len == size);
             size -= len;
             buff += len;
         }
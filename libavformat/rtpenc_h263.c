@@ -44,20 +44,19 @@ void ff_rtp_send_h263(AVFormatContext *s1, const uint8_t *buf1, int size)
 {
     RTPMuxContext *s = s1->priv_data;
     int len, max_packet_size;
-    uint8_t *q;
+    uint8_t hdr[2];
 
     max_packet_size = s->max_payload_size;
 
     while (size > 0) {
-        q = s->buf;
         if (size >= 2 && (buf1[0] == 0) && (buf1[1] == 0)) {
-            *q++ = 0x04;
+            hdr[0] = 0x04;
             buf1 += 2;
             size -= 2;
         } else {
-            *q++ = 0;
+            hdr[0] = 0;
         }
-        *q++ = 0;
+        hdr[1] = 0;
 
         len = FFMIN(max_packet_size - 2, size);
 
@@ -67,12 +66,9 @@ void ff_rtp_send_h263(AVFormatContext *s1, const uint8_t *buf1, int size)
             len = end - buf1;
         }
 
-        memcpy(q, buf1, len);
-        q += len;
-
         /* 90 KHz time stamp */
         s->timestamp = s->cur_timestamp;
-        ff_rtp_send_data(s1, s->buf, q - s->buf, (len == size));
+        ff_rtp_send_data_ref(s1, hdr, 2, buf1, len, (len == size));
 
         buf1 += len;
         size -= len;
@@ -35,28 +35,27 @@ static void nal_send(AVFormatContext *s1, const uint8_t *buf, int size, int last
 
     av_log(s1, AV_LOG_DEBUG, "Sending NAL %x of len %d M=%d\n", buf[0] & 0x1F, size, last);
     if (size <= s->max_payload_size) {
-        ff_rtp_send_data(s1, buf, size, last);
+        ff_rtp_send_data_ref(s1, NULL, 0, buf, size, last);
     } else {
         uint8_t type = buf[0] & 0x1F;
         uint8_t nri = buf[0] & 0x60;
+        uint8_t fu[2];
 
         av_log(s1, AV_LOG_DEBUG, "NAL size %d > %d\n", size, s->max_payload_size);
-        s->buf[0] = 28;        /* FU Indicator; Type = 28 ---> FU-A */
-        s->buf[0] |= nri;
-        s->buf[1] = type;
-        s->buf[1] |= 1 << 7;
+        fu[0] = 28;        /* FU Indicator; Type = 28 ---> FU-A */
+        fu[0] |= nri;
+        fu[1] = type;
+        fu[1] |= 1 << 7;
         buf += 1;
         size -= 1;
         while (size + 2 > s->max_payload_size) {
-            memcpy(&s->buf[2], buf, s->max_payload_size - 2);
-            ff_rtp_send_data(s1, s->buf, s->max_payload_size, 0);
+            ff_rtp_send_data_ref(s1, fu, 2, buf, s->max_payload_size - 2, 0);
             buf += s->max_payload_size - 2;
             size -= s->max_payload_size - 2;
-            s->buf[1] &= ~(1 << 7);
+            fu[1] &= ~(1 << 7);
         }
-        s->buf[1] |= 1 << 6;
-        memcpy(&s->buf[2], buf, size);
-        ff_rtp_send_data(s1, s->buf, size + 2, last);
+        fu[1] |= 1 << 6;
+        ff_rtp_send_data_ref(s1, fu, 2, buf, size, last);
     }
 }
 
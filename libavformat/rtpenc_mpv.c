@@ -21,6 +21,7 @@
  */
 
 #include "libavcodec/mpegvideo.h"
+#include "libavutil/intreadwrite.h"
 #include "avformat.h"
 #include "rtpenc.h"
 
@@ -30,7 +31,7 @@ void ff_rtp_send_mpegvideo(AVFormatContext *s1, const uint8_t *buf1, int size)
 {
     RTPMuxContext *s = s1->priv_data;
     int len, h, max_packet_size;
-    uint8_t *q;
+    uint8_t hdr[4];
     const uint8_t *end = buf1 + size;
     int begin_of_slice, end_of_slice, frame_type, temporal_reference;
 
@@ -96,18 +97,11 @@ void ff_rtp_send_mpegvideo(AVFormatContext *s1, const uint8_t *buf1, int size)
         h |= end_of_slice << 11;
         h |= frame_type << 8;
 
-        q = s->buf;
-        *q++ = h >> 24;
-        *q++ = h >> 16;
-        *q++ = h >> 8;
-        *q++ = h;
-
-        memcpy(q, buf1, len);
-        q += len;
+        AV_WB32(hdr, h);
 
         /* 90kHz time stamp */
         s->timestamp = s->cur_timestamp;
-        ff_rtp_send_data(s1, s->buf, q - s->buf, (len == size));
+        ff_rtp_send_data_ref(s1, hdr, 4, buf1, len, (len == size));
 
         buf1 += len;
         size -= len;
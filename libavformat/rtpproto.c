@@ -305,6 +305,34 @@ static int rtp_write(URLContext *h, const uint8_t *buf, int size)
     return ret;
 }
 
+#if HAVE_SENDMMSG
+static int is_rtcp_packet(const URLPacket *pkt)
+{
+    int type = pkt->header_size > 1 ? pkt->header[1] :
+                                      pkt->data[1 - pkt->header_size];
+    return type >= RTCP_SR && type <= RTCP_APP;
+}
+
+static int rtp_write_packets(URLContext *h, const URLPacket *pkts,
+                             int nb_packets)
+{
+    RTPContext *s = h->priv_data;
+    int i, n, rtcp, ret;
+
+    /* write each run of RTP or RTCP packets to its own connection */
+    for (i = 0; i < nb_packets; i += n) {
+        rtcp = is_rtcp_packet(&pkts[i]);
+        for (n = 1; i + n < nb_packets; n++)
+            if (is_rtcp_packet(&pkts[i + n]) != rtcp)
+                break;
+        ret = url_write_packets(rtcp ? s->rtcp_hd : s->rtp_hd, pkts + i, n);
+        if (ret < 0)
+            return ret;
+    }
+    return 0;
+}
+#endif
+
 static int rtp_close(URLContext *h)
 {
     RTPContext *s = h->priv_data;
@@ -358,4 +386,7 @@ URLProtocol rtp_protocol = {
     NULL, /* seek */
     rtp_close,
     .url_get_file_handle = rtp_get_file_handle,
+#if HAVE_SENDMMSG
+    .url_write_packets = rtp_write_packets,
+#endif
 };
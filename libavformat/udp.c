@@ -25,6 +25,7 @@
  */
 
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() with glibc */
 #define _DARWIN_C_SOURCE /* Needed for using IP_MULTICAST_TTL on OS X */
 #include "avformat.h"
 #include <unistd.h>
@@ -36,6 +37,11 @@
 #endif
 #include <sys/time.h>
 
+#define UDP_TX_BUF_SIZE 32768
+#define UDP_MAX_PKT_SIZE 65536
+#define UDP_BATCH_SIZE 32      ///< datagrams per recvmmsg() or sendmmsg() call
+#define UDP_RX_SLOT_SIZE 2048  ///< minimum room per datagram received ahead
+
 #ifndef IPV6_ADD_MEMBERSHIP
 #define IPV6_ADD_MEMBERSHIP IPV6_JOIN_GROUP
 #define IPV6_DROP_MEMBERSHIP IPV6_LEAVE_GROUP
@@ -51,11 +57,20 @@ typedef struct {
     struct sockaddr_storage dest_addr;
     int dest_addr_len;
     int is_connected;
+#if HAVE_RECVMMSG
+    /* datagrams received by one recvmmsg() call, returned by the next reads */
+    uint8_t *rx_buf;            ///< UDP_BATCH_SIZE slots of rx_slot_size bytes
+    int rx_slot_size;
+    struct mmsghdr rx_msgs[UDP_BATCH_SIZE];
+    struct iovec rx_iov[UDP_BATCH_SIZE];
+    int rx_count;               ///< number of datagrams in rx_msgs
+    int rx_pos;                 ///< index of the next datagram to return
+#endif
+#if HAVE_SENDMMSG
+    int no_sendmmsg;            ///< sendmmsg() is not supported by the kernel
+#endif
 } UDPContext;
 
-#define UDP_TX_BUF_SIZE 32768
-#define UDP_MAX_PKT_SIZE 65536
-
 static int udp_set_multicast_ttl(int sockfd, int mcastTTL,
                                  struct sockaddr *addr)
 {
@@ -285,6 +300,25 @@ int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+#if HAVE_RECVMMSG
+static int udp_alloc_rx_batch(UDPContext *s, int max_packet_size)
+{
+    int i;
+
+    s->rx_slot_size = FFMAX(max_packet_size, UDP_RX_SLOT_SIZE);
+    s->rx_buf = av_malloc(UDP_BATCH_SIZE * s->rx_slot_size);
+    if (!s->rx_buf)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < UDP_BATCH_SIZE; i++) {
+        s->rx_iov[i].iov_base = s->rx_buf + i * s->rx_slot_size;
+        s->rx_iov[i].iov_len  = s->rx_slot_size;
+        s->rx_msgs[i].msg_hdr.msg_iov    = &s->rx_iov[i];
+        s->rx_msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    return 0;
+}
+#endif
+
 /* put it in UDP context */
 /* return non zero if error */
 static int udp_open(URLContext *h, const char *uri, int flags)
@@ -396,6 +430,10 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         }
         /* make the socket non-blocking */
         ff_socket_nonblock(udp_fd, 1);
+#if HAVE_RECVMMSG
+        if (udp_alloc_rx_batch(s, h->max_packet_size) < 0)
+            goto fail;
+#endif
     }
     if (s->is_connected) {
         if (connect(udp_fd, (struct sockaddr *) &s->dest_addr, s->dest_addr_len)) {
@@ -409,10 +447,24 @@ static int udp_open(URLContext *h, const char *uri, int flags)
  fail:
     if (udp_fd >= 0)
         closesocket(udp_fd);
+#if HAVE_RECVMMSG
+    av_free(s->rx_buf);
+#endif
     av_free(s);
     return AVERROR(EIO);
 }
 
+#if HAVE_RECVMMSG
+static int udp_read_queued(UDPContext *s, uint8_t *buf, int size)
+{
+    int len = FFMIN(s->rx_msgs[s->rx_pos].msg_len, size);
+
+    memcpy(buf, s->rx_iov[s->rx_pos].iov_base, len);
+    s->rx_pos++;
+    return len;
+}
+#endif
+
 static int udp_read(URLContext *h, uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
@@ -420,10 +472,35 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
     fd_set rfds;
     int ret;
     struct timeval tv;
+#if HAVE_RECVMMSG
+    /* datagrams larger than a slot would be truncated, read them directly */
+    int batch = s->rx_buf && size <= s->rx_slot_size;
+
+    if (s->rx_pos < s->rx_count)
+        return udp_read_queued(s, buf, size);
+#endif
 
     for(;;) {
         if (url_interrupt_cb())
             return AVERROR(EINTR);
+#if HAVE_RECVMMSG
+        if (batch) {
+            /* the socket is non-blocking, wait only if nothing is pending */
+            ret = recvmmsg(s->udp_fd, s->rx_msgs, UDP_BATCH_SIZE, 0, NULL);
+            if (ret > 0) {
+                s->rx_count = ret;
+                s->rx_pos   = 0;
+                return udp_read_queued(s, buf, size);
+            }
+            if (ff_neterrno() == FF_NETERROR(ENOSYS)) {
+                av_freep(&s->rx_buf);
+                batch = 0;
+            } else if (ff_neterrno() != FF_NETERROR(EAGAIN) &&
+                       ff_neterrno() != FF_NETERROR(EINTR)) {
+                return AVERROR(EIO);
+            }
+        }
+#endif
         FD_ZERO(&rfds);
         FD_SET(s->udp_fd, &rfds);
         tv.tv_sec = 0;
@@ -436,6 +513,10 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
         }
         if (!(ret > 0 && FD_ISSET(s->udp_fd, &rfds)))
             continue;
+#if HAVE_RECVMMSG
+        if (batch)
+            continue;
+#endif
         len = recv(s->udp_fd, buf, size, 0);
         if (len < 0) {
             if (ff_neterrno() != FF_NETERROR(EAGAIN) &&
@@ -471,6 +552,68 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
     return size;
 }
 
+#if HAVE_SENDMMSG
+static int udp_write_packets(URLContext *h, const URLPacket *pkts,
+                             int nb_packets)
+{
+    UDPContext *s = h->priv_data;
+    struct mmsghdr msgs[UDP_BATCH_SIZE];
+    struct iovec iov[UDP_BATCH_SIZE][2];
+    int i, n, ret;
+
+    while (nb_packets > 0) {
+        n = FFMIN(nb_packets, UDP_BATCH_SIZE);
+        memset(msgs, 0, n * sizeof(*msgs));
+        for (i = 0; i < n; i++) {
+            struct msghdr *msg = &msgs[i].msg_hdr;
+
+            /* the header and the payload are gathered by the kernel */
+            msg->msg_iov = iov[i];
+            if (pkts[i].header_size) {
+                iov[i][msg->msg_iovlen].iov_base = pkts[i].header;
+                iov[i][msg->msg_iovlen].iov_len  = pkts[i].header_size;
+                msg->msg_iovlen++;
+            }
+            if (pkts[i].size) {
+                iov[i][msg->msg_iovlen].iov_base = pkts[i].data;
+                iov[i][msg->msg_iovlen].iov_len  = pkts[i].size;
+                msg->msg_iovlen++;
+            }
+            if (!s->is_connected) {
+                msg->msg_name    = &s->dest_addr;
+                msg->msg_namelen = s->dest_addr_len;
+            }
+        }
+
+        if (!s->no_sendmmsg) {
+            ret = sendmmsg(s->udp_fd, msgs, n, 0);
+            if (ret >= 0) {
+                /* a partial batch is continued by the next call */
+                pkts       += ret;
+                nb_packets -= ret;
+                continue;
+            }
+            if (ff_neterrno() == FF_NETERROR(EINTR) ||
+                ff_neterrno() == FF_NETERROR(EAGAIN))
+                continue;
+            if (ff_neterrno() != FF_NETERROR(ENOSYS))
+                return ff_neterrno();
+            s->no_sendmmsg = 1;
+        }
+        for (i = 0; i < n; i++) {
+            while (sendmsg(s->udp_fd, &msgs[i].msg_hdr, 0) < 0) {
+                if (ff_neterrno() != FF_NETERROR(EINTR) &&
+                    ff_neterrno() != FF_NETERROR(EAGAIN))
+                    return ff_neterrno();
+            }
+        }
+        pkts       += n;
+        nb_packets -= n;
+    }
+    return 0;
+}
+#endif
+
 static int udp_close(URLContext *h)
 {
     UDPContext *s = h->priv_data;
@@ -478,6 +621,9 @@ static int udp_close(URLContext *h)
     if (s->is_multicast && !(h->flags & URL_WRONLY))
         udp_leave_multicast_group(s->udp_fd, (struct sockaddr *)&s->dest_addr);
     closesocket(s->udp_fd);
+#if HAVE_RECVMMSG
+    av_free(s->rx_buf);
+#endif
     av_free(s);
     return 0;
 }
@@ -490,4 +636,7 @@ URLProtocol udp_protocol = {
     NULL, /* seek */
     udp_close,
     .url_get_file_handle = udp_get_file_handle,
+#if HAVE_SENDMMSG
+    .url_write_packets = udp_write_packets,
+#endif
 };
@@ -628,6 +628,10 @@ int av_open_input_file(AVFormatContext **ic_ptr, const char *filename,
     err = av_open_input_stream(ic_ptr, pb, filename, fmt, ap);
     if (err)
         goto fail;
+    if ((*ic_ptr)->index_filename &&
+        (err = av_read_index_file(*ic_ptr, (*ic_ptr)->index_filename)) < 0)
+        av_log(*ic_ptr, AV_LOG_WARNING, "Could not load index file %s\n",
+               (*ic_ptr)->index_filename);
     return 0;
  fail:
     av_freep(&pd->buf);
@@ -1071,7 +1075,7 @@ static int av_read_frame_internal(AVFormatContext *s, AVPacket *pkt)
                 *pkt = st->cur_pkt; st->cur_pkt.data= NULL;
                 compute_pkt_fields(s, st, NULL, pkt);
                 s->cur_st = NULL;
-                if ((s->iformat->flags & AVFMT_GENERIC_INDEX) &&
+                if ((s->iformat->flags & AVFMT_GENERIC_INDEX || s->flags & AVFMT_FLAG_GENIDX) &&
                     (pkt->flags & AV_PKT_FLAG_KEY) && pkt->dts != AV_NOPTS_VALUE) {
                     ff_reduce_index(s, st->index);
                     av_add_index_entry(st, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
@@ -1111,6 +1115,11 @@ static int av_read_frame_internal(AVFormatContext *s, AVPacket *pkt)
                         ff_reduce_index(s, st->index);
                         av_add_index_entry(st, st->parser->frame_offset, pkt->dts,
                                            0, 0, AVINDEX_KEYFRAME);
+                    }else if((s->flags & AVFMT_FLAG_GENIDX) && pkt->flags & AV_PKT_FLAG_KEY &&
+                             pkt->pos >= 0 && pkt->dts != AV_NOPTS_VALUE){
+                        /* the parser offset is not a file position for packetized input */
+                        ff_reduce_index(s, st->index);
+                        av_add_index_entry(st, pkt->pos, pkt->dts, 0, 0, AVINDEX_KEYFRAME);
                     }
 
                     break;
@@ -1723,6 +1732,23 @@ int av_seek_frame(AVFormatContext *s, int stream_index, int64_t timestamp, int f
         timestamp = av_rescale(timestamp, st->time_base.den, AV_TIME_BASE * (int64_t)st->time_base.num);
     }
 
+    /* a preloaded index file knows the exact position, no search needed;
+     * demuxers with their own read_seek() keep state that has to follow the
+     * seek, they get the loaded entries through st->index_entries instead */
+    ff_index_file_apply(s);
+    if (!s->iformat->read_seek && ff_index_file_stream_loaded(s, stream_index)) {
+        int index;
+        st = s->streams[stream_index];
+        index = av_index_search_timestamp(st, timestamp, flags);
+        if (index >= 0) {
+            AVIndexEntry *ie = &st->index_entries[index];
+            if ((ret = url_fseek(s->pb, ie->pos, SEEK_SET)) < 0)
+                return ret;
+            av_update_cur_dts(s, st, ie->timestamp);
+            return 0;
+        }
+    }
+
     /* first, we try the format specific seek */
     if (s->iformat->read_seek)
         ret = s->iformat->read_seek(s, stream_index, timestamp, flags);
@@ -1978,7 +2004,8 @@ static void av_estimate_timings(AVFormatContext *ic, int64_t old_offset)
 
     if ((!strcmp(ic->iformat->name, "mpeg") ||
          !strcmp(ic->iformat->name, "mpegts")) &&
-        file_size && !url_is_streamed(ic->pb)) {
+        file_size && !url_is_streamed(ic->pb) &&
+        !ff_index_file_has_timings(ic)) {
         /* get accurate estimate from the PTSes */
         av_estimate_timings_from_pts(ic, old_offset);
     } else if (av_has_duration(ic)) {
@@ -2401,6 +2428,7 @@ int av_find_stream_info(AVFormatContext *ic)
         }
     }
 
+    ff_index_file_apply(ic);
     av_estimate_timings(ic, old_offset);
 
     compute_chapters_end(ic);
@@ -2493,6 +2521,7 @@ void av_close_input_stream(AVFormatContext *s)
     av_freep(&s->programs);
     flush_packet_queue(s);
     av_freep(&s->priv_data);
+    ff_index_file_free(s);
     while(s->nb_chapters--) {
 #if FF_API_OLD_METADATA
         av_free(s->chapters[s->nb_chapters]->title);
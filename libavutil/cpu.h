@@ -44,6 +44,15 @@
  */
 int av_get_cpu_flags(void);
 
+/**
+ * Disable CPU detection and make av_get_cpu_flags() return the given flags.
+ * This is meant for testing the different code paths on one machine; the
+ * flags must not include extensions which the CPU does not support.
+ * Contexts initialized before the call keep the functions they selected.
+ * @param flags the flags to return, or -1 to detect the CPU again
+ */
+void av_force_cpu_flags(int flags);
+
 /* The following CPU-specific functions shall not be called directly. */
 int ff_get_cpu_flags_arm(void);
 int ff_get_cpu_flags_ppc(void);
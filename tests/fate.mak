@@ -316,6 +316,15 @@ FATE_TESTS += fate-v210
 fate-v210: CMD = framecrc  -i $(SAMPLES)/v210/v210_720p-partial.avi -pix_fmt yuv422p16be -an
 FATE_TESTS += fate-vc1
 fate-vc1: CMD = framecrc  -i $(SAMPLES)/vc1/SA00040.vc1
+FATE_TESTS += fate-vc1-threads-2
+fate-vc1-threads-2: CMD = framecrc  -threads 2 -i $(SAMPLES)/vc1/SA00040.vc1
+fate-vc1-threads-2: REF = $(SRC_PATH)/tests/ref/fate/vc1
+FATE_TESTS += fate-vc1-threads-3
+fate-vc1-threads-3: CMD = framecrc  -threads 3 -i $(SAMPLES)/vc1/SA00040.vc1
+fate-vc1-threads-3: REF = $(SRC_PATH)/tests/ref/fate/vc1
+FATE_TESTS += fate-vc1-threads-8
+fate-vc1-threads-8: CMD = framecrc  -threads 8 -i $(SAMPLES)/vc1/SA00040.vc1
+fate-vc1-threads-8: REF = $(SRC_PATH)/tests/ref/fate/vc1
 FATE_TESTS += fate-vcr1
 fate-vcr1: CMD = framecrc  -i $(SAMPLES)/vcr1/VCR1test.avi -an
 FATE_TESTS += fate-video-xl
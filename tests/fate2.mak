@@ -191,6 +191,18 @@ fate-txd-16bpp: CMD = framecrc -i $(SAMPLES)/txd/misc.txd -pix_fmt bgra -an
 FATE_TESTS += fate-vp3
 fate-vp3: CMD = framecrc -i $(SAMPLES)/vp3/vp31.avi
 
+FATE_TESTS += fate-vp3-threads-2
+fate-vp3-threads-2: CMD = framecrc -threads 2 -i $(SAMPLES)/vp3/vp31.avi
+fate-vp3-threads-2: REF = $(SRC_PATH)/tests/ref/fate/vp3
+
+FATE_TESTS += fate-vp3-threads-3
+fate-vp3-threads-3: CMD = framecrc -threads 3 -i $(SAMPLES)/vp3/vp31.avi
+fate-vp3-threads-3: REF = $(SRC_PATH)/tests/ref/fate/vp3
+
+FATE_TESTS += fate-vp3-threads-8
+fate-vp3-threads-8: CMD = framecrc -threads 8 -i $(SAMPLES)/vp3/vp31.avi
+fate-vp3-threads-8: REF = $(SRC_PATH)/tests/ref/fate/vp3
+
 FATE_TESTS += fate-fax-g3
 fate-fax-g3: CMD = framecrc -i $(SAMPLES)/CCITT_fax/G31D.TIF
 
@@ -212,3 +224,19 @@ fate-rv30: CMD = framecrc -flags +bitexact -dct fastint -idct simple -i $(SAMPLE
 FATE_TESTS += fate-sha
 fate-sha: libavutil/sha-test$(EXESUF)
 fate-sha: CMD = run libavutil/sha-test
+
+FATE_TESTS += fate-sbrdsp
+fate-sbrdsp: libavcodec/sbrdsp-test$(EXESUF)
+fate-sbrdsp: CMD = run libavcodec/sbrdsp-test
+
+FATE_TESTS += fate-v210dsp
+fate-v210dsp: libavcodec/v210dsp-test$(EXESUF)
+fate-v210dsp: CMD = run libavcodec/v210dsp-test
+
+FATE_TESTS += fate-put_bits
+fate-put_bits: libavcodec/put_bits-test$(EXESUF)
+fate-put_bits: CMD = run libavcodec/put_bits-test
+
+FATE_TESTS += fate-dsp
+fate-dsp: libavcodec/dsp-test$(EXESUF)
+fate-dsp: CMD = run libavcodec/dsp-test
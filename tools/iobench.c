@@ -0,0 +1,528 @@
+/*
+ * Protocol and demuxer I/O benchmark
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Time the demuxing of files over the file, http and udp protocols.
+ *
+ * Every input is read packet by packet with av_read_frame(), from the
+ * local file, from a loopback HTTP server serving the directory of the
+ * input and, for MPEG-TS inputs, from a loopback UDP sender. Nothing is
+ * decoded, so the numbers cover the protocol, ByteIOContext and demuxer
+ * layers only. For each combination the best of several runs is printed:
+ *  - MB/s: bytes read from the socket or file per second, from opening
+ *    the input to the last packet,
+ *  - syscalls/MB: calls into the file, tcp and udp protocols per MB; each
+ *    is one read, recv, write or seek system call, except for socket reads
+ *    which also wait in select() and UDP reads served from a recvmmsg()
+ *    batch,
+ *  - first packet: time from opening the input to the first packet.
+ *
+ * HLS inputs are given as their playlist; the segments must be in the
+ * same directory. Sample inputs can be made with e.g.
+ *   ffmpeg -i in -t 60 -vcodec mpeg2video -acodec mp2 bench.ts
+ *   ffmpeg -i bench.ts -vcodec copy -acodec copy bench.mp4
+ *   ffmpeg -i bench.ts -vcodec copy -acodec copy bench.mkv
+ *   ffmpeg -i bench.ts -vcodec copy -acodec copy -f applehttp hls/bench.m3u8
+ */
+
+#include "config.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>             /* getopt */
+#include <fcntl.h>
+#if HAVE_FORK
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#endif
+
+#include "libavutil/avstring.h"
+#include "libavformat/avformat.h"
+
+#define UDP_PACKET_SIZE  (7 * 188)
+#define UDP_BUFFER_SIZE  (8 << 20)
+#define UDP_IDLE_TIMEOUT 500000         ///< end of a UDP input, in microseconds
+
+/** Original callbacks of a protocol whose calls are counted. */
+typedef struct ProtocolHook {
+    URLProtocol *prot;
+    int     (*read) (URLContext *h, unsigned char *buf, int size);
+    int     (*write)(URLContext *h, const unsigned char *buf, int size);
+    int64_t (*seek) (URLContext *h, int64_t pos, int whence);
+} ProtocolHook;
+
+typedef struct Result {
+    int64_t bytes;
+    int64_t calls;
+    int64_t packets;
+    int64_t first_packet;               ///< microseconds after opening
+    int64_t time;                       ///< microseconds up to the last packet
+} Result;
+
+static ProtocolHook hooks[3];
+static int nb_hooks;
+static int64_t io_bytes, io_calls, io_last;
+static int udp_timeout;
+
+static ProtocolHook *find_hook(URLProtocol *prot)
+{
+    int i;
+
+    for (i = 0; i < nb_hooks; i++)
+        if (hooks[i].prot == prot)
+            return &hooks[i];
+    abort();
+}
+
+static int hook_read(URLContext *h, unsigned char *buf, int size)
+{
+    int ret = find_hook(h->prot)->read(h, buf, size);
+
+    io_calls++;
+    if (ret > 0) {
+        io_bytes += ret;
+        io_last   = av_gettime();
+    }
+    return ret;
+}
+
+static int hook_write(URLContext *h, const unsigned char *buf, int size)
+{
+    io_calls++;
+    return find_hook(h->prot)->write(h, buf, size);
+}
+
+static int64_t hook_seek(URLContext *h, int64_t pos, int whence)
+{
+    io_calls++;
+    return find_hook(h->prot)->seek(h, pos, whence);
+}
+
+/**
+ * Count the calls into the protocols which make system calls. The
+ * protocols layered on top of them, like http, are left alone so that
+ * nothing is counted twice.
+ */
+static void hook_protocols(void)
+{
+    static const char *const names[] = { "file", "tcp", "udp" };
+    URLProtocol *prot = NULL;
+    int i;
+
+    while ((prot = av_protocol_next(prot))) {
+        for (i = 0; i < FF_ARRAY_ELEMS(names); i++)
+            if (!strcmp(prot->name, names[i]))
+                break;
+        if (i == FF_ARRAY_ELEMS(names))
+            continue;
+        hooks[nb_hooks].prot  = prot;
+        hooks[nb_hooks].read  = prot->url_read;
+        hooks[nb_hooks].write = prot->url_write;
+        hooks[nb_hooks].seek  = prot->url_seek;
+        nb_hooks++;
+        if (prot->url_read)
+            prot->url_read  = hook_read;
+        if (prot->url_write)
+            prot->url_write = hook_write;
+        if (prot->url_seek)
+            prot->url_seek  = hook_seek;
+    }
+}
+
+/** UDP has no end of stream, stop reading once the sender has been quiet. */
+static int interrupt_cb(void)
+{
+    return udp_timeout && av_gettime() - io_last > UDP_IDLE_TIMEOUT;
+}
+
+static void read_packets(AVFormatContext *ic, int64_t start, Result *r)
+{
+    AVPacket pkt;
+
+    while (av_read_frame(ic, &pkt) >= 0) {
+        int64_t now = av_gettime();
+
+        if (!r->packets++)
+            r->first_packet = now - start;
+        r->time = now - start;
+        av_free_packet(&pkt);
+    }
+}
+
+static int bench_url(const char *url, Result *r)
+{
+    AVFormatContext *ic;
+    int64_t start;
+    int ret;
+
+    memset(r, 0, sizeof(*r));
+    io_bytes = io_calls = 0;
+    start = av_gettime();
+    if ((ret = av_open_input_file(&ic, url, NULL, 0, NULL)) < 0)
+        return ret;
+    read_packets(ic, start, r);
+    av_close_input_file(ic);
+    r->bytes = io_bytes;
+    r->calls = io_calls;
+    return 0;
+}
+
+#if HAVE_FORK
+static int write_all(int fd, const char *buf, int size)
+{
+    while (size > 0) {
+        int ret = write(fd, buf, size);
+        if (ret <= 0)
+            return -1;
+        buf  += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+/** Answer the GET requests of one keep-alive connection. */
+static void serve_http(int fd, const char *root)
+{
+    char req[4096], path[1024], filename[2048], buf[65536];
+    int len = 0;
+
+    req[0] = '\0';
+
+    for (;;) {
+        char *end, *p;
+        int64_t off = 0, size;
+        int file, ret, range, close_conn;
+
+        while (!(end = strstr(req, "\r\n\r\n"))) {
+            if (len == sizeof(req) - 1)
+                return;
+            ret = read(fd, req + len, sizeof(req) - 1 - len);
+            if (ret <= 0)
+                return;
+            len += ret;
+            req[len] = '\0';
+        }
+        *end = '\0';
+        if (sscanf(req, "GET %1023s", path) != 1)
+            return;
+        if ((p = strchr(path, '?')))
+            *p = '\0';
+        if ((p = strstr(req, "\r\nRange: bytes=")))
+            off = strtoll(p + 15, NULL, 10);
+        range      = !!p;
+        close_conn = !!strstr(req, "\r\nConnection: close");
+        /* requests are not pipelined, drop anything after the headers */
+        len = 0;
+        req[0] = '\0';
+
+        snprintf(filename, sizeof(filename), "%s%s", root, path);
+        if (strstr(path, "..") || (file = open(filename, O_RDONLY)) < 0) {
+            ret = snprintf(buf, sizeof(buf), "HTTP/1.1 404 Not Found\r\n"
+                           "Content-Length: 0\r\n\r\n");
+            if (write_all(fd, buf, ret) < 0)
+                return;
+            continue;
+        }
+        size = lseek(file, 0, SEEK_END);
+        off  = FFMIN(off, size);
+        lseek(file, off, SEEK_SET);
+        /* http only seeks in responses with a Content-Range */
+        if (range)
+            ret = snprintf(buf, sizeof(buf), "HTTP/1.1 206 Partial Content\r\n"
+                           "Content-Range: bytes %"PRId64"-%"PRId64"/%"PRId64"\r\n",
+                           off, size - 1, size);
+        else
+            ret = snprintf(buf, sizeof(buf), "HTTP/1.1 200 OK\r\n");
+        ret += snprintf(buf + ret, sizeof(buf) - ret,
+                        "Content-Type: application/octet-stream\r\n"
+                        "Content-Length: %"PRId64"\r\n%s\r\n", size - off,
+                        close_conn ? "Connection: close\r\n" : "");
+        if (write_all(fd, buf, ret) < 0) {
+            close(file);
+            return;
+        }
+        while ((ret = read(file, buf, sizeof(buf))) > 0)
+            if (write_all(fd, buf, ret) < 0)
+                break;
+        close(file);
+        if (ret || close_conn)
+            return;
+    }
+}
+
+/**
+ * Start an HTTP server on a loopback port serving the files below root,
+ * each connection is handled by its own process.
+ * @return the pid of the server, or -1 on error
+ */
+static pid_t start_http_server(const char *root, int *port)
+{
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    int fd, conn, one = 1;
+    pid_t pid;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if ((fd = socket(AF_INET, SOCK_STREAM, 0)) < 0)
+        return -1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(fd, 16) < 0 ||
+        getsockname(fd, (struct sockaddr *)&addr, &addrlen) < 0 ||
+        (pid = fork()) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (pid) {
+        close(fd);
+        *port = ntohs(addr.sin_port);
+        return pid;
+    }
+
+    signal(SIGCHLD, SIG_IGN);
+    for (;;) {
+        if ((conn = accept(fd, NULL, NULL)) < 0)
+            continue;
+        if (!fork()) {
+            close(fd);
+            /* responses are written as header and body, do not delay them */
+            setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            serve_http(conn, root);
+            _exit(0);
+        }
+        close(conn);
+    }
+}
+
+/**
+ * Send a file to a loopback UDP port in MPEG-TS sized datagrams.
+ * @param rate bytes per second, 0 for as fast as possible
+ */
+static pid_t start_udp_sender(const char *filename, int port, int64_t rate)
+{
+    struct sockaddr_in addr;
+    char buf[UDP_PACKET_SIZE];
+    int64_t start, sent = 0;
+    int fd, file, len;
+    pid_t pid;
+
+    if ((pid = fork()))
+        return pid;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family      = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port        = htons(port);
+    if ((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+        connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        (file = open(filename, O_RDONLY)) < 0)
+        _exit(1);
+    start = av_gettime();
+    while ((len = read(file, buf, sizeof(buf))) > 0) {
+        if (rate) {
+            int64_t wait = sent * 1000000 / rate - (av_gettime() - start);
+            if (wait > 0) {
+                struct timespec ts = { wait / 1000000, wait % 1000000 * 1000 };
+                nanosleep(&ts, NULL);
+            }
+        }
+        send(fd, buf, len, 0);
+        sent += len;
+    }
+    _exit(0);
+}
+
+static void stop_process(pid_t pid)
+{
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+}
+
+static int bench_http(const char *filename, Result *r)
+{
+    char root[1024], url[1024];
+    const char *name = strrchr(filename, '/');
+    int port, ret;
+    pid_t pid;
+
+    if (name) {
+        av_strlcpy(root, filename, FFMIN(sizeof(root), name - filename + 1));
+        name++;
+    } else {
+        av_strlcpy(root, ".", sizeof(root));
+        name = filename;
+    }
+    if ((pid = start_http_server(root, &port)) < 0)
+        return AVERROR(EIO);
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/%s", port, name);
+    ret = bench_url(url, r);
+    stop_process(pid);
+    return ret;
+}
+
+static int bench_udp(const char *filename, int64_t rate, Result *r)
+{
+    AVFormatContext *ic;
+    ByteIOContext *pb;
+    char url[128];
+    int64_t start;
+    int ret;
+    pid_t pid;
+
+    memset(r, 0, sizeof(*r));
+    io_bytes = io_calls = 0;
+    snprintf(url, sizeof(url), "udp://:0?buffer_size=%d", UDP_BUFFER_SIZE);
+    start = io_last = av_gettime();
+    if ((ret = url_fopen(&pb, url, URL_RDONLY)) < 0)
+        return ret;
+    /* the socket is bound now, the sender cannot get ahead of it */
+    pid = start_udp_sender(filename, udp_get_local_port(url_fileno(pb)), rate);
+    if (pid < 0) {
+        url_fclose(pb);
+        return AVERROR(EIO);
+    }
+    udp_timeout = 1;
+    ret = av_open_input_stream(&ic, pb, url, av_find_input_format("mpegts"), NULL);
+    if (ret >= 0) {
+        read_packets(ic, start, r);
+        av_close_input_stream(ic);
+        /* the last packets are only output after the idle timeout */
+        r->time = io_last - start;
+    }
+    udp_timeout = 0;
+    url_fclose(pb);
+    stop_process(pid);
+    r->bytes = io_bytes;
+    r->calls = io_calls;
+    return ret;
+}
+#endif /* HAVE_FORK */
+
+static void print_result(const char *filename, const char *format,
+                         const char *proto, int64_t size, const Result *r)
+{
+    double mb = r->bytes / 1048576.0;
+
+    printf("%-24.24s %-10.10s %-5s %9.1f %12.1f %13.2f %9"PRId64,
+           filename, format, proto, r->time ? mb * 1000000 / r->time : 0,
+           mb > 0 ? r->calls / mb : 0, r->first_packet / 1000.0, r->packets);
+    if (!strcmp(proto, "udp") && size > 0)
+        printf("  %.1f%% lost", 100.0 * FFMAX(size - r->bytes, 0) / size);
+    printf("\n");
+}
+
+static void usage(void)
+{
+    printf("usage: iobench [-n runs] [-r udp_rate] input...\n"
+           "Times demuxing the inputs over file, http and udp.\n"
+           "-n runs      number of runs of which the best is printed, default 3\n"
+           "-r udp_rate  UDP send rate in bytes per second, default unlimited\n");
+}
+
+int main(int argc, char **argv)
+{
+    int runs = 3, i, j, c;
+    int64_t udp_rate = 0;
+
+    while ((c = getopt(argc, argv, "hn:r:")) != -1) {
+        switch (c) {
+        case 'n':
+            runs = FFMAX(atoi(optarg), 1);
+            break;
+        case 'r':
+            udp_rate = strtoll(optarg, NULL, 10);
+            break;
+        default:
+            usage();
+            return c != 'h';
+        }
+    }
+    if (optind == argc) {
+        usage();
+        return 1;
+    }
+
+    av_register_all();
+    av_log_set_level(AV_LOG_ERROR);
+    hook_protocols();
+    url_set_interrupt_cb(interrupt_cb);
+#if HAVE_FORK
+    signal(SIGPIPE, SIG_IGN);
+#endif
+
+    printf("%-24s %-10s %-5s %9s %12s %13s %9s\n", "input", "format",
+           "proto", "MB/s", "syscalls/MB", "first pkt ms", "packets");
+    for (i = optind; i < argc; i++) {
+        static const char *const protos[] = { "file", "http", "udp" };
+        const char *filename = argv[i];
+        char format[32] = "?";
+        AVFormatContext *ic;
+        int64_t size = -1;
+        int p;
+
+        if (av_open_input_file(&ic, filename, NULL, 0, NULL) < 0) {
+            fprintf(stderr, "%s: cannot open\n", filename);
+            continue;
+        }
+        av_strlcpy(format, ic->iformat->name, sizeof(format));
+        if (ic->pb)
+            size = url_fsize(ic->pb);
+        av_close_input_file(ic);
+
+        for (p = 0; p < FF_ARRAY_ELEMS(protos); p++) {
+            Result best = { 0 }, r;
+            int ret = 0;
+
+            if (!strcmp(protos[p], "udp") && strcmp(format, "mpegts"))
+                continue;
+            for (j = 0; j < runs; j++) {
+                if (!strcmp(protos[p], "file"))
+                    ret = bench_url(filename, &r);
+#if HAVE_FORK
+                else if (!strcmp(protos[p], "http"))
+                    ret = bench_http(filename, &r);
+                else
+                    ret = bench_udp(filename, udp_rate, &r);
+#else
+                else
+                    ret = AVERROR(ENOSYS);
+#endif
+                if (ret < 0)
+                    break;
+                if (!j || r.time < best.time)
+                    best = r;
+            }
+            if (ret < 0)
+                printf("%-24.24s %-10.10s %-5s failed\n", filename, format, protos[p]);
+            else
+                print_result(filename, format, protos[p], size, &best);
+        }
+    }
+    return 0;
+}